@@ -0,0 +1,126 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measure how citer_group_fold() and citer_par_group_fold() scale with the
+ * number of threads, for 10, 10 thousand and 10 million distinct keys.
+ */
+
+/* Needed for clock_gettime() and sysconf() when compiling with -std=c99. */
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <citer.h>
+
+struct stats {
+    uint64_t count;
+    uint64_t sum;
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *identity(void *item, void *fn_data) {
+    return item;
+}
+
+static uint64_t hash_u64(void *key, void *fn_data) {
+    return citer_hash_u64(*(uint64_t *) key);
+}
+
+static bool eq_u64(void *key1, void *key2, void *fn_data) {
+    return *(uint64_t *) key1 == *(uint64_t *) key2;
+}
+
+static void add(void *acc, void *item, void *fn_data) {
+    struct stats *stats = (struct stats *) acc;
+    stats->count++;
+    stats->sum += *(uint64_t *) item;
+}
+
+static void merge(void *dst, void *src, void *fn_data) {
+    struct stats *d = (struct stats *) dst;
+    const struct stats *s = (const struct stats *) src;
+    d->count += s->count;
+    d->sum += s->sum;
+}
+
+/* Aggregate the keys, and return the time taken in seconds. */
+static double run(const uint64_t *keys, size_t n, size_t n_threads, size_t *n_groups) {
+    citer_group_ops_t ops = {
+        .key = identity,
+        .hash = hash_u64,
+        .eq = eq_u64,
+        .acc_size = sizeof(struct stats),
+        .acc = add,
+        .merge = merge,
+    };
+    double start = now();
+    iterator_t *src = citer_over_array((void *) keys, sizeof(*keys), n);
+    iterator_t *it = n_threads ? citer_par_group_fold(src, &ops, n_threads) : citer_group_fold(src, &ops);
+    double elapsed = now() - start;
+    *n_groups = it->size_bound.upper;
+    citer_free(it);
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [number of items]\n", argv[0]);
+        return 1;
+    }
+    size_t n = (argc == 2) ? strtoul(argv[1], NULL, 10) : 20000000;
+    long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_cpus < 1)
+        n_cpus = 1;
+
+    uint64_t *keys = malloc(n * sizeof(*keys));
+    size_t cardinalities[] = { 10, 10000, 10000000 };
+    uint64_t state = 1;
+    for (size_t c = 0; c < sizeof(cardinalities) / sizeof(*cardinalities); c++) {
+        for (size_t i = 0; i < n; i++) {
+            /* xorshift64, so that keys are spread over the table. */
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            keys[i] = state % cardinalities[c];
+        }
+
+        size_t n_groups;
+        double base = run(keys, n, 0, &n_groups);
+        printf("%zu items, %zu keys (%zu distinct)\n", n, cardinalities[c], n_groups);
+        printf("  group_fold            %8.3f s  %7.1f M items/s\n", base, n / base / 1e6);
+        for (size_t t = 1; t <= (size_t) n_cpus; t *= 2) {
+            double elapsed = run(keys, n, t, &n_groups);
+            printf("  par_group_fold %3zu thr %8.3f s  %7.1f M items/s  x%.2f\n",
+                   t, elapsed, n / elapsed / 1e6, base / elapsed);
+        }
+    }
+
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compare the throughput of citer_read_records() and
+ * citer_read_records_async() on a temporary file.
+ *
+ * The file is in the page cache after the first pass, so this mostly measures
+ * the cost of the reads themselves, and how well they overlap with the
+ * consumer. Drop the page cache between runs to measure disk reads.
+ */
+
+/* Needed for mkstemp() and clock_gettime() when compiling with -std=c99. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <citer.h>
+
+#define RECORD_SIZE 64
+#define BUFFER_BYTES (256 * 1024)
+#define QUEUE_DEPTH 4
+#define REPEATS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Some work per record, so that there is something to overlap reads with. */
+static uint64_t consume(iterator_t *it) {
+    uint64_t checksum = 0;
+    const uint64_t *record;
+    while ((record = citer_next(it))) {
+        for (size_t i = 0; i < RECORD_SIZE / sizeof(uint64_t); i++)
+            checksum = checksum * 31 + record[i];
+    }
+    citer_free(it);
+    return checksum;
+}
+
+static void bench(const char *name, int fd, size_t file_bytes, citer_io_engine_t engine) {
+    double best = 0;
+    uint64_t checksum = 0;
+    citer_io_engine_t used = engine;
+    for (int r = 0; r < REPEATS; r++) {
+        if (lseek(fd, 0, SEEK_SET) != 0) {
+            perror("lseek");
+            exit(1);
+        }
+        double start = now();
+        iterator_t *it;
+        if (engine == CITER_IO_SYNC) {
+            it = citer_read_records(fd, RECORD_SIZE, BUFFER_BYTES);
+        } else {
+            it = citer_read_records_async(fd, RECORD_SIZE, BUFFER_BYTES, QUEUE_DEPTH, engine);
+            used = citer_read_records_engine(it);
+        }
+        checksum = consume(it);
+        double elapsed = now() - start;
+        if (r == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    const char *used_name = (used == CITER_IO_URING) ? "io_uring" : (used == CITER_IO_THREAD) ? "thread" : "sync";
+    printf("%-8s (%-8s) %8.1f MiB/s  checksum %016llx\n", name, used_name,
+           file_bytes / best / (1 << 20), (unsigned long long) checksum);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [size in MiB]\n", argv[0]);
+        return 1;
+    }
+    size_t mib = (argc == 2) ? strtoul(argv[1], NULL, 10) : 256;
+    size_t file_bytes = mib << 20;
+
+    char path[] = "/tmp/citer_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    unlink(path);
+
+    uint64_t *block = malloc(1 << 20);
+    for (size_t i = 0; i < mib; i++) {
+        for (size_t j = 0; j < (1 << 20) / sizeof(uint64_t); j++)
+            block[j] = i * (1 << 20) + j;
+        if (write(fd, block, 1 << 20) != 1 << 20) {
+            perror("write");
+            return 1;
+        }
+    }
+    free(block);
+
+    printf("%zu MiB, %d byte records, %d KiB buffers, queue depth %d\n",
+           mib, RECORD_SIZE, BUFFER_BYTES / 1024, QUEUE_DEPTH);
+    bench("sync", fd, file_bytes, CITER_IO_SYNC);
+    bench("uring", fd, file_bytes, CITER_IO_URING);
+    bench("thread", fd, file_bytes, CITER_IO_THREAD);
+
+    close(fd);
+    return 0;
+}
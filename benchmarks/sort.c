@@ -0,0 +1,103 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compare citer_sorted_by_key_u64() with citer_sorted() using a comparison
+ * function, for random 64-bit keys and for timestamp-like keys (a few minutes
+ * of nanoseconds, mostly in order), at several sizes.
+ */
+
+/* Needed for clock_gettime() when compiling with -std=c99. */
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <citer.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int cmp_u64(void *item1, void *item2, void *extra_data) {
+    uint64_t x = *(uint64_t *) item1;
+    uint64_t y = *(uint64_t *) item2;
+    return (x > y) - (x < y);
+}
+
+static uint64_t key_u64(void *item, void *fn_data) {
+    return *(uint64_t *) item;
+}
+
+/* Sort the keys, and return the time taken in seconds. */
+static double run(const uint64_t *keys, size_t n, bool radix) {
+    double start = now();
+    iterator_t *src = citer_over_array((void *) keys, sizeof(*keys), n);
+    iterator_t *it = radix ? citer_sorted_by_key_u64(src, key_u64, NULL) : citer_sorted(src, cmp_u64, NULL);
+    double elapsed = now() - start;
+    /* Make sure the result is used. */
+    if (n > 0 && !citer_next(it))
+        abort();
+    citer_free(it);
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [largest number of items]\n", argv[0]);
+        return 1;
+    }
+    size_t max_n = (argc == 2) ? strtoul(argv[1], NULL, 10) : 10000000;
+
+    uint64_t *keys = malloc(max_n * sizeof(*keys));
+    const char *distributions[] = { "random", "timestamps" };
+    for (size_t n = 10000; n <= max_n; n *= 10) {
+        for (size_t d = 0; d < sizeof(distributions) / sizeof(*distributions); d++) {
+            uint64_t state = 1;
+            uint64_t t = 1700000000000000000u;
+            for (size_t i = 0; i < n; i++) {
+                /* xorshift64 */
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                if (d == 0) {
+                    keys[i] = state;
+                } else {
+                    /* Rising by about 10us per item, with some jitter. */
+                    t += state % 20000;
+                    keys[i] = t - state % 5000;
+                }
+            }
+
+            double base = run(keys, n, false);
+            double elapsed = run(keys, n, true);
+            printf("%zu items, %s keys\n", n, distributions[d]);
+            printf("  sorted             %8.3f s  %7.1f M items/s\n", base, n / base / 1e6);
+            printf("  sorted_by_key_u64  %8.3f s  %7.1f M items/s  x%.2f\n",
+                   elapsed, n / elapsed / 1e6, base / elapsed);
+        }
+    }
+
+    free(keys);
+    return 0;
+}
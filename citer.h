@@ -0,0 +1,2446 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_SIZE_H_
+#define _CITER_SIZE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A size bound for an iterator.
+ *
+ * The size bound is the bound on the number of items the iterator can produce.
+ *
+ * The bound can be exact or inexact. A bound is considered exact if and only if
+ * the upper and lower bounds are equal, and neither is infinite.
+ */
+typedef struct citer_size_bound {
+	size_t lower;
+	size_t upper;
+	bool lower_infinite: 1;
+    bool upper_infinite: 1;
+} citer_size_bound_t;
+
+/*
+ * A default size bound which is true for all iterators.
+ * Bound is [0, inf).
+ */
+#define CITER_DEFAULT_SIZE_BOUND \
+    ((citer_size_bound_t) { \
+        .lower = 0, \
+        .upper = 0, \
+        .lower_infinite = false, \
+        .upper_infinite = true, \
+    })
+
+/*
+ * Check if a size bound is exact.
+ *
+ * Returns 1 if the bound is exact, 0 otherwise.
+ */
+#define citer_bound_is_exact(bound) (((bound).lower == (bound).upper) && !(bound).lower_infinite && !(bound).upper_infinite)
+
+/*
+ * True if N is greater than the upper limit of this size bound.
+ */
+#define citer_gt_upper(bound, N) (!(bound).upper_infinite && ((N) > (bound).upper))
+
+/*
+ * True if N is greater than or equal to the upper limit of this size bound.
+ */
+#define citer_ge_upper(bound, N) (!(bound).upper_infinite && ((N) >= (bound).upper))
+
+/*
+ * True if N is less than the upper limit of this size bound.
+ */
+#define citer_lt_upper(bound, N) ((bound).upper_infinite || ((N) < (bound).upper))
+
+/*
+ * True if N is less than or equal to the upper limit of this size bound.
+ */
+#define citer_le_upper(bound, N) ((bound).upper_infinite || ((N) <= (bound).upper))
+
+/*
+ * True if N is greater than the lower limit of this size bound.
+ */
+#define citer_gt_lower(bound, N) (!(bound).lower_infinite && ((N) > (bound).lower))
+
+/*
+ * True if N is greater than or equal to the lower limit of this size bound.
+ */
+#define citer_ge_lower(bound, N) (!(bound).lower_infinite && ((N) >= (bound).lower))
+
+/*
+ * True if N is less than the lower limit of this size bound.
+ */
+#define citer_lt_lower(bound, N) ((bound).lower_infinite || ((N) < (bound).lower))
+
+/*
+ * True if N is less than or equal to the lower limit of this size bound.
+ */
+#define citer_le_lower(bound, N) ((bound).lower_infinite || ((N) <= (bound).lower))
+
+/*
+ * Subtract N from the lower and upper limits of the size bound.
+ */
+#define citer_bound_sub(bound, N) \
+    do { \
+        if (!(bound).lower_infinite) { \
+            if ((bound).lower > (N)) \
+                (bound).lower -= (N); \
+            else \
+                (bound).lower = 0; \
+        } \
+        if (!(bound).upper_infinite) { \
+            if ((bound).upper > (N)) \
+                (bound).upper -= (N); \
+            else \
+                (bound).upper = 0; \
+        } \
+    } while (0)
+
+/*
+ * Add N to the lower and upper limits of the size bound.
+ */
+#define citer_bound_add(bound, N) \
+    do { \
+        if (!(bound).lower_infinite) { \
+            if ((bound).lower > (SIZE_MAX - (N))) \
+                (bound).lower_infinite = true; \
+            else \
+                (bound).lower += (N); \
+        } \
+        if (!(bound).upper_infinite) { \
+            if ((bound).upper > (SIZE_MAX - (N))) \
+                (bound).upper_infinite = true; \
+            else \
+                (bound).upper += (N); \
+        } \
+    } while (0)
+
+#endif /* _CITER_SIZE_H_ */
+#ifndef _CITER_ITERATOR_H_
+#define _CITER_ITERATOR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/* Forward declaration for use in the function typedefs below. */
+typedef struct iterator_t iterator_t;
+
+/*
+ * Function type for getting the next item from an iterator.
+ * Used for both iterator_t::next() and iterator_t::next_back().
+ */
+typedef void *(*citer_next_fn)(iterator_t *);
+
+/*
+ * Function type for freeing an iterator's data.
+ * Used for iterator_t::free_data().
+ */
+typedef void (*citer_free_data_fn)(void *);
+
+/*
+ * Function type for splitting an iterator in two.
+ * Used for iterator_t::split().
+ */
+typedef iterator_t *(*citer_split_fn)(iterator_t *, size_t);
+
+/*
+ * Function type for skipping items of an iterator.
+ * Used for iterator_t::advance() and iterator_t::advance_back().
+ */
+typedef size_t (*citer_advance_fn)(iterator_t *, size_t);
+
+/*
+ * Iterator structure
+ *
+ * Fields:
+ *   data - Opaque data for this iterator_t
+ *   next - A method that takes a pointer to this iterator_t's data and returns
+ *          the next item.
+ *   next_back - A method that takes a pointer to this iterator_t's data and
+ *               returns the next item from the back of the iterator. This
+ *               field is NULL for iterators which are not double-ended.
+ *   free_data - A method that takes a pointer to this iterator_t's data and
+ *               frees (de-allocates) said data.
+ *   split - An optional method that splits this iterator at a given index in
+ *           O(1) time. See citer_split_at(). This field is NULL for iterators
+ *           which cannot be split, and is set to NULL by citer_new(), so
+ *           splittable iterators must set it after creation.
+ *   advance - An optional method that skips up to N items from the front in
+ *             less than O(N) time, returning the number of items skipped. See
+ *             citer_advance(). Set to NULL by citer_new().
+ *   advance_back - Like advance, but skips items from the back. Set to NULL by
+ *                  citer_new().
+ */
+struct iterator_t {
+	citer_size_bound_t size_bound;
+	void *data;
+	citer_next_fn next;
+	citer_next_fn next_back;
+	citer_free_data_fn free_data;
+	citer_split_fn split;
+	citer_advance_fn advance;
+	citer_advance_fn advance_back;
+};
+
+/*
+ * Create a new iterator.
+ */
+void *citer_new(
+	void *data,
+	citer_next_fn next,
+	citer_next_fn next_back,
+	citer_free_data_fn free_data,
+	citer_size_bound_t size_bound
+);
+
+/*
+ * Get the next item from an iterator.
+ */
+void *citer_next(iterator_t *);
+
+/*
+ * Get the next item from the back of a double-ended iterator.
+ */
+void *citer_next_back(iterator_t *);
+
+/*
+ * Get up to N items from an iterator at once.
+ *
+ * The items are stored in the array given as the second argument, which must
+ * have room for at least N items.
+ *
+ * Returns the number of items stored. A return value less than N means the
+ * iterator is exhausted.
+ */
+size_t citer_next_batch(iterator_t *, void **, size_t);
+
+/*
+ * Skip up to N items from the front of an iterator.
+ *
+ * Iterators which can skip items without producing them (e.g.
+ * citer_over_array() and citer_range_i64()) do so in O(1) time. Other
+ * iterators are advanced one item at a time.
+ *
+ * Returns the number of items skipped, which is less than N only if the
+ * iterator was exhausted.
+ */
+size_t citer_advance(iterator_t *, size_t);
+
+/*
+ * Skip up to N items from the back of a double-ended iterator.
+ *
+ * This is the same as citer_advance(), but for the back of the iterator.
+ * Returns 0 if the iterator is not double-ended.
+ */
+size_t citer_advance_back(iterator_t *, size_t);
+
+/*
+ * Split an iterator in two.
+ *
+ * After splitting, the iterator only yields its next N items, and the
+ * returned iterator yields the items after those, in the same order. If the
+ * iterator has fewer than N items left, the returned iterator is empty.
+ *
+ * This is only supported by iterators which can do it without consuming any
+ * items, e.g. citer_over_array(). It is mainly useful for dividing work
+ * between threads.
+ *
+ * Returns a new iterator which must be freed with citer_free(), or NULL if the
+ * iterator cannot be split. The two iterators are independent, and freeing one
+ * does not free the other.
+ */
+iterator_t *citer_split_at(iterator_t *, size_t);
+
+/*
+ * Check if an iterator can be split using citer_split_at().
+ */
+#define citer_is_splittable(it) (!!(it)->split)
+
+/*
+ * Free an iterator's data
+ */
+void citer_free_data(iterator_t *);
+
+/*
+ * Free a heap-allocated iterator.
+ */
+void citer_free(iterator_t *);
+
+/*
+ * Check if an iterator is double-ended.
+ *
+ * Returns 1 if the iterator is double-ended, 0 otherwise.
+ */
+#define citer_is_double_ended(it) (!!(it)->next_back)
+
+/*
+ * Count the number of items in an iterator.
+ *
+ * Only works for finite iterators. Will return SIZE_MAX for iterators which are
+ * guaranteed to be finite. Otherwise will result in an infinite loop.
+ *
+ * This function may consume the iterator, but will not free it.
+ */
+size_t citer_count(iterator_t *);
+
+/*
+ * Check if an iterator has an exact size.
+ * Returns 1 if the iterator has an exact known size and 0 otherwise.
+ */
+#define citer_has_exact_size(it) (citer_bound_is_exact((it)->size_bound))
+
+/*
+ * Whether an iterator is guaranteed to be finite.
+ *
+ * Returns 1 if and only if neither bound is infinite.
+ *
+ * It is possible for an iterator to be finite even when this macro returns 0.
+ * This macro checks whether an iterator is guaranteed to be finite, not whether
+ * it is possible.
+ */
+#define citer_is_finite(it) (!(it)->size_bound.lower_infinite && !(it)->size_bound.upper_infinite)
+
+/*
+ * Whether an iterator is guaranteed to be infinite.
+ *
+ * Returns 1 if and only if the iterator's lower size bound is infinite.
+ *
+ * It is possible for an iterator to return an infinite number of items even
+ * when this macro returns 0, because this macro checks whether it is guaranteed
+ * to be infinite, not whether it can be infinite.
+ */
+#define citer_is_infinite(it) (!!(it)->size_bound.lower_infinite)
+
+/*
+ * Check if an iterator has an exact size and is double-ended.
+ */
+#define CITER_HEDE(it) (citer_has_exact_size(it) && citer_is_double_ended(it))
+
+#endif /* _CITER_ITERATOR_H_ */
+#ifndef _CITER_ALL_H_
+#define _CITER_ALL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/*
+ * Predicate function type.
+ *
+ * Accepts an item as the first argument and returns a boolean.
+ * The second argument is implementation-defined extra data that can be passed
+ * to the predicate.
+ */
+typedef bool (*citer_predicate_t)(void *item, void *extra_data);
+
+/*
+ * Comparison function type.
+ *
+ * Accepts two items plus an extra data argument.
+ * The extra data argument is implementation-defined and can be used to pass
+ * additional data to the comparison function.
+ *
+ * Returns:
+ *   < 0 if the first item is less than the second item,
+ *   0 if the items are equal,
+ *   > 0 if the first item is greater than the second item.
+ */
+typedef int (*citer_cmp_fn_t)(void *item1, void *item2, void *extra_data);
+
+/*
+ * Returns true if all elements of the iterator satisfy the predicate.
+ *
+ * The third argument is extra data to pass to the predicate. This is
+ * user-defined and can be anything. It will not be touched by citer_all().
+ *
+ * This function only works for finite iterators. When the input iterator is
+ * guaranteed to be infinite, NULL is returned. When other infinite iterators
+ * are passed in, this function loops forever.
+ *
+ * This function exhausts the iterator, but does not free it.
+ */
+bool citer_all(iterator_t *, citer_predicate_t, void *);
+
+/*
+ * Returns true if any element of the iterator satisfies the predicate.
+ *
+ * The third argument is extra data to pass to the predicate. This is
+ * user-defined and can be anything. It will not be touched by citer_any().
+ */
+bool citer_any(iterator_t *, citer_predicate_t, void *);
+
+/*
+ * Returns the minimum item of the iterator.
+ *
+ * Uses the provided compare function to compare items.
+ * See citer_cmp_fn_t for more information.
+ *
+ * The third argument to this function is the extra data to be passed to the compare function.
+ *
+ * This function exhausts the iterator but does not free it.
+ *
+ * This function only works for finite iterators. When the input iterator is
+ * guaranteed to be infinite, NULL is returned. When other infinite iterators
+ * are passed in, this function loops forever.
+ */
+void *citer_min(iterator_t *it, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Returns the maximum item of the iterator.
+ *
+ * Uses the provided compare function to compare items.
+ * See citer_cmp_fn_t for more information.
+ *
+ * The third argument to this function is the extra data to be passed to the compare function.
+ *
+ * This function exhausts the iterator but does not free it.
+ *
+ * This function only works for finite iterators. When the input iterator is
+ * guaranteed to be infinite, NULL is returned. When other infinite iterators
+ * are passed in, this function loops forever.
+ */
+void *citer_max(iterator_t *it, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Returns the first itme of the iterator that satisfies the predicate.
+ * If no matching item is found, returns NULL.
+ *
+ * The third argument is extra data to pass to the predicate. This is
+ * user-defined and can be anything. It will not be touched by citer_find().
+ */
+void *citer_find(iterator_t *it, citer_predicate_t predicate, void *extra_data);
+
+/*
+ * Iterator which filters out elements that do not satisfy the predicate.
+ *
+ * Parameters:
+ * - iterator: The iterator to filter.
+ * - predicate: The predicate to apply. Will be called with an item as the
+ *              argument.
+ * - extra_data: Extra data to pass to the predicate.
+ *
+ * Returns a new iterator.
+ * This new iterator returns all the items of the original iterator for which
+ * the predicate returns true.
+ *
+ * The returned iterator must be freed with citer_free().
+ * When this iterator is freed, the original iterator is also freed.
+ */
+iterator_t *citer_filter(iterator_t *, citer_predicate_t, void *);
+
+#endif /* _CITER_ALL_H_ */
+#ifndef _CITER_REPEAT_H_
+#define _CITER_REPEAT_H_
+
+
+iterator_t *citer_repeat(void *);
+
+/*
+ * Create an iterator that yields a single item.
+ *
+ * Parameters:
+ *   item - The item to yield.
+ *
+ * The returned iterator must be freed after use with citer_free().
+ */
+iterator_t *citer_once(void *);
+
+/*
+ * Create an empty iterator.
+ *
+ * The returned iterator must be freed after use with citer_free().
+ */
+iterator_t *citer_empty(void);
+
+#endif /* _CITER_REPEAT_H_ */
+#ifndef _CITER_TAKE_H_
+#define _CITER_TAKE_H_
+
+#include <stddef.h>
+
+
+iterator_t *citer_take(iterator_t *, size_t);
+iterator_t *citer_skip(iterator_t *, size_t);
+void *citer_nth(iterator_t *, size_t);
+
+/*
+ * Get the nth item from the back end of a double-ended iterator.
+ *
+ * This function requires a double-ended iterator. If the iterator is not
+ * double-ended, it will return NULL.
+ */
+void *citer_nth_back(iterator_t *, size_t);
+
+/*
+ * Take elements from the iterator while the predicate is true.
+ *
+ * Similar to citer_filter(), but stops when the predicate returns false.
+ *
+ * The returned iterator must be freed with citer_free().
+ * When this iterator is freed, the original iterator is also freed.
+ */
+iterator_t *citer_take_while(iterator_t *, citer_predicate_t, void *);
+
+/*
+ * Skip elements from the iterator while the predicate is true.
+ *
+ * This is like citer_skip(), but uses a predicate to determine when to stop
+ * rather than a fixed number of elements.
+ *
+ * The returned iterator must be freed with citer_free(). When this iterator is
+ * freed, the original iterator is also freed.
+ */
+iterator_t *citer_skip_while(iterator_t *, citer_predicate_t, void *);
+
+#endif /* _CITER_TAKE_H_ */
+#ifndef _CITER_OVER_ARRAY_H_
+#define _CITER_OVER_ARRAY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/*
+ * A view of a run of consecutive items.
+ *
+ * If indirect is false, ptr points to len items of itemsize bytes each, laid
+ * out contiguously, e.g. a range of the array of an over_array iterator.
+ * If indirect is true, ptr is an array of len items of type (void *), i.e. the
+ * items exactly as an iterator returned them.
+ *
+ * Use citer_slice_get() to get the items of a slice without caring which
+ * representation is used.
+ */
+typedef struct citer_slice {
+    void *ptr;
+    size_t len;
+    size_t itemsize;
+    bool indirect;
+} citer_slice_t;
+
+/*
+ * Get the Ith item of a slice (given as a pointer to a citer_slice_t).
+ *
+ * The result is the same item an iterator over the slice's source would have
+ * returned, i.e. a pointer to the item for contiguous slices.
+ */
+#define citer_slice_get(slice, i) \
+    ((slice)->indirect \
+     ? ((void **) (slice)->ptr)[(i)] \
+     : (void *) (((char *) (slice)->ptr) + ((i) * (slice)->itemsize)))
+
+/*
+ * Iterator over an array.
+ *
+ * Parameters:
+ * - array: pointer to the first element of the array
+ * - itemsize: size (in bytes) of each item in the array
+ * - num_items: number of items in the array
+ *
+ * Returns an new iterator. This iterator's items are pointers to the items in
+ * the array.
+ *
+ * The returned iterator must be freed with citer_free() after use.
+ * Freeing the iterator does not free the array itself, only the iterator
+ * object. If the array itself needs to be freed, that must be done separately.
+ */
+iterator_t *citer_over_array(void *array, size_t itemsize, size_t num_items);
+
+/*
+ * Iterator over one field of an array of structs (or any other items spaced a
+ * fixed number of bytes apart).
+ *
+ * Parameters:
+ * - base: pointer to the first element of the array
+ * - offset: offset (in bytes) of the field within each element, e.g. as given
+ *           by offsetof()
+ * - stride: distance (in bytes) between consecutive elements, e.g. the size
+ *           of the struct
+ * - len: number of elements in the array
+ *
+ * Returns a new iterator. This iterator's items are pointers to the field in
+ * each element, i.e. base + offset + (i * stride) for the Ith item. It is
+ * exact-sized, double-ended and splittable.
+ *
+ * This avoids the extra stage (and indirect call per item) of mapping an
+ * over_array iterator to a field. Typed reductions (e.g. citer_sum_f64()) and
+ * citer_filter_cmp() recognise strided iterators (see citer_as_strided()) and
+ * read the fields directly.
+ *
+ * The returned iterator must be freed with citer_free() after use. Freeing the
+ * iterator does not free the array itself.
+ */
+iterator_t *citer_over_strided(void *base, size_t offset, size_t stride, size_t len);
+
+/*
+ * Get direct access to the remaining items of a contiguous iterator.
+ *
+ * If the iterator is an over_array iterator (which has not been reversed),
+ * stores a pointer to its next item in *array, the size of each item in
+ * *itemsize, and the number of remaining items in *len, then returns true.
+ * Otherwise returns false and leaves the output arguments untouched.
+ *
+ * The iterator is not advanced. Callers which process the items through the
+ * returned pointer should mark them as consumed using citer_array_advance().
+ *
+ * This is used by consumers which can process a whole array at once much
+ * faster than one item at a time, e.g. citer_sum_i64().
+ */
+bool citer_as_array(iterator_t *it, void **array, size_t *itemsize, size_t *len);
+
+/*
+ * Mark the first N remaining items of a contiguous iterator as consumed.
+ *
+ * Must only be called on iterators for which citer_as_array() or
+ * citer_as_strided() returns true.
+ * N is clamped to the number of remaining items.
+ */
+void citer_array_advance(iterator_t *it, size_t n);
+
+/*
+ * Get direct access to the remaining items of a strided iterator.
+ *
+ * If the iterator is an over_strided or over_array iterator (which has not been
+ * reversed), stores its next item in *first, the distance (in bytes) between
+ * consecutive items in *stride, and the number of remaining items in *len,
+ * then returns true. Otherwise returns false and leaves the output arguments
+ * untouched.
+ *
+ * The iterator is not advanced. Callers which process the items through the
+ * returned pointer should mark them as consumed using citer_array_advance().
+ */
+bool citer_as_strided(iterator_t *it, void **first, size_t *stride, size_t *len);
+
+#endif /* _CITER_OVER_ARRAY_H_ */
+#ifndef _CITER_RANGE_H_
+#define _CITER_RANGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ * Iterator over a range of 64-bit integers.
+ *
+ * Parameters:
+ *   start - The first value of the range.
+ *   end - The end of the range. This value itself is not included.
+ *   step - The difference between consecutive values. Must not be 0. For
+ *          citer_range_i64(), a negative step counts down from start to end.
+ *
+ * Each item is a pointer to the current value (an int64_t for
+ * citer_range_i64() and a uint64_t for citer_range_u64()). The values are not
+ * stored anywhere; they are computed when needed and written to a slot in the
+ * iterator's data. The front and back of the iterator use separate slots, so
+ * the pointer returned by citer_next() stays valid until the next call to
+ * citer_next() (and likewise for citer_next_back()), but not any longer.
+ *
+ * The returned iterator is exact-sized, double-ended and splittable, and can
+ * skip items (see citer_advance()) in O(1) time, so citer_nth(), citer_skip()
+ * and citer_nth_back() do not step through the skipped values. Values can be
+ * written to an array in bulk using citer_range_fill().
+ *
+ * Returns a new iterator, or NULL if step is 0. The returned iterator must be
+ * freed with citer_free() after use.
+ */
+iterator_t *citer_range_i64(int64_t start, int64_t end, int64_t step);
+iterator_t *citer_range_u64(uint64_t start, uint64_t end, uint64_t step);
+
+/*
+ * Write the next N values of a range iterator into an array.
+ *
+ * The array must have room for at least N values of the range's type, i.e. it
+ * should be an (int64_t *) for citer_range_i64() iterators and a (uint64_t *)
+ * for citer_range_u64() iterators. Reversed ranges are filled in reverse
+ * order. The iterator is advanced past the written values.
+ *
+ * Returns the number of values written, which is less than N only if the
+ * iterator was exhausted. Returns 0 if the iterator is not a range iterator.
+ */
+size_t citer_range_fill(iterator_t *it, void *out, size_t n);
+
+#endif /* _CITER_RANGE_H_ */
+#ifndef _CITER_CHAIN_H_
+#define _CITER_CHAIN_H_
+
+#include <stddef.h>
+
+
+iterator_t *citer_chain(iterator_t *, iterator_t *);
+
+#endif /* _CITER_CHAIN_H_ */
+#ifndef _CITER_MAP_H_
+#define _CITER_MAP_H_
+
+#include <stddef.h>
+
+
+typedef void *(*citer_map_fn_t)(void *item, void *fn_data);
+typedef iterator_t *(*citer_flat_map_fn_t)(void *item, void *fn_data);
+
+/*
+ * Accumulator function for citer_fold().
+ *
+ * The first argument is the data being accumulated. The type of this data is up
+ * to the user.
+ * The second argument is the current iterator item.
+ *
+ * Returns the new value of the accumulated data after processing the item.
+ */
+typedef void *(*citer_accumulator_fn_t)(void *data, void *item);
+
+/*
+ * Map each item of an iterator using a given function.
+ *
+ * Parameters:
+ *   orig - The source iterator to map.
+ *   fn - The function to apply to each item. This function should take two
+ *        arguments: the first is the item to be processed, and the second is
+ *        custom data which can be used by the function.
+ *   fn_data - Custom data to be passed as the second argument to the mapping
+ *             function. This data can be anything (or nothing); it is up to
+ *             the user.
+ *
+ * Returns a new iterator which yields the result of the mapping function for
+ * each input item. This iterator must be freed after use using citer_free().
+ * Freeing this iterator will free the source iterator as well, but not the
+ * fn_data argument.
+ */
+iterator_t *citer_map(iterator_t *orig, citer_map_fn_t fn, void *fn_data);
+
+#define citer_flat_map(it, fn) citer_flatten(citer_map((it), (fn)))
+
+/*
+ * Flatten an iterator over iterators.
+ *
+ * Takes an iterator whose items are of type (iterator_t *). Returns an iterator
+ * which yields the items of the each iterator in the input iterator.
+ *
+ * The returned iterator is heap-allocated and must be freed using citer_free().
+ * Freeing this iterator will free the original iterator as well.
+ */
+iterator_t *citer_flatten(iterator_t *);
+
+/*
+ * Process an iterator by applying an accumulator function to each item.
+ *
+ * The result of the accumulator function is passed as the first argument the
+ * next time it is called.
+ *
+ * The third argument to citer_fold() is the initial value for the accumulated
+ * data, i.e. what should be passed as the first argument to the accumulator on
+ * its first call.
+ *
+ * This function returns the value returned by the last call to the accumulator.
+ * The input iterator will be consumed but will not be freed.
+ */
+void *citer_fold(iterator_t *, citer_accumulator_fn_t, void *);
+
+#endif /* _CITER_MAP_H_ */
+#ifndef _CITER_ENUMERATE_H_
+#define _CITER_ENUMERATE_H_
+
+#include <stddef.h>
+
+
+typedef struct citer_enumerate_item {
+    size_t index;
+    void *item;
+} citer_enumerate_item_t;
+
+iterator_t *citer_enumerate(iterator_t *iter);
+
+#endif /* _CITER_ENUMERATE_H_ */
+#ifndef _CITER_CHUNKED_H_
+#define _CITER_CHUNKED_H_
+
+#include <stddef.h>
+
+
+/*
+ * Iterator over chunks of another iterator's items.
+ *
+ * Each chunk is returned as an array of items. If the chunksize does not divide
+ * the number of items in the source iterator, the last chunk may have some NULL
+ * elements.
+ *
+ * Each item is a heap-allocated array of type (void *[]) and must be freed by
+ * the caller.
+ *
+ * Parameters:
+ *   1. The source iterator to chunk.
+ *   2. The size of each chunk. Must be greater than 0.
+ *
+ * Returns a new iterator which must be freed with citer_free().
+ * Freeing this iterator also frees the source iterator.
+ */
+iterator_t *citer_chunked(iterator_t *, size_t);
+
+/*
+ * Iterator over chunks of another iterator's items, without allocating.
+ *
+ * Like citer_chunked(), but each item is a pointer to a citer_slice_t
+ * describing the chunk. The last chunk is shorter than the chunk size if the
+ * chunk size does not divide the number of items; its len field says how many
+ * items it holds.
+ *
+ * If the source is contiguous (see citer_as_array()), each slice points
+ * straight into the source's array. Otherwise, the items are gathered into a
+ * buffer owned by this iterator, which is reused for every chunk.
+ *
+ * The same slice structure (and buffer) is reused each time the iterator is
+ * advanced, so a chunk is only valid until the next call to citer_next() or
+ * citer_next_back(). Use citer_slice_get() to access the items of a chunk.
+ *
+ * Parameters:
+ *   1. The source iterator to chunk.
+ *   2. The size of each chunk. Must be greater than 0.
+ *
+ * Returns a new iterator which must be freed with citer_free(), or NULL if the
+ * chunk size is 0. Freeing this iterator also frees the source iterator.
+ */
+iterator_t *citer_chunks(iterator_t *, size_t);
+
+/*
+ * Iterator over overlapping windows of another iterator's items.
+ *
+ * Each item is a pointer to a citer_slice_t holding WIDTH consecutive items of
+ * the source, starting one item later than the previous window. A source of N
+ * items has N - WIDTH + 1 windows, or none if N < WIDTH.
+ *
+ * If the source is contiguous (see citer_as_array()), each slice points
+ * straight into the source's array, so advancing is O(1) and nothing is
+ * copied. Otherwise, the last WIDTH items are kept in a ring buffer owned by
+ * this iterator, laid out so that the window is still a contiguous array of
+ * item pointers.
+ *
+ * The same slice structure is reused each time the iterator is advanced, so a
+ * window is only valid until the next call to citer_next() or
+ * citer_next_back(). Use citer_slice_get() to access the items of a window.
+ *
+ * Like citer_chunked(), this iterator is double-ended if the source is
+ * double-ended and exact-sized.
+ *
+ * Parameters:
+ *   1. The source iterator.
+ *   2. The width of each window. Must be greater than 0.
+ *
+ * Returns a new iterator which must be freed with citer_free(), or NULL if the
+ * width is 0. Freeing this iterator also frees the source iterator.
+ */
+iterator_t *citer_windows(iterator_t *, size_t);
+
+#endif /* _CITER_CHUNKED_H_ */
+#ifndef _CITER_COLLECT_H_
+#define _CITER_COLLECT_H_
+
+
+/*
+ * Doubly-linked list node structure.
+ * Used for collecting items into a linked list.
+ */
+typedef struct citer_llnode {
+    void *item;
+    struct citer_llnode *prev;
+    struct citer_llnode *next;
+} citer_llnode_t;
+
+/*
+ * Collect items from an iterator into an array.
+ *
+ * Only call this function if you know the iterator is finite. Will return NULL
+ * for iterators which are guaranteed to be infinite. For others, it will just
+ * loop until running out of memory.
+ *
+ * The second argument to this function is a pointer to a size_t variable that
+ * will be set to the length of the returned array.
+ *
+ * The returned array will be dynamically allocated and must be freed after use,
+ * even if the array is empty (i.e. the returned length is 0). The only
+ * exception is if the iterator passed in is guaranteed to be infinite.
+ *
+ * This function will consume all items in the iterator, but will not free the
+ * iterator.
+ */
+void **citer_collect_into_array(iterator_t *, size_t *);
+
+/*
+ * Collect items from an iterator into a linked list.
+ *
+ * Only call this function if you know the iterator is finite. Will return NULL
+ * for iterators which are guaranteed to be infinite. For others, it will just
+ * loop until running out of memory.
+ *
+ * The second argument to this function is a pointer to the location at which to
+ * store the pointer to the tail node in the returned list. If this argument is
+ * NULL, it will not be set.
+ *
+ * Each node in the returned list will be dynamically allocated and must be
+ * freed after use.
+ *
+ * This function will consume all items in the iterator, but will not free the
+ * iterator.
+ */
+citer_llnode_t *citer_collect_into_linked_list(iterator_t *, citer_llnode_t **);
+
+#endif /* _CITER_COLLECT_H_ */
+#ifndef _CITER_INSPECT_H_
+#define _CITER_INSPECT_H_
+
+#include <stddef.h>
+
+
+typedef void (*citer_inspect_fn_t)(void *item, void *fn_data);
+
+/*
+ * Iterator which can be used to inspect a chain of iterators.
+ *
+ * Takes a function which will be called on each item of the iterator. The
+ * function does not affect the iterator chain. For that, use citer_map().
+ *
+ * Note: The inspect function will be called even when the item is NULL, so that
+ * should be checked before casting and using the item.
+ *
+ * The third argument is extra data which will be passed to the callback
+ * function. It can be any type and is up to the user to utilize.
+ *
+ * This is mainly useful for printing items at different steps of the iterator
+ * chain. See examples/inspect.c for an example.
+ */
+iterator_t *citer_inspect(iterator_t *, citer_inspect_fn_t, void *);
+
+#endif /* _CITER_INSPECT_H_ */
+#ifndef _CITER_ZIP_H_
+#define _CITER_ZIP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/*
+ * Represents a pair of items.
+ */
+typedef struct citer_pair {
+    void *x;
+    void *y;
+} citer_pair_t;
+
+/*
+ * Zips two iterators together.
+ * The resulting iterator will yield pairs of items from the input iterators.
+ * The item is a pointer to a citer_pair_t.
+ *
+ * The same pair structure will be reused each time the iterator is advanced, so
+ * pointers to it should not be saved without first being copied.
+ *
+ * The item from the first iterator is stored in the x field of the pair, and
+ * the item from the second iterator is stored in the y field.
+ *
+ * The zipped iterator will return NULL if either of the input iterators returns
+ * NULL.
+ *
+ * The returned iterator must be freed after use using citer_free().
+ * Freeing this iterator also frees the two input iterators.
+ */
+iterator_t *citer_zip(iterator_t *, iterator_t *);
+
+/*
+ * Represents a tuple of N items.
+ *
+ * The items field points to an array of len items.
+ */
+typedef struct citer_tuple {
+    void **items;
+    size_t len;
+} citer_tuple_t;
+
+/*
+ * Zips N iterators together.
+ *
+ * Like citer_zip(), but for any number of iterators. The resulting iterator
+ * yields pointers to a citer_tuple_t, whose Kth item comes from the Kth input
+ * iterator.
+ *
+ * The same tuple structure will be reused each time the iterator is advanced,
+ * so pointers to it should not be saved without first being copied.
+ *
+ * If all input iterators are contiguous (see citer_as_array()), they are
+ * advanced together with a single shared index, as with citer_zip_arrays().
+ *
+ * The array of iterators is copied, so it does not need to outlive the
+ * returned iterator, but the iterators themselves are owned by it.
+ *
+ * Returns a new iterator, or NULL if n is 0. The returned iterator must be
+ * freed after use using citer_free(). Freeing this iterator also frees the
+ * input iterators.
+ */
+iterator_t *citer_zip_n(iterator_t **its, size_t n);
+
+/*
+ * Zips N arrays together.
+ *
+ * Parameters:
+ *   bases - Pointers to the first item of each array.
+ *   itemsizes - The size (in bytes) of the items of each array.
+ *   n - The number of arrays.
+ *   len - The number of items to iterate over. Each array must have at least
+ *         this many items.
+ *
+ * The resulting iterator yields pointers to a citer_tuple_t, whose Kth item is
+ * a pointer to the current item of the Kth array. All arrays are advanced with
+ * a single shared index, so this is much cheaper than zipping N
+ * citer_over_array() iterators.
+ *
+ * The same tuple structure will be reused each time the iterator is advanced,
+ * so pointers to it should not be saved without first being copied.
+ *
+ * The returned iterator is exact-sized, double-ended and can be split using
+ * citer_split_at(). The bases and itemsizes arrays are copied, but the arrays
+ * they describe are not.
+ *
+ * Returns a new iterator, or NULL if n is 0. The returned iterator must be
+ * freed after use using citer_free().
+ */
+iterator_t *citer_zip_arrays(void **bases, size_t *itemsizes, size_t n, size_t len);
+
+/*
+ * Describes one column of a columnar (struct-of-arrays) table.
+ *
+ * The base field points to the first value of the column, and itemsize is the
+ * size (in bytes) of each value.
+ */
+typedef struct citer_column {
+    void *base;
+    size_t itemsize;
+} citer_column_t;
+
+/*
+ * Iterator over the rows of a columnar table.
+ *
+ * Parameters:
+ *   columns - Array of column descriptors.
+ *   n_columns - Number of columns.
+ *   n_rows - Number of rows. Each column must have at least this many values.
+ *   projection - Indices (into columns) of the columns to iterate over, or
+ *                NULL to iterate over all columns.
+ *   n_projected - Number of indices in projection. Ignored if projection is
+ *                 NULL.
+ *
+ * Each item is a pointer to a citer_tuple_t which serves as a view of the
+ * current row. Its Kth item points to the current value of the Kth projected
+ * column. Only the projected columns are touched, so projecting away unused
+ * columns keeps them out of the cache.
+ *
+ * The same tuple structure will be reused each time the iterator is advanced,
+ * so pointers to it should not be saved without first being copied.
+ *
+ * This is equivalent to citer_zip_arrays() over the projected columns, so the
+ * returned iterator is exact-sized, double-ended and splittable. Consumers
+ * which can process a whole column at once can get the remaining values of a
+ * column using citer_as_column().
+ *
+ * The columns and projection arrays are copied, but the columns themselves
+ * are not.
+ *
+ * Returns a new iterator, or NULL if there are no columns to iterate over or
+ * the projection names a column past the end of columns. The returned iterator
+ * must be freed after use using citer_free().
+ */
+iterator_t *citer_over_columns(const citer_column_t *columns, size_t n_columns, size_t n_rows, const size_t *projection, size_t n_projected);
+
+/*
+ * Get direct access to the remaining values of a column.
+ *
+ * If the iterator was created by citer_over_columns() or citer_zip_arrays()
+ * (or by citer_zip_n() over contiguous iterators) and has not been reversed,
+ * stores a pointer to the Kth column's value in the next row in *array, the
+ * size of each value in *itemsize, and the number of remaining rows in *len,
+ * then returns true. Otherwise returns false and leaves the output arguments
+ * untouched.
+ *
+ * The iterator is not advanced. The returned array can be passed to
+ * citer_over_array() to use column-aware consumers, e.g. to sum one column
+ * with citer_sum_f64() or filter it with citer_filter_cmp().
+ */
+bool citer_as_column(iterator_t *it, size_t k, void **array, size_t *itemsize, size_t *len);
+
+#endif /* _CITER_ZIP_H_ */
+#ifndef _CITER_REVERSE_H_
+#define _CITER_REVERSE_H_
+
+#include <stddef.h>
+
+
+/*
+ * Reverse a double-ended iterator.
+ *
+ * Returns a new iterator which iterates over the items of the input iterator in
+ * reverse.
+ *
+ * The input iterator must be double-ended. If it is not, this function will
+ * return NULL.
+ *
+ * This function literally swaps the next and next_back function pointers of the
+ * input iterator. Unlike other constructors, this function returns the input
+ * iterator, not a newly-allocated iterator.
+ */
+iterator_t *citer_reverse(iterator_t *);
+
+#endif /* _CITER_REVERSE_H_ */
+#ifndef _CITER_REDUCE_H_
+#define _CITER_REDUCE_H_
+
+#include <stdint.h>
+
+
+/*
+ * Typed reductions.
+ *
+ * These functions sum or multiply the items of an iterator whose items are
+ * pointers to numbers of the given type, e.g. citer_sum_i64() expects each item
+ * to be an (int64_t *). This is what citer_over_array() yields for an array of
+ * the corresponding type.
+ *
+ * When the iterator is contiguous (see citer_as_array()) and its item size
+ * matches the type, the whole remaining array is reduced at once using
+ * vectorised kernels, with the instruction set chosen at runtime. Otherwise,
+ * items are pulled from the iterator in batches and gathered into a buffer,
+ * which is then reduced using the same kernels. Strided iterators (see
+ * citer_over_strided()) are gathered into the buffer directly from the array,
+ * without going through the iterator.
+ *
+ * Integer sums of 32-bit types are accumulated in 64 bits. Integer overflow
+ * wraps around (modulo 2^64) instead of being undefined behaviour.
+ *
+ * Floating-point sums are accumulated in double precision using Kahan
+ * summation, so the result does not depend much on the order of the items.
+ *
+ * These functions only work for finite iterators. When the input iterator is
+ * guaranteed to be infinite, 0 is returned. When other infinite iterators are
+ * passed in, these functions loop forever.
+ *
+ * These functions exhaust the iterator, but do not free it.
+ */
+int64_t citer_sum_i32(iterator_t *);
+int64_t citer_sum_i64(iterator_t *);
+uint64_t citer_sum_u32(iterator_t *);
+uint64_t citer_sum_u64(iterator_t *);
+double citer_sum_f32(iterator_t *);
+double citer_sum_f64(iterator_t *);
+
+/*
+ * Typed products.
+ *
+ * Same as the typed sums above, but multiplies the items instead. The product
+ * of an empty iterator is 1.
+ */
+int64_t citer_product_i64(iterator_t *);
+uint64_t citer_product_u64(iterator_t *);
+double citer_product_f64(iterator_t *);
+
+#endif /* _CITER_REDUCE_H_ */
+#ifndef _CITER_FILTER_CMP_H_
+#define _CITER_FILTER_CMP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ * Numeric type of a field compared by a built-in predicate.
+ */
+typedef enum citer_num_type {
+    CITER_I32,
+    CITER_I64,
+    CITER_U32,
+    CITER_U64,
+    CITER_F32,
+    CITER_F64,
+} citer_num_type_t;
+
+/*
+ * Comparison operator of a built-in predicate.
+ *
+ * Each operator compares the field (x) against the predicate's value (a). The
+ * CITER_BETWEEN operator also uses the predicate's second value (b), and is
+ * true when a <= x < b.
+ */
+typedef enum citer_cmp_op {
+    CITER_LT,
+    CITER_LE,
+    CITER_GT,
+    CITER_GE,
+    CITER_EQ,
+    CITER_NE,
+    CITER_BETWEEN,
+} citer_cmp_op_t;
+
+/*
+ * Constant operand of a built-in predicate.
+ *
+ * Signed fields (CITER_I32, CITER_I64) are compared against the i member,
+ * unsigned fields against the u member, and floating-point fields against the
+ * f member.
+ */
+typedef union citer_num {
+    int64_t i;
+    uint64_t u;
+    double f;
+} citer_num_t;
+
+/*
+ * Built-in predicate descriptor.
+ *
+ * Describes a comparison on a numeric field of each item. Items are pointers
+ * to records, and the field is located offset bytes from the start of the
+ * record. For iterators over arrays of plain numbers, the offset is 0.
+ */
+typedef struct citer_cmp_pred {
+    size_t offset;
+    citer_num_type_t type;
+    citer_cmp_op_t op;
+    citer_num_t a;
+    citer_num_t b;
+} citer_cmp_pred_t;
+
+/*
+ * How multiple built-in predicates are combined.
+ */
+typedef enum citer_combine {
+    CITER_ALL_OF,
+    CITER_ANY_OF,
+} citer_combine_t;
+
+/*
+ * Evaluate a built-in predicate over a block of records.
+ *
+ * Parameters:
+ *   base - Pointer to the first record.
+ *   stride - Distance (in bytes) between consecutive records.
+ *   n - Number of records. Must be at most 64.
+ *   pred - The predicate to evaluate.
+ *
+ * Returns a bitmap in which bit i is set if and only if record i satisfies the
+ * predicate. Bitmaps of different predicates over the same block can be
+ * combined using bitwise AND and OR.
+ */
+uint64_t citer_cmp_eval(const void *base, size_t stride, size_t n, const citer_cmp_pred_t *pred);
+
+/*
+ * Iterator which filters out items that do not satisfy built-in predicates.
+ *
+ * Parameters:
+ *   orig - The iterator to filter. Its items must be pointers to records.
+ *   preds - Array of predicate descriptors. This array is copied, so it does
+ *           not need to outlive the iterator.
+ *   n_preds - Number of predicates. Must be greater than 0.
+ *   combine - Whether items must satisfy all predicates or any predicate.
+ *
+ * This behaves like citer_filter(), but does not call a function for each
+ * item. When the source is contiguous or strided (see citer_as_strided()),
+ * predicates are evaluated over blocks of 64 items at a time using vectorised
+ * comparisons, producing one bitmap per predicate. The bitmaps are combined,
+ * and the items are then yielded by walking the set bits.
+ *
+ * Returns a new iterator, or NULL if n_preds is 0.
+ * The returned iterator must be freed with citer_free().
+ * When this iterator is freed, the original iterator is also freed.
+ */
+iterator_t *citer_filter_cmp(iterator_t *orig, const citer_cmp_pred_t *preds, size_t n_preds, citer_combine_t combine);
+
+#endif /* _CITER_FILTER_CMP_H_ */
+#ifndef _CITER_ROLLING_H_
+#define _CITER_ROLLING_H_
+
+#include <stddef.h>
+
+
+/*
+ * Update function for citer_rolling().
+ *
+ * The first argument is the user's aggregation state. The second argument is
+ * the item entering (for the add function) or leaving (for the remove
+ * function) the window.
+ */
+typedef void (*citer_rolling_fn_t)(void *state, void *item);
+
+/*
+ * Generic rolling (windowed) aggregation.
+ *
+ * For every window of WIDTH consecutive items of the source, yields the state
+ * pointer after updating it incrementally: each item is passed to add_fn when
+ * it enters the window, and to remove_fn when it leaves the window. Each step
+ * therefore costs one add and at most one remove, regardless of the width.
+ *
+ * The last WIDTH items are remembered by this iterator, so the items
+ * returned by the source must stay valid while they are in the window.
+ * When the source is contiguous (see citer_as_array()), the items are read
+ * straight from its array and nothing is copied.
+ *
+ * A source of N items yields N - WIDTH + 1 states, or none if N < WIDTH.
+ *
+ * Parameters:
+ *   orig - The source iterator.
+ *   width - The width of each window. Must be greater than 0.
+ *   add_fn - Function called on each item entering the window.
+ *   remove_fn - Function called on each item leaving the window.
+ *   state - The aggregation state passed to add_fn and remove_fn. This is
+ *           also the item returned for each window.
+ *
+ * Returns a new iterator, or NULL if width is 0. This iterator must be freed
+ * after use using citer_free(). Freeing this iterator will free the source
+ * iterator as well, but not the state.
+ */
+iterator_t *citer_rolling(iterator_t *orig, size_t width, citer_rolling_fn_t add_fn, citer_rolling_fn_t remove_fn, void *state);
+
+/*
+ * Typed rolling aggregations.
+ *
+ * The source's items must be pointers to doubles, as yielded by
+ * citer_over_array() over an array of doubles. Each returned item is a pointer
+ * to a double holding the aggregate of the current window. The same double is
+ * reused each time the iterator is advanced.
+ *
+ * - citer_rolling_sum() keeps a Kahan-compensated running sum.
+ * - citer_rolling_mean() is the running sum divided by the width.
+ * - citer_rolling_var() keeps a running mean and sum of squared deviations,
+ *   and yields the sample variance (0 when the width is 1).
+ * - citer_rolling_min() and citer_rolling_max() use a monotonic deque, so
+ *   each item is pushed and popped at most once.
+ *
+ * For contiguous sources of doubles, values are read straight from the array,
+ * and the running sum is recomputed with the vectorised summation kernel once
+ * every WIDTH steps, which costs O(1) amortised and stops rounding errors from
+ * building up.
+ *
+ * A source of N items yields N - WIDTH + 1 aggregates, or none if N < WIDTH.
+ *
+ * These functions return NULL if the width is 0. The returned iterator must be
+ * freed after use using citer_free(). Freeing this iterator will free the
+ * source iterator as well.
+ */
+iterator_t *citer_rolling_sum(iterator_t *orig, size_t width);
+iterator_t *citer_rolling_mean(iterator_t *orig, size_t width);
+iterator_t *citer_rolling_var(iterator_t *orig, size_t width);
+iterator_t *citer_rolling_min(iterator_t *orig, size_t width);
+iterator_t *citer_rolling_max(iterator_t *orig, size_t width);
+
+#endif /* _CITER_ROLLING_H_ */
+#ifndef _CITER_LINES_H_
+#define _CITER_LINES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/*
+ * A view of one line of text.
+ *
+ * The ptr field points to the first character of the line, and len is its
+ * length in bytes, not including the line terminator. The line is not
+ * NUL-terminated.
+ */
+typedef struct citer_line {
+    const char *ptr;
+    size_t len;
+} citer_line_t;
+
+/*
+ * Iterator over the lines of a file, which is memory-mapped instead of read.
+ *
+ * Parameters:
+ *   path - Path of the file to read.
+ *
+ * Each item is a pointer to a citer_line_t which views the line in the mapped
+ * file, so no data is copied. Lines are terminated by '\n'. A '\r' before the
+ * '\n' is not removed. A final '\n' at the end of the file does not start
+ * another (empty) line.
+ *
+ * The text the views point to stays valid until the iterator is freed, but
+ * the citer_line_t structures themselves are reused: the one returned by
+ * citer_next() is overwritten by the next call to citer_next(), and likewise
+ * for citer_next_back().
+ *
+ * Newlines are found by comparing 64 bytes at a time with vectorised
+ * comparisons and walking the resulting bitmaps, in either direction. The
+ * iterator is double-ended, so the last lines of a file can be read using
+ * citer_reverse() without touching the rest of the file. The kernel is told
+ * that the mapping will be read sequentially (and asked to back it with huge
+ * pages where supported); this advice is dropped once lines are read from the
+ * back.
+ *
+ * The file must not be truncated while the iterator is in use.
+ *
+ * Without an index (see citer_mmap_lines_indexed()), the number of lines is
+ * not known in advance, and skipping lines means scanning them.
+ *
+ * Returns a new iterator, or NULL if the file cannot be opened or mapped, in
+ * which case errno is set. The returned iterator must be freed with
+ * citer_free(), which unmaps the file.
+ */
+iterator_t *citer_mmap_lines(const char *path);
+
+/*
+ * Sparse index of the lines of a file.
+ *
+ * The index records the total number of lines, and the offset of every
+ * 1024th line. Finding any line then only requires scanning from the nearest
+ * recorded line. The index is tied to the size and modification time of the
+ * file it was built from.
+ */
+typedef struct citer_line_index citer_line_index_t;
+
+/*
+ * Build a line index for a file.
+ *
+ * The file is memory-mapped and divided into byte ranges which are scanned in
+ * parallel, each by its own thread, in a single pass. N_THREADS is the maximum
+ * number of threads to use, or 0 to use one per online CPU. Small files use
+ * fewer threads.
+ *
+ * Returns a new index, or NULL if the file cannot be opened or mapped, in
+ * which case errno is set. The index must be freed with
+ * citer_line_index_free().
+ */
+citer_line_index_t *citer_line_index_build(const char *path, size_t n_threads);
+
+/*
+ * Save a line index to a file.
+ *
+ * The index is saved in the native byte order, so it can only be loaded on
+ * machines of the same architecture.
+ *
+ * Returns true on success, or false if the file cannot be written, in which
+ * case errno is set.
+ */
+bool citer_line_index_save(const citer_line_index_t *index, const char *index_path);
+
+/*
+ * Load a line index for the file at PATH, which was saved to INDEX_PATH.
+ *
+ * Returns a new index, or NULL if the index cannot be read, is corrupt, or is
+ * stale (i.e. the file's size or modification time has changed since the
+ * index was built). The index must be freed with citer_line_index_free().
+ */
+citer_line_index_t *citer_line_index_load(const char *path, const char *index_path);
+
+/*
+ * Get a line index for a file, using the saved index next to it if possible.
+ *
+ * Loads the index saved at PATH followed by ".lidx". If that is missing or
+ * stale, a new index is built (see citer_line_index_build()) and saved there.
+ * Failing to save the index is not an error.
+ *
+ * Returns a new index, or NULL if the file cannot be opened or mapped. The
+ * index must be freed with citer_line_index_free().
+ */
+citer_line_index_t *citer_line_index_open(const char *path, size_t n_threads);
+
+/*
+ * Get the number of lines in the file a line index was built from.
+ */
+size_t citer_line_index_count(const citer_line_index_t *index);
+
+/*
+ * Free a line index. Does nothing if index is NULL.
+ */
+void citer_line_index_free(citer_line_index_t *index);
+
+/*
+ * Iterator over the lines of a file, using a line index.
+ *
+ * This is the same as citer_mmap_lines(), but the iterator knows its exact
+ * size and can find any line quickly using the index. So it skips lines (see
+ * citer_advance(), citer_nth() and citer_skip()) from either end without
+ * scanning the skipped lines, and it can be split (see citer_split_at()) by
+ * line count, e.g. to divide a file between threads. The file is only mapped
+ * once, and is unmapped when the last of the split iterators is freed, which
+ * can happen on any thread.
+ *
+ * The index is not copied, so it must not be freed until this iterator and
+ * all iterators split off from it have been freed.
+ *
+ * The index must match the file: its size, modification time, and the number
+ * of lines after the index's last checkpoint (which are counted) are checked.
+ *
+ * Returns a new iterator, or NULL if the file cannot be opened or mapped, or
+ * if the index does not match the file (in which case errno is set to
+ * EINVAL). The returned iterator must be freed with citer_free().
+ */
+iterator_t *citer_mmap_lines_indexed(const char *path, const citer_line_index_t *index);
+
+#endif /* _CITER_LINES_H_ */
+#ifndef _CITER_CSV_H_
+#define _CITER_CSV_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/*
+ * Dialect of the text read by citer_csv().
+ *
+ * Fields are separated by the delimiter, and rows by '\n' (a '\r' before the
+ * '\n' is removed). A field which starts with the quote character extends to
+ * the next unescaped quote, and may contain delimiters and newlines. If the
+ * closing quote is missing, the field extends to the end of the text, less a
+ * final newline. A quote anywhere else in a field is an ordinary character.
+ *
+ * If the escape character is the quote character or '\0', quotes inside
+ * quoted fields are written as two quotes (as in RFC 4180). Otherwise, the
+ * escape character makes the next character literal, including delimiters,
+ * quotes and newlines, inside or outside quotes.
+ *
+ * A quote of '\0' disables quoting.
+ */
+typedef struct citer_csv_options {
+    char delimiter;
+    char quote;
+    char escape;
+} citer_csv_options_t;
+
+/* RFC 4180 CSV: comma-separated, with doubled quotes. */
+#define CITER_CSV_DEFAULT ((citer_csv_options_t) { ',', '"', '"' })
+
+/* Tab-separated values, without quoting. */
+#define CITER_TSV_DEFAULT ((citer_csv_options_t) { '\t', '\0', '\0' })
+
+/*
+ * A view of one field of a row.
+ *
+ * The ptr field points to the first character of the field in the parsed
+ * buffer, and len is its length in bytes. For quoted fields, the view does not
+ * include the surrounding quotes. If escaped is true, the field contains
+ * escape sequences (or doubled quotes), and must be passed through
+ * citer_csv_unescape() to get its value.
+ */
+typedef struct citer_csv_field {
+    const char *ptr;
+    size_t len;
+    bool escaped;
+} citer_csv_field_t;
+
+/*
+ * A view of one row.
+ *
+ * fields points to an array of n_fields field views.
+ */
+typedef struct citer_csv_row {
+    const citer_csv_field_t *fields;
+    size_t n_fields;
+} citer_csv_row_t;
+
+/*
+ * Iterator over the rows of CSV (or TSV, etc.) text in a buffer.
+ *
+ * Parameters:
+ *   buf - The text to parse. It must stay valid (and unchanged) while the
+ *         iterator and its rows are in use. It does not need to be
+ *         NUL-terminated, e.g. it can be a memory-mapped file.
+ *   len - Length of the text in bytes.
+ *   options - The dialect of the text. If NULL, CITER_CSV_DEFAULT is used.
+ *
+ * Each item is a pointer to a citer_csv_row_t which views the fields of the
+ * row in buf, so nothing is copied or allocated per field. The row and its
+ * array of fields are reused: they are overwritten by the next call to
+ * citer_next().
+ *
+ * An empty line is a row with one empty field. A final '\n' at the end of the
+ * text does not start another row. A quoted field which is not closed extends
+ * to the end of the text, less a final '\n' (and a '\r' before it).
+ *
+ * Delimiters, quotes and newlines are found 64 bytes at a time with vectorised
+ * comparisons. Quoted regions are found for a whole block at once from the
+ * bitmap of quotes, so the rest of the text is only looked at where fields
+ * start and end.
+ *
+ * Returns a new iterator, or NULL if the delimiter is '\n', the quote character
+ * or the escape character, or if the quote or escape character is '\n'. The
+ * returned iterator must be freed with citer_free().
+ */
+iterator_t *citer_csv(const char *buf, size_t len, const citer_csv_options_t *options);
+
+/*
+ * Get the value of a field, removing its escape sequences.
+ *
+ * Parameters:
+ *   field - The field to unescape.
+ *   out - Where to write the value. Must have room for field->len bytes. It
+ *         is not NUL-terminated.
+ *   options - The dialect given to citer_csv(), or NULL for
+ *             CITER_CSV_DEFAULT.
+ *
+ * Returns the length of the value in bytes.
+ */
+size_t citer_csv_unescape(const citer_csv_field_t *field, char *out, const citer_csv_options_t *options);
+
+#endif /* _CITER_CSV_H_ */
+#ifndef _CITER_IO_H_
+#define _CITER_IO_H_
+
+#include <stddef.h>
+
+
+/*
+ * Iterator over fixed-size records read from a file descriptor.
+ *
+ * Parameters:
+ *   fd - The file descriptor to read from, e.g. a file or a pipe. Reading
+ *        starts at its current offset. It is not closed by the iterator.
+ *   record_size - Size (in bytes) of each record. Must be greater than 0.
+ *   buffer_bytes - Size (in bytes) of each of the iterator's two buffers. Large
+ *                  buffers mean fewer, larger reads. Values smaller than
+ *                  record_size are rounded up to record_size.
+ *
+ * Each item is a pointer to a record inside one of the iterator's buffers.
+ * Records are not copied out of the buffers, except for records which straddle
+ * the end of a read, which are moved to the start of the next buffer.
+ *
+ * The iterator alternates between its two buffers, filling one while the
+ * records in the other stay untouched. So a record stays valid until at least
+ * buffer_bytes / record_size more records have been read, and consumers which
+ * hold on to a few records at a time (e.g. citer_chunked()) can use the
+ * pointers directly.
+ *
+ * If the file descriptor refers to a regular file, the iterator has an exact
+ * size, computed from the file's size and current offset, so that consumers
+ * like citer_collect_into_array() can preallocate. The file must not change
+ * size while it is being read. For other file descriptors, the size is not
+ * known in advance.
+ *
+ * Iteration stops at the end of the file, or when a read fails. A partial
+ * record at the end of the file is ignored. Use citer_read_records_error() to
+ * tell whether iteration stopped because of an error.
+ *
+ * Returns a new iterator, or NULL if record_size is 0. The returned iterator
+ * must be freed with citer_free().
+ */
+iterator_t *citer_read_records(int fd, size_t record_size, size_t buffer_bytes);
+
+/*
+ * Get the error which stopped a record iterator.
+ *
+ * Must only be called on iterators created by citer_read_records() or
+ * citer_read_records_async().
+ *
+ * Returns the errno value of the read which failed, or 0 if no read has
+ * failed (i.e. the iterator is not exhausted yet, or it reached the end of the
+ * file).
+ */
+int citer_read_records_error(iterator_t *it);
+
+/*
+ * How a record iterator reads its file descriptor.
+ */
+typedef enum citer_io_engine {
+    /* Use io_uring if possible, and fall back to CITER_IO_THREAD otherwise. */
+    CITER_IO_AUTO,
+    /* Reads are done by the consumer, as in citer_read_records(). */
+    CITER_IO_SYNC,
+    /* Several reads are kept in flight through io_uring. */
+    CITER_IO_URING,
+    /* A background thread reads ahead of the consumer. */
+    CITER_IO_THREAD,
+} citer_io_engine_t;
+
+/*
+ * Iterator over fixed-size records read ahead of the consumer from a file
+ * descriptor.
+ *
+ * Like citer_read_records(), but the next buffers are read in the background
+ * while the consumer goes through the current one, so that reading and
+ * processing overlap.
+ *
+ * Parameters:
+ *   fd - The file descriptor to read from. Reading starts at its current
+ *        offset. It is not closed by the iterator, and must not be used by
+ *        anything else until the iterator is freed.
+ *   record_size - Size (in bytes) of each record. Must be greater than 0.
+ *   buffer_bytes - Size (in bytes) of each buffer. It is rounded down to a
+ *                  multiple of record_size, and up to at least one record.
+ *   queue_depth - Number of buffers being read in the background at once. 0 is
+ *                 treated as 1.
+ *   engine - How to read the file descriptor. With CITER_IO_AUTO or
+ *            CITER_IO_URING, io_uring is used if the kernel supports it and fd
+ *            refers to a regular file. Otherwise, and with CITER_IO_THREAD, a
+ *            background thread does the reads. CITER_IO_SYNC is treated as
+ *            CITER_IO_AUTO.
+ *
+ * Each item is a pointer to a record inside one of the iterator's buffers. A
+ * record stays valid until at least buffer_bytes / record_size more records
+ * have been read.
+ *
+ * The size, end of iteration and errors are as in citer_read_records(). With
+ * io_uring, a regular file is read up to its size when the iterator is
+ * created.
+ *
+ * Returns a new iterator, or NULL if record_size is 0. The returned iterator
+ * must be freed with citer_free(), which waits for reads in flight.
+ */
+iterator_t *citer_read_records_async(int fd, size_t record_size, size_t buffer_bytes, size_t queue_depth, citer_io_engine_t engine);
+
+/*
+ * Get how a record iterator reads its file descriptor.
+ *
+ * Must only be called on iterators created by citer_read_records() or
+ * citer_read_records_async().
+ *
+ * Returns CITER_IO_SYNC for citer_read_records(), and CITER_IO_URING or
+ * CITER_IO_THREAD for citer_read_records_async().
+ */
+citer_io_engine_t citer_read_records_engine(iterator_t *it);
+
+/*
+ * Serialisation function for citer_write_all().
+ *
+ * Writes the serialised form of item into buf, if it fits in len bytes, like
+ * snprintf(). fn_data is the custom data given to citer_write_all().
+ *
+ * Returns the size (in bytes) of the serialised item, even if it is larger
+ * than len. The size must not change from one call to the next for the same
+ * item.
+ */
+typedef size_t (*citer_serialize_fn_t)(void *item, char *buf, size_t len, void *fn_data);
+
+/*
+ * Write all the items of an iterator to a file descriptor.
+ *
+ * Items are serialised into a large staging buffer, which is flushed when
+ * full, so that the items take few system calls to write. The buffer grows
+ * for items larger than it.
+ *
+ * Parameters:
+ *   it - The iterator to write. It is exhausted, but not freed.
+ *   fd - The file descriptor to write to. It is not closed.
+ *   serialize - Function which serialises an item into the buffer.
+ *   fn_data - Custom data to be passed as the last argument to serialize.
+ *   error - If not NULL, set to the errno value of the write which failed, or
+ *           0 if all writes succeeded.
+ *
+ * Partial writes (e.g. to pipes or sockets) are continued until all the bytes
+ * have been written. Writing stops at the first failed write, in which case
+ * items may have been taken from the iterator without being written.
+ *
+ * Returns the number of bytes written.
+ */
+size_t citer_write_all(iterator_t *it, int fd, citer_serialize_fn_t serialize, void *fn_data, int *error);
+
+/*
+ * Write fixed-size records to a file descriptor.
+ *
+ * Each item must point to a record of record_size bytes, which is written as
+ * is, e.g. the items of citer_read_records(). Arrays (see citer_as_strided())
+ * are written straight from their memory, with writev(), without iterating
+ * over them. Other records are copied into a staging buffer as they are
+ * taken, since the source may reuse a record's memory for later ones, and the
+ * buffer is written when full.
+ *
+ * The iterator is exhausted (but not freed), and partial writes and errors are
+ * handled as in citer_write_all().
+ *
+ * Returns the number of bytes written.
+ */
+size_t citer_write_records(iterator_t *it, int fd, size_t record_size, int *error);
+
+#endif /* _CITER_IO_H_ */
+#ifndef _CITER_HASH_H_
+#define _CITER_HASH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Hash function for hash-based adapters such as citer_distinct().
+ *
+ * The first argument is the item (or key) to hash, and the second is custom
+ * data given to the adapter. Items which compare equal must have the same
+ * hash. Any 64-bit value is allowed, but the better the bits are mixed, the
+ * fewer collisions; see citer_hash_u64() and citer_hash_bytes().
+ */
+typedef uint64_t (*citer_hash_fn_t)(void *item, void *fn_data);
+
+/*
+ * Equality function for hash-based adapters.
+ *
+ * Returns true if and only if the two items (or keys) are equal. The third
+ * argument is custom data given to the adapter.
+ */
+typedef bool (*citer_eq_fn_t)(void *item1, void *item2, void *fn_data);
+
+/*
+ * Hash a 64-bit integer, mixing all of its bits into all of the hash's bits.
+ */
+uint64_t citer_hash_u64(uint64_t x);
+
+/*
+ * Hash LEN bytes of memory.
+ */
+uint64_t citer_hash_bytes(const void *p, size_t len);
+
+#endif /* _CITER_HASH_H_ */
+#ifndef _CITER_DISTINCT_H_
+#define _CITER_DISTINCT_H_
+
+#include <stddef.h>
+
+
+/*
+ * Iterator which yields each distinct item of an iterator once, the first
+ * time it is seen.
+ *
+ * Parameters:
+ *   it - The source iterator.
+ *   hash - Hash function for the items.
+ *   eq - Equality function for the items.
+ *   fn_data - Custom data to be passed to hash and eq.
+ *
+ * The items seen so far are kept in an open-addressing hash table with linear
+ * probing. The items' hashes are kept in an array of their own, so a probe
+ * compares hashes in consecutive memory and only calls eq when they match.
+ * Items must stay valid while the iterator is in use. This is the case for
+ * arrays (citer_over_array()), but not for iterators which reuse their items,
+ * such as citer_mmap_lines(). The table is sized up front from the source's
+ * upper size bound, when it is finite, so that it doesn't have to grow while
+ * it fills up.
+ *
+ * The iterator is not double-ended, since the item yielded for a group of
+ * equal items is the first one.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees the source iterator as well, but not fn_data.
+ */
+iterator_t *citer_distinct(iterator_t *it, citer_hash_fn_t hash, citer_eq_fn_t eq, void *fn_data);
+
+/*
+ * Function which maps an item to an index in a small integer domain, for
+ * citer_distinct_bitmap().
+ */
+typedef size_t (*citer_index_fn_t)(void *item, void *fn_data);
+
+/*
+ * Iterator which yields each distinct item of an iterator once, for items with
+ * a small integer domain.
+ *
+ * Parameters:
+ *   it - The source iterator.
+ *   index - Function which maps each item to an integer. Items are equal if
+ *           and only if they map to the same integer.
+ *   domain_size - Size of the domain: integers are less than this.
+ *   fn_data - Custom data to be passed to index.
+ *
+ * The integers seen so far are marked in a bitmap of domain_size bits, which
+ * takes no hashing, probing or comparisons, and does not keep hold of the
+ * items. Items whose integer is not in the domain are always yielded.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees the source iterator as well, but not fn_data.
+ */
+iterator_t *citer_distinct_bitmap(iterator_t *it, citer_index_fn_t index, size_t domain_size, void *fn_data);
+
+#endif /* _CITER_DISTINCT_H_ */
+#ifndef _CITER_GROUP_H_
+#define _CITER_GROUP_H_
+
+#include <stddef.h>
+
+
+/*
+ * Function which gets the key of an item, for citer_group_fold().
+ *
+ * Returns a pointer to the key, e.g. to a field of the item.
+ */
+typedef void *(*citer_key_fn_t)(void *item, void *fn_data);
+
+/*
+ * Function which initialises the accumulator of a new group. The accumulator
+ * is zeroed before it is called.
+ */
+typedef void (*citer_group_init_fn_t)(void *acc, void *key, void *fn_data);
+
+/*
+ * Function which adds an item to the accumulator of its group.
+ */
+typedef void (*citer_group_acc_fn_t)(void *acc, void *item, void *fn_data);
+
+/*
+ * Function which merges the accumulator src into the accumulator dst of the
+ * same group, for citer_par_group_fold().
+ */
+typedef void (*citer_group_merge_fn_t)(void *dst, void *src, void *fn_data);
+
+/*
+ * Description of a per-key aggregation.
+ *
+ * Fields:
+ *   key - Gets the key of an item.
+ *   hash - Hash function for keys.
+ *   eq - Equality function for keys.
+ *   key_size - If not 0, keys are key_size bytes long and are copied into the
+ *              table, so items (and keys) only need to stay valid until they
+ *              are aggregated. If 0, only pointers to the keys are kept, and
+ *              the keys must stay valid while the result is in use.
+ *   acc_size - Size (in bytes) of each accumulator. Accumulators are stored
+ *              inline in the table, aligned to 8 bytes.
+ *   init - Initialises the accumulator of a new group. May be NULL, in which
+ *          case accumulators start zeroed.
+ *   acc - Adds an item to the accumulator of its group.
+ *   merge - Merges two accumulators of the same group. Only needed by
+ *           citer_par_group_fold().
+ *   fn_data - Custom data to be passed to all the functions.
+ *   partitions - If greater than 1, the number of partitions to aggregate
+ *                separately (see citer_group_fold()). Rounded up to a power of
+ *                two.
+ */
+typedef struct citer_group_ops {
+    citer_key_fn_t key;
+    citer_hash_fn_t hash;
+    citer_eq_fn_t eq;
+    size_t key_size;
+    size_t acc_size;
+    citer_group_init_fn_t init;
+    citer_group_acc_fn_t acc;
+    citer_group_merge_fn_t merge;
+    void *fn_data;
+    size_t partitions;
+} citer_group_ops_t;
+
+/*
+ * A group: its key and its accumulator.
+ */
+typedef struct citer_group {
+    void *key;
+    void *acc;
+} citer_group_t;
+
+/*
+ * Aggregate the items of an iterator per key, like a citer_fold() for each
+ * distinct key.
+ *
+ * Parameters:
+ *   it - The iterator to aggregate. It is consumed and freed.
+ *   ops - Description of the aggregation. It is copied.
+ *
+ * The groups are kept in a flat open-addressing hash table with linear
+ * probing, with the keys (when key_size is not 0) and the accumulators stored
+ * inline in the table's entries, and the keys' hashes in an array of their
+ * own. The table is sized up front from the source's upper size bound (up to
+ * a limit). When keys are not copied (key_size is 0), items are taken from the
+ * source in batches: the hashes of a whole batch are computed first, and their
+ * slots prefetched, so that the cache misses of a batch overlap.
+ *
+ * With many keys, a table which doesn't fit in the cache makes every item a
+ * cache miss. If ops->partitions is greater than 1, the aggregation is done in
+ * two phases instead: the items are first split into partitions by hash, then
+ * each partition is aggregated into a table of its own, which is more likely
+ * to fit in the cache. This requires the items to stay valid until
+ * citer_group_fold() returns, e.g. items of citer_over_array().
+ *
+ * The aggregation is done before citer_group_fold() returns.
+ *
+ * Returns an exact-sized, double-ended iterator over the groups, in no
+ * particular order. Each item is a pointer to a citer_group_t, which is reused:
+ * it is overwritten by the next call to citer_next() or citer_next_back().
+ * The keys and accumulators it points to stay valid until the iterator is
+ * freed. The returned iterator must be freed with citer_free().
+ */
+iterator_t *citer_group_fold(iterator_t *it, const citer_group_ops_t *ops);
+
+/*
+ * Aggregate the items of an iterator per key, using several threads.
+ *
+ * Parameters:
+ *   it - The iterator to aggregate. It is consumed and freed.
+ *   ops - Description of the aggregation, as for citer_group_fold(). The merge
+ *         function is required, and all the functions must be safe to call
+ *         from several threads at once.
+ *   n_threads - Number of threads to use, or 0 to use one per CPU.
+ *
+ * The source is split (see citer_split_at()) into one piece per thread. Each
+ * thread aggregates its piece into tables of its own, one per partition of the
+ * hashes. Then each partition is merged by a single thread, which combines the
+ * accumulators of its keys from every thread with ops->merge. Threads never
+ * share a table, so no locks are needed. The number of partitions is a few
+ * per thread, or ops->partitions if that is more.
+ *
+ * Items with equal keys may be aggregated by different threads, so the items
+ * of a group are not added to its accumulator in order.
+ *
+ * If the source cannot be split, its size is not exact, ops->merge is NULL, or
+ * there are too few items to be worth dividing, this is the same as
+ * citer_group_fold().
+ *
+ * Returns an iterator over the groups, as for citer_group_fold().
+ */
+iterator_t *citer_par_group_fold(iterator_t *it, const citer_group_ops_t *ops, size_t n_threads);
+
+#endif /* _CITER_GROUP_H_ */
+#ifndef _CITER_JOIN_H_
+#define _CITER_JOIN_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/*
+ * Kind of join performed by citer_hash_join().
+ */
+typedef enum citer_join_kind {
+    /* Pairs of matching left and right items. */
+    CITER_INNER_JOIN,
+    /* Left items which match at least one right item. */
+    CITER_SEMI_JOIN,
+    /* Left items which match no right item. */
+    CITER_ANTI_JOIN,
+} citer_join_kind_t;
+
+/*
+ * Description of a join.
+ *
+ * Fields:
+ *   left_key - Gets the key of a left item.
+ *   right_key - Gets the key of a right item.
+ *   hash - Hash function for keys.
+ *   eq - Equality function for keys.
+ *   fn_data - Custom data to be passed to all the functions.
+ *   memory_budget - If not 0, the number of bytes the build side may use in
+ *                   memory before it is spilled to temporary files.
+ *   left_size, right_size - Sizes (in bytes) of the left and right items.
+ *                           Only needed for spilling, in which case items are
+ *                           copied byte for byte, so the keys must be inside
+ *                           the items. If the build side's size is 0, it is
+ *                           never spilled.
+ */
+typedef struct citer_join_ops {
+    citer_key_fn_t left_key;
+    citer_key_fn_t right_key;
+    citer_hash_fn_t hash;
+    citer_eq_fn_t eq;
+    void *fn_data;
+    size_t memory_budget;
+    size_t left_size;
+    size_t right_size;
+} citer_join_ops_t;
+
+/*
+ * Join two iterators on equal keys, using a hash table.
+ *
+ * Parameters:
+ *   left - The left iterator.
+ *   right - The right iterator.
+ *   ops - Description of the join. It is copied.
+ *   kind - Kind of join.
+ *
+ * One side (the build side) is read into a hash table of its keys before
+ * citer_hash_join() returns, and must be finite. The other side (the probe
+ * side) is then streamed through the table as the join is iterated, so it
+ * only needs to keep each item valid until the next one is read. Semi and
+ * anti joins build the right side. Inner joins build the side with the
+ * smaller upper size bound (the right side, if they are the same). The items
+ * of the build side must stay valid while the join is in use.
+ *
+ * For inner joins, each item is a pointer to a citer_pair_t, with the left
+ * item as x and the right item as y, which is overwritten by the next call to
+ * citer_next(). For each probe item, its matches are returned in the order of
+ * the build side. Semi and anti joins return the left items themselves, in
+ * order.
+ *
+ * If the build side's memory goes over ops->memory_budget, the build side is
+ * split into partitions by hash and written to temporary files (see
+ * tmpfile()), as is the probe side, when the join is first iterated. Then each
+ * partition of the build side is read back and joined with the same partition
+ * of the probe side in turn (a "Grace" hash join). Items are then copies in
+ * buffers of the join, valid until the next call to citer_next(), and they are
+ * returned grouped by partition instead of in order. Partitions are not split
+ * further, so a single partition larger than the budget is still read whole.
+ * If the temporary files can't be created, or the items built so far can't be
+ * written to them, the join stays in memory. If a later write or read of the
+ * files fails, items would be lost, so the join ends early instead; use
+ * citer_hash_join_error() to tell this apart from the end of the join.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees both sides as well.
+ */
+iterator_t *citer_hash_join(iterator_t *left, iterator_t *right, const citer_join_ops_t *ops, citer_join_kind_t kind);
+
+/*
+ * Get the largest amount of memory (in bytes) used by the build side of a
+ * join so far, for its hash table and item lists.
+ *
+ * Must only be called on iterators created by citer_hash_join().
+ */
+size_t citer_hash_join_memory(iterator_t *it);
+
+/*
+ * Check whether the build side of a join was spilled to temporary files.
+ *
+ * Must only be called on iterators created by citer_hash_join().
+ */
+bool citer_hash_join_spilled(iterator_t *it);
+
+/*
+ * Get the error which stopped a spilled join.
+ *
+ * Must only be called on iterators created by citer_hash_join().
+ *
+ * Returns the errno value of the write or read of a temporary file which
+ * failed, or 0 if none has failed.
+ */
+int citer_hash_join_error(iterator_t *it);
+
+#endif /* _CITER_JOIN_H_ */
+#ifndef _CITER_FILTER_IN_SET_H_
+#define _CITER_FILTER_IN_SET_H_
+
+#include <stddef.h>
+
+
+/*
+ * Description of a set membership filter.
+ *
+ * Fields:
+ *   key - Gets the key of an item of the filtered iterator. If NULL, each item
+ *         is its own key.
+ *   hash - Hash function for keys.
+ *   eq - Equality function for keys. Only used by exact filters.
+ *   key_size - Only used by exact filters. If 0, the set holds pointers to the
+ *              keys, which must stay valid while the filter is in use.
+ *              Otherwise, it holds copies of the keys' key_size bytes.
+ *   fn_data - Custom data to be passed to all the functions.
+ */
+typedef struct citer_set_ops {
+    citer_key_fn_t key;
+    citer_hash_fn_t hash;
+    citer_eq_fn_t eq;
+    size_t key_size;
+    void *fn_data;
+} citer_set_ops_t;
+
+/*
+ * Filter the items of an iterator by whether their keys are in a set.
+ *
+ * Parameters:
+ *   it - The iterator to filter.
+ *   key_it - Iterator over the keys of the set. It is read to the end, then
+ *            freed, before citer_filter_in_set() returns.
+ *   ops - Description of the keys. It is copied.
+ *   fp_rate - Rate of false positives allowed, in [0, 1).
+ *
+ * If fp_rate is greater than 0, the set is a blocked Bloom filter sized for
+ * that rate: all the bits of a key are in one 64-byte block, so that each
+ * lookup touches a single cache line. Items whose key is in the set are always
+ * yielded, as are about fp_rate of the others, so this is a cheap way to drop
+ * most non-matching items before an exact join or lookup. The filter keeps no
+ * hold of the keys.
+ *
+ * If fp_rate is 0, the set is an exact hash set (see citer_distinct()), and
+ * ops->eq must not be NULL.
+ *
+ * When the filtered iterator is contiguous (see citer_as_strided()), items are
+ * probed in blocks: all the keys of a block are hashed and their cache lines
+ * prefetched before any is tested, so that the cache misses of the lookups
+ * overlap.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees the filtered iterator as well, but not fn_data. Returns NULL if
+ * fp_rate is not in [0, 1) or the filter is exact and ops->eq is NULL; it and
+ * key_it are then left alone.
+ */
+iterator_t *citer_filter_in_set(iterator_t *it, iterator_t *key_it, const citer_set_ops_t *ops, double fp_rate);
+
+#endif /* _CITER_FILTER_IN_SET_H_ */
+#ifndef _CITER_MERGE_H_
+#define _CITER_MERGE_H_
+
+
+/*
+ * Operations on sorted iterators.
+ *
+ * The iterators passed to these functions must be sorted in ascending order by
+ * the given comparison function. They are streamed in a single pass, without
+ * buffering or hashing, in O(n + m) comparisons.
+ *
+ * Iterators which can be read directly (see citer_as_strided()), such as
+ * citer_over_array(), are skipped over by galloping: once several items in a
+ * row have been skipped, an exponential search finds the end of the items to
+ * skip, and they are jumped over with citer_advance(). This takes O(log d)
+ * comparisons to skip d items, so that intersections of a small iterator with
+ * a large array are sublinear.
+ *
+ * For all of these functions, the returned iterator must be freed with
+ * citer_free(). Freeing it frees both input iterators as well.
+ */
+
+/*
+ * Join two sorted iterators on equal items.
+ *
+ * Parameters:
+ *   a - The left iterator.
+ *   b - The right iterator.
+ *   cmp - Comparison function, called with an item of a first and an item of
+ *         b second, so a and b may have items of different types.
+ *   extra_data - Extra data to pass to cmp.
+ *
+ * Each item is a pointer to a citer_pair_t, with an item of a as x and an equal
+ * item of b as y. It is overwritten by the next call to citer_next(). Every
+ * pair of equal items is yielded, in the order of a, then of b.
+ *
+ * To pair each item of a with a run of equal items of b, the run is kept, so
+ * that memory use is O(1) only if the items of b are distinct. Items of b
+ * which are part of a run must stay valid until the run is passed, so b must
+ * not reuse its items if it has duplicates.
+ */
+iterator_t *citer_merge_join(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Union of two sorted iterators.
+ *
+ * Yields the items of both iterators in sorted order. Items which are in both
+ * iterators are yielded once, from a. Like C++'s std::set_union(), an item
+ * which is m times in a and n times in b is yielded max(m, n) times.
+ */
+iterator_t *citer_sorted_union(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Intersection of two sorted iterators.
+ *
+ * Yields the items of a which are also in b, in order. An item which is m times
+ * in a and n times in b is yielded min(m, n) times.
+ */
+iterator_t *citer_sorted_intersect(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Difference of two sorted iterators.
+ *
+ * Yields the items of a which are not in b, in order. An item which is m times
+ * in a and n times in b is yielded max(m - n, 0) times.
+ */
+iterator_t *citer_sorted_difference(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Merge K sorted iterators into one sorted iterator.
+ *
+ * Parameters:
+ *   its - Array of K iterators, each sorted by cmp. The array is copied, and
+ *         the iterators are owned by the merge.
+ *   k - Number of iterators.
+ *   cmp - Comparison function for the items.
+ *   extra_data - Extra data to pass to cmp.
+ *
+ * The next items of the iterators are kept in a tournament (loser) tree, so
+ * each item takes about log2(K) comparisons. Equal items are yielded in the
+ * order of the iterators in its, so the merge is stable.
+ *
+ * Iterators which can be read directly (see citer_as_strided()) are consumed
+ * a block of items at a time, which are then read from memory without
+ * calling the iterator. Other iterators are read one item at a time, and their
+ * items only need to stay valid until the next call to citer_next() on the
+ * merge.
+ *
+ * The size bound is the sum of the bounds of the iterators, so it is exact if
+ * they all are. The merge is not double-ended.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees the K iterators as well, but not the array its.
+ */
+iterator_t *citer_merge_sorted(iterator_t **its, size_t k, citer_cmp_fn_t cmp, void *extra_data);
+
+#endif /* _CITER_MERGE_H_ */
+#ifndef _CITER_SELECTION_H_
+#define _CITER_SELECTION_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ * Get the K largest items of an iterator.
+ *
+ * Parameters:
+ *   it - The iterator.
+ *   k - Number of items to keep.
+ *   cmp - Comparison function for the items.
+ *   extra_data - Extra data to pass to cmp.
+ *   len_out - Set to the length of the returned array, which is K, or fewer if
+ *             the iterator has fewer items.
+ *
+ * The largest items seen so far are kept in a binary min-heap of K items, so
+ * each item takes one comparison with the smallest of them, plus O(log K)
+ * comparisons if it replaces it. Only O(K) extra memory is used, however long
+ * the iterator is. To get the K smallest items, reverse the comparison.
+ *
+ * The returned array holds the items in descending order, from the largest.
+ * Which of several equal items are kept is unspecified. Since the array holds
+ * pointers to the items, they must stay valid after the iterator returns them,
+ * as for citer_collect_into_array().
+ *
+ * The returned array is dynamically allocated and must be freed after use, even
+ * if it is empty. Returns NULL for iterators which are guaranteed to be
+ * infinite. For other infinite iterators, this function loops forever.
+ *
+ * This function exhausts the iterator, but does not free it.
+ */
+void **citer_top_k(iterator_t *it, size_t k, citer_cmp_fn_t cmp, void *extra_data, size_t *len_out);
+
+/*
+ * Get the Nth smallest item (counting from 0) of an iterator, i.e. the item at
+ * index N if the items were sorted.
+ *
+ * The items are collected into an array (see citer_collect_into_array()), in
+ * which the Nth item is found by introselect: quickselect with median-of-three
+ * pivots, which switches to heapsort if partitioning makes too little
+ * progress, so it takes O(n) time on average and O(n log n) at worst.
+ *
+ * Returns the item, or NULL if the iterator has N items or fewer, or is
+ * guaranteed to be infinite. Items must stay valid after the iterator returns
+ * them.
+ *
+ * This function exhausts the iterator, but does not free it.
+ */
+void *citer_select_nth(iterator_t *it, size_t n, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Typed top-K and selection.
+ *
+ * Same as citer_top_k() and citer_select_nth(), for iterators whose items are
+ * pointers to numbers of the given type (see citer_sum_i64()). The numbers are
+ * compared and moved directly, without calling a comparison function, and
+ * copied out, so items do not need to stay valid. Strided iterators (see
+ * citer_as_strided()) are read directly from their array.
+ *
+ * The citer_top_k_* functions write the K largest numbers to out, which must
+ * have room for K numbers, in descending order, and return how many were
+ * written. They use out as their heap, and allocate no memory.
+ *
+ * The citer_select_nth_* functions store the Nth smallest number in *out and
+ * return true, or return false if the iterator has N items or fewer.
+ *
+ * For doubles, NaNs are ordered after all other numbers.
+ *
+ * These functions exhaust the iterator, but do not free it. They return 0 (or
+ * false) for iterators which are guaranteed to be infinite.
+ */
+size_t citer_top_k_i64(iterator_t *it, size_t k, int64_t *out);
+size_t citer_top_k_u64(iterator_t *it, size_t k, uint64_t *out);
+size_t citer_top_k_f64(iterator_t *it, size_t k, double *out);
+bool citer_select_nth_i64(iterator_t *it, size_t n, int64_t *out);
+bool citer_select_nth_u64(iterator_t *it, size_t n, uint64_t *out);
+bool citer_select_nth_f64(iterator_t *it, size_t n, double *out);
+
+#endif /* _CITER_SELECTION_H_ */
+#ifndef _CITER_SORT_H_
+#define _CITER_SORT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ * Key functions for citer_sorted_by_key_*(). They return the sort key of an
+ * item.
+ */
+typedef uint64_t (*citer_key_u64_fn_t)(void *item, void *fn_data);
+typedef int64_t (*citer_key_i64_fn_t)(void *item, void *fn_data);
+typedef double (*citer_key_f64_fn_t)(void *item, void *fn_data);
+
+/*
+ * Iterate over the items of an iterator in sorted order.
+ *
+ * Parameters:
+ *   it - The iterator to sort. It must be finite.
+ *   cmp - Comparison function for the items.
+ *   extra_data - Extra data to pass to cmp.
+ *
+ * The items are collected into an array (pre-sized from the source's size
+ * bound, see citer_collect_into_array()) before citer_sorted() returns, and
+ * sorted with a stable merge sort: runs of a few items are insertion sorted,
+ * then merged in passes. Equal items keep their order. The sort runs on the
+ * calling thread, so cmp needn't be thread-safe; use citer_par_sorted() to
+ * sort on several threads.
+ *
+ * The result has an exact size and is double-ended and splittable (see
+ * citer_split_at()). Skipping items from either end is O(1), so
+ * citer_reverse(), citer_take(), citer_nth() and citer_nth_back() on it take
+ * no extra work.
+ *
+ * Since the array holds pointers to the items, they must stay valid after the
+ * source returns them, as for citer_collect_into_array(). The source is kept
+ * until the result (and every iterator split from it) is freed, in case it owns
+ * its items.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees the source iterator too. Returns NULL if the source is guaranteed to be
+ * infinite; it is then left alone.
+ */
+iterator_t *citer_sorted(iterator_t *it, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Sort the items of an iterator using several threads.
+ *
+ * Parameters:
+ *   it, cmp, extra_data - As for citer_sorted(). cmp must be safe to call from
+ *                         several threads at once.
+ *   n_threads - Number of threads to use, or 0 to use one per CPU.
+ *
+ * The array is cut into one slice per thread, and the slices are sorted in
+ * parallel. Then pairs of sorted runs are merged in rounds until one run is
+ * left. Each round is shared evenly between all the threads: a thread's share
+ * of the output of a merge is found by binary search (a "merge path"), so the
+ * last merge is as parallel as the first. Arrays too small to be worth
+ * dividing are sorted on the calling thread.
+ *
+ * Returns an iterator over the sorted items, as for citer_sorted().
+ */
+iterator_t *citer_par_sorted(iterator_t *it, citer_cmp_fn_t cmp, void *extra_data, size_t n_threads);
+
+/*
+ * Sort the items of an iterator by a numeric key.
+ *
+ * Parameters:
+ *   it - The iterator to sort. It must be finite.
+ *   key - Function returning the key of an item. It is called once per item,
+ *         possibly from several threads at once.
+ *   fn_data - Extra data to pass to key.
+ *
+ * Instead of comparing items, these functions sort (key, item) pairs with a
+ * least-significant-digit radix sort. Keys are mapped to unsigned integers
+ * which order the same way, and sorted one digit at a time: 8-bit digits for
+ * small arrays, 11-bit digits for medium ones and 16-bit digits for large
+ * ones, so there are never more buckets than are worth filling. The counts for
+ * every digit are taken in a single pass over the pairs, shared between one
+ * thread per CPU for large arrays, and digits which are the same in every key
+ * are skipped. Keys which only use their low bits therefore take fewer passes.
+ *
+ * The sort is stable: items with equal keys keep their order. For doubles,
+ * -0.0 equals 0.0, and NaNs are ordered after all other numbers.
+ *
+ * Returns an iterator over the sorted items, as for citer_sorted(), or NULL if
+ * the source is guaranteed to be infinite.
+ */
+iterator_t *citer_sorted_by_key_u64(iterator_t *it, citer_key_u64_fn_t key, void *fn_data);
+iterator_t *citer_sorted_by_key_i64(iterator_t *it, citer_key_i64_fn_t key, void *fn_data);
+iterator_t *citer_sorted_by_key_f64(iterator_t *it, citer_key_f64_fn_t key, void *fn_data);
+
+#endif /* _CITER_SORT_H_ */
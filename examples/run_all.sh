@@ -34,12 +34,16 @@ run ./chain a 3 b 4
 run ./enumerate a b c d
 run ./map 1 2 3 4
 run ./chunked 3 {1..20}
+run ./chunks 3 {1..20}
+run ./windows 3 a b - c d - e
 run ./filter 2 1 2 3 4 5 6 7 8 9 10
 run ./minmax {1..50}
 run ./count_using_fold {a..z}
 run ./sum {1..5}
+run ./sum_typed 1.5 2.5 3 4
 run ./inspect {1..5}
 run ./skip_take_while {1..100}
 run ./zip {1..5} {a..e}
 run ./reverse {a..f}
 run ./double_ended
+run ./tail 5 tail.c
@@ -0,0 +1,52 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <citer.h>
+
+int main(int argc, char *argv[]) {
+    if (argc <= 1) {
+        fprintf(stderr, "Usage: %s <numbers...>\n", argv[0]);
+        return 1;
+    }
+
+    size_t len = argc - 1;
+    double *arr = malloc(len * sizeof(*arr));
+    for (size_t i = 0; i < len; i++) {
+        if (sscanf(argv[i + 1], "%lf", &arr[i]) != 1) {
+            fprintf(stderr, "Invalid number: %s\n", argv[i + 1]);
+            return 1;
+        }
+    }
+
+    /* The array is summed directly using vectorised kernels, without calling
+     * a function for each item. */
+    iterator_t *it = citer_over_array(arr, sizeof(*arr), len);
+    printf("Sum: %g\n", citer_sum_f64(it));
+    citer_free(it);
+
+    it = citer_over_array(arr, sizeof(*arr), len);
+    printf("Product: %g\n", citer_product_f64(it));
+    citer_free(it);
+
+    free(arr);
+    return 0;
+}
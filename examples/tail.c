@@ -0,0 +1,59 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <citer.h>
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <count> <file>\n", argv[0]);
+        return 1;
+    }
+
+    unsigned long count;
+    if (sscanf(argv[1], "%lu", &count) != 1) {
+        fprintf(stderr, "Invalid count: %s\n", argv[1]);
+        return 1;
+    }
+
+    iterator_t *it = citer_mmap_lines(argv[2]);
+    if (!it) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    /* Read the last lines from the back, so the rest of the file is never
+     * scanned, then print them in their original order. */
+    citer_line_t *lines = malloc(count * sizeof(*lines));
+    size_t n = 0;
+    citer_line_t *line;
+    while (n < count && (line = citer_next_back(it)))
+        lines[n++] = *line;
+
+    while (n > 0) {
+        n--;
+        printf("%.*s\n", (int) lines[n].len, lines[n].ptr);
+    }
+
+    free(lines);
+    citer_free(it);
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <citer.h>
+
+static bool not_dash(void *item, void *fn_data) {
+    (void) fn_data; /* Mark as unused */
+    return **((char **) item) != '-';
+}
+
+static void print_windows(iterator_t *it) {
+    citer_slice_t *win;
+    while ((win = citer_next(it))) {
+        printf("Got: [");
+        for (size_t i = 0; i < win->len; i++) {
+            printf("%s", *((char **) citer_slice_get(win, i)));
+            if (i < win->len - 1) {
+                printf(", ");
+            }
+        }
+        printf("]\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc <= 2) {
+        fprintf(stderr, "Usage: %s <width> <args...>\n", argv[0]);
+        return 1;
+    }
+
+    unsigned long width;
+    if (sscanf(argv[1], "%lu", &width) != 1 || width == 0) {
+        fprintf(stderr, "Invalid width: %s\n", argv[1]);
+        return 1;
+    }
+
+    /* Contiguous source: windows are views into argv. */
+    iterator_t *it = citer_over_array(argv + 2, sizeof(*argv), argc - 2);
+    it = citer_windows(it, width);
+    print_windows(it);
+    citer_free(it);
+
+    /* Non-contiguous source: windows are kept in a ring buffer. */
+    printf("Skipping arguments starting with '-':\n");
+    it = citer_over_array(argv + 2, sizeof(*argv), argc - 2);
+    it = citer_windows(citer_filter(it, not_dash, NULL), width);
+    print_windows(it);
+    citer_free(it);
+
+    return 0;
+}
@@ -18,6 +18,7 @@
 
 #include "chunked.h"
 
+#include <stdbool.h>
 #include <stdlib.h>
 
 #define CEIL_DIV(a, b) (((a) + (b) - 1) / (b))
@@ -60,10 +61,10 @@ static void *citer_chunked_next_back(iterator_t *self) {
         n_in_last = data->chunksize;
 
     void **chunk = malloc(data->chunksize * sizeof(*chunk));
-    for (int i = n_in_last - 1; i >= 0; i--) {
-        chunk[i] = citer_next_back(data->orig);
+    for (size_t i = n_in_last; i > 0; i--) {
+        chunk[i - 1] = citer_next_back(data->orig);
     }
-    for (int i = n_in_last; i < data->chunksize; i++) {
+    for (size_t i = n_in_last; i < data->chunksize; i++) {
         chunk[i] = NULL;
     }
     return chunk;
@@ -98,3 +99,354 @@ iterator_t *citer_chunked(iterator_t *orig, size_t chunksize) {
         }
     );
 }
+
+typedef struct citer_chunks_data {
+    iterator_t *orig;
+    size_t chunksize;
+    citer_slice_t slice;
+    /* Only used when the source is contiguous. Items in [front, back) of the
+     * array at base have not been returned yet. */
+    char *base;
+    size_t front;
+    size_t back;
+} citer_chunks_data_t;
+
+static void *citer_chunks_array_next(iterator_t *self) {
+    citer_chunks_data_t *data = (citer_chunks_data_t *) self->data;
+    if (data->front == data->back)
+        return NULL;
+
+    size_t n = data->back - data->front;
+    if (n > data->chunksize)
+        n = data->chunksize;
+
+    data->slice.ptr = data->base + (data->front * data->slice.itemsize);
+    data->slice.len = n;
+    data->front += n;
+    self->size_bound.lower--;
+    self->size_bound.upper--;
+    return &data->slice;
+}
+
+static void *citer_chunks_array_next_back(iterator_t *self) {
+    citer_chunks_data_t *data = (citer_chunks_data_t *) self->data;
+    if (data->front == data->back)
+        return NULL;
+
+    /* Chunks are aligned to the front, so the last chunk holds the remainder. */
+    size_t n = (data->back - data->front) % data->chunksize;
+    if (n == 0)
+        n = data->chunksize;
+
+    data->back -= n;
+    data->slice.ptr = data->base + (data->back * data->slice.itemsize);
+    data->slice.len = n;
+    self->size_bound.lower--;
+    self->size_bound.upper--;
+    return &data->slice;
+}
+
+static void *citer_chunks_next(iterator_t *self) {
+    citer_chunks_data_t *data = (citer_chunks_data_t *) self->data;
+
+    size_t n = citer_next_batch(data->orig, data->slice.ptr, data->chunksize);
+    if (n == 0)
+        return NULL;
+
+    citer_bound_sub(self->size_bound, 1);
+    data->slice.len = n;
+    return &data->slice;
+}
+
+/*
+ * Double-endedness is only implemented for exact-size sources, so we can freely
+ * use the source's size_bound as the source length here.
+ */
+static void *citer_chunks_next_back(iterator_t *self) {
+    citer_chunks_data_t *data = (citer_chunks_data_t *) self->data;
+
+    size_t len = data->orig->size_bound.upper;
+    if (len == 0)
+        return NULL;
+
+    size_t n = len % data->chunksize;
+    if (n == 0)
+        n = data->chunksize;
+
+    void **buf = (void **) data->slice.ptr;
+    for (size_t i = n; i > 0; i--) {
+        buf[i - 1] = citer_next_back(data->orig);
+    }
+    citer_bound_sub(self->size_bound, 1);
+    data->slice.len = n;
+    return &data->slice;
+}
+
+static void citer_chunks_free_data(void *_data) {
+    citer_chunks_data_t *data = (citer_chunks_data_t *) _data;
+    if (data->slice.indirect)
+        free(data->slice.ptr);
+    citer_free(data->orig);
+    free(data);
+}
+
+iterator_t *citer_chunks(iterator_t *orig, size_t chunksize) {
+    /* Chunk size cannot be 0. */
+    if (chunksize == 0)
+        return NULL;
+
+    citer_chunks_data_t *data = malloc(sizeof(*data));
+    *data = (citer_chunks_data_t) {
+        .orig = orig,
+        .chunksize = chunksize,
+    };
+
+    citer_size_bound_t size_bound = {
+        .lower = CEIL_DIV(orig->size_bound.lower, chunksize),
+        .upper = CEIL_DIV(orig->size_bound.upper, chunksize),
+        .lower_infinite = orig->size_bound.lower_infinite,
+        .upper_infinite = orig->size_bound.upper_infinite,
+    };
+
+    void *array;
+    size_t len;
+    if (citer_as_array(orig, &array, &data->slice.itemsize, &len)) {
+        /* Chunks are views straight into the source's array. */
+        data->base = (char *) array;
+        data->front = 0;
+        data->back = len;
+        data->slice.indirect = false;
+        return citer_new(
+            data,
+            citer_chunks_array_next,
+            citer_chunks_array_next_back,
+            citer_chunks_free_data,
+            size_bound
+        );
+    }
+
+    /* Otherwise, items are gathered into a buffer which is reused for every
+     * chunk. */
+    data->slice.ptr = malloc(chunksize * sizeof(void *));
+    data->slice.itemsize = sizeof(void *);
+    data->slice.indirect = true;
+    return citer_new(
+        data,
+        citer_chunks_next,
+        CITER_HEDE(orig) ? citer_chunks_next_back : NULL,
+        citer_chunks_free_data,
+        size_bound
+    );
+}
+
+/*
+ * Ring buffer of the last (or first) items pulled by a windows iterator.
+ *
+ * The buffer has room for 2 * width items, and the items at indices i and
+ * i + width are always equal. This way the items currently in the ring can
+ * always be read as a contiguous array starting at buf + head.
+ */
+typedef struct citer_window_ring {
+    void **buf;
+    size_t head;
+    size_t count;
+} citer_window_ring_t;
+
+typedef struct citer_windows_data {
+    iterator_t *orig;
+    size_t width;
+    citer_slice_t slice;
+    /* When flat is true, windows start at the indices in [front, back) of the
+     * array at base. This is the case for contiguous sources, and for
+     * double-ended sources once they have been exhausted from both ends. */
+    bool flat;
+    char *base;
+    size_t front;
+    size_t back;
+    /* Otherwise, the front ring holds the last items pulled from the front of
+     * the source, and the back ring holds the last items pulled from the back.
+     * The pending counts are the number of those items which are still part of
+     * a window that has not been returned yet. */
+    citer_window_ring_t front_ring;
+    citer_window_ring_t back_ring;
+    size_t front_pending;
+    size_t back_pending;
+    void **flatbuf;
+} citer_windows_data_t;
+
+static void ring_push_back(citer_window_ring_t *ring, size_t width, void *item) {
+    size_t pos;
+    if (ring->count == width) {
+        /* Overwrite the oldest item. */
+        pos = ring->head;
+        ring->head = (ring->head + 1) % width;
+    } else {
+        pos = (ring->head + ring->count) % width;
+        ring->count++;
+    }
+    ring->buf[pos] = ring->buf[pos + width] = item;
+}
+
+static void ring_push_front(citer_window_ring_t *ring, size_t width, void *item) {
+    /* When the ring is full, this overwrites the rearmost item, which is the
+     * one pushed longest ago. */
+    ring->head = (ring->head + width - 1) % width;
+    ring->buf[ring->head] = ring->buf[ring->head + width] = item;
+    if (ring->count < width)
+        ring->count++;
+}
+
+/*
+ * Switch to flat mode once a double-ended source is exhausted. The items still
+ * needed by the remaining windows are the pending items of the front ring
+ * followed by the pending items of the back ring.
+ */
+static void citer_windows_flatten(citer_windows_data_t *data) {
+    citer_window_ring_t *fr = &data->front_ring;
+    citer_window_ring_t *br = &data->back_ring;
+    size_t len = data->front_pending + data->back_pending;
+
+    data->flatbuf = malloc(2 * data->width * sizeof(*data->flatbuf));
+    for (size_t i = 0; i < data->front_pending; i++)
+        data->flatbuf[i] = fr->buf[fr->head + fr->count - data->front_pending + i];
+    for (size_t i = 0; i < data->back_pending; i++)
+        data->flatbuf[data->front_pending + i] = br->buf[br->head + i];
+
+    data->flat = true;
+    data->base = (char *) data->flatbuf;
+    data->front = 0;
+    data->back = (len >= data->width) ? (len - data->width + 1) : 0;
+}
+
+static void *citer_windows_flat_next(iterator_t *self, citer_windows_data_t *data) {
+    if (data->front == data->back)
+        return NULL;
+    data->slice.ptr = data->base + (data->front++ * data->slice.itemsize);
+    citer_bound_sub(self->size_bound, 1);
+    return &data->slice;
+}
+
+static void *citer_windows_flat_next_back(iterator_t *self, citer_windows_data_t *data) {
+    if (data->front == data->back)
+        return NULL;
+    data->slice.ptr = data->base + (--data->back * data->slice.itemsize);
+    citer_bound_sub(self->size_bound, 1);
+    return &data->slice;
+}
+
+static void *citer_windows_next(iterator_t *self) {
+    citer_windows_data_t *data = (citer_windows_data_t *) self->data;
+    if (data->flat)
+        return citer_windows_flat_next(self, data);
+
+    bool double_ended = citer_is_double_ended(self);
+    if (double_ended && self->size_bound.upper == 0)
+        return NULL;
+
+    while (data->front_pending < data->width) {
+        if (double_ended && data->orig->size_bound.upper == 0) {
+            /* The rest of the items were pulled by the back end. */
+            citer_windows_flatten(data);
+            return citer_windows_flat_next(self, data);
+        }
+        void *item = citer_next(data->orig);
+        if (!item)
+            return NULL;
+        ring_push_back(&data->front_ring, data->width, item);
+        data->front_pending++;
+    }
+
+    /* The oldest item is not part of the next window. */
+    data->front_pending--;
+    data->slice.ptr = data->front_ring.buf + data->front_ring.head;
+    citer_bound_sub(self->size_bound, 1);
+    return &data->slice;
+}
+
+/*
+ * Double-endedness is only implemented for exact-size sources, so we can freely
+ * use the source's size_bound as the source length here.
+ */
+static void *citer_windows_next_back(iterator_t *self) {
+    citer_windows_data_t *data = (citer_windows_data_t *) self->data;
+    if (data->flat)
+        return citer_windows_flat_next_back(self, data);
+
+    if (self->size_bound.upper == 0)
+        return NULL;
+
+    while (data->back_pending < data->width) {
+        if (data->orig->size_bound.upper == 0) {
+            /* The rest of the items were pulled by the front end. */
+            citer_windows_flatten(data);
+            return citer_windows_flat_next_back(self, data);
+        }
+        ring_push_front(&data->back_ring, data->width, citer_next_back(data->orig));
+        data->back_pending++;
+    }
+
+    /* The newest item is not part of the next window from the back. */
+    data->back_pending--;
+    data->slice.ptr = data->back_ring.buf + data->back_ring.head;
+    citer_bound_sub(self->size_bound, 1);
+    return &data->slice;
+}
+
+static void citer_windows_free_data(void *_data) {
+    citer_windows_data_t *data = (citer_windows_data_t *) _data;
+    free(data->front_ring.buf);
+    free(data->back_ring.buf);
+    free(data->flatbuf);
+    citer_free(data->orig);
+    free(data);
+}
+
+iterator_t *citer_windows(iterator_t *orig, size_t width) {
+    /* Window width cannot be 0. */
+    if (width == 0)
+        return NULL;
+
+    citer_windows_data_t *data = malloc(sizeof(*data));
+    *data = (citer_windows_data_t) {
+        .orig = orig,
+        .width = width,
+        .slice = {
+            .len = width,
+        },
+    };
+
+    /* A source of N items has N - width + 1 windows. */
+    citer_size_bound_t size_bound = orig->size_bound;
+    citer_bound_sub(size_bound, width - 1);
+
+    void *array;
+    size_t len;
+    if (citer_as_array(orig, &array, &data->slice.itemsize, &len)) {
+        /* Windows are views straight into the source's array. */
+        data->flat = true;
+        data->base = (char *) array;
+        data->front = 0;
+        data->back = size_bound.upper;
+        data->slice.indirect = false;
+        return citer_new(
+            data,
+            citer_windows_next,
+            citer_windows_next_back,
+            citer_windows_free_data,
+            size_bound
+        );
+    }
+
+    data->slice.itemsize = sizeof(void *);
+    data->slice.indirect = true;
+    data->front_ring.buf = malloc(2 * width * sizeof(void *));
+    if (CITER_HEDE(orig))
+        data->back_ring.buf = malloc(2 * width * sizeof(void *));
+    return citer_new(
+        data,
+        citer_windows_next,
+        CITER_HEDE(orig) ? citer_windows_next_back : NULL,
+        citer_windows_free_data,
+        size_bound
+    );
+}
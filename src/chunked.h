@@ -22,6 +22,7 @@
 #include <stddef.h>
 
 #include "iterator.h"
+#include "over_array.h"
 
 /*
  * Iterator over chunks of another iterator's items.
@@ -42,4 +43,58 @@
  */
 iterator_t *citer_chunked(iterator_t *, size_t);
 
+/*
+ * Iterator over chunks of another iterator's items, without allocating.
+ *
+ * Like citer_chunked(), but each item is a pointer to a citer_slice_t
+ * describing the chunk. The last chunk is shorter than the chunk size if the
+ * chunk size does not divide the number of items; its len field says how many
+ * items it holds.
+ *
+ * If the source is contiguous (see citer_as_array()), each slice points
+ * straight into the source's array. Otherwise, the items are gathered into a
+ * buffer owned by this iterator, which is reused for every chunk.
+ *
+ * The same slice structure (and buffer) is reused each time the iterator is
+ * advanced, so a chunk is only valid until the next call to citer_next() or
+ * citer_next_back(). Use citer_slice_get() to access the items of a chunk.
+ *
+ * Parameters:
+ *   1. The source iterator to chunk.
+ *   2. The size of each chunk. Must be greater than 0.
+ *
+ * Returns a new iterator which must be freed with citer_free(), or NULL if the
+ * chunk size is 0. Freeing this iterator also frees the source iterator.
+ */
+iterator_t *citer_chunks(iterator_t *, size_t);
+
+/*
+ * Iterator over overlapping windows of another iterator's items.
+ *
+ * Each item is a pointer to a citer_slice_t holding WIDTH consecutive items of
+ * the source, starting one item later than the previous window. A source of N
+ * items has N - WIDTH + 1 windows, or none if N < WIDTH.
+ *
+ * If the source is contiguous (see citer_as_array()), each slice points
+ * straight into the source's array, so advancing is O(1) and nothing is
+ * copied. Otherwise, the last WIDTH items are kept in a ring buffer owned by
+ * this iterator, laid out so that the window is still a contiguous array of
+ * item pointers.
+ *
+ * The same slice structure is reused each time the iterator is advanced, so a
+ * window is only valid until the next call to citer_next() or
+ * citer_next_back(). Use citer_slice_get() to access the items of a window.
+ *
+ * Like citer_chunked(), this iterator is double-ended if the source is
+ * double-ended and exact-sized.
+ *
+ * Parameters:
+ *   1. The source iterator.
+ *   2. The width of each window. Must be greater than 0.
+ *
+ * Returns a new iterator which must be freed with citer_free(), or NULL if the
+ * width is 0. Freeing this iterator also frees the source iterator.
+ */
+iterator_t *citer_windows(iterator_t *, size_t);
+
 #endif /* _CITER_CHUNKED_H_ */
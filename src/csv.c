@@ -0,0 +1,270 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "csv.h"
+#include "simd.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_SIZE 64
+
+/*
+ * Bits of the current block's mask are the delimiters and newlines of the
+ * block which are outside quotes and have not been consumed yet. The current
+ * field starts at field_start.
+ */
+typedef struct citer_csv_data {
+    const char *buf;
+    size_t len;
+    citer_csv_options_t options;
+
+    size_t block;
+    size_t next_block;
+    uint64_t mask;
+    uint64_t newlines;
+    /* The next block starts inside quotes. */
+    bool in_quotes;
+    /* A quote at the start of the next block would open a quoted field. */
+    bool quote_opens;
+    /* The first byte of the next block is escaped. */
+    bool escape_carry;
+
+    size_t field_start;
+    citer_csv_row_t row;
+    citer_csv_field_t *fields;
+    size_t capacity;
+} citer_csv_data_t;
+
+/* Whether quotes inside quoted fields are escaped by doubling them. */
+static bool doubled_quotes(const citer_csv_options_t *options) {
+    return (options->escape == '\0') || (options->escape == options->quote);
+}
+
+/*
+ * Find the bytes made literal by the escape characters in esc, in order. An
+ * escape character which is itself escaped doesn't escape the next byte.
+ */
+static uint64_t escaped_mask(uint64_t esc, bool *carry) {
+    uint64_t escaped = *carry ? 1 : 0;
+    *carry = false;
+    while (esc) {
+        unsigned i = citer_ctz64(esc);
+        esc &= esc - 1;
+        if ((escaped >> i) & 1)
+            continue;
+        if (i == BLOCK_SIZE - 1)
+            *carry = true;
+        else
+            escaped |= ((uint64_t) 1) << (i + 1);
+    }
+    return escaped;
+}
+
+/*
+ * Find which of a block's quotes open or close quoted fields, one at a time.
+ * Outside quotes, only a quote at the start of a field, or right after a
+ * closing quote (a doubled quote), opens a quoted field; other quotes are
+ * ordinary characters. Inside quotes, every quote closes the field.
+ */
+static uint64_t quote_toggles(uint64_t quotes, uint64_t structural, bool in_quotes, bool quote_opens) {
+    uint64_t toggles = 0;
+    /* Positions at which a quote would open a quoted field. */
+    uint64_t opens = quote_opens ? 1 : 0;
+    for (uint64_t bits = quotes | structural; bits; bits &= bits - 1) {
+        unsigned i = citer_ctz64(bits);
+        uint64_t bit = ((uint64_t) 1) << i;
+        if (!(quotes & bit)) {
+            if (!in_quotes)
+                opens |= bit << 1;
+        } else if (in_quotes) {
+            in_quotes = false;
+            toggles |= bit;
+            opens |= bit << 1;
+        } else if (opens & bit) {
+            in_quotes = true;
+            toggles |= bit;
+        }
+    }
+    return toggles;
+}
+
+/* Scan the next block for delimiters and newlines outside quotes. */
+static void scan_block(citer_csv_data_t *data) {
+    size_t start = data->next_block;
+    size_t n = data->len - start;
+    if (n > BLOCK_SIZE)
+        n = BLOCK_SIZE;
+    const char *p = data->buf + start;
+    const citer_csv_options_t *options = &data->options;
+
+    uint64_t newlines = citer_byte_mask64(p, n, '\n');
+    uint64_t structural = citer_byte_mask64(p, n, options->delimiter) | newlines;
+    uint64_t quotes = options->quote ? citer_byte_mask64(p, n, options->quote) : 0;
+    if (!doubled_quotes(options)) {
+        uint64_t escaped = escaped_mask(citer_byte_mask64(p, n, options->escape), &data->escape_carry);
+        structural &= ~escaped;
+        quotes &= ~escaped;
+    }
+    if (options->quote) {
+        /* Doubled quotes toggle in and out of quotes, which cancels out. */
+        uint64_t inside = citer_prefix_xor64(quotes);
+        if (data->in_quotes)
+            inside = ~inside;
+        /* Opening quotes must start a field or follow a closing quote. A
+         * block with a quote in the middle of an unquoted field is rare, and
+         * scanned one quote at a time instead. */
+        uint64_t closes = quotes & ~inside;
+        uint64_t opens = ((structural | closes) << 1) | data->quote_opens;
+        if (quotes & inside & ~opens) {
+            quotes = quote_toggles(quotes, structural, data->in_quotes, data->quote_opens);
+            inside = citer_prefix_xor64(quotes);
+            if (data->in_quotes)
+                inside = ~inside;
+            closes = quotes & ~inside;
+        }
+        data->in_quotes = inside >> (BLOCK_SIZE - 1);
+        structural &= ~inside;
+        data->quote_opens = (structural | closes) >> (BLOCK_SIZE - 1);
+    }
+
+    data->block = start;
+    data->next_block = start + BLOCK_SIZE;
+    data->mask = structural;
+    data->newlines = newlines;
+}
+
+/*
+ * Add the field in [start, end) to the current row. The last field of a row
+ * has its '\r' removed.
+ */
+static void add_field(citer_csv_data_t *data, size_t start, size_t end, bool last) {
+    const char *buf = data->buf;
+    const citer_csv_options_t *options = &data->options;
+    if (last && (end > start) && (buf[end - 1] == '\r'))
+        end--;
+
+    if (data->row.n_fields == data->capacity) {
+        data->capacity *= 2;
+        data->fields = realloc(data->fields, data->capacity * sizeof(*data->fields));
+        data->row.fields = data->fields;
+    }
+    citer_csv_field_t *field = &data->fields[data->row.n_fields++];
+
+    if (options->quote && (end > start) && (buf[start] == options->quote)) {
+        /* Leave out the quotes, if the field is closed. */
+        start++;
+        if ((end > start) && (buf[end - 1] == options->quote))
+            end--;
+    }
+    field->ptr = buf + start;
+    field->len = end - start;
+    if (doubled_quotes(options))
+        field->escaped = options->quote && memchr(field->ptr, options->quote, field->len);
+    else
+        field->escaped = memchr(field->ptr, options->escape, field->len) != NULL;
+}
+
+static void *citer_csv_next(iterator_t *self) {
+    citer_csv_data_t *data = (citer_csv_data_t *) self->data;
+    if (data->field_start >= data->len)
+        return NULL;
+
+    data->row.n_fields = 0;
+    for (;;) {
+        while (data->mask == 0) {
+            if (data->next_block >= data->len) {
+                /* The last row isn't terminated. An unterminated quoted
+                 * field doesn't keep the final newline. */
+                size_t end = data->len;
+                if (data->in_quotes && (end > data->field_start) && (data->buf[end - 1] == '\n'))
+                    end--;
+                add_field(data, data->field_start, end, true);
+                data->field_start = data->len;
+                goto end_row;
+            }
+            scan_block(data);
+        }
+
+        unsigned bit = citer_ctz64(data->mask);
+        data->mask &= data->mask - 1;
+        size_t pos = data->block + bit;
+        bool newline = (data->newlines >> bit) & 1;
+        add_field(data, data->field_start, pos, newline);
+        data->field_start = pos + 1;
+        if (newline)
+            break;
+    }
+
+end_row:
+    /* Each row takes at least one byte. */
+    self->size_bound.upper = data->len - data->field_start;
+    self->size_bound.lower = (self->size_bound.upper > 0) ? 1 : 0;
+    return &data->row;
+}
+
+static void citer_csv_free_data(void *_data) {
+    citer_csv_data_t *data = (citer_csv_data_t *) _data;
+    free(data->fields);
+    free(data);
+}
+
+iterator_t *citer_csv(const char *buf, size_t len, const citer_csv_options_t *options) {
+    citer_csv_options_t opts = options ? *options : CITER_CSV_DEFAULT;
+    if ((opts.delimiter == '\n') || (opts.quote == '\n') || (opts.escape == '\n'))
+        return NULL;
+    if ((opts.delimiter == opts.quote) || (opts.delimiter == opts.escape))
+        return NULL;
+
+    citer_csv_data_t *data = calloc(1, sizeof(*data));
+    data->buf = buf;
+    data->len = len;
+    data->options = opts;
+    data->quote_opens = true;
+    data->capacity = 16;
+    data->fields = malloc(data->capacity * sizeof(*data->fields));
+    data->row.fields = data->fields;
+
+    return citer_new(
+        data,
+        citer_csv_next,
+        NULL,
+        citer_csv_free_data,
+        (citer_size_bound_t) {
+            .lower = (len > 0) ? 1 : 0,
+            .upper = len,
+            .lower_infinite = false,
+            .upper_infinite = false,
+        }
+    );
+}
+
+size_t citer_csv_unescape(const citer_csv_field_t *field, char *out, const citer_csv_options_t *options) {
+    citer_csv_options_t opts = options ? *options : CITER_CSV_DEFAULT;
+    char escape = doubled_quotes(&opts) ? opts.quote : opts.escape;
+    const char *p = field->ptr;
+    size_t n = 0;
+    for (size_t i = 0; i < field->len; i++) {
+        /* With doubled quotes, only a quote followed by a quote is escaped. */
+        if (escape && (p[i] == escape) && (i + 1 < field->len) && (!doubled_quotes(&opts) || (p[i + 1] == escape)))
+            i++;
+        out[n++] = p[i];
+    }
+    return n;
+}
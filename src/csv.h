@@ -0,0 +1,124 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_CSV_H_
+#define _CITER_CSV_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "iterator.h"
+
+/*
+ * Dialect of the text read by citer_csv().
+ *
+ * Fields are separated by the delimiter, and rows by '\n' (a '\r' before the
+ * '\n' is removed). A field which starts with the quote character extends to
+ * the next unescaped quote, and may contain delimiters and newlines. If the
+ * closing quote is missing, the field extends to the end of the text, less a
+ * final newline. A quote anywhere else in a field is an ordinary character.
+ *
+ * If the escape character is the quote character or '\0', quotes inside
+ * quoted fields are written as two quotes (as in RFC 4180). Otherwise, the
+ * escape character makes the next character literal, including delimiters,
+ * quotes and newlines, inside or outside quotes.
+ *
+ * A quote of '\0' disables quoting.
+ */
+typedef struct citer_csv_options {
+    char delimiter;
+    char quote;
+    char escape;
+} citer_csv_options_t;
+
+/* RFC 4180 CSV: comma-separated, with doubled quotes. */
+#define CITER_CSV_DEFAULT ((citer_csv_options_t) { ',', '"', '"' })
+
+/* Tab-separated values, without quoting. */
+#define CITER_TSV_DEFAULT ((citer_csv_options_t) { '\t', '\0', '\0' })
+
+/*
+ * A view of one field of a row.
+ *
+ * The ptr field points to the first character of the field in the parsed
+ * buffer, and len is its length in bytes. For quoted fields, the view does not
+ * include the surrounding quotes. If escaped is true, the field contains
+ * escape sequences (or doubled quotes), and must be passed through
+ * citer_csv_unescape() to get its value.
+ */
+typedef struct citer_csv_field {
+    const char *ptr;
+    size_t len;
+    bool escaped;
+} citer_csv_field_t;
+
+/*
+ * A view of one row.
+ *
+ * fields points to an array of n_fields field views.
+ */
+typedef struct citer_csv_row {
+    const citer_csv_field_t *fields;
+    size_t n_fields;
+} citer_csv_row_t;
+
+/*
+ * Iterator over the rows of CSV (or TSV, etc.) text in a buffer.
+ *
+ * Parameters:
+ *   buf - The text to parse. It must stay valid (and unchanged) while the
+ *         iterator and its rows are in use. It does not need to be
+ *         NUL-terminated, e.g. it can be a memory-mapped file.
+ *   len - Length of the text in bytes.
+ *   options - The dialect of the text. If NULL, CITER_CSV_DEFAULT is used.
+ *
+ * Each item is a pointer to a citer_csv_row_t which views the fields of the
+ * row in buf, so nothing is copied or allocated per field. The row and its
+ * array of fields are reused: they are overwritten by the next call to
+ * citer_next().
+ *
+ * An empty line is a row with one empty field. A final '\n' at the end of the
+ * text does not start another row. A quoted field which is not closed extends
+ * to the end of the text, less a final '\n' (and a '\r' before it).
+ *
+ * Delimiters, quotes and newlines are found 64 bytes at a time with vectorised
+ * comparisons. Quoted regions are found for a whole block at once from the
+ * bitmap of quotes, so the rest of the text is only looked at where fields
+ * start and end.
+ *
+ * Returns a new iterator, or NULL if the delimiter is '\n', the quote character
+ * or the escape character, or if the quote or escape character is '\n'. The
+ * returned iterator must be freed with citer_free().
+ */
+iterator_t *citer_csv(const char *buf, size_t len, const citer_csv_options_t *options);
+
+/*
+ * Get the value of a field, removing its escape sequences.
+ *
+ * Parameters:
+ *   field - The field to unescape.
+ *   out - Where to write the value. Must have room for field->len bytes. It
+ *         is not NUL-terminated.
+ *   options - The dialect given to citer_csv(), or NULL for
+ *             CITER_CSV_DEFAULT.
+ *
+ * Returns the length of the value in bytes.
+ */
+size_t citer_csv_unescape(const citer_csv_field_t *field, char *out, const citer_csv_options_t *options);
+
+#endif /* _CITER_CSV_H_ */
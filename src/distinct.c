@@ -0,0 +1,142 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "distinct.h"
+#include "table.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Largest table to allocate up front, in entries. */
+#define MAX_PRESIZE (1 << 20)
+
+typedef struct citer_distinct_data {
+    iterator_t *orig;
+    citer_hash_fn_t hash;
+    citer_eq_fn_t eq;
+    void *fn_data;
+    citer_table_t seen;
+} citer_distinct_data_t;
+
+typedef struct citer_distinct_bitmap_data {
+    iterator_t *orig;
+    citer_index_fn_t index;
+    size_t domain_size;
+    void *fn_data;
+    uint64_t *seen;
+} citer_distinct_bitmap_data_t;
+
+/*
+ * Update the size bound after the source gives an item. Any item after the
+ * first may be a duplicate, so the lower bound drops to 0.
+ */
+static void update_bound(iterator_t *self, iterator_t *orig) {
+    self->size_bound.lower = 0;
+    self->size_bound.upper = orig->size_bound.upper;
+    self->size_bound.upper_infinite = orig->size_bound.upper_infinite;
+}
+
+static void *citer_distinct_next(iterator_t *self) {
+    citer_distinct_data_t *data = (citer_distinct_data_t *) self->data;
+    void *item;
+    while ((item = citer_next(data->orig))) {
+        update_bound(self, data->orig);
+        bool inserted;
+        citer_table_insert(&data->seen, data->hash(item, data->fn_data), item, data->eq, data->fn_data, &inserted);
+        if (inserted)
+            return item;
+    }
+    return NULL;
+}
+
+static void citer_distinct_free_data(void *_data) {
+    citer_distinct_data_t *data = (citer_distinct_data_t *) _data;
+    citer_free(data->orig);
+    citer_table_free(&data->seen);
+    free(data);
+}
+
+/* Initial bound: a non-empty source has at least one distinct item. */
+static citer_size_bound_t distinct_bound(iterator_t *orig) {
+    citer_size_bound_t size_bound = orig->size_bound;
+    size_bound.lower = (size_bound.lower > 0 || size_bound.lower_infinite) ? 1 : 0;
+    size_bound.lower_infinite = false;
+    return size_bound;
+}
+
+iterator_t *citer_distinct(iterator_t *it, citer_hash_fn_t hash, citer_eq_fn_t eq, void *fn_data) {
+    citer_distinct_data_t *data = malloc(sizeof(*data));
+    data->orig = it;
+    data->hash = hash;
+    data->eq = eq;
+    data->fn_data = fn_data;
+
+    size_t expected = 0;
+    if (!it->size_bound.upper_infinite)
+        expected = (it->size_bound.upper < MAX_PRESIZE) ? it->size_bound.upper : MAX_PRESIZE;
+    citer_table_init(&data->seen, sizeof(void *), 0, expected);
+
+    return citer_new(
+        data,
+        citer_distinct_next,
+        NULL,
+        citer_distinct_free_data,
+        distinct_bound(it)
+    );
+}
+
+static void *citer_distinct_bitmap_next(iterator_t *self) {
+    citer_distinct_bitmap_data_t *data = (citer_distinct_bitmap_data_t *) self->data;
+    void *item;
+    while ((item = citer_next(data->orig))) {
+        update_bound(self, data->orig);
+        size_t i = data->index(item, data->fn_data);
+        if (i >= data->domain_size)
+            return item;
+        uint64_t bit = ((uint64_t) 1) << (i % 64);
+        if (!(data->seen[i / 64] & bit)) {
+            data->seen[i / 64] |= bit;
+            return item;
+        }
+    }
+    return NULL;
+}
+
+static void citer_distinct_bitmap_free_data(void *_data) {
+    citer_distinct_bitmap_data_t *data = (citer_distinct_bitmap_data_t *) _data;
+    citer_free(data->orig);
+    free(data->seen);
+    free(data);
+}
+
+iterator_t *citer_distinct_bitmap(iterator_t *it, citer_index_fn_t index, size_t domain_size, void *fn_data) {
+    citer_distinct_bitmap_data_t *data = malloc(sizeof(*data));
+    data->orig = it;
+    data->index = index;
+    data->domain_size = domain_size;
+    data->fn_data = fn_data;
+    data->seen = calloc(domain_size / 64 + 1, sizeof(*data->seen));
+
+    return citer_new(
+        data,
+        citer_distinct_bitmap_next,
+        NULL,
+        citer_distinct_bitmap_free_data,
+        distinct_bound(it)
+    );
+}
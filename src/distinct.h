@@ -0,0 +1,80 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_DISTINCT_H_
+#define _CITER_DISTINCT_H_
+
+#include <stddef.h>
+
+#include "hash.h"
+#include "iterator.h"
+
+/*
+ * Iterator which yields each distinct item of an iterator once, the first
+ * time it is seen.
+ *
+ * Parameters:
+ *   it - The source iterator.
+ *   hash - Hash function for the items.
+ *   eq - Equality function for the items.
+ *   fn_data - Custom data to be passed to hash and eq.
+ *
+ * The items seen so far are kept in an open-addressing hash table with linear
+ * probing. The items' hashes are kept in an array of their own, so a probe
+ * compares hashes in consecutive memory and only calls eq when they match.
+ * Items must stay valid while the iterator is in use. This is the case for
+ * arrays (citer_over_array()), but not for iterators which reuse their items,
+ * such as citer_mmap_lines(). The table is sized up front from the source's
+ * upper size bound, when it is finite, so that it doesn't have to grow while
+ * it fills up.
+ *
+ * The iterator is not double-ended, since the item yielded for a group of
+ * equal items is the first one.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees the source iterator as well, but not fn_data.
+ */
+iterator_t *citer_distinct(iterator_t *it, citer_hash_fn_t hash, citer_eq_fn_t eq, void *fn_data);
+
+/*
+ * Function which maps an item to an index in a small integer domain, for
+ * citer_distinct_bitmap().
+ */
+typedef size_t (*citer_index_fn_t)(void *item, void *fn_data);
+
+/*
+ * Iterator which yields each distinct item of an iterator once, for items with
+ * a small integer domain.
+ *
+ * Parameters:
+ *   it - The source iterator.
+ *   index - Function which maps each item to an integer. Items are equal if
+ *           and only if they map to the same integer.
+ *   domain_size - Size of the domain: integers are less than this.
+ *   fn_data - Custom data to be passed to index.
+ *
+ * The integers seen so far are marked in a bitmap of domain_size bits, which
+ * takes no hashing, probing or comparisons, and does not keep hold of the
+ * items. Items whose integer is not in the domain are always yielded.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees the source iterator as well, but not fn_data.
+ */
+iterator_t *citer_distinct_bitmap(iterator_t *it, citer_index_fn_t index, size_t domain_size, void *fn_data);
+
+#endif /* _CITER_DISTINCT_H_ */
@@ -0,0 +1,304 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "filter_cmp.h"
+#include "over_array.h"
+#include "simd.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Number of records evaluated at once. One bit per record in a uint64_t. */
+#define BLOCK_SIZE 64
+
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+
+/*
+ * Comparison kernels.
+ *
+ * Each kernel compares N fields against the constant operands and writes 1 or
+ * 0 to out[j] depending on whether field j satisfies the comparison. Fields are
+ * widened to W before comparing. When the fields are packed (i.e. the records
+ * are plain numbers), the loop indexes a typed array so that it vectorises.
+ */
+#define CMP_LOOP(T, W, expr) \
+    if (stride == sizeof(T)) { \
+        const T *arr = (const T *) base; \
+        for (size_t j = 0; j < n; j++) { \
+            W x = (W) arr[j]; \
+            out[j] = (expr); \
+        } \
+    } else { \
+        for (size_t j = 0; j < n; j++) { \
+            W x = (W) *((const T *) (base + j * stride)); \
+            out[j] = (expr); \
+        } \
+    }
+
+#define CMP_BODY(T, W) { \
+    switch (op) { \
+    case CITER_LT: CMP_LOOP(T, W, x < a) break; \
+    case CITER_LE: CMP_LOOP(T, W, x <= a) break; \
+    case CITER_GT: CMP_LOOP(T, W, x > a) break; \
+    case CITER_GE: CMP_LOOP(T, W, x >= a) break; \
+    case CITER_EQ: CMP_LOOP(T, W, x == a) break; \
+    case CITER_NE: CMP_LOOP(T, W, x != a) break; \
+    case CITER_BETWEEN: CMP_LOOP(T, W, (a <= x) & (x < b)) break; \
+    } \
+}
+
+#define CMP_ARGS (base, stride, n, op, a, b, out)
+
+CITER_DISPATCH_KERNEL(void, cmp_i32, (const char *base, size_t stride, size_t n, citer_cmp_op_t op, int64_t a, int64_t b, uint8_t *out), CMP_ARGS, CMP_BODY(int32_t, int64_t))
+CITER_DISPATCH_KERNEL(void, cmp_i64, (const char *base, size_t stride, size_t n, citer_cmp_op_t op, int64_t a, int64_t b, uint8_t *out), CMP_ARGS, CMP_BODY(int64_t, int64_t))
+CITER_DISPATCH_KERNEL(void, cmp_u32, (const char *base, size_t stride, size_t n, citer_cmp_op_t op, uint64_t a, uint64_t b, uint8_t *out), CMP_ARGS, CMP_BODY(uint32_t, uint64_t))
+CITER_DISPATCH_KERNEL(void, cmp_u64, (const char *base, size_t stride, size_t n, citer_cmp_op_t op, uint64_t a, uint64_t b, uint8_t *out), CMP_ARGS, CMP_BODY(uint64_t, uint64_t))
+CITER_DISPATCH_KERNEL(void, cmp_f32, (const char *base, size_t stride, size_t n, citer_cmp_op_t op, double a, double b, uint8_t *out), CMP_ARGS, CMP_BODY(float, double))
+CITER_DISPATCH_KERNEL(void, cmp_f64, (const char *base, size_t stride, size_t n, citer_cmp_op_t op, double a, double b, uint8_t *out), CMP_ARGS, CMP_BODY(double, double))
+
+/*
+ * Pack a block of BLOCK_SIZE bytes, each 0 or 1, into a bitmap.
+ */
+static inline uint64_t pack_bits(const uint8_t *bytes) {
+    uint64_t mask = 0;
+#if defined(__SSE2__)
+    for (size_t k = 0; k < BLOCK_SIZE / 16; k++) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (bytes + 16 * k));
+        v = _mm_cmpgt_epi8(v, _mm_setzero_si128());
+        mask |= ((uint64_t) (uint16_t) _mm_movemask_epi8(v)) << (16 * k);
+    }
+#else
+    for (size_t j = 0; j < BLOCK_SIZE; j++)
+        mask |= ((uint64_t) bytes[j]) << j;
+#endif
+    return mask;
+}
+
+uint64_t citer_cmp_eval(const void *_base, size_t stride, size_t n, const citer_cmp_pred_t *pred) {
+    uint8_t out[BLOCK_SIZE] = { 0 };
+    const char *base = ((const char *) _base) + pred->offset;
+    if (n > BLOCK_SIZE)
+        n = BLOCK_SIZE;
+
+    switch (pred->type) {
+    case CITER_I32:
+        cmp_i32(base, stride, n, pred->op, pred->a.i, pred->b.i, out);
+        break;
+    case CITER_I64:
+        cmp_i64(base, stride, n, pred->op, pred->a.i, pred->b.i, out);
+        break;
+    case CITER_U32:
+        cmp_u32(base, stride, n, pred->op, pred->a.u, pred->b.u, out);
+        break;
+    case CITER_U64:
+        cmp_u64(base, stride, n, pred->op, pred->a.u, pred->b.u, out);
+        break;
+    case CITER_F32:
+        cmp_f32(base, stride, n, pred->op, pred->a.f, pred->b.f, out);
+        break;
+    case CITER_F64:
+        cmp_f64(base, stride, n, pred->op, pred->a.f, pred->b.f, out);
+        break;
+    }
+
+    return pack_bits(out);
+}
+
+typedef struct citer_filter_cmp_data {
+    iterator_t *orig;
+    citer_cmp_pred_t *preds;
+    size_t n_preds;
+    citer_combine_t combine;
+
+    /* The fields below are only used when the source is contiguous (or
+     * strided), with records stride bytes apart. Records in [front, back)
+     * have not been evaluated yet. The front and back blocks hold the bitmaps
+     * of matching records which have not been returned. */
+    char *base;
+    size_t stride;
+    size_t front;
+    size_t back;
+    size_t front_start;
+    uint64_t front_mask;
+    size_t back_start;
+    uint64_t back_mask;
+} citer_filter_cmp_data_t;
+
+/*
+ * Evaluate all predicates over N records and combine the results.
+ */
+static uint64_t eval_block(citer_filter_cmp_data_t *data, const char *block, size_t stride, size_t n) {
+    uint64_t valid = (n == BLOCK_SIZE) ? UINT64_MAX : ((UINT64_C(1) << n) - 1);
+    uint64_t mask = (data->combine == CITER_ALL_OF) ? valid : 0;
+    for (size_t p = 0; p < data->n_preds; p++) {
+        uint64_t m = citer_cmp_eval(block, stride, n, &data->preds[p]);
+        if (data->combine == CITER_ALL_OF) {
+            mask &= m;
+            if (!mask)
+                break;
+        } else {
+            mask |= m;
+        }
+    }
+    return mask & valid;
+}
+
+/*
+ * Update the size bound of a contiguous filter. The upper bound is the number
+ * of unevaluated records plus the number of matches left in the blocks.
+ */
+static inline void update_bound(iterator_t *self, citer_filter_cmp_data_t *data) {
+    self->size_bound.upper = (data->back - data->front)
+                             + citer_popcount64(data->front_mask)
+                             + citer_popcount64(data->back_mask);
+}
+
+static void *citer_filter_cmp_array_next(iterator_t *self) {
+    citer_filter_cmp_data_t *data = (citer_filter_cmp_data_t *) self->data;
+    for (;;) {
+        if (data->front_mask) {
+            size_t bit = citer_ctz64(data->front_mask);
+            data->front_mask &= data->front_mask - 1;
+            update_bound(self, data);
+            return data->base + ((data->front_start + bit) * data->stride);
+        }
+        if (data->front < data->back) {
+            size_t n = MIN(BLOCK_SIZE, data->back - data->front);
+            data->front_start = data->front;
+            data->front_mask = eval_block(data, data->base + (data->front * data->stride), data->stride, n);
+            data->front += n;
+            continue;
+        }
+        /* Everything else has been evaluated, so only the back block can
+         * contain items. */
+        if (data->back_mask) {
+            size_t bit = citer_ctz64(data->back_mask);
+            data->back_mask &= data->back_mask - 1;
+            update_bound(self, data);
+            return data->base + ((data->back_start + bit) * data->stride);
+        }
+        update_bound(self, data);
+        return NULL;
+    }
+}
+
+static void *citer_filter_cmp_array_next_back(iterator_t *self) {
+    citer_filter_cmp_data_t *data = (citer_filter_cmp_data_t *) self->data;
+    for (;;) {
+        if (data->back_mask) {
+            size_t bit = 63 - citer_clz64(data->back_mask);
+            data->back_mask &= ~(UINT64_C(1) << bit);
+            update_bound(self, data);
+            return data->base + ((data->back_start + bit) * data->stride);
+        }
+        if (data->front < data->back) {
+            size_t n = MIN(BLOCK_SIZE, data->back - data->front);
+            data->back -= n;
+            data->back_start = data->back;
+            data->back_mask = eval_block(data, data->base + (data->back * data->stride), data->stride, n);
+            continue;
+        }
+        if (data->front_mask) {
+            size_t bit = 63 - citer_clz64(data->front_mask);
+            data->front_mask &= ~(UINT64_C(1) << bit);
+            update_bound(self, data);
+            return data->base + ((data->front_start + bit) * data->stride);
+        }
+        update_bound(self, data);
+        return NULL;
+    }
+}
+
+static void *citer_filter_cmp_next(iterator_t *self) {
+    citer_filter_cmp_data_t *data = (citer_filter_cmp_data_t *) self->data;
+    void *item;
+    while ((item = citer_next(data->orig))) {
+        /* The lower bound is 0, so this only decreases the upper bound. */
+        citer_bound_sub(self->size_bound, 1);
+        if (eval_block(data, item, 0, 1))
+            return item;
+    }
+    return NULL;
+}
+
+static void *citer_filter_cmp_next_back(iterator_t *self) {
+    citer_filter_cmp_data_t *data = (citer_filter_cmp_data_t *) self->data;
+    void *item;
+    while ((item = citer_next_back(data->orig))) {
+        /* The lower bound is 0, so this only decreases the upper bound. */
+        citer_bound_sub(self->size_bound, 1);
+        if (eval_block(data, item, 0, 1))
+            return item;
+    }
+    return NULL;
+}
+
+static void citer_filter_cmp_free_data(void *_data) {
+    citer_filter_cmp_data_t *data = (citer_filter_cmp_data_t *) _data;
+    citer_free(data->orig);
+    free(data->preds);
+    free(data);
+}
+
+iterator_t *citer_filter_cmp(iterator_t *orig, const citer_cmp_pred_t *preds, size_t n_preds, citer_combine_t combine) {
+    if (n_preds == 0)
+        return NULL;
+
+    citer_filter_cmp_data_t *data = malloc(sizeof(*data));
+    *data = (citer_filter_cmp_data_t) {
+        .orig = orig,
+        .preds = malloc(n_preds * sizeof(*preds)),
+        .n_preds = n_preds,
+        .combine = combine,
+    };
+    memcpy(data->preds, preds, n_preds * sizeof(*preds));
+
+    /* When filtering, the upper bound does not change. The lower bound is 0. */
+    citer_size_bound_t size_bound = orig->size_bound;
+    size_bound.lower = 0;
+    size_bound.lower_infinite = false;
+
+    void *array;
+    size_t len;
+    if (citer_as_strided(orig, &array, &data->stride, &len)) {
+        data->base = (char *) array;
+        data->front = 0;
+        data->back = len;
+        return citer_new(
+            data,
+            citer_filter_cmp_array_next,
+            citer_filter_cmp_array_next_back,
+            citer_filter_cmp_free_data,
+            size_bound
+        );
+    }
+
+    return citer_new(
+        data,
+        citer_filter_cmp_next,
+        citer_is_double_ended(orig) ? citer_filter_cmp_next_back : NULL,
+        citer_filter_cmp_free_data,
+        size_bound
+    );
+}
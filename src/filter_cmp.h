@@ -0,0 +1,129 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_FILTER_CMP_H_
+#define _CITER_FILTER_CMP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "iterator.h"
+
+/*
+ * Numeric type of a field compared by a built-in predicate.
+ */
+typedef enum citer_num_type {
+    CITER_I32,
+    CITER_I64,
+    CITER_U32,
+    CITER_U64,
+    CITER_F32,
+    CITER_F64,
+} citer_num_type_t;
+
+/*
+ * Comparison operator of a built-in predicate.
+ *
+ * Each operator compares the field (x) against the predicate's value (a). The
+ * CITER_BETWEEN operator also uses the predicate's second value (b), and is
+ * true when a <= x < b.
+ */
+typedef enum citer_cmp_op {
+    CITER_LT,
+    CITER_LE,
+    CITER_GT,
+    CITER_GE,
+    CITER_EQ,
+    CITER_NE,
+    CITER_BETWEEN,
+} citer_cmp_op_t;
+
+/*
+ * Constant operand of a built-in predicate.
+ *
+ * Signed fields (CITER_I32, CITER_I64) are compared against the i member,
+ * unsigned fields against the u member, and floating-point fields against the
+ * f member.
+ */
+typedef union citer_num {
+    int64_t i;
+    uint64_t u;
+    double f;
+} citer_num_t;
+
+/*
+ * Built-in predicate descriptor.
+ *
+ * Describes a comparison on a numeric field of each item. Items are pointers
+ * to records, and the field is located offset bytes from the start of the
+ * record. For iterators over arrays of plain numbers, the offset is 0.
+ */
+typedef struct citer_cmp_pred {
+    size_t offset;
+    citer_num_type_t type;
+    citer_cmp_op_t op;
+    citer_num_t a;
+    citer_num_t b;
+} citer_cmp_pred_t;
+
+/*
+ * How multiple built-in predicates are combined.
+ */
+typedef enum citer_combine {
+    CITER_ALL_OF,
+    CITER_ANY_OF,
+} citer_combine_t;
+
+/*
+ * Evaluate a built-in predicate over a block of records.
+ *
+ * Parameters:
+ *   base - Pointer to the first record.
+ *   stride - Distance (in bytes) between consecutive records.
+ *   n - Number of records. Must be at most 64.
+ *   pred - The predicate to evaluate.
+ *
+ * Returns a bitmap in which bit i is set if and only if record i satisfies the
+ * predicate. Bitmaps of different predicates over the same block can be
+ * combined using bitwise AND and OR.
+ */
+uint64_t citer_cmp_eval(const void *base, size_t stride, size_t n, const citer_cmp_pred_t *pred);
+
+/*
+ * Iterator which filters out items that do not satisfy built-in predicates.
+ *
+ * Parameters:
+ *   orig - The iterator to filter. Its items must be pointers to records.
+ *   preds - Array of predicate descriptors. This array is copied, so it does
+ *           not need to outlive the iterator.
+ *   n_preds - Number of predicates. Must be greater than 0.
+ *   combine - Whether items must satisfy all predicates or any predicate.
+ *
+ * This behaves like citer_filter(), but does not call a function for each
+ * item. When the source is contiguous or strided (see citer_as_strided()),
+ * predicates are evaluated over blocks of 64 items at a time using vectorised
+ * comparisons, producing one bitmap per predicate. The bitmaps are combined,
+ * and the items are then yielded by walking the set bits.
+ *
+ * Returns a new iterator, or NULL if n_preds is 0.
+ * The returned iterator must be freed with citer_free().
+ * When this iterator is freed, the original iterator is also freed.
+ */
+iterator_t *citer_filter_cmp(iterator_t *orig, const citer_cmp_pred_t *preds, size_t n_preds, citer_combine_t combine);
+
+#endif /* _CITER_FILTER_CMP_H_ */
@@ -0,0 +1,382 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "filter_in_set.h"
+#include "over_array.h"
+#include "simd.h"
+#include "table.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Number of items probed at once. One bit per item in a uint64_t. */
+#define BLOCK_SIZE 64
+
+/* Bloom filter blocks: one cache line, as 8 words of 64 bits. */
+#define WORDS_PER_BLOCK 8
+#define BITS_PER_BLOCK (WORDS_PER_BLOCK * 64)
+#define CACHE_LINE 64
+
+/* Most bits set per key. */
+#define MAX_BITS_PER_KEY 16
+
+/* Largest table to allocate up front, in entries. */
+#define MAX_PRESIZE (1 << 20)
+
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+
+/* Odd multipliers which pick the bits of a key within its block. */
+static const uint64_t SALTS[MAX_BITS_PER_KEY] = {
+    UINT64_C(0x4164d8399f767c45), UINT64_C(0x5bc8fbbcbde5c099),
+    UINT64_C(0xb0c11fdecb91ce37), UINT64_C(0xd76d4330f1446beb),
+    UINT64_C(0xa6eb8c9ebd69fe29), UINT64_C(0x87b0b125ec1d7da1),
+    UINT64_C(0xd7210dff076ce2ef), UINT64_C(0xc6a5387777330bdb),
+    UINT64_C(0x3fc1ea36f17fd375), UINT64_C(0x0d464138a6233255),
+    UINT64_C(0x2827688de6a16a3b), UINT64_C(0x5f2dd97f1cfb10f7),
+    UINT64_C(0xde5271007814e8a3), UINT64_C(0x617959ce3f1f65a9),
+    UINT64_C(0x1a1afe878b33e969), UINT64_C(0x3fd4235992edcf45),
+};
+
+/*
+ * Blocked Bloom filter. A key sets (or tests) k bits of the block picked by
+ * the top bits of its (mixed) hash.
+ */
+typedef struct bloom {
+    uint64_t *blocks;
+    void *alloc;
+    size_t n_blocks;
+    unsigned k;
+} bloom_t;
+
+typedef struct citer_filter_in_set_data {
+    iterator_t *orig;
+    citer_set_ops_t ops;
+    bool exact;
+    bloom_t bloom;
+    citer_table_t set;
+
+    /* The fields below are only used when the source is contiguous (or
+     * strided), as in citer_filter_cmp(). Items in [front, back) have not been
+     * probed yet. The front and back blocks hold the bitmaps of matching items
+     * which have not been returned. */
+    char *base;
+    size_t stride;
+    size_t front;
+    size_t back;
+    size_t front_start;
+    uint64_t front_mask;
+    size_t back_start;
+    uint64_t back_mask;
+} citer_filter_in_set_data_t;
+
+/*
+ * Approximate log2(1/p) for p in (0, 1), without libm. Exact at powers of
+ * two, and within 0.1 in between.
+ */
+static double log2_inverse(double p) {
+    double n = 0;
+    while (p < 0.5) {
+        p *= 2;
+        n++;
+    }
+    return n + 2 * (1 - p);
+}
+
+static void bloom_init(bloom_t *bloom, size_t n_keys, double fp_rate) {
+    double bits = log2_inverse(fp_rate);
+    /* The optimal filter takes 1.44 bits per key per halving of the rate.
+     * Keeping each key in one block skews the load of the blocks, which costs
+     * more the more bits each key sets, so add a few percent per bit. */
+    double bits_per_key = bits * 1.44 * (1 + 0.02 * bits);
+    bloom->k = (unsigned) (bits + 0.5);
+    if (bloom->k < 1)
+        bloom->k = 1;
+    if (bloom->k > MAX_BITS_PER_KEY)
+        bloom->k = MAX_BITS_PER_KEY;
+
+    /* Blocks are picked with a 32-bit multiply, which limits them to 256 GiB. */
+    double n_blocks = bits_per_key * (double) n_keys / BITS_PER_BLOCK + 1;
+    bloom->n_blocks = (n_blocks < (double) UINT32_MAX) ? (size_t) n_blocks : UINT32_MAX;
+
+    /* Align the blocks to cache lines. */
+    bloom->alloc = calloc(bloom->n_blocks * CACHE_LINE + CACHE_LINE, 1);
+    bloom->blocks = (uint64_t *) (((uintptr_t) bloom->alloc + CACHE_LINE - 1) & ~(uintptr_t) (CACHE_LINE - 1));
+}
+
+/*
+ * Get the block of a mixed hash: its top 32 bits, scaled to the number of
+ * blocks (which need not be a power of two).
+ */
+static inline size_t bloom_block(const bloom_t *bloom, uint64_t x) {
+    return (size_t) (((x >> 32) * (uint64_t) bloom->n_blocks) >> 32);
+}
+
+/* Get the block of a hash, and the mask of its bits within the block. */
+static inline const uint64_t *bloom_mask(const bloom_t *bloom, uint64_t hash, uint64_t mask[WORDS_PER_BLOCK]) {
+    /* User hashes may have weak top bits, so mix them first. */
+    uint64_t x = citer_hash_u64(hash);
+    for (size_t w = 0; w < WORDS_PER_BLOCK; w++)
+        mask[w] = 0;
+    for (unsigned i = 0; i < bloom->k; i++) {
+        unsigned bit = (unsigned) ((x * SALTS[i]) >> 55);
+        mask[bit / 64] |= UINT64_C(1) << (bit % 64);
+    }
+    return bloom->blocks + bloom_block(bloom, x) * WORDS_PER_BLOCK;
+}
+
+static void bloom_add(bloom_t *bloom, uint64_t hash) {
+    uint64_t mask[WORDS_PER_BLOCK];
+    uint64_t *block = (uint64_t *) bloom_mask(bloom, hash, mask);
+    for (size_t w = 0; w < WORDS_PER_BLOCK; w++)
+        block[w] |= mask[w];
+}
+
+static inline bool bloom_test(const bloom_t *bloom, uint64_t hash) {
+    uint64_t mask[WORDS_PER_BLOCK];
+    const uint64_t *block = bloom_mask(bloom, hash, mask);
+    uint64_t missing = 0;
+    for (size_t w = 0; w < WORDS_PER_BLOCK; w++)
+        missing |= mask[w] & ~block[w];
+    return missing == 0;
+}
+
+static inline void bloom_prefetch(const bloom_t *bloom, uint64_t hash) {
+#if defined(__GNUC__)
+    __builtin_prefetch(bloom->blocks + bloom_block(bloom, citer_hash_u64(hash)) * WORDS_PER_BLOCK);
+#else
+    (void) bloom;
+    (void) hash;
+#endif
+}
+
+static inline void *item_key(const citer_filter_in_set_data_t *data, void *item) {
+    return data->ops.key ? data->ops.key(item, data->ops.fn_data) : item;
+}
+
+static inline bool contains(const citer_filter_in_set_data_t *data, void *key, uint64_t hash) {
+    if (data->exact)
+        return citer_table_find(&data->set, hash, key, data->ops.eq, data->ops.fn_data) != NULL;
+    return bloom_test(&data->bloom, hash);
+}
+
+/*
+ * Probe N items, stride bytes apart. All their hashes are computed and their
+ * cache lines prefetched before the first is tested.
+ */
+static uint64_t probe_block(const citer_filter_in_set_data_t *data, char *block, size_t n) {
+    void *keys[BLOCK_SIZE];
+    uint64_t hashes[BLOCK_SIZE];
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = item_key(data, block + i * data->stride);
+        hashes[i] = data->ops.hash(keys[i], data->ops.fn_data);
+        if (data->exact)
+            citer_table_prefetch(&data->set, hashes[i]);
+        else
+            bloom_prefetch(&data->bloom, hashes[i]);
+    }
+    uint64_t mask = 0;
+    for (size_t i = 0; i < n; i++)
+        mask |= (uint64_t) contains(data, keys[i], hashes[i]) << i;
+    return mask;
+}
+
+/*
+ * Update the size bound of a contiguous filter. The upper bound is the number
+ * of unprobed items plus the number of matches left in the blocks.
+ */
+static inline void update_bound(iterator_t *self, citer_filter_in_set_data_t *data) {
+    self->size_bound.upper = (data->back - data->front)
+                             + citer_popcount64(data->front_mask)
+                             + citer_popcount64(data->back_mask);
+}
+
+static void *citer_filter_in_set_array_next(iterator_t *self) {
+    citer_filter_in_set_data_t *data = (citer_filter_in_set_data_t *) self->data;
+    for (;;) {
+        if (data->front_mask) {
+            size_t bit = citer_ctz64(data->front_mask);
+            data->front_mask &= data->front_mask - 1;
+            update_bound(self, data);
+            return data->base + ((data->front_start + bit) * data->stride);
+        }
+        if (data->front < data->back) {
+            size_t n = MIN(BLOCK_SIZE, data->back - data->front);
+            data->front_start = data->front;
+            data->front_mask = probe_block(data, data->base + (data->front * data->stride), n);
+            data->front += n;
+            continue;
+        }
+        /* Everything else has been probed, so only the back block can contain
+         * items. */
+        if (data->back_mask) {
+            size_t bit = citer_ctz64(data->back_mask);
+            data->back_mask &= data->back_mask - 1;
+            update_bound(self, data);
+            return data->base + ((data->back_start + bit) * data->stride);
+        }
+        update_bound(self, data);
+        return NULL;
+    }
+}
+
+static void *citer_filter_in_set_array_next_back(iterator_t *self) {
+    citer_filter_in_set_data_t *data = (citer_filter_in_set_data_t *) self->data;
+    for (;;) {
+        if (data->back_mask) {
+            size_t bit = 63 - citer_clz64(data->back_mask);
+            data->back_mask &= ~(UINT64_C(1) << bit);
+            update_bound(self, data);
+            return data->base + ((data->back_start + bit) * data->stride);
+        }
+        if (data->front < data->back) {
+            size_t n = MIN(BLOCK_SIZE, data->back - data->front);
+            data->back -= n;
+            data->back_start = data->back;
+            data->back_mask = probe_block(data, data->base + (data->back * data->stride), n);
+            continue;
+        }
+        if (data->front_mask) {
+            size_t bit = 63 - citer_clz64(data->front_mask);
+            data->front_mask &= ~(UINT64_C(1) << bit);
+            update_bound(self, data);
+            return data->base + ((data->front_start + bit) * data->stride);
+        }
+        update_bound(self, data);
+        return NULL;
+    }
+}
+
+static void *citer_filter_in_set_next(iterator_t *self) {
+    citer_filter_in_set_data_t *data = (citer_filter_in_set_data_t *) self->data;
+    void *item;
+    while ((item = citer_next(data->orig))) {
+        /* The lower bound is 0, so this only decreases the upper bound. */
+        citer_bound_sub(self->size_bound, 1);
+        void *key = item_key(data, item);
+        if (contains(data, key, data->ops.hash(key, data->ops.fn_data)))
+            return item;
+    }
+    return NULL;
+}
+
+static void *citer_filter_in_set_next_back(iterator_t *self) {
+    citer_filter_in_set_data_t *data = (citer_filter_in_set_data_t *) self->data;
+    void *item;
+    while ((item = citer_next_back(data->orig))) {
+        /* The lower bound is 0, so this only decreases the upper bound. */
+        citer_bound_sub(self->size_bound, 1);
+        void *key = item_key(data, item);
+        if (contains(data, key, data->ops.hash(key, data->ops.fn_data)))
+            return item;
+    }
+    return NULL;
+}
+
+static void citer_filter_in_set_free_data(void *_data) {
+    citer_filter_in_set_data_t *data = (citer_filter_in_set_data_t *) _data;
+    citer_free(data->orig);
+    if (data->exact)
+        citer_table_free(&data->set);
+    else
+        free(data->bloom.alloc);
+    free(data);
+}
+
+/* Read the keys into a hash set. */
+static void build_set(citer_filter_in_set_data_t *data, iterator_t *key_it) {
+    size_t expected = 0;
+    if (!key_it->size_bound.upper_infinite)
+        expected = MIN(key_it->size_bound.upper, MAX_PRESIZE);
+    size_t entry_size = data->ops.key_size ? data->ops.key_size : sizeof(void *);
+    citer_table_init(&data->set, entry_size, data->ops.key_size, expected);
+    void *key;
+    bool inserted;
+    while ((key = citer_next(key_it)))
+        citer_table_insert(&data->set, data->ops.hash(key, data->ops.fn_data), key, data->ops.eq, data->ops.fn_data, &inserted);
+}
+
+/* Read the keys into a Bloom filter. The filter is sized from the number of
+ * keys, so their hashes are gathered first. */
+static void build_bloom(citer_filter_in_set_data_t *data, iterator_t *key_it, double fp_rate) {
+    size_t capacity = 64;
+    if (!key_it->size_bound.upper_infinite && key_it->size_bound.upper > capacity)
+        capacity = MIN(key_it->size_bound.upper, MAX_PRESIZE);
+    uint64_t *hashes = malloc(capacity * sizeof(*hashes));
+    size_t n = 0;
+    void *key;
+    while ((key = citer_next(key_it))) {
+        if (n == capacity) {
+            capacity *= 2;
+            hashes = realloc(hashes, capacity * sizeof(*hashes));
+        }
+        hashes[n++] = data->ops.hash(key, data->ops.fn_data);
+    }
+    bloom_init(&data->bloom, n, fp_rate);
+    for (size_t i = 0; i < n; i++)
+        bloom_add(&data->bloom, hashes[i]);
+    free(hashes);
+}
+
+iterator_t *citer_filter_in_set(iterator_t *it, iterator_t *key_it, const citer_set_ops_t *ops, double fp_rate) {
+    if (!(fp_rate >= 0 && fp_rate < 1))
+        return NULL;
+    if (fp_rate == 0 && !ops->eq)
+        return NULL;
+
+    citer_filter_in_set_data_t *data = malloc(sizeof(*data));
+    *data = (citer_filter_in_set_data_t) {
+        .orig = it,
+        .ops = *ops,
+        .exact = fp_rate == 0,
+    };
+    if (data->exact)
+        build_set(data, key_it);
+    else
+        build_bloom(data, key_it, fp_rate);
+    citer_free(key_it);
+
+    /* When filtering, the upper bound does not change. The lower bound is 0. */
+    citer_size_bound_t size_bound = it->size_bound;
+    size_bound.lower = 0;
+    size_bound.lower_infinite = false;
+
+    void *array;
+    size_t len;
+    if (citer_as_strided(it, &array, &data->stride, &len)) {
+        data->base = (char *) array;
+        data->front = 0;
+        data->back = len;
+        return citer_new(
+            data,
+            citer_filter_in_set_array_next,
+            citer_filter_in_set_array_next_back,
+            citer_filter_in_set_free_data,
+            size_bound
+        );
+    }
+
+    return citer_new(
+        data,
+        citer_filter_in_set_next,
+        citer_is_double_ended(it) ? citer_filter_in_set_next_back : NULL,
+        citer_filter_in_set_free_data,
+        size_bound
+    );
+}
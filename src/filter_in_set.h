@@ -0,0 +1,81 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_FILTER_IN_SET_H_
+#define _CITER_FILTER_IN_SET_H_
+
+#include <stddef.h>
+
+#include "group.h"
+#include "hash.h"
+#include "iterator.h"
+
+/*
+ * Description of a set membership filter.
+ *
+ * Fields:
+ *   key - Gets the key of an item of the filtered iterator. If NULL, each item
+ *         is its own key.
+ *   hash - Hash function for keys.
+ *   eq - Equality function for keys. Only used by exact filters.
+ *   key_size - Only used by exact filters. If 0, the set holds pointers to the
+ *              keys, which must stay valid while the filter is in use.
+ *              Otherwise, it holds copies of the keys' key_size bytes.
+ *   fn_data - Custom data to be passed to all the functions.
+ */
+typedef struct citer_set_ops {
+    citer_key_fn_t key;
+    citer_hash_fn_t hash;
+    citer_eq_fn_t eq;
+    size_t key_size;
+    void *fn_data;
+} citer_set_ops_t;
+
+/*
+ * Filter the items of an iterator by whether their keys are in a set.
+ *
+ * Parameters:
+ *   it - The iterator to filter.
+ *   key_it - Iterator over the keys of the set. It is read to the end, then
+ *            freed, before citer_filter_in_set() returns.
+ *   ops - Description of the keys. It is copied.
+ *   fp_rate - Rate of false positives allowed, in [0, 1).
+ *
+ * If fp_rate is greater than 0, the set is a blocked Bloom filter sized for
+ * that rate: all the bits of a key are in one 64-byte block, so that each
+ * lookup touches a single cache line. Items whose key is in the set are always
+ * yielded, as are about fp_rate of the others, so this is a cheap way to drop
+ * most non-matching items before an exact join or lookup. The filter keeps no
+ * hold of the keys.
+ *
+ * If fp_rate is 0, the set is an exact hash set (see citer_distinct()), and
+ * ops->eq must not be NULL.
+ *
+ * When the filtered iterator is contiguous (see citer_as_strided()), items are
+ * probed in blocks: all the keys of a block are hashed and their cache lines
+ * prefetched before any is tested, so that the cache misses of the lookups
+ * overlap.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees the filtered iterator as well, but not fn_data. Returns NULL if
+ * fp_rate is not in [0, 1) or the filter is exact and ops->eq is NULL; it and
+ * key_it are then left alone.
+ */
+iterator_t *citer_filter_in_set(iterator_t *it, iterator_t *key_it, const citer_set_ops_t *ops, double fp_rate);
+
+#endif /* _CITER_FILTER_IN_SET_H_ */
@@ -0,0 +1,424 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Needed for sysconf() when compiling with -std=c99. */
+#define _DEFAULT_SOURCE
+
+#include "group.h"
+#include "table.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Number of items hashed (and prefetched) at once. */
+#define BATCH_SIZE 64
+
+/* Largest table to allocate up front, in entries. */
+#define MAX_PRESIZE (1 << 16)
+
+/* How far ahead to prefetch slots when aggregating a partition. */
+#define PREFETCH_DISTANCE 16
+
+/* Fewest items worth giving a thread of its own. */
+#define MIN_ITEMS_PER_THREAD (1 << 14)
+
+/* Partitions per thread of citer_par_group_fold(), unless more are asked for. */
+#define PARTITIONS_PER_THREAD 4
+
+/*
+ * The groups are the entries of one table per partition. Groups before the
+ * front position and at or after the back position have been returned.
+ */
+typedef struct citer_group_data {
+    citer_group_ops_t ops;
+    size_t acc_offset;
+    citer_table_t *tables;
+    size_t n_tables;
+    size_t front_table;
+    size_t front_slot;
+    size_t back_table;
+    size_t back_slot;
+    size_t remaining;
+    citer_group_t group;
+} citer_group_data_t;
+
+/* An item of a partition, with its hash. */
+typedef struct citer_group_ref {
+    uint64_t hash;
+    void *item;
+} citer_group_ref_t;
+
+typedef struct citer_group_partition {
+    citer_group_ref_t *refs;
+    size_t len;
+    size_t capacity;
+} citer_group_partition_t;
+
+/* Get the partition of a hash, out of 2^bits partitions. */
+static size_t partition_of(uint64_t hash, unsigned bits) {
+    return bits ? (size_t) (hash >> (64 - bits)) : 0;
+}
+
+/* Smallest power of two which is at least n. */
+static unsigned log2_ceil(size_t n) {
+    unsigned bits = 0;
+    while (((size_t) 1 << bits) < n)
+        bits++;
+    return bits;
+}
+
+static size_t presize(size_t expected) {
+    return (expected < MAX_PRESIZE) ? expected : MAX_PRESIZE;
+}
+
+static void group_table_init(const citer_group_ops_t *ops, citer_table_t *t, size_t expected) {
+    citer_table_init(t, citer_table_value_offset(ops->key_size) + ops->acc_size, ops->key_size, presize(expected));
+}
+
+/* Add an item to its group, creating the group if needed. */
+static void aggregate(const citer_group_ops_t *ops, citer_table_t *t, size_t acc_offset, void *item, void *key, uint64_t hash) {
+    bool inserted;
+    char *entry = citer_table_insert(t, hash, key, ops->eq, ops->fn_data, &inserted);
+    void *acc = entry + acc_offset;
+    if (inserted && ops->init)
+        ops->init(acc, citer_table_key(t, entry), ops->fn_data);
+    ops->acc(acc, item, ops->fn_data);
+}
+
+/*
+ * Aggregate all the items of an iterator into one table, a batch at a time.
+ * Batches hold on to items, so items which may be reused (when keys are
+ * copied) are aggregated one at a time instead.
+ */
+static void aggregate_batches(const citer_group_ops_t *ops, citer_table_t *t, size_t acc_offset, iterator_t *it) {
+    if (ops->key_size) {
+        void *item;
+        while ((item = citer_next(it))) {
+            void *key = ops->key(item, ops->fn_data);
+            aggregate(ops, t, acc_offset, item, key, ops->hash(key, ops->fn_data));
+        }
+        return;
+    }
+
+    void *items[BATCH_SIZE];
+    void *keys[BATCH_SIZE];
+    uint64_t hashes[BATCH_SIZE];
+    size_t n;
+    do {
+        n = citer_next_batch(it, items, BATCH_SIZE);
+        for (size_t i = 0; i < n; i++) {
+            keys[i] = ops->key(items[i], ops->fn_data);
+            hashes[i] = ops->hash(keys[i], ops->fn_data);
+            citer_table_prefetch(t, hashes[i]);
+        }
+        for (size_t i = 0; i < n; i++)
+            aggregate(ops, t, acc_offset, items[i], keys[i], hashes[i]);
+    } while (n == BATCH_SIZE);
+}
+
+/*
+ * Split the items of an iterator into n_partitions (a power of two) by the
+ * top bits of their hashes, then aggregate each partition into its own table.
+ */
+static void aggregate_partitioned(const citer_group_ops_t *ops, citer_table_t *tables, size_t n_partitions, size_t acc_offset, iterator_t *it) {
+    unsigned bits = log2_ceil(n_partitions);
+    citer_group_partition_t *partitions = calloc(n_partitions, sizeof(*partitions));
+
+    void *items[BATCH_SIZE];
+    size_t n;
+    do {
+        n = citer_next_batch(it, items, BATCH_SIZE);
+        for (size_t i = 0; i < n; i++) {
+            uint64_t hash = ops->hash(ops->key(items[i], ops->fn_data), ops->fn_data);
+            citer_group_partition_t *p = &partitions[partition_of(hash, bits)];
+            if (p->len == p->capacity) {
+                p->capacity = p->capacity ? 2 * p->capacity : 256;
+                p->refs = realloc(p->refs, p->capacity * sizeof(*p->refs));
+            }
+            p->refs[p->len].hash = hash;
+            p->refs[p->len].item = items[i];
+            p->len++;
+        }
+    } while (n == BATCH_SIZE);
+
+    for (size_t k = 0; k < n_partitions; k++) {
+        citer_group_partition_t *p = &partitions[k];
+        citer_table_t *t = &tables[k];
+        group_table_init(ops, t, p->len);
+        for (size_t i = 0; i < p->len; i++) {
+            if (i + PREFETCH_DISTANCE < p->len)
+                citer_table_prefetch(t, p->refs[i + PREFETCH_DISTANCE].hash);
+            void *item = p->refs[i].item;
+            aggregate(ops, t, acc_offset, item, ops->key(item, ops->fn_data), p->refs[i].hash);
+        }
+        free(p->refs);
+    }
+    free(partitions);
+}
+
+/* Point the group at the entry in a slot, and count it as returned. */
+static citer_group_t *take_group(iterator_t *self, citer_table_t *t, size_t slot) {
+    citer_group_data_t *data = (citer_group_data_t *) self->data;
+    char *entry = citer_table_entry(t, slot);
+    data->group.key = citer_table_key(t, entry);
+    data->group.acc = entry + data->acc_offset;
+    data->remaining--;
+    citer_bound_sub(self->size_bound, 1);
+    return &data->group;
+}
+
+static void *citer_group_next(iterator_t *self) {
+    citer_group_data_t *data = (citer_group_data_t *) self->data;
+    if (!data->remaining)
+        return NULL;
+    /* There is a group ahead, so this stops before the end of the tables. */
+    for (;;) {
+        citer_table_t *t = &data->tables[data->front_table];
+        if (data->front_slot == t->capacity) {
+            data->front_table++;
+            data->front_slot = 0;
+        } else if (citer_table_occupied(t, data->front_slot++)) {
+            return take_group(self, t, data->front_slot - 1);
+        }
+    }
+}
+
+static void *citer_group_next_back(iterator_t *self) {
+    citer_group_data_t *data = (citer_group_data_t *) self->data;
+    if (!data->remaining)
+        return NULL;
+    for (;;) {
+        if (data->back_slot == 0) {
+            data->back_table--;
+            data->back_slot = data->tables[data->back_table].capacity;
+            continue;
+        }
+        citer_table_t *t = &data->tables[data->back_table];
+        if (citer_table_occupied(t, --data->back_slot))
+            return take_group(self, t, data->back_slot);
+    }
+}
+
+static void citer_group_free_data(void *_data) {
+    citer_group_data_t *data = (citer_group_data_t *) _data;
+    for (size_t i = 0; i < data->n_tables; i++)
+        citer_table_free(&data->tables[i]);
+    free(data->tables);
+    free(data);
+}
+
+/*
+ * Make an iterator over the groups in an array of tables, taking ownership of
+ * the tables.
+ */
+static iterator_t *groups_iterator(const citer_group_ops_t *ops, citer_table_t *tables, size_t n_tables) {
+    citer_group_data_t *data = malloc(sizeof(*data));
+    data->ops = *ops;
+    data->acc_offset = citer_table_value_offset(ops->key_size);
+    data->tables = tables;
+    data->n_tables = n_tables;
+    data->front_table = 0;
+    data->front_slot = 0;
+    data->back_table = n_tables - 1;
+    data->back_slot = tables[n_tables - 1].capacity;
+    data->remaining = 0;
+    for (size_t i = 0; i < n_tables; i++)
+        data->remaining += tables[i].count;
+
+    return citer_new(
+        data,
+        citer_group_next,
+        citer_group_next_back,
+        citer_group_free_data,
+        (citer_size_bound_t) {
+            .lower = data->remaining,
+            .upper = data->remaining,
+            .lower_infinite = false,
+            .upper_infinite = false,
+        }
+    );
+}
+
+/* Expected number of items of an iterator, from its size bound. */
+static size_t expected_items(iterator_t *it) {
+    return it->size_bound.upper_infinite ? 0 : it->size_bound.upper;
+}
+
+iterator_t *citer_group_fold(iterator_t *it, const citer_group_ops_t *ops) {
+    size_t acc_offset = citer_table_value_offset(ops->key_size);
+    size_t n_tables = 1;
+    while (n_tables < ops->partitions)
+        n_tables *= 2;
+    citer_table_t *tables = malloc(n_tables * sizeof(*tables));
+
+    if (n_tables > 1) {
+        aggregate_partitioned(ops, tables, n_tables, acc_offset, it);
+    } else {
+        group_table_init(ops, &tables[0], expected_items(it));
+        aggregate_batches(ops, &tables[0], acc_offset, it);
+    }
+    citer_free(it);
+    return groups_iterator(ops, tables, n_tables);
+}
+
+/*
+ * A worker of citer_par_group_fold(). In the first phase, it aggregates its
+ * split of the source into its own tables, one per partition. In the second
+ * phase, it merges the tables of every worker for the partitions
+ * first_partition, first_partition + n_workers, etc. into the first worker's
+ * tables.
+ */
+typedef struct par_worker {
+    const citer_group_ops_t *ops;
+    size_t acc_offset;
+    iterator_t *it;
+    size_t n_items;
+    citer_table_t *tables;
+    unsigned bits;
+    struct par_worker *workers;
+    size_t n_workers;
+    size_t first_partition;
+} par_worker_t;
+
+static void *par_aggregate(void *_worker) {
+    par_worker_t *worker = (par_worker_t *) _worker;
+    const citer_group_ops_t *ops = worker->ops;
+    size_t n_partitions = (size_t) 1 << worker->bits;
+    for (size_t k = 0; k < n_partitions; k++)
+        group_table_init(ops, &worker->tables[k], worker->n_items / n_partitions);
+
+    void *items[BATCH_SIZE];
+    void *keys[BATCH_SIZE];
+    uint64_t hashes[BATCH_SIZE];
+    /* Batches hold on to items, which may be reused when keys are copied. */
+    size_t batch_size = ops->key_size ? 1 : BATCH_SIZE;
+    size_t n;
+    do {
+        n = citer_next_batch(worker->it, items, batch_size);
+        for (size_t i = 0; i < n; i++) {
+            keys[i] = ops->key(items[i], ops->fn_data);
+            hashes[i] = ops->hash(keys[i], ops->fn_data);
+            citer_table_prefetch(&worker->tables[partition_of(hashes[i], worker->bits)], hashes[i]);
+        }
+        for (size_t i = 0; i < n; i++) {
+            citer_table_t *t = &worker->tables[partition_of(hashes[i], worker->bits)];
+            aggregate(ops, t, worker->acc_offset, items[i], keys[i], hashes[i]);
+        }
+    } while (n == batch_size);
+    return NULL;
+}
+
+static void *par_merge(void *_worker) {
+    par_worker_t *worker = (par_worker_t *) _worker;
+    const citer_group_ops_t *ops = worker->ops;
+    size_t n_partitions = (size_t) 1 << worker->bits;
+    for (size_t k = worker->first_partition; k < n_partitions; k += worker->n_workers) {
+        citer_table_t *dst = &worker->workers[0].tables[k];
+        for (size_t w = 1; w < worker->n_workers; w++) {
+            citer_table_t *src = &worker->workers[w].tables[k];
+            for (size_t slot = 0; slot < src->capacity; slot++) {
+                if (!citer_table_occupied(src, slot))
+                    continue;
+                /* Stored hashes are reused, without hashing keys again. */
+                char *src_entry = citer_table_entry(src, slot);
+                bool inserted;
+                char *dst_entry = citer_table_insert(dst, src->hashes[slot], citer_table_key(src, src_entry), ops->eq, ops->fn_data, &inserted);
+                if (inserted)
+                    memcpy(dst_entry + worker->acc_offset, src_entry + worker->acc_offset, ops->acc_size);
+                else
+                    ops->merge(dst_entry + worker->acc_offset, src_entry + worker->acc_offset, ops->fn_data);
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Run a function on each worker, the first one on this thread. Workers which
+ * can't be started on their own thread run on this thread too.
+ */
+static void run_workers(void *(*fn)(void *), par_worker_t *workers, size_t n_workers) {
+    pthread_t *threads = malloc(n_workers * sizeof(*threads));
+    bool *started = calloc(n_workers, sizeof(*started));
+    for (size_t w = 1; w < n_workers; w++)
+        started[w] = (pthread_create(&threads[w], NULL, fn, &workers[w]) == 0);
+    for (size_t w = 0; w < n_workers; w++) {
+        if (!started[w])
+            fn(&workers[w]);
+    }
+    for (size_t w = 1; w < n_workers; w++) {
+        if (started[w])
+            pthread_join(threads[w], NULL);
+    }
+    free(threads);
+    free(started);
+}
+
+iterator_t *citer_par_group_fold(iterator_t *it, const citer_group_ops_t *ops, size_t n_threads) {
+    if (n_threads == 0) {
+        long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = (n_cpus > 0) ? (size_t) n_cpus : 1;
+    }
+    size_t n_items = it->size_bound.upper;
+    size_t max_threads = n_items / MIN_ITEMS_PER_THREAD + 1;
+    if (n_threads > max_threads)
+        n_threads = max_threads;
+    if ((n_threads < 2) || !ops->merge || !citer_is_splittable(it) || !citer_has_exact_size(it))
+        return citer_group_fold(it, ops);
+
+    size_t n_partitions = PARTITIONS_PER_THREAD * n_threads;
+    if (ops->partitions > n_partitions)
+        n_partitions = ops->partitions;
+    unsigned bits = log2_ceil(n_partitions);
+    n_partitions = (size_t) 1 << bits;
+
+    /* Split the source into consecutive pieces, one per worker. */
+    size_t per_worker = n_items / n_threads + 1;
+    par_worker_t *workers = calloc(n_threads, sizeof(*workers));
+    for (size_t w = 0; w < n_threads; w++) {
+        workers[w] = (par_worker_t) {
+            .ops = ops,
+            .acc_offset = citer_table_value_offset(ops->key_size),
+            .it = (w == 0) ? it : citer_split_at(workers[w - 1].it, per_worker),
+            .n_items = per_worker,
+            .tables = malloc(n_partitions * sizeof(citer_table_t)),
+            .bits = bits,
+            .workers = workers,
+            .n_workers = n_threads,
+            .first_partition = w,
+        };
+    }
+
+    run_workers(par_aggregate, workers, n_threads);
+    run_workers(par_merge, workers, n_threads);
+
+    for (size_t w = 0; w < n_threads; w++) {
+        citer_free(workers[w].it);
+        if (w > 0) {
+            for (size_t k = 0; k < n_partitions; k++)
+                citer_table_free(&workers[w].tables[k]);
+            free(workers[w].tables);
+        }
+    }
+    citer_table_t *tables = workers[0].tables;
+    free(workers);
+    return groups_iterator(ops, tables, n_partitions);
+}
@@ -0,0 +1,156 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_GROUP_H_
+#define _CITER_GROUP_H_
+
+#include <stddef.h>
+
+#include "hash.h"
+#include "iterator.h"
+
+/*
+ * Function which gets the key of an item, for citer_group_fold().
+ *
+ * Returns a pointer to the key, e.g. to a field of the item.
+ */
+typedef void *(*citer_key_fn_t)(void *item, void *fn_data);
+
+/*
+ * Function which initialises the accumulator of a new group. The accumulator
+ * is zeroed before it is called.
+ */
+typedef void (*citer_group_init_fn_t)(void *acc, void *key, void *fn_data);
+
+/*
+ * Function which adds an item to the accumulator of its group.
+ */
+typedef void (*citer_group_acc_fn_t)(void *acc, void *item, void *fn_data);
+
+/*
+ * Function which merges the accumulator src into the accumulator dst of the
+ * same group, for citer_par_group_fold().
+ */
+typedef void (*citer_group_merge_fn_t)(void *dst, void *src, void *fn_data);
+
+/*
+ * Description of a per-key aggregation.
+ *
+ * Fields:
+ *   key - Gets the key of an item.
+ *   hash - Hash function for keys.
+ *   eq - Equality function for keys.
+ *   key_size - If not 0, keys are key_size bytes long and are copied into the
+ *              table, so items (and keys) only need to stay valid until they
+ *              are aggregated. If 0, only pointers to the keys are kept, and
+ *              the keys must stay valid while the result is in use.
+ *   acc_size - Size (in bytes) of each accumulator. Accumulators are stored
+ *              inline in the table, aligned to 8 bytes.
+ *   init - Initialises the accumulator of a new group. May be NULL, in which
+ *          case accumulators start zeroed.
+ *   acc - Adds an item to the accumulator of its group.
+ *   merge - Merges two accumulators of the same group. Only needed by
+ *           citer_par_group_fold().
+ *   fn_data - Custom data to be passed to all the functions.
+ *   partitions - If greater than 1, the number of partitions to aggregate
+ *                separately (see citer_group_fold()). Rounded up to a power of
+ *                two.
+ */
+typedef struct citer_group_ops {
+    citer_key_fn_t key;
+    citer_hash_fn_t hash;
+    citer_eq_fn_t eq;
+    size_t key_size;
+    size_t acc_size;
+    citer_group_init_fn_t init;
+    citer_group_acc_fn_t acc;
+    citer_group_merge_fn_t merge;
+    void *fn_data;
+    size_t partitions;
+} citer_group_ops_t;
+
+/*
+ * A group: its key and its accumulator.
+ */
+typedef struct citer_group {
+    void *key;
+    void *acc;
+} citer_group_t;
+
+/*
+ * Aggregate the items of an iterator per key, like a citer_fold() for each
+ * distinct key.
+ *
+ * Parameters:
+ *   it - The iterator to aggregate. It is consumed and freed.
+ *   ops - Description of the aggregation. It is copied.
+ *
+ * The groups are kept in a flat open-addressing hash table with linear
+ * probing, with the keys (when key_size is not 0) and the accumulators stored
+ * inline in the table's entries, and the keys' hashes in an array of their
+ * own. The table is sized up front from the source's upper size bound (up to
+ * a limit). When keys are not copied (key_size is 0), items are taken from the
+ * source in batches: the hashes of a whole batch are computed first, and their
+ * slots prefetched, so that the cache misses of a batch overlap.
+ *
+ * With many keys, a table which doesn't fit in the cache makes every item a
+ * cache miss. If ops->partitions is greater than 1, the aggregation is done in
+ * two phases instead: the items are first split into partitions by hash, then
+ * each partition is aggregated into a table of its own, which is more likely
+ * to fit in the cache. This requires the items to stay valid until
+ * citer_group_fold() returns, e.g. items of citer_over_array().
+ *
+ * The aggregation is done before citer_group_fold() returns.
+ *
+ * Returns an exact-sized, double-ended iterator over the groups, in no
+ * particular order. Each item is a pointer to a citer_group_t, which is reused:
+ * it is overwritten by the next call to citer_next() or citer_next_back().
+ * The keys and accumulators it points to stay valid until the iterator is
+ * freed. The returned iterator must be freed with citer_free().
+ */
+iterator_t *citer_group_fold(iterator_t *it, const citer_group_ops_t *ops);
+
+/*
+ * Aggregate the items of an iterator per key, using several threads.
+ *
+ * Parameters:
+ *   it - The iterator to aggregate. It is consumed and freed.
+ *   ops - Description of the aggregation, as for citer_group_fold(). The merge
+ *         function is required, and all the functions must be safe to call
+ *         from several threads at once.
+ *   n_threads - Number of threads to use, or 0 to use one per CPU.
+ *
+ * The source is split (see citer_split_at()) into one piece per thread. Each
+ * thread aggregates its piece into tables of its own, one per partition of the
+ * hashes. Then each partition is merged by a single thread, which combines the
+ * accumulators of its keys from every thread with ops->merge. Threads never
+ * share a table, so no locks are needed. The number of partitions is a few
+ * per thread, or ops->partitions if that is more.
+ *
+ * Items with equal keys may be aggregated by different threads, so the items
+ * of a group are not added to its accumulator in order.
+ *
+ * If the source cannot be split, its size is not exact, ops->merge is NULL, or
+ * there are too few items to be worth dividing, this is the same as
+ * citer_group_fold().
+ *
+ * Returns an iterator over the groups, as for citer_group_fold().
+ */
+iterator_t *citer_par_group_fold(iterator_t *it, const citer_group_ops_t *ops, size_t n_threads);
+
+#endif /* _CITER_GROUP_H_ */
@@ -0,0 +1,142 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "hash.h"
+#include "table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Multiplier of the mixing functions (from splitmix64). */
+#define MIX1 0xbf58476d1ce4e5b9ULL
+#define MIX2 0x94d049bb133111ebULL
+
+uint64_t citer_hash_u64(uint64_t x) {
+    x ^= x >> 30;
+    x *= MIX1;
+    x ^= x >> 27;
+    x *= MIX2;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t citer_hash_bytes(const void *p, size_t len) {
+    const unsigned char *bytes = (const unsigned char *) p;
+    uint64_t h = len * MIX2;
+    /* Eight bytes at a time, then the rest. */
+    for (; len >= 8; bytes += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, sizeof(word));
+        h = (h ^ citer_hash_u64(word)) * MIX1;
+    }
+    if (len > 0) {
+        uint64_t word = 0;
+        memcpy(&word, bytes, len);
+        h = (h ^ citer_hash_u64(word)) * MIX1;
+    }
+    return citer_hash_u64(h);
+}
+
+/* Smallest power of two which is at least n (and at least 16). */
+static size_t table_capacity(size_t n) {
+    size_t capacity = 16;
+    while (capacity < n)
+        capacity *= 2;
+    return capacity;
+}
+
+void citer_table_init(citer_table_t *t, size_t entry_size, size_t key_size, size_t expected) {
+    /* Round up to keep entries aligned. */
+    t->entry_size = (entry_size + 7) & ~(size_t) 7;
+    t->key_size = key_size;
+    t->capacity = table_capacity(expected + expected / 3 + 1);
+    t->count = 0;
+    t->hashes = calloc(t->capacity, sizeof(*t->hashes));
+    t->entries = malloc(t->capacity * t->entry_size);
+}
+
+void citer_table_free(citer_table_t *t) {
+    free(t->hashes);
+    free(t->entries);
+}
+
+/* Double the capacity, moving entries to their new slots. */
+static void table_grow(citer_table_t *t) {
+    citer_table_t old = *t;
+    t->capacity *= 2;
+    t->hashes = calloc(t->capacity, sizeof(*t->hashes));
+    t->entries = malloc(t->capacity * t->entry_size);
+
+    size_t mask = t->capacity - 1;
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (!old.hashes[i])
+            continue;
+        size_t slot = old.hashes[i] & mask;
+        while (t->hashes[slot])
+            slot = (slot + 1) & mask;
+        t->hashes[slot] = old.hashes[i];
+        memcpy(citer_table_entry(t, slot), citer_table_entry(&old, i), t->entry_size);
+    }
+    citer_table_free(&old);
+}
+
+/*
+ * Find the slot of a key, or the empty slot where it would be inserted.
+ */
+static size_t table_probe(const citer_table_t *t, uint64_t hash, void *key, citer_eq_fn_t eq, void *fn_data) {
+    size_t mask = t->capacity - 1;
+    size_t slot = hash & mask;
+    for (;;) {
+        uint64_t h = t->hashes[slot];
+        if (!h)
+            return slot;
+        if (h == hash && eq(citer_table_key(t, citer_table_entry(t, slot)), key, fn_data))
+            return slot;
+        slot = (slot + 1) & mask;
+    }
+}
+
+void *citer_table_find(const citer_table_t *t, uint64_t hash, void *key, citer_eq_fn_t eq, void *fn_data) {
+    hash = citer_table_hash(hash);
+    size_t slot = table_probe(t, hash, key, eq, fn_data);
+    return t->hashes[slot] ? citer_table_entry(t, slot) : NULL;
+}
+
+void *citer_table_insert(citer_table_t *t, uint64_t hash, void *key, citer_eq_fn_t eq, void *fn_data, bool *inserted) {
+    hash = citer_table_hash(hash);
+    size_t slot = table_probe(t, hash, key, eq, fn_data);
+    if (t->hashes[slot]) {
+        *inserted = false;
+        return citer_table_entry(t, slot);
+    }
+
+    if (4 * (t->count + 1) > 3 * t->capacity) {
+        table_grow(t);
+        slot = table_probe(t, hash, key, eq, fn_data);
+    }
+    t->hashes[slot] = hash;
+    t->count++;
+    void *entry = citer_table_entry(t, slot);
+    memset(entry, 0, t->entry_size);
+    if (t->key_size)
+        memcpy(entry, key, t->key_size);
+    else
+        *(void **) entry = key;
+    *inserted = true;
+    return entry;
+}
@@ -0,0 +1,54 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_HASH_H_
+#define _CITER_HASH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Hash function for hash-based adapters such as citer_distinct().
+ *
+ * The first argument is the item (or key) to hash, and the second is custom
+ * data given to the adapter. Items which compare equal must have the same
+ * hash. Any 64-bit value is allowed, but the better the bits are mixed, the
+ * fewer collisions; see citer_hash_u64() and citer_hash_bytes().
+ */
+typedef uint64_t (*citer_hash_fn_t)(void *item, void *fn_data);
+
+/*
+ * Equality function for hash-based adapters.
+ *
+ * Returns true if and only if the two items (or keys) are equal. The third
+ * argument is custom data given to the adapter.
+ */
+typedef bool (*citer_eq_fn_t)(void *item1, void *item2, void *fn_data);
+
+/*
+ * Hash a 64-bit integer, mixing all of its bits into all of the hash's bits.
+ */
+uint64_t citer_hash_u64(uint64_t x);
+
+/*
+ * Hash LEN bytes of memory.
+ */
+uint64_t citer_hash_bytes(const void *p, size_t len);
+
+#endif /* _CITER_HASH_H_ */
@@ -0,0 +1,830 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Needed for the POSIX I/O functions when compiling with -std=c99. */
+#define _DEFAULT_SOURCE
+
+#include "io.h"
+#include "over_array.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+/* io_uring is used through raw system calls, so only the kernel headers are
+ * needed, not liburing. */
+#if defined(__linux__) && defined(__GNUC__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+/* IORING_OP_READ was added in the same version as this feature flag. */
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define CITER_HAVE_URING 1
+#endif
+#endif
+#endif
+
+#ifndef CITER_HAVE_URING
+#define CITER_HAVE_URING 0
+#endif
+
+/*
+ * Records in [pos, filled) of the current buffer have not been returned yet.
+ */
+typedef struct citer_read_records_data {
+    int fd;
+    size_t record_size;
+    size_t capacity;
+    char *bufs[2];
+    int cur;
+    size_t pos;
+    size_t filled;
+    bool eof;
+    int error;
+} citer_read_records_data_t;
+
+/*
+ * Read into buf until it holds len bytes, the end of the file is reached, or a
+ * read fails. Returns the number of bytes read. Sets *eof at the end of the
+ * file or on failure, and *error on failure.
+ */
+static size_t read_full(int fd, char *buf, size_t len, bool *eof, int *error) {
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = read(fd, buf + total, len - total);
+        if (n > 0) {
+            total += (size_t) n;
+        } else if (n == 0) {
+            *eof = true;
+            break;
+        } else if (errno != EINTR) {
+            *error = errno;
+            *eof = true;
+            break;
+        }
+    }
+    return total;
+}
+
+/*
+ * Get the size bound of an iterator over the records of a file descriptor,
+ * starting at its current offset. Sets *regular (and *offset to the current
+ * offset) if the descriptor is a regular file, whose size is known.
+ */
+static citer_size_bound_t records_bound(int fd, size_t record_size, bool *regular, off_t *offset) {
+    citer_size_bound_t size_bound = {
+        .lower = 0,
+        .upper = 0,
+        .lower_infinite = false,
+        .upper_infinite = true,
+    };
+    *regular = false;
+
+    struct stat st;
+    if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && ((*offset = lseek(fd, 0, SEEK_CUR)) >= 0)) {
+        size_t remaining = (st.st_size > *offset) ? (size_t) (st.st_size - *offset) : 0;
+        size_bound.lower = remaining / record_size;
+        size_bound.upper = remaining / record_size;
+        size_bound.upper_infinite = false;
+        *regular = true;
+    }
+    return size_bound;
+}
+
+/*
+ * End the iteration. The end of the file (or an error) may cut the iteration
+ * short, so there are no more items, whatever the bounds said.
+ */
+static void *records_end(iterator_t *self) {
+    self->size_bound.lower = 0;
+    self->size_bound.upper = 0;
+    self->size_bound.upper_infinite = false;
+    return NULL;
+}
+
+/*
+ * Switch to the other buffer, moving the leftover bytes of a straddling
+ * record to its start, and fill the rest of it.
+ */
+static void refill(citer_read_records_data_t *data) {
+    int next = 1 - data->cur;
+    size_t leftover = data->filled - data->pos;
+    memcpy(data->bufs[next], data->bufs[data->cur] + data->pos, leftover);
+    data->cur = next;
+    data->pos = 0;
+    data->filled = leftover + read_full(data->fd, data->bufs[next] + leftover, data->capacity - leftover, &data->eof, &data->error);
+}
+
+static void *citer_read_records_next(iterator_t *self) {
+    citer_read_records_data_t *data = (citer_read_records_data_t *) self->data;
+    if (data->filled - data->pos < data->record_size) {
+        if (!data->eof)
+            refill(data);
+        if (data->filled - data->pos < data->record_size)
+            return records_end(self);
+    }
+
+    citer_bound_sub(self->size_bound, 1);
+    void *record = data->bufs[data->cur] + data->pos;
+    data->pos += data->record_size;
+    return record;
+}
+
+static void citer_read_records_free_data(void *_data) {
+    citer_read_records_data_t *data = (citer_read_records_data_t *) _data;
+    free(data->bufs[0]);
+    free(data->bufs[1]);
+    free(data);
+}
+
+iterator_t *citer_read_records(int fd, size_t record_size, size_t buffer_bytes) {
+    if (record_size == 0)
+        return NULL;
+    if (buffer_bytes < record_size)
+        buffer_bytes = record_size;
+
+    citer_read_records_data_t *data = malloc(sizeof(*data));
+    *data = (citer_read_records_data_t) {
+        .fd = fd,
+        .record_size = record_size,
+        .capacity = buffer_bytes,
+        .bufs = { malloc(buffer_bytes), malloc(buffer_bytes) },
+        .cur = 0,
+        .pos = 0,
+        .filled = 0,
+        .eof = false,
+        .error = 0,
+    };
+
+    /* The number of records is known in advance for regular files. */
+    bool regular;
+    off_t offset;
+    citer_size_bound_t size_bound = records_bound(fd, record_size, &regular, &offset);
+
+    return citer_new(
+        data,
+        citer_read_records_next,
+        NULL,
+        citer_read_records_free_data,
+        size_bound
+    );
+}
+
+#if CITER_HAVE_URING
+/*
+ * Minimal io_uring interface: a submission queue and a completion queue,
+ * shared with the kernel through memory maps.
+ */
+typedef struct citer_uring {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    size_t sqes_len;
+} citer_uring_t;
+
+static bool uring_init(citer_uring_t *ring, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = (int) syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0)
+        return false;
+    /* Plain reads need a newer kernel than io_uring itself. */
+    if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+        close(fd);
+        return false;
+    }
+
+    ring->fd = fd;
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len)
+            ring->sq_len = ring->cq_len;
+        ring->cq_len = ring->sq_len;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            munmap(ring->sq_ptr, ring->sq_len);
+            close(fd);
+            return false;
+        }
+    }
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_ptr != ring->sq_ptr)
+            munmap(ring->cq_ptr, ring->cq_len);
+        munmap(ring->sq_ptr, ring->sq_len);
+        close(fd);
+        return false;
+    }
+
+    char *sq = (char *) ring->sq_ptr;
+    char *cq = (char *) ring->cq_ptr;
+    ring->sq_head = (unsigned *) (sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + p.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+    return true;
+}
+
+static void uring_destroy(citer_uring_t *ring) {
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr)
+        munmap(ring->cq_ptr, ring->cq_len);
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+}
+
+/* Queue a read. It is submitted by the next call to uring_enter(). There must
+ * be a free submission queue entry. */
+static void uring_queue_read(citer_uring_t *ring, int fd, void *buf, size_t len, off_t offset, uint64_t user_data) {
+    /* Only this thread adds entries, so the tail can be read plainly. */
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) buf;
+    sqe->len = (uint32_t) len;
+    sqe->off = (uint64_t) offset;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    /* Publish the entry before the new tail. */
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/* Number of queued reads which the kernel has not consumed yet. */
+static unsigned uring_unsubmitted(const citer_uring_t *ring) {
+    return *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Submit queued reads, and wait for at least min_complete completions.
+ *
+ * Returns false if the kernel is short of resources (EAGAIN) or the completion
+ * queue is full (EBUSY). Neither goes away by retrying at once: completions
+ * must be reaped first, so this is left to the caller. Reads which were not
+ * submitted stay queued, and are submitted by the next call.
+ */
+static bool uring_enter(citer_uring_t *ring, unsigned min_complete) {
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    while (syscall(__NR_io_uring_enter, ring->fd, uring_unsubmitted(ring), min_complete, flags, NULL, 0) < 0) {
+        if (errno != EINTR)
+            return false;
+    }
+    return true;
+}
+#endif /* CITER_HAVE_URING */
+
+/*
+ * Buffers are filled in sequence, and buffer number SEQ is stored in slot
+ * (SEQ % n_bufs). The consumer holds the buffer it is reading (cur) and the one
+ * before it, so that records stay valid for a buffer's worth of records. The
+ * other n_bufs - 2 slots are being filled in the background.
+ *
+ * Buffers are a whole number of records long, so records never straddle
+ * buffers, except for a partial record at the end of the file.
+ */
+typedef struct citer_async_records_data {
+    int fd;
+    size_t record_size;
+    size_t buf_size;
+    size_t n_bufs;
+    char **bufs;
+    /* Number of valid bytes in each slot, once it is filled. */
+    size_t *lens;
+    citer_io_engine_t engine;
+
+    /* Consumer state. Records in [pos, lens[cur % n_bufs]) of buffer cur have
+     * not been returned yet. */
+    size_t cur;
+    size_t pos;
+    bool started;
+
+    /* The producer hits the end of the file (or an error) at buffer end_seq,
+     * which may be partially filled. */
+    size_t end_seq;
+    int error;
+
+    /* Thread engine. Buffers before produced have been filled, and buffers
+     * before released can be overwritten. */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t produced;
+    size_t released;
+    bool done;
+    bool stop;
+
+#if CITER_HAVE_URING
+    /* io_uring engine, only used for regular files. Reads are at explicit
+     * offsets from base. Slots with a read in flight are busy. */
+    citer_uring_t ring;
+    off_t base;
+    size_t total_bytes;
+    size_t next_submit;
+    size_t *slot_seq;
+    bool *busy;
+    size_t in_flight;
+#endif
+} citer_async_records_data_t;
+
+static void *reader_thread(void *_data) {
+    citer_async_records_data_t *data = (citer_async_records_data_t *) _data;
+    for (size_t seq = 0; ; seq++) {
+        pthread_mutex_lock(&data->lock);
+        while (!data->stop && (seq >= data->released + data->n_bufs))
+            pthread_cond_wait(&data->cond, &data->lock);
+        bool stop = data->stop;
+        pthread_mutex_unlock(&data->lock);
+        if (stop)
+            break;
+
+        bool eof = false;
+        int error = 0;
+        size_t len = read_full(data->fd, data->bufs[seq % data->n_bufs], data->buf_size, &eof, &error);
+
+        pthread_mutex_lock(&data->lock);
+        data->lens[seq % data->n_bufs] = len;
+        data->produced = seq + 1;
+        if (eof) {
+            data->done = true;
+            data->end_seq = seq;
+            data->error = error;
+        }
+        pthread_cond_broadcast(&data->cond);
+        pthread_mutex_unlock(&data->lock);
+        if (eof)
+            break;
+    }
+    return NULL;
+}
+
+#if CITER_HAVE_URING
+static size_t uring_chunk_len(const citer_async_records_data_t *data, size_t seq) {
+    size_t start = seq * data->buf_size;
+    size_t len = data->total_bytes - start;
+    return (len < data->buf_size) ? len : data->buf_size;
+}
+
+/* Queue reads into all free slots, up to the end of the file. */
+static void uring_fill(citer_async_records_data_t *data) {
+    while ((data->next_submit < data->end_seq) && (data->next_submit < data->released + data->n_bufs)) {
+        size_t seq = data->next_submit++;
+        size_t slot = seq % data->n_bufs;
+        data->slot_seq[slot] = seq;
+        data->lens[slot] = 0;
+        data->busy[slot] = true;
+        data->in_flight++;
+        uring_queue_read(&data->ring, data->fd, data->bufs[slot], uring_chunk_len(data, seq), data->base + (off_t) (seq * data->buf_size), seq);
+    }
+}
+
+/* Process all available completions. Returns how many there were. */
+static unsigned uring_reap(citer_async_records_data_t *data) {
+    citer_uring_t *ring = &data->ring;
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned n = tail - head;
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        size_t seq = (size_t) cqe->user_data;
+        size_t slot = seq % data->n_bufs;
+        int res = cqe->res;
+        data->in_flight--;
+
+        if (res == -EINTR || res == -EAGAIN) {
+            /* Retry the rest of the read. */
+        } else if (res < 0) {
+            if (seq < data->end_seq) {
+                data->end_seq = seq;
+                data->error = -res;
+            }
+            data->busy[slot] = false;
+            continue;
+        } else if (res == 0) {
+            /* The file was truncated. */
+            if (seq < data->end_seq)
+                data->end_seq = seq;
+            data->busy[slot] = false;
+            continue;
+        } else {
+            data->lens[slot] += (size_t) res;
+        }
+
+        size_t want = uring_chunk_len(data, seq);
+        if ((data->lens[slot] < want) && (seq < data->end_seq)) {
+            data->in_flight++;
+            uring_queue_read(ring, data->fd, data->bufs[slot] + data->lens[slot], want - data->lens[slot], data->base + (off_t) (seq * data->buf_size + data->lens[slot]), seq);
+        } else {
+            data->busy[slot] = false;
+        }
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+/*
+ * Wait for at least one read to complete, and reap the completions. If
+ * submitting fails with nothing to reap, wait for a read the kernel already
+ * has, without submitting more, or sleep briefly if it has none, rather than
+ * retrying in a busy loop.
+ */
+static void uring_wait(citer_async_records_data_t *data) {
+    citer_uring_t *ring = &data->ring;
+    bool entered = uring_enter(ring, 1);
+    if ((uring_reap(data) > 0) || entered)
+        return;
+
+    if (data->in_flight > uring_unsubmitted(ring)) {
+        while ((syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) && (errno == EINTR))
+            ;
+    } else {
+        struct timespec delay = { .tv_sec = 0, .tv_nsec = 1000000 };
+        nanosleep(&delay, NULL);
+    }
+    uring_reap(data);
+}
+#endif /* CITER_HAVE_URING */
+
+/*
+ * Wait until buffer seq has been filled. Returns false if there is no such
+ * buffer, because the end of the file comes before it.
+ */
+static bool wait_for_buffer(citer_async_records_data_t *data, size_t seq) {
+#if CITER_HAVE_URING
+    if (data->engine == CITER_IO_URING) {
+        size_t slot = seq % data->n_bufs;
+        for (;;) {
+            if (seq > data->end_seq)
+                return false;
+            if ((data->slot_seq[slot] == seq) && !data->busy[slot])
+                return (seq < data->end_seq) || (data->lens[slot] > 0);
+            if ((seq == data->end_seq) && (data->slot_seq[slot] != seq))
+                return false;
+            uring_fill(data);
+            if (data->in_flight == 0)
+                return false;
+            uring_wait(data);
+        }
+    }
+#endif
+    pthread_mutex_lock(&data->lock);
+    while ((data->produced <= seq) && !data->done)
+        pthread_cond_wait(&data->cond, &data->lock);
+    bool available = data->produced > seq;
+    pthread_mutex_unlock(&data->lock);
+    return available;
+}
+
+/* Let buffers before seq be overwritten. */
+static void release_buffers(citer_async_records_data_t *data, size_t seq) {
+#if CITER_HAVE_URING
+    if (data->engine == CITER_IO_URING) {
+        data->released = seq;
+        uring_fill(data);
+        uring_enter(&data->ring, 0);
+        return;
+    }
+#endif
+    pthread_mutex_lock(&data->lock);
+    data->released = seq;
+    pthread_cond_broadcast(&data->cond);
+    pthread_mutex_unlock(&data->lock);
+}
+
+static void *citer_read_records_async_next(iterator_t *self) {
+    citer_async_records_data_t *data = (citer_async_records_data_t *) self->data;
+    while (!data->started || (data->lens[data->cur % data->n_bufs] - data->pos < data->record_size)) {
+        size_t next = data->started ? data->cur + 1 : 0;
+        if (data->started && data->lens[data->cur % data->n_bufs] < data->buf_size)
+            /* A short buffer is the last one. */
+            return records_end(self);
+        /* Keep the current buffer, which becomes the previous one. */
+        if (next >= 1)
+            release_buffers(data, next - 1);
+        if (!wait_for_buffer(data, next))
+            return records_end(self);
+        data->cur = next;
+        data->pos = 0;
+        data->started = true;
+    }
+
+    citer_bound_sub(self->size_bound, 1);
+    void *record = data->bufs[data->cur % data->n_bufs] + data->pos;
+    data->pos += data->record_size;
+    return record;
+}
+
+static void citer_read_records_async_free_data(void *_data) {
+    citer_async_records_data_t *data = (citer_async_records_data_t *) _data;
+#if CITER_HAVE_URING
+    if (data->engine == CITER_IO_URING) {
+        /* The kernel may still be writing into the buffers. */
+        while (data->in_flight > 0)
+            uring_wait(data);
+        uring_destroy(&data->ring);
+        free(data->slot_seq);
+        free(data->busy);
+    }
+#endif
+    if (data->engine == CITER_IO_THREAD) {
+        pthread_mutex_lock(&data->lock);
+        data->stop = true;
+        pthread_cond_broadcast(&data->cond);
+        pthread_mutex_unlock(&data->lock);
+        pthread_join(data->thread, NULL);
+    }
+    pthread_mutex_destroy(&data->lock);
+    pthread_cond_destroy(&data->cond);
+    for (size_t i = 0; i < data->n_bufs; i++)
+        free(data->bufs[i]);
+    free(data->bufs);
+    free(data->lens);
+    free(data);
+}
+
+#if CITER_HAVE_URING
+static bool uring_start(citer_async_records_data_t *data, off_t base, size_t total_bytes) {
+    if (!uring_init(&data->ring, (unsigned) data->n_bufs))
+        return false;
+    data->base = base;
+    data->total_bytes = total_bytes;
+    data->end_seq = (total_bytes + data->buf_size - 1) / data->buf_size;
+    data->next_submit = 0;
+    data->in_flight = 0;
+    data->slot_seq = malloc(data->n_bufs * sizeof(*data->slot_seq));
+    data->busy = calloc(data->n_bufs, sizeof(*data->busy));
+    /* No slot holds buffer SIZE_MAX. */
+    for (size_t i = 0; i < data->n_bufs; i++)
+        data->slot_seq[i] = SIZE_MAX;
+    uring_fill(data);
+    uring_enter(&data->ring, 0);
+    return true;
+}
+#endif
+
+iterator_t *citer_read_records_async(int fd, size_t record_size, size_t buffer_bytes, size_t queue_depth, citer_io_engine_t engine) {
+    if (record_size == 0)
+        return NULL;
+    /* Round the buffers down to a whole number of records. */
+    size_t records_per_buf = buffer_bytes / record_size;
+    if (records_per_buf == 0)
+        records_per_buf = 1;
+    if (queue_depth == 0)
+        queue_depth = 1;
+
+    bool regular;
+    off_t offset;
+    citer_size_bound_t size_bound = records_bound(fd, record_size, &regular, &offset);
+
+    citer_async_records_data_t *data = calloc(1, sizeof(*data));
+    data->fd = fd;
+    data->record_size = record_size;
+    data->buf_size = records_per_buf * record_size;
+    data->n_bufs = queue_depth + 2;
+    data->bufs = malloc(data->n_bufs * sizeof(*data->bufs));
+    for (size_t i = 0; i < data->n_bufs; i++)
+        data->bufs[i] = malloc(data->buf_size);
+    data->lens = calloc(data->n_bufs, sizeof(*data->lens));
+    data->end_seq = SIZE_MAX;
+    pthread_mutex_init(&data->lock, NULL);
+    pthread_cond_init(&data->cond, NULL);
+
+    data->engine = CITER_IO_THREAD;
+#if CITER_HAVE_URING
+    if ((engine != CITER_IO_THREAD) && regular) {
+        /* Read whole records only, up to the end of the file as it is now. */
+        size_t total_bytes = size_bound.upper * record_size;
+        if (uring_start(data, offset, total_bytes))
+            data->engine = CITER_IO_URING;
+    }
+#endif
+    if (data->engine == CITER_IO_THREAD)
+        pthread_create(&data->thread, NULL, reader_thread, data);
+
+    return citer_new(
+        data,
+        citer_read_records_async_next,
+        NULL,
+        citer_read_records_async_free_data,
+        size_bound
+    );
+}
+
+citer_io_engine_t citer_read_records_engine(iterator_t *it) {
+    if (it->next == citer_read_records_async_next)
+        return ((citer_async_records_data_t *) it->data)->engine;
+    return CITER_IO_SYNC;
+}
+
+int citer_read_records_error(iterator_t *it) {
+    if (it->next == citer_read_records_async_next) {
+        citer_async_records_data_t *data = (citer_async_records_data_t *) it->data;
+        if (data->engine == CITER_IO_URING)
+            return data->error;
+        pthread_mutex_lock(&data->lock);
+        int error = data->error;
+        pthread_mutex_unlock(&data->lock);
+        return error;
+    }
+    return ((citer_read_records_data_t *) it->data)->error;
+}
+
+/* Maximum number of items (and iovecs) written at once. */
+#if defined(IOV_MAX) && (IOV_MAX < 1024)
+#define WRITE_BATCH IOV_MAX
+#else
+#define WRITE_BATCH 1024
+#endif
+
+/* Default size of the staging buffers of citer_write_all() and
+ * citer_write_records(). */
+#define STAGING_BYTES (64 * 1024)
+
+/*
+ * Write the n buffers of iov, retrying partial writes. The iovecs are updated
+ * as they are written. Returns the number of bytes written. Sets *error if a
+ * write fails.
+ */
+static size_t writev_full(int fd, struct iovec *iov, size_t n, int *error) {
+    size_t total = 0;
+    while (n > 0) {
+        /* Skip empty buffers, so that a write of 0 bytes means no progress. */
+        if (iov->iov_len == 0) {
+            iov++;
+            n--;
+            continue;
+        }
+        ssize_t written = writev(fd, iov, (int) n);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            *error = errno;
+            break;
+        } else if (written == 0) {
+            *error = EIO;
+            break;
+        }
+
+        total += (size_t) written;
+        size_t left = (size_t) written;
+        while (n > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (char *) iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+    return total;
+}
+
+size_t citer_write_all(iterator_t *it, int fd, citer_serialize_fn_t serialize, void *fn_data, int *error) {
+    int err = 0;
+    size_t total = 0;
+    size_t capacity = STAGING_BYTES;
+    char *buf = malloc(capacity);
+    size_t used = 0;
+
+    /* Each item is serialised as soon as it is taken, since the source may
+     * reuse its memory for the next one. */
+    void *item;
+    while (!err && (item = citer_next(it))) {
+        size_t len = serialize(item, buf + used, capacity - used, fn_data);
+        if (len <= capacity - used) {
+            used += len;
+            continue;
+        }
+
+        /* The item doesn't fit. Flush, and grow the buffer if needed. */
+        struct iovec iov = { .iov_base = buf, .iov_len = used };
+        total += writev_full(fd, &iov, 1, &err);
+        used = 0;
+        if (len > capacity) {
+            free(buf);
+            capacity = len;
+            buf = malloc(capacity);
+        }
+        used = serialize(item, buf, capacity, fn_data);
+    }
+
+    if (!err && used > 0) {
+        struct iovec iov = { .iov_base = buf, .iov_len = used };
+        total += writev_full(fd, &iov, 1, &err);
+    }
+    free(buf);
+    if (error)
+        *error = err;
+    return total;
+}
+
+size_t citer_write_records(iterator_t *it, int fd, size_t record_size, int *error) {
+    int err = 0;
+    size_t total = 0;
+    struct iovec iov[WRITE_BATCH];
+
+    /* Arrays and strided fields are written straight from their memory. */
+    void *first;
+    size_t stride, len;
+    if (citer_as_strided(it, &first, &stride, &len)) {
+        if (stride == record_size) {
+            /* Contiguous, so write it in one go. */
+            iov[0].iov_base = first;
+            iov[0].iov_len = len * record_size;
+            total = writev_full(fd, iov, 1, &err);
+            citer_advance(it, total / record_size);
+        } else {
+            for (size_t start = 0; start < len && !err; start += WRITE_BATCH) {
+                size_t n = (len - start < WRITE_BATCH) ? len - start : WRITE_BATCH;
+                for (size_t i = 0; i < n; i++) {
+                    iov[i].iov_base = (char *) first + (start + i) * stride;
+                    iov[i].iov_len = record_size;
+                }
+                size_t written = writev_full(fd, iov, n, &err);
+                total += written;
+                citer_advance(it, written / record_size);
+            }
+        }
+        if (error)
+            *error = err;
+        return total;
+    }
+
+    /* Other sources may reuse a record's memory for the next one, so each
+     * record is copied into a staging buffer of whole records as soon as it is
+     * taken. */
+    size_t per_buf = (STAGING_BYTES > record_size) ? STAGING_BYTES / record_size : 1;
+    char *buf = malloc(per_buf * record_size);
+    size_t used = 0;
+    void *item;
+    while (!err && (item = citer_next(it))) {
+        memcpy(buf + used * record_size, item, record_size);
+        if (++used == per_buf) {
+            iov[0] = (struct iovec) { .iov_base = buf, .iov_len = used * record_size };
+            total += writev_full(fd, iov, 1, &err);
+            used = 0;
+        }
+    }
+    if (!err && used > 0) {
+        iov[0] = (struct iovec) { .iov_base = buf, .iov_len = used * record_size };
+        total += writev_full(fd, iov, 1, &err);
+    }
+    free(buf);
+
+    if (error)
+        *error = err;
+    return total;
+}
@@ -0,0 +1,187 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_IO_H_
+#define _CITER_IO_H_
+
+#include <stddef.h>
+
+#include "iterator.h"
+
+/*
+ * Iterator over fixed-size records read from a file descriptor.
+ *
+ * Parameters:
+ *   fd - The file descriptor to read from, e.g. a file or a pipe. Reading
+ *        starts at its current offset. It is not closed by the iterator.
+ *   record_size - Size (in bytes) of each record. Must be greater than 0.
+ *   buffer_bytes - Size (in bytes) of each of the iterator's two buffers. Large
+ *                  buffers mean fewer, larger reads. Values smaller than
+ *                  record_size are rounded up to record_size.
+ *
+ * Each item is a pointer to a record inside one of the iterator's buffers.
+ * Records are not copied out of the buffers, except for records which straddle
+ * the end of a read, which are moved to the start of the next buffer.
+ *
+ * The iterator alternates between its two buffers, filling one while the
+ * records in the other stay untouched. So a record stays valid until at least
+ * buffer_bytes / record_size more records have been read, and consumers which
+ * hold on to a few records at a time (e.g. citer_chunked()) can use the
+ * pointers directly.
+ *
+ * If the file descriptor refers to a regular file, the iterator has an exact
+ * size, computed from the file's size and current offset, so that consumers
+ * like citer_collect_into_array() can preallocate. The file must not change
+ * size while it is being read. For other file descriptors, the size is not
+ * known in advance.
+ *
+ * Iteration stops at the end of the file, or when a read fails. A partial
+ * record at the end of the file is ignored. Use citer_read_records_error() to
+ * tell whether iteration stopped because of an error.
+ *
+ * Returns a new iterator, or NULL if record_size is 0. The returned iterator
+ * must be freed with citer_free().
+ */
+iterator_t *citer_read_records(int fd, size_t record_size, size_t buffer_bytes);
+
+/*
+ * Get the error which stopped a record iterator.
+ *
+ * Must only be called on iterators created by citer_read_records() or
+ * citer_read_records_async().
+ *
+ * Returns the errno value of the read which failed, or 0 if no read has
+ * failed (i.e. the iterator is not exhausted yet, or it reached the end of the
+ * file).
+ */
+int citer_read_records_error(iterator_t *it);
+
+/*
+ * How a record iterator reads its file descriptor.
+ */
+typedef enum citer_io_engine {
+    /* Use io_uring if possible, and fall back to CITER_IO_THREAD otherwise. */
+    CITER_IO_AUTO,
+    /* Reads are done by the consumer, as in citer_read_records(). */
+    CITER_IO_SYNC,
+    /* Several reads are kept in flight through io_uring. */
+    CITER_IO_URING,
+    /* A background thread reads ahead of the consumer. */
+    CITER_IO_THREAD,
+} citer_io_engine_t;
+
+/*
+ * Iterator over fixed-size records read ahead of the consumer from a file
+ * descriptor.
+ *
+ * Like citer_read_records(), but the next buffers are read in the background
+ * while the consumer goes through the current one, so that reading and
+ * processing overlap.
+ *
+ * Parameters:
+ *   fd - The file descriptor to read from. Reading starts at its current
+ *        offset. It is not closed by the iterator, and must not be used by
+ *        anything else until the iterator is freed.
+ *   record_size - Size (in bytes) of each record. Must be greater than 0.
+ *   buffer_bytes - Size (in bytes) of each buffer. It is rounded down to a
+ *                  multiple of record_size, and up to at least one record.
+ *   queue_depth - Number of buffers being read in the background at once. 0 is
+ *                 treated as 1.
+ *   engine - How to read the file descriptor. With CITER_IO_AUTO or
+ *            CITER_IO_URING, io_uring is used if the kernel supports it and fd
+ *            refers to a regular file. Otherwise, and with CITER_IO_THREAD, a
+ *            background thread does the reads. CITER_IO_SYNC is treated as
+ *            CITER_IO_AUTO.
+ *
+ * Each item is a pointer to a record inside one of the iterator's buffers. A
+ * record stays valid until at least buffer_bytes / record_size more records
+ * have been read.
+ *
+ * The size, end of iteration and errors are as in citer_read_records(). With
+ * io_uring, a regular file is read up to its size when the iterator is
+ * created.
+ *
+ * Returns a new iterator, or NULL if record_size is 0. The returned iterator
+ * must be freed with citer_free(), which waits for reads in flight.
+ */
+iterator_t *citer_read_records_async(int fd, size_t record_size, size_t buffer_bytes, size_t queue_depth, citer_io_engine_t engine);
+
+/*
+ * Get how a record iterator reads its file descriptor.
+ *
+ * Must only be called on iterators created by citer_read_records() or
+ * citer_read_records_async().
+ *
+ * Returns CITER_IO_SYNC for citer_read_records(), and CITER_IO_URING or
+ * CITER_IO_THREAD for citer_read_records_async().
+ */
+citer_io_engine_t citer_read_records_engine(iterator_t *it);
+
+/*
+ * Serialisation function for citer_write_all().
+ *
+ * Writes the serialised form of item into buf, if it fits in len bytes, like
+ * snprintf(). fn_data is the custom data given to citer_write_all().
+ *
+ * Returns the size (in bytes) of the serialised item, even if it is larger
+ * than len. The size must not change from one call to the next for the same
+ * item.
+ */
+typedef size_t (*citer_serialize_fn_t)(void *item, char *buf, size_t len, void *fn_data);
+
+/*
+ * Write all the items of an iterator to a file descriptor.
+ *
+ * Items are serialised into a large staging buffer, which is flushed when
+ * full, so that the items take few system calls to write. The buffer grows
+ * for items larger than it.
+ *
+ * Parameters:
+ *   it - The iterator to write. It is exhausted, but not freed.
+ *   fd - The file descriptor to write to. It is not closed.
+ *   serialize - Function which serialises an item into the buffer.
+ *   fn_data - Custom data to be passed as the last argument to serialize.
+ *   error - If not NULL, set to the errno value of the write which failed, or
+ *           0 if all writes succeeded.
+ *
+ * Partial writes (e.g. to pipes or sockets) are continued until all the bytes
+ * have been written. Writing stops at the first failed write, in which case
+ * items may have been taken from the iterator without being written.
+ *
+ * Returns the number of bytes written.
+ */
+size_t citer_write_all(iterator_t *it, int fd, citer_serialize_fn_t serialize, void *fn_data, int *error);
+
+/*
+ * Write fixed-size records to a file descriptor.
+ *
+ * Each item must point to a record of record_size bytes, which is written as
+ * is, e.g. the items of citer_read_records(). Arrays (see citer_as_strided())
+ * are written straight from their memory, with writev(), without iterating
+ * over them. Other records are copied into a staging buffer as they are
+ * taken, since the source may reuse a record's memory for later ones, and the
+ * buffer is written when full.
+ *
+ * The iterator is exhausted (but not freed), and partial writes and errors are
+ * handled as in citer_write_all().
+ *
+ * Returns the number of bytes written.
+ */
+size_t citer_write_records(iterator_t *it, int fd, size_t record_size, int *error);
+
+#endif /* _CITER_IO_H_ */
@@ -38,6 +38,9 @@ void *citer_new(
 		.next = next,
 		.next_back = next_back,
 		.free_data = free_data,
+		.split = NULL,
+		.advance = NULL,
+		.advance_back = NULL,
 	};
 	return it;
 }
@@ -60,6 +63,53 @@ void *citer_next_back(iterator_t *it) {
 		return NULL;
 }
 
+/*
+ * Get up to N items from an iterator at once.
+ */
+size_t citer_next_batch(iterator_t *it, void **items, size_t n) {
+	size_t count = 0;
+	while (count < n && (items[count] = it->next(it)))
+		count++;
+	return count;
+}
+
+/*
+ * Skip up to N items from the front of an iterator.
+ */
+size_t citer_advance(iterator_t *it, size_t n) {
+	if (it->advance)
+		return it->advance(it, n);
+	size_t count = 0;
+	while (count < n && it->next(it))
+		count++;
+	return count;
+}
+
+/*
+ * Skip up to N items from the back of a double-ended iterator.
+ */
+size_t citer_advance_back(iterator_t *it, size_t n) {
+	if (!citer_is_double_ended(it))
+		/* TODO: Notify caller of error. */
+		return 0;
+	if (it->advance_back)
+		return it->advance_back(it, n);
+	size_t count = 0;
+	while (count < n && it->next_back(it))
+		count++;
+	return count;
+}
+
+/*
+ * Split an iterator in two.
+ */
+iterator_t *citer_split_at(iterator_t *it, size_t n) {
+	if (!citer_is_splittable(it))
+		/* TODO: Notify caller of error. */
+		return NULL;
+	return it->split(it, n);
+}
+
 /*
  * Free an iterator's data
  */
@@ -39,6 +39,18 @@ typedef void *(*citer_next_fn)(iterator_t *);
  */
 typedef void (*citer_free_data_fn)(void *);
 
+/*
+ * Function type for splitting an iterator in two.
+ * Used for iterator_t::split().
+ */
+typedef iterator_t *(*citer_split_fn)(iterator_t *, size_t);
+
+/*
+ * Function type for skipping items of an iterator.
+ * Used for iterator_t::advance() and iterator_t::advance_back().
+ */
+typedef size_t (*citer_advance_fn)(iterator_t *, size_t);
+
 /*
  * Iterator structure
  *
@@ -51,6 +63,15 @@ typedef void (*citer_free_data_fn)(void *);
  *               field is NULL for iterators which are not double-ended.
  *   free_data - A method that takes a pointer to this iterator_t's data and
  *               frees (de-allocates) said data.
+ *   split - An optional method that splits this iterator at a given index in
+ *           O(1) time. See citer_split_at(). This field is NULL for iterators
+ *           which cannot be split, and is set to NULL by citer_new(), so
+ *           splittable iterators must set it after creation.
+ *   advance - An optional method that skips up to N items from the front in
+ *             less than O(N) time, returning the number of items skipped. See
+ *             citer_advance(). Set to NULL by citer_new().
+ *   advance_back - Like advance, but skips items from the back. Set to NULL by
+ *                  citer_new().
  */
 struct iterator_t {
 	citer_size_bound_t size_bound;
@@ -58,6 +79,9 @@ struct iterator_t {
 	citer_next_fn next;
 	citer_next_fn next_back;
 	citer_free_data_fn free_data;
+	citer_split_fn split;
+	citer_advance_fn advance;
+	citer_advance_fn advance_back;
 };
 
 /*
@@ -81,6 +105,59 @@ void *citer_next(iterator_t *);
  */
 void *citer_next_back(iterator_t *);
 
+/*
+ * Get up to N items from an iterator at once.
+ *
+ * The items are stored in the array given as the second argument, which must
+ * have room for at least N items.
+ *
+ * Returns the number of items stored. A return value less than N means the
+ * iterator is exhausted.
+ */
+size_t citer_next_batch(iterator_t *, void **, size_t);
+
+/*
+ * Skip up to N items from the front of an iterator.
+ *
+ * Iterators which can skip items without producing them (e.g.
+ * citer_over_array() and citer_range_i64()) do so in O(1) time. Other
+ * iterators are advanced one item at a time.
+ *
+ * Returns the number of items skipped, which is less than N only if the
+ * iterator was exhausted.
+ */
+size_t citer_advance(iterator_t *, size_t);
+
+/*
+ * Skip up to N items from the back of a double-ended iterator.
+ *
+ * This is the same as citer_advance(), but for the back of the iterator.
+ * Returns 0 if the iterator is not double-ended.
+ */
+size_t citer_advance_back(iterator_t *, size_t);
+
+/*
+ * Split an iterator in two.
+ *
+ * After splitting, the iterator only yields its next N items, and the
+ * returned iterator yields the items after those, in the same order. If the
+ * iterator has fewer than N items left, the returned iterator is empty.
+ *
+ * This is only supported by iterators which can do it without consuming any
+ * items, e.g. citer_over_array(). It is mainly useful for dividing work
+ * between threads.
+ *
+ * Returns a new iterator which must be freed with citer_free(), or NULL if the
+ * iterator cannot be split. The two iterators are independent, and freeing one
+ * does not free the other.
+ */
+iterator_t *citer_split_at(iterator_t *, size_t);
+
+/*
+ * Check if an iterator can be split using citer_split_at().
+ */
+#define citer_is_splittable(it) (!!(it)->split)
+
 /*
  * Free an iterator's data
  */
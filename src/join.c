@@ -0,0 +1,454 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "join.h"
+#include "table.h"
+#include "zip.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Marks the end of a list of build items. */
+#define NO_ITEM SIZE_MAX
+
+/* Largest table to allocate up front, in entries. */
+#define MAX_PRESIZE (1 << 16)
+
+/* Bounds on the number of partitions of a spilled join. Each partition takes
+ * two temporary files. */
+#define MIN_PARTITIONS 4
+#define MAX_PARTITIONS 128
+
+/*
+ * Entry of the build table. The build items with a key form a list, from head
+ * to tail, linked through the build's next array.
+ */
+typedef struct join_entry {
+    void *key;
+    size_t head;
+    size_t tail;
+    size_t count;
+} join_entry_t;
+
+/*
+ * The build side in memory: its items, and a table of their keys.
+ */
+typedef struct join_build {
+    citer_table_t table;
+    void **items;
+    size_t *next;
+    size_t n_items;
+    size_t capacity;
+    /* Length of the longest list of items with the same key. */
+    size_t max_matches;
+} join_build_t;
+
+/*
+ * A spilled join. Partition K of each side is in files build[K] and probe[K].
+ */
+typedef struct join_spill {
+    FILE **build;
+    FILE **probe;
+    unsigned bits;
+    /* The partition being joined, if loaded is true. */
+    size_t partition;
+    bool loaded;
+    bool probe_written;
+    /* Copies of the current partition's build items, and of the current probe
+     * item. */
+    char *build_buf;
+    char *probe_buf;
+} join_spill_t;
+
+typedef struct citer_hash_join_data {
+    citer_join_ops_t ops;
+    citer_join_kind_t kind;
+    iterator_t *left;
+    iterator_t *right;
+    /* Whether the left side is the build side. */
+    bool build_left;
+    iterator_t *probe;
+    citer_key_fn_t build_key;
+    citer_key_fn_t probe_key;
+    size_t build_size;
+    size_t probe_size;
+
+    join_build_t build;
+    join_spill_t *spill;
+    /* The errno value of a failed spill, which ends the join. */
+    int error;
+    size_t memory;
+    size_t peak_memory;
+
+    /* Inner joins: the current probe item, and its next match. */
+    void *probe_item;
+    size_t match;
+    size_t remaining_matches;
+    citer_pair_t pair;
+} citer_hash_join_data_t;
+
+static void build_init(join_build_t *build, size_t expected) {
+    citer_table_init(&build->table, sizeof(join_entry_t), 0, (expected < MAX_PRESIZE) ? expected : MAX_PRESIZE);
+    build->items = NULL;
+    build->next = NULL;
+    build->n_items = 0;
+    build->capacity = 0;
+    build->max_matches = 0;
+}
+
+static void build_free(join_build_t *build) {
+    citer_table_free(&build->table);
+    free(build->items);
+    free(build->next);
+}
+
+/* Memory used by the build side, in bytes. */
+static size_t build_memory(const join_build_t *build) {
+    return build->table.capacity * (sizeof(uint64_t) + build->table.entry_size)
+        + build->capacity * (sizeof(*build->items) + sizeof(*build->next));
+}
+
+static void track_memory(citer_hash_join_data_t *data, size_t extra) {
+    data->memory = build_memory(&data->build) + extra;
+    if (data->memory > data->peak_memory)
+        data->peak_memory = data->memory;
+}
+
+/* Add an item to the end of the list of its key. */
+static void build_add(citer_hash_join_data_t *data, void *item) {
+    join_build_t *build = &data->build;
+    if (build->n_items == build->capacity) {
+        build->capacity = build->capacity ? 2 * build->capacity : 64;
+        build->items = realloc(build->items, build->capacity * sizeof(*build->items));
+        build->next = realloc(build->next, build->capacity * sizeof(*build->next));
+    }
+    size_t i = build->n_items++;
+    build->items[i] = item;
+    build->next[i] = NO_ITEM;
+
+    void *key = data->build_key(item, data->ops.fn_data);
+    bool inserted;
+    join_entry_t *entry = citer_table_insert(&build->table, data->ops.hash(key, data->ops.fn_data), key, data->ops.eq, data->ops.fn_data, &inserted);
+    if (inserted)
+        entry->head = i;
+    else
+        build->next[entry->tail] = i;
+    entry->tail = i;
+    entry->count++;
+    if (entry->count > build->max_matches)
+        build->max_matches = entry->count;
+}
+
+static join_entry_t *build_find(citer_hash_join_data_t *data, void *probe_item) {
+    void *key = data->probe_key(probe_item, data->ops.fn_data);
+    return citer_table_find(&data->build.table, data->ops.hash(key, data->ops.fn_data), key, data->ops.eq, data->ops.fn_data);
+}
+
+static size_t partition_of(uint64_t hash, unsigned bits) {
+    return (size_t) (hash >> (64 - bits));
+}
+
+static void spill_free(join_spill_t *spill, size_t n_partitions) {
+    for (size_t k = 0; k < n_partitions; k++) {
+        if (spill->build[k])
+            fclose(spill->build[k]);
+        if (spill->probe[k])
+            fclose(spill->probe[k]);
+    }
+    free(spill->build);
+    free(spill->probe);
+    free(spill->build_buf);
+    free(spill->probe_buf);
+    free(spill);
+}
+
+/* Record the error of a failed spill, unless there was one already. */
+static void spill_error(citer_hash_join_data_t *data) {
+    if (!data->error)
+        data->error = errno ? errno : EIO;
+}
+
+/* Flush the n files, so that failed writes show up. */
+static bool spill_flush(FILE **files, size_t n) {
+    bool ok = true;
+    for (size_t k = 0; k < n; k++)
+        ok = (fflush(files[k]) == 0) && ok;
+    return ok;
+}
+
+/* Write an item to the file of its partition. */
+static bool spill_write(citer_hash_join_data_t *data, FILE **files, citer_key_fn_t key_fn, size_t size, void *item) {
+    uint64_t hash = citer_table_hash(data->ops.hash(key_fn(item, data->ops.fn_data), data->ops.fn_data));
+    return fwrite(item, size, 1, files[partition_of(hash, data->spill->bits)]) == 1;
+}
+
+/*
+ * Move the build side to temporary files: the items built so far, then the
+ * rest of the build side. Returns false (keeping the join in memory) if the
+ * files can't be created or the items built so far can't be written. Once the
+ * rest of the build side is being read, its items are only in the files, so a
+ * failed write there is recorded as the join's error instead.
+ */
+static bool spill_build(citer_hash_join_data_t *data, iterator_t *build_it) {
+    /* Aim for partitions of half the budget. */
+    size_t expected = data->memory * 2;
+    if (!build_it->size_bound.upper_infinite) {
+        size_t per_item = data->build.n_items ? data->memory / data->build.n_items + data->build_size : 0;
+        expected = build_it->size_bound.upper * per_item + data->memory;
+    }
+    unsigned bits = 0;
+    while ((((size_t) 1 << bits) < MIN_PARTITIONS || ((size_t) 1 << bits) * data->ops.memory_budget / 2 < expected) && ((size_t) 1 << bits) < MAX_PARTITIONS)
+        bits++;
+    size_t n_partitions = (size_t) 1 << bits;
+
+    join_spill_t *spill = calloc(1, sizeof(*spill));
+    spill->bits = bits;
+    spill->build = calloc(n_partitions, sizeof(*spill->build));
+    spill->probe = calloc(n_partitions, sizeof(*spill->probe));
+    for (size_t k = 0; k < n_partitions; k++) {
+        if (!(spill->build[k] = tmpfile()) || !(spill->probe[k] = tmpfile())) {
+            spill_free(spill, n_partitions);
+            return false;
+        }
+    }
+    data->spill = spill;
+
+    bool ok = true;
+    for (size_t i = 0; i < data->build.n_items; i++)
+        ok = ok && spill_write(data, spill->build, data->build_key, data->build_size, data->build.items[i]);
+    if (!ok || !spill_flush(spill->build, n_partitions)) {
+        /* The items are still in memory. */
+        spill_free(spill, n_partitions);
+        data->spill = NULL;
+        return false;
+    }
+
+    void *item;
+    while (ok && (item = citer_next(build_it)))
+        ok = spill_write(data, spill->build, data->build_key, data->build_size, item);
+    if (!ok || !spill_flush(spill->build, n_partitions))
+        spill_error(data);
+
+    build_free(&data->build);
+    build_init(&data->build, 0);
+    track_memory(data, 0);
+    return true;
+}
+
+/* Read the build side into memory, spilling it if it goes over the budget. */
+static void build_side(citer_hash_join_data_t *data, iterator_t *build_it) {
+    size_t expected = build_it->size_bound.upper_infinite ? 0 : build_it->size_bound.upper;
+    if (data->ops.memory_budget) {
+        /* Don't presize the table past the budget. Each expected item takes
+         * at most three slots. */
+        size_t max_expected = data->ops.memory_budget / (3 * (sizeof(uint64_t) + sizeof(join_entry_t)));
+        if (expected > max_expected)
+            expected = max_expected;
+    }
+    build_init(&data->build, expected);
+    bool can_spill = data->ops.memory_budget && data->build_size;
+    void *item;
+    while ((item = citer_next(build_it))) {
+        build_add(data, item);
+        track_memory(data, 0);
+        if (can_spill && data->memory > data->ops.memory_budget) {
+            if (spill_build(data, build_it))
+                return;
+            can_spill = false;
+        }
+    }
+}
+
+/*
+ * Load partition K of a spilled build side into memory, and rewind partition
+ * K of the probe side. Returns false, recording the error, if the partition
+ * can't be read.
+ */
+static bool spill_load(citer_hash_join_data_t *data, size_t k) {
+    join_spill_t *spill = data->spill;
+    FILE *f = spill->build[k];
+    long bytes = (fseek(f, 0, SEEK_END) == 0) ? ftell(f) : -1;
+    if ((bytes < 0) || (fseek(f, 0, SEEK_SET) != 0) || (fseek(spill->probe[k], 0, SEEK_SET) != 0)) {
+        spill_error(data);
+        return false;
+    }
+    size_t n = (size_t) bytes / data->build_size;
+
+    build_free(&data->build);
+    build_init(&data->build, n);
+    free(spill->build_buf);
+    spill->build_buf = malloc(n * data->build_size + 1);
+    if (fread(spill->build_buf, data->build_size, n, f) != n) {
+        spill_error(data);
+        return false;
+    }
+    for (size_t i = 0; i < n; i++)
+        build_add(data, spill->build_buf + i * data->build_size);
+    track_memory(data, n * data->build_size);
+
+    spill->partition = k;
+    spill->loaded = true;
+    return true;
+}
+
+/* Get the next probe item, going through the partitions of a spilled join. */
+static void *next_probe(citer_hash_join_data_t *data) {
+    join_spill_t *spill = data->spill;
+    if (!spill)
+        return citer_next(data->probe);
+    if (data->error)
+        return NULL;
+
+    size_t n_partitions = (size_t) 1 << spill->bits;
+    if (!spill->probe_written) {
+        spill->probe_written = true;
+        void *item;
+        bool ok = true;
+        while (ok && (item = citer_next(data->probe)))
+            ok = spill_write(data, spill->probe, data->probe_key, data->probe_size, item);
+        if (!ok || !spill_flush(spill->probe, n_partitions)) {
+            spill_error(data);
+            return NULL;
+        }
+        spill->probe_buf = malloc(data->probe_size);
+    }
+    for (;;) {
+        if (spill->loaded && fread(spill->probe_buf, data->probe_size, 1, spill->probe[spill->partition]) == 1)
+            return spill->probe_buf;
+        if (spill->loaded && ferror(spill->probe[spill->partition])) {
+            spill_error(data);
+            return NULL;
+        }
+        size_t k = spill->loaded ? spill->partition + 1 : 0;
+        if ((k == n_partitions) || !spill_load(data, k))
+            return NULL;
+    }
+}
+
+static void update_bound(iterator_t *self) {
+    citer_hash_join_data_t *data = (citer_hash_join_data_t *) self->data;
+    citer_size_bound_t probe_bound = data->probe->size_bound;
+    self->size_bound.lower = 0;
+    if (data->spill || probe_bound.upper_infinite) {
+        /* Spilled items are counted by the files, not the bounds. */
+        self->size_bound.upper = 0;
+        self->size_bound.upper_infinite = true;
+    } else if (data->kind == CITER_INNER_JOIN) {
+        /* Each probe item has at most max_matches matches. */
+        size_t max = data->build.max_matches;
+        bool overflow = max && (probe_bound.upper > (SIZE_MAX - data->remaining_matches) / max);
+        self->size_bound.upper = overflow ? 0 : data->remaining_matches + probe_bound.upper * max;
+        self->size_bound.upper_infinite = overflow;
+    } else {
+        self->size_bound.upper = probe_bound.upper;
+        self->size_bound.upper_infinite = false;
+    }
+}
+
+static void *citer_hash_join_next(iterator_t *self) {
+    citer_hash_join_data_t *data = (citer_hash_join_data_t *) self->data;
+    for (;;) {
+        if (data->remaining_matches > 0) {
+            void *build_item = data->build.items[data->match];
+            data->match = data->build.next[data->match];
+            data->remaining_matches--;
+            data->pair.x = data->build_left ? build_item : data->probe_item;
+            data->pair.y = data->build_left ? data->probe_item : build_item;
+            update_bound(self);
+            return &data->pair;
+        }
+
+        void *item = next_probe(data);
+        if (!item) {
+            self->size_bound = (citer_size_bound_t) { 0 };
+            return NULL;
+        }
+        join_entry_t *entry = build_find(data, item);
+        if (data->kind == CITER_INNER_JOIN) {
+            if (entry) {
+                data->probe_item = item;
+                data->match = entry->head;
+                data->remaining_matches = entry->count;
+            }
+        } else if ((entry != NULL) == (data->kind == CITER_SEMI_JOIN)) {
+            update_bound(self);
+            return item;
+        }
+    }
+}
+
+static void citer_hash_join_free_data(void *_data) {
+    citer_hash_join_data_t *data = (citer_hash_join_data_t *) _data;
+    build_free(&data->build);
+    if (data->spill)
+        spill_free(data->spill, (size_t) 1 << data->spill->bits);
+    citer_free(data->left);
+    citer_free(data->right);
+    free(data);
+}
+
+/* Whether a's upper size bound is smaller than b's. */
+static bool smaller(iterator_t *a, iterator_t *b) {
+    if (a->size_bound.upper_infinite)
+        return false;
+    return b->size_bound.upper_infinite || (a->size_bound.upper < b->size_bound.upper);
+}
+
+iterator_t *citer_hash_join(iterator_t *left, iterator_t *right, const citer_join_ops_t *ops, citer_join_kind_t kind) {
+    citer_hash_join_data_t *data = calloc(1, sizeof(*data));
+    data->ops = *ops;
+    data->kind = kind;
+    data->left = left;
+    data->right = right;
+    data->build_left = (kind == CITER_INNER_JOIN) && smaller(left, right);
+    data->probe = data->build_left ? right : left;
+    data->build_key = data->build_left ? ops->left_key : ops->right_key;
+    data->probe_key = data->build_left ? ops->right_key : ops->left_key;
+    data->build_size = data->build_left ? ops->left_size : ops->right_size;
+    data->probe_size = data->build_left ? ops->right_size : ops->left_size;
+    /* The probe side must be spillable too. */
+    if (!data->probe_size)
+        data->build_size = 0;
+
+    build_side(data, data->build_left ? left : right);
+
+    iterator_t *it = citer_new(
+        data,
+        citer_hash_join_next,
+        NULL,
+        citer_hash_join_free_data,
+        CITER_DEFAULT_SIZE_BOUND
+    );
+    update_bound(it);
+    return it;
+}
+
+size_t citer_hash_join_memory(iterator_t *it) {
+    return ((citer_hash_join_data_t *) it->data)->peak_memory;
+}
+
+bool citer_hash_join_spilled(iterator_t *it) {
+    return ((citer_hash_join_data_t *) it->data)->spill != NULL;
+}
+
+int citer_hash_join_error(iterator_t *it) {
+    return ((citer_hash_join_data_t *) it->data)->error;
+}
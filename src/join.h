@@ -0,0 +1,135 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_JOIN_H_
+#define _CITER_JOIN_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "group.h"
+#include "hash.h"
+#include "iterator.h"
+
+/*
+ * Kind of join performed by citer_hash_join().
+ */
+typedef enum citer_join_kind {
+    /* Pairs of matching left and right items. */
+    CITER_INNER_JOIN,
+    /* Left items which match at least one right item. */
+    CITER_SEMI_JOIN,
+    /* Left items which match no right item. */
+    CITER_ANTI_JOIN,
+} citer_join_kind_t;
+
+/*
+ * Description of a join.
+ *
+ * Fields:
+ *   left_key - Gets the key of a left item.
+ *   right_key - Gets the key of a right item.
+ *   hash - Hash function for keys.
+ *   eq - Equality function for keys.
+ *   fn_data - Custom data to be passed to all the functions.
+ *   memory_budget - If not 0, the number of bytes the build side may use in
+ *                   memory before it is spilled to temporary files.
+ *   left_size, right_size - Sizes (in bytes) of the left and right items.
+ *                           Only needed for spilling, in which case items are
+ *                           copied byte for byte, so the keys must be inside
+ *                           the items. If the build side's size is 0, it is
+ *                           never spilled.
+ */
+typedef struct citer_join_ops {
+    citer_key_fn_t left_key;
+    citer_key_fn_t right_key;
+    citer_hash_fn_t hash;
+    citer_eq_fn_t eq;
+    void *fn_data;
+    size_t memory_budget;
+    size_t left_size;
+    size_t right_size;
+} citer_join_ops_t;
+
+/*
+ * Join two iterators on equal keys, using a hash table.
+ *
+ * Parameters:
+ *   left - The left iterator.
+ *   right - The right iterator.
+ *   ops - Description of the join. It is copied.
+ *   kind - Kind of join.
+ *
+ * One side (the build side) is read into a hash table of its keys before
+ * citer_hash_join() returns, and must be finite. The other side (the probe
+ * side) is then streamed through the table as the join is iterated, so it
+ * only needs to keep each item valid until the next one is read. Semi and
+ * anti joins build the right side. Inner joins build the side with the
+ * smaller upper size bound (the right side, if they are the same). The items
+ * of the build side must stay valid while the join is in use.
+ *
+ * For inner joins, each item is a pointer to a citer_pair_t, with the left
+ * item as x and the right item as y, which is overwritten by the next call to
+ * citer_next(). For each probe item, its matches are returned in the order of
+ * the build side. Semi and anti joins return the left items themselves, in
+ * order.
+ *
+ * If the build side's memory goes over ops->memory_budget, the build side is
+ * split into partitions by hash and written to temporary files (see
+ * tmpfile()), as is the probe side, when the join is first iterated. Then each
+ * partition of the build side is read back and joined with the same partition
+ * of the probe side in turn (a "Grace" hash join). Items are then copies in
+ * buffers of the join, valid until the next call to citer_next(), and they are
+ * returned grouped by partition instead of in order. Partitions are not split
+ * further, so a single partition larger than the budget is still read whole.
+ * If the temporary files can't be created, or the items built so far can't be
+ * written to them, the join stays in memory. If a later write or read of the
+ * files fails, items would be lost, so the join ends early instead; use
+ * citer_hash_join_error() to tell this apart from the end of the join.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees both sides as well.
+ */
+iterator_t *citer_hash_join(iterator_t *left, iterator_t *right, const citer_join_ops_t *ops, citer_join_kind_t kind);
+
+/*
+ * Get the largest amount of memory (in bytes) used by the build side of a
+ * join so far, for its hash table and item lists.
+ *
+ * Must only be called on iterators created by citer_hash_join().
+ */
+size_t citer_hash_join_memory(iterator_t *it);
+
+/*
+ * Check whether the build side of a join was spilled to temporary files.
+ *
+ * Must only be called on iterators created by citer_hash_join().
+ */
+bool citer_hash_join_spilled(iterator_t *it);
+
+/*
+ * Get the error which stopped a spilled join.
+ *
+ * Must only be called on iterators created by citer_hash_join().
+ *
+ * Returns the errno value of the write or read of a temporary file which
+ * failed, or 0 if none has failed.
+ */
+int citer_hash_join_error(iterator_t *it);
+
+#endif /* _CITER_JOIN_H_ */
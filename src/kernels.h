@@ -0,0 +1,55 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_KERNELS_H_
+#define _CITER_KERNELS_H_
+
+#include <stddef.h>
+
+/*
+ * Internal interface to the vectorised kernels of the reduce module, for use
+ * by other modules.
+ *
+ * This header is not part of citer.h.
+ */
+
+/*
+ * Running Kahan sum.
+ *
+ * The c field holds the error introduced by the last addition, which is
+ * subtracted from the next item before adding it. The value of the sum is
+ * sum - c.
+ */
+typedef struct citer_kahan {
+    double sum;
+    double c;
+} citer_kahan_t;
+
+static inline void citer_kahan_add(citer_kahan_t *k, double x) {
+    double y = x - k->c;
+    double t = k->sum + y;
+    k->c = (t - k->sum) - y;
+    k->sum = t;
+}
+
+/*
+ * Sum an array of doubles using the vectorised Kahan summation kernel.
+ */
+double citer_kernel_sum_f64(const double *arr, size_t n);
+
+#endif /* _CITER_KERNELS_H_ */
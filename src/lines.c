@@ -0,0 +1,778 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Needed for mmap(), madvise() and sysconf() when compiling with -std=c99. */
+#define _DEFAULT_SOURCE
+
+#include "lines.h"
+#include "simd.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Number of bytes scanned for newlines at once. One bit per byte. */
+#define BLOCK_SIZE 64
+
+/* Returned by the newline search functions when there is no newline. */
+#define NO_NEWLINE SIZE_MAX
+
+/* Number of lines between consecutive checkpoints of a line index. */
+#define INDEX_SPACING 1024
+
+/* Identifies line index files. The last byte is the format version. */
+static const char INDEX_MAGIC[8] = { 'C', 'I', 'T', 'E', 'R', 'L', 'X', 2 };
+
+/*
+ * A memory-mapped file, shared between an iterator and the iterators split off
+ * from it. It is unmapped when the last reference is released, which may
+ * happen on any thread.
+ */
+typedef struct citer_file_map {
+    char *ptr;
+    size_t size;
+    time_t mtime;
+    long mtime_nsec;
+    size_t refs;
+    pthread_mutex_t lock;
+} citer_file_map_t;
+
+/*
+ * Map a file into memory. Returns NULL (with errno set) on failure.
+ */
+static citer_file_map_t *file_map_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return NULL;
+    }
+
+    /* Empty files can't be mapped, but have no lines anyway. */
+    size_t size = (size_t) st.st_size;
+    char *ptr = NULL;
+    if (size > 0) {
+        ptr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            errno = err;
+            return NULL;
+        }
+        posix_madvise(ptr, size, POSIX_MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+        madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+    }
+    /* The mapping stays valid after the file is closed. */
+    close(fd);
+
+    citer_file_map_t *map = malloc(sizeof(*map));
+    *map = (citer_file_map_t) {
+        .ptr = ptr,
+        .size = size,
+        .mtime = st.st_mtime,
+        .mtime_nsec = st.st_mtim.tv_nsec,
+        .refs = 1,
+    };
+    pthread_mutex_init(&map->lock, NULL);
+    return map;
+}
+
+static void file_map_retain(citer_file_map_t *map) {
+    pthread_mutex_lock(&map->lock);
+    map->refs++;
+    pthread_mutex_unlock(&map->lock);
+}
+
+static void file_map_release(citer_file_map_t *map) {
+    pthread_mutex_lock(&map->lock);
+    size_t refs = --map->refs;
+    pthread_mutex_unlock(&map->lock);
+    if (refs > 0)
+        return;
+
+    if (map->size > 0)
+        munmap(map->ptr, map->size);
+    pthread_mutex_destroy(&map->lock);
+    free(map);
+}
+
+/*
+ * Find all newlines in the block of up to BLOCK_SIZE bytes at start. There are
+ * none past the end of the file.
+ */
+static uint64_t scan_block(const citer_file_map_t *map, size_t start) {
+    if (start >= map->size)
+        return 0;
+    size_t n = map->size - start;
+    if (n > BLOCK_SIZE)
+        n = BLOCK_SIZE;
+    return citer_byte_mask64(map->ptr + start, n, '\n');
+}
+
+/*
+ * Get the offset just after the Kth newline at or after pos. There should be
+ * at least K newlines there; if not, the search stops at the end of the file.
+ */
+static size_t skip_newlines(const citer_file_map_t *map, size_t pos, size_t k) {
+    while (k > 0) {
+        if (pos >= map->size)
+            return map->size;
+        uint64_t mask = scan_block(map, pos);
+        unsigned count = citer_popcount64(mask);
+        if (count < k) {
+            k -= count;
+            pos += BLOCK_SIZE;
+            continue;
+        }
+        /* Drop the first K - 1 newlines of this block. */
+        while (--k > 0)
+            mask &= mask - 1;
+        return pos + citer_ctz64(mask) + 1;
+    }
+    return pos;
+}
+
+typedef struct citer_line_checkpoint {
+    uint64_t line;
+    uint64_t offset;
+} citer_line_checkpoint_t;
+
+/*
+ * Sparse line index. Line checkpoints[i].line starts at byte
+ * checkpoints[i].offset. The first checkpoint is always line 0 at offset 0.
+ */
+struct citer_line_index {
+    uint64_t file_size;
+    int64_t mtime;
+    int64_t mtime_nsec;
+    uint64_t n_lines;
+    uint64_t n_checkpoints;
+    citer_line_checkpoint_t *checkpoints;
+};
+
+/*
+ * Get the offset of the start of a line, starting the search from the nearest
+ * checkpoint or from a known line start (known_line at known_offset), whichever
+ * is closer.
+ */
+static size_t find_line_start(
+    const citer_file_map_t *map,
+    const citer_line_index_t *index,
+    size_t line,
+    size_t known_line,
+    size_t known_offset
+) {
+    /* Find the last checkpoint at or before the line. */
+    size_t lo = 0, hi = index->n_checkpoints;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->checkpoints[mid].line <= line)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    size_t from_line = index->checkpoints[lo].line;
+    size_t pos = index->checkpoints[lo].offset;
+    if (known_line <= line && known_line > from_line) {
+        from_line = known_line;
+        pos = known_offset;
+    }
+    return skip_newlines(map, pos, line - from_line);
+}
+
+/*
+ * The lines which have not been returned yet are in [front, back) of the
+ * mapping. The front and back masks hold the newlines which have not been
+ * passed yet in the blocks starting at front_block and back_block. The next
+ * block scanned from the front starts at front_next, and the next block
+ * scanned from the back ends at back_block.
+ *
+ * When an index is given, the remaining lines are numbered [front_line,
+ * back_line).
+ */
+typedef struct citer_mmap_lines_data {
+    citer_file_map_t *map;
+    const citer_line_index_t *index;
+    size_t front;
+    size_t back;
+    size_t front_line;
+    size_t back_line;
+    bool exhausted;
+    bool sequential;
+    size_t front_block;
+    size_t front_next;
+    uint64_t front_mask;
+    size_t back_block;
+    uint64_t back_mask;
+    citer_line_t front_view;
+    citer_line_t back_view;
+} citer_mmap_lines_data_t;
+
+/* Restart newline scanning from the current front. */
+static void reset_front_scan(citer_mmap_lines_data_t *data) {
+    data->front_block = data->front;
+    data->front_next = data->front;
+    data->front_mask = 0;
+}
+
+/* Restart newline scanning from the current back. */
+static void reset_back_scan(citer_mmap_lines_data_t *data) {
+    /* Round up so that the first block scanned from the back contains the
+     * last byte of the range. */
+    data->back_block = ((data->back + BLOCK_SIZE - 1) / BLOCK_SIZE) * BLOCK_SIZE;
+    data->back_mask = 0;
+}
+
+/* Find the first newline in [front, back). */
+static size_t find_next_newline(citer_mmap_lines_data_t *data) {
+    for (;;) {
+        while (data->front_mask) {
+            size_t pos = data->front_block + citer_ctz64(data->front_mask);
+            data->front_mask &= data->front_mask - 1;
+            if (pos >= data->back)
+                return NO_NEWLINE;
+            if (pos >= data->front)
+                return pos;
+        }
+        if (data->front_next >= data->back)
+            return NO_NEWLINE;
+        data->front_block = data->front_next;
+        data->front_mask = scan_block(data->map, data->front_block);
+        data->front_next += BLOCK_SIZE;
+    }
+}
+
+/* Find the last newline in [front, back). */
+static size_t find_prev_newline(citer_mmap_lines_data_t *data) {
+    for (;;) {
+        while (data->back_mask) {
+            unsigned bit = 63 - citer_clz64(data->back_mask);
+            size_t pos = data->back_block + bit;
+            data->back_mask &= ~(UINT64_C(1) << bit);
+            if (pos < data->front)
+                return NO_NEWLINE;
+            if (pos < data->back)
+                return pos;
+        }
+        if (data->back_block <= data->front)
+            return NO_NEWLINE;
+        data->back_block -= BLOCK_SIZE;
+        data->back_mask = scan_block(data->map, data->back_block);
+    }
+}
+
+static void update_bounds(iterator_t *self, citer_mmap_lines_data_t *data) {
+    if (data->exhausted) {
+        self->size_bound.lower = 0;
+        self->size_bound.upper = 0;
+    } else if (data->index) {
+        self->size_bound.lower = data->back_line - data->front_line;
+        self->size_bound.upper = data->back_line - data->front_line;
+    } else {
+        /* There is at least one more line, and at most one more line than
+         * there are bytes left. */
+        self->size_bound.lower = 1;
+        self->size_bound.upper = data->back - data->front + 1;
+    }
+}
+
+static void *citer_mmap_lines_next(iterator_t *self) {
+    citer_mmap_lines_data_t *data = (citer_mmap_lines_data_t *) self->data;
+    if (data->exhausted)
+        return NULL;
+
+    size_t pos = find_next_newline(data);
+    data->front_view.ptr = data->map->ptr + data->front;
+    if (pos == NO_NEWLINE) {
+        data->front_view.len = data->back - data->front;
+        data->exhausted = true;
+    } else {
+        data->front_view.len = pos - data->front;
+        data->front = pos + 1;
+        data->front_line++;
+    }
+    update_bounds(self, data);
+    return &data->front_view;
+}
+
+static void *citer_mmap_lines_next_back(iterator_t *self) {
+    citer_mmap_lines_data_t *data = (citer_mmap_lines_data_t *) self->data;
+    if (data->exhausted)
+        return NULL;
+
+    /* Sequential access advice makes the kernel read ahead (and drop pages
+     * behind) in the wrong direction for reading backwards. */
+    if (data->sequential) {
+        posix_madvise(data->map->ptr, data->map->size, POSIX_MADV_NORMAL);
+        data->sequential = false;
+    }
+
+    size_t pos = find_prev_newline(data);
+    if (pos == NO_NEWLINE) {
+        data->back_view.ptr = data->map->ptr + data->front;
+        data->back_view.len = data->back - data->front;
+        data->exhausted = true;
+    } else {
+        data->back_view.ptr = data->map->ptr + pos + 1;
+        data->back_view.len = data->back - (pos + 1);
+        data->back = pos;
+        data->back_line--;
+    }
+    update_bounds(self, data);
+    return &data->back_view;
+}
+
+/*
+ * The functions below are only used for iterators with an index, which know
+ * the exact number of lines remaining.
+ */
+
+static size_t citer_mmap_lines_advance(iterator_t *self, size_t n) {
+    citer_mmap_lines_data_t *data = (citer_mmap_lines_data_t *) self->data;
+    size_t remaining = data->exhausted ? 0 : data->back_line - data->front_line;
+    if (n > remaining)
+        n = remaining;
+    if (n == 0)
+        return 0;
+
+    if (n == remaining) {
+        data->exhausted = true;
+    } else {
+        data->front = find_line_start(data->map, data->index, data->front_line + n, data->front_line, data->front);
+        data->front_line += n;
+        reset_front_scan(data);
+    }
+    update_bounds(self, data);
+    return n;
+}
+
+static size_t citer_mmap_lines_advance_back(iterator_t *self, size_t n) {
+    citer_mmap_lines_data_t *data = (citer_mmap_lines_data_t *) self->data;
+    size_t remaining = data->exhausted ? 0 : data->back_line - data->front_line;
+    if (n > remaining)
+        n = remaining;
+    if (n == 0)
+        return 0;
+
+    if (n == remaining) {
+        data->exhausted = true;
+    } else {
+        /* The new back is the newline before the first skipped line. */
+        size_t start = find_line_start(data->map, data->index, data->back_line - n, data->front_line, data->front);
+        data->back = start - 1;
+        data->back_line -= n;
+        reset_back_scan(data);
+    }
+    update_bounds(self, data);
+    return n;
+}
+
+static void citer_mmap_lines_free_data(void *_data) {
+    citer_mmap_lines_data_t *data = (citer_mmap_lines_data_t *) _data;
+    file_map_release(data->map);
+    free(data);
+}
+
+static iterator_t *citer_mmap_lines_new(
+    citer_file_map_t *map,
+    const citer_line_index_t *index,
+    size_t front,
+    size_t back,
+    size_t front_line,
+    size_t back_line,
+    bool exhausted
+);
+
+static iterator_t *citer_mmap_lines_split(iterator_t *self, size_t n) {
+    citer_mmap_lines_data_t *data = (citer_mmap_lines_data_t *) self->data;
+    size_t remaining = data->exhausted ? 0 : data->back_line - data->front_line;
+    if (n > remaining)
+        n = remaining;
+
+    /* The new iterator takes the lines after the first N. */
+    size_t split_line = data->front_line + n;
+    size_t split_offset = (n < remaining)
+        ? find_line_start(data->map, data->index, split_line, data->front_line, data->front)
+        : data->back;
+    file_map_retain(data->map);
+    iterator_t *rest = citer_mmap_lines_new(
+        data->map,
+        data->index,
+        split_offset,
+        data->back,
+        split_line,
+        data->back_line,
+        n == remaining
+    );
+
+    if (n == 0) {
+        data->exhausted = true;
+    } else if (n < remaining) {
+        data->back = split_offset - 1;
+        data->back_line = split_line;
+        reset_back_scan(data);
+    }
+    update_bounds(self, data);
+    return rest;
+}
+
+static iterator_t *citer_mmap_lines_new(
+    citer_file_map_t *map,
+    const citer_line_index_t *index,
+    size_t front,
+    size_t back,
+    size_t front_line,
+    size_t back_line,
+    bool exhausted
+) {
+    citer_mmap_lines_data_t *data = malloc(sizeof(*data));
+    *data = (citer_mmap_lines_data_t) {
+        .map = map,
+        .index = index,
+        .front = front,
+        .back = back,
+        .front_line = front_line,
+        .back_line = back_line,
+        .exhausted = exhausted,
+        .sequential = (map->size > 0),
+    };
+    reset_front_scan(data);
+    reset_back_scan(data);
+
+    iterator_t *it = citer_new(
+        data,
+        citer_mmap_lines_next,
+        citer_mmap_lines_next_back,
+        citer_mmap_lines_free_data,
+        (citer_size_bound_t) { 0 }
+    );
+    if (index) {
+        it->split = citer_mmap_lines_split;
+        it->advance = citer_mmap_lines_advance;
+        it->advance_back = citer_mmap_lines_advance_back;
+    }
+    update_bounds(it, data);
+    return it;
+}
+
+/*
+ * Get the end of the range of lines of a file. A final newline terminates the
+ * last line instead of starting a new one, so it is left out of the range.
+ */
+static size_t lines_end(const citer_file_map_t *map) {
+    if ((map->size > 0) && (map->ptr[map->size - 1] == '\n'))
+        return map->size - 1;
+    return map->size;
+}
+
+iterator_t *citer_mmap_lines(const char *path) {
+    citer_file_map_t *map = file_map_open(path);
+    if (!map)
+        return NULL;
+    /* Lines aren't counted without an index, so back_line is unused. */
+    return citer_mmap_lines_new(map, NULL, 0, lines_end(map), 0, 0, map->size == 0);
+}
+
+/*
+ * Check that an index's line count matches the mapped file, by counting the
+ * lines after its last checkpoint, which must start a line.
+ */
+static bool index_matches(const citer_file_map_t *map, const citer_line_index_t *index) {
+    if (map->size == 0)
+        return index->n_lines == 0;
+    if (index->n_lines == 0)
+        return false;
+    const citer_line_checkpoint_t *last = &index->checkpoints[index->n_checkpoints - 1];
+    if ((last->offset > 0) && (map->ptr[last->offset - 1] != '\n'))
+        return false;
+
+    size_t end = lines_end(map);
+    size_t count = 0;
+    for (size_t pos = last->offset; pos < end; pos += BLOCK_SIZE) {
+        size_t n = end - pos;
+        if (n > BLOCK_SIZE)
+            n = BLOCK_SIZE;
+        count += citer_popcount64(citer_byte_mask64(map->ptr + pos, n, '\n'));
+    }
+    return count == index->n_lines - 1 - last->line;
+}
+
+iterator_t *citer_mmap_lines_indexed(const char *path, const citer_line_index_t *index) {
+    citer_file_map_t *map = file_map_open(path);
+    if (!map)
+        return NULL;
+    if ((map->size != index->file_size) || ((int64_t) map->mtime != index->mtime) || ((int64_t) map->mtime_nsec != index->mtime_nsec)
+        || !index_matches(map, index)) {
+        file_map_release(map);
+        errno = EINVAL;
+        return NULL;
+    }
+    return citer_mmap_lines_new(map, index, 0, lines_end(map), 0, index->n_lines, index->n_lines == 0);
+}
+
+/*
+ * Work done by one thread while building an index: counting the newlines in
+ * [start, end) of the file, and recording the offset after every
+ * INDEX_SPACING-th newline, numbered from the start of the range.
+ */
+typedef struct index_task {
+    const citer_file_map_t *map;
+    size_t start;
+    size_t end;
+    size_t n_newlines;
+    citer_line_checkpoint_t *checkpoints;
+    size_t n_checkpoints;
+    size_t cap;
+} index_task_t;
+
+static void *index_task_run(void *_task) {
+    index_task_t *task = (index_task_t *) _task;
+    const char *ptr = task->map->ptr;
+    size_t count = 0;
+    /* Checkpoint after the newline with this (0-based) number. */
+    size_t next_checkpoint = INDEX_SPACING - 1;
+
+    for (size_t pos = task->start; pos < task->end; pos += BLOCK_SIZE) {
+        size_t n = task->end - pos;
+        if (n > BLOCK_SIZE)
+            n = BLOCK_SIZE;
+        uint64_t mask = citer_byte_mask64(ptr + pos, n, '\n');
+        size_t block_count = citer_popcount64(mask);
+
+        while (count + block_count > next_checkpoint) {
+            /* Drop the newlines before the checkpoint's one. */
+            uint64_t m = mask;
+            for (size_t k = count; k < next_checkpoint; k++)
+                m &= m - 1;
+            if (task->n_checkpoints == task->cap) {
+                task->cap = task->cap ? 2 * task->cap : 64;
+                task->checkpoints = realloc(task->checkpoints, task->cap * sizeof(*task->checkpoints));
+            }
+            task->checkpoints[task->n_checkpoints++] = (citer_line_checkpoint_t) {
+                .line = next_checkpoint,
+                .offset = pos + citer_ctz64(m) + 1,
+            };
+            next_checkpoint += INDEX_SPACING;
+        }
+        count += block_count;
+    }
+
+    task->n_newlines = count;
+    return NULL;
+}
+
+citer_line_index_t *citer_line_index_build(const char *path, size_t n_threads) {
+    citer_file_map_t *map = file_map_open(path);
+    if (!map)
+        return NULL;
+
+    if (n_threads == 0) {
+        long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = (n_cpus > 0) ? (size_t) n_cpus : 1;
+    }
+    /* Don't bother splitting small files into tiny pieces. */
+    size_t max_threads = (map->size / (1 << 20)) + 1;
+    if (n_threads > max_threads)
+        n_threads = max_threads;
+
+    /* Divide the file into ranges of whole blocks. */
+    index_task_t *tasks = calloc(n_threads, sizeof(*tasks));
+    pthread_t *threads = malloc(n_threads * sizeof(*threads));
+    bool *started = calloc(n_threads, sizeof(*started));
+    size_t per_task = ((map->size / n_threads) / BLOCK_SIZE + 1) * BLOCK_SIZE;
+    for (size_t t = 0; t < n_threads; t++) {
+        size_t start = t * per_task;
+        size_t end = start + per_task;
+        tasks[t] = (index_task_t) {
+            .map = map,
+            .start = (start < map->size) ? start : map->size,
+            .end = (end < map->size) ? end : map->size,
+        };
+        /* The first task runs on this thread, as do any which can't be
+         * started on their own thread. */
+        if (t > 0)
+            started[t] = (pthread_create(&threads[t], NULL, index_task_run, &tasks[t]) == 0);
+    }
+    for (size_t t = 0; t < n_threads; t++) {
+        if (!started[t])
+            index_task_run(&tasks[t]);
+    }
+    for (size_t t = 1; t < n_threads; t++) {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+    }
+
+    /* Renumber the checkpoints of each task by the newlines before it. Line
+     * numbers are one more than the number of the newline before them. */
+    size_t n_checkpoints = 1;
+    for (size_t t = 0; t < n_threads; t++)
+        n_checkpoints += tasks[t].n_checkpoints;
+
+    citer_line_index_t *index = malloc(sizeof(*index));
+    index->checkpoints = malloc(n_checkpoints * sizeof(*index->checkpoints));
+    index->checkpoints[0] = (citer_line_checkpoint_t) { .line = 0, .offset = 0 };
+    index->n_checkpoints = 1;
+    size_t newlines_before = 0;
+    for (size_t t = 0; t < n_threads; t++) {
+        for (size_t i = 0; i < tasks[t].n_checkpoints; i++) {
+            citer_line_checkpoint_t cp = tasks[t].checkpoints[i];
+            /* A final newline doesn't start another line. */
+            if (cp.offset < map->size) {
+                cp.line += newlines_before + 1;
+                index->checkpoints[index->n_checkpoints++] = cp;
+            }
+        }
+        newlines_before += tasks[t].n_newlines;
+        free(tasks[t].checkpoints);
+    }
+
+    index->file_size = map->size;
+    index->mtime = (int64_t) map->mtime;
+    index->mtime_nsec = (int64_t) map->mtime_nsec;
+    index->n_lines = newlines_before;
+    if (lines_end(map) == map->size && map->size > 0)
+        /* The last line has no final newline. */
+        index->n_lines++;
+
+    free(started);
+    free(threads);
+    free(tasks);
+    file_map_release(map);
+    return index;
+}
+
+bool citer_line_index_save(const citer_line_index_t *index, const char *index_path) {
+    FILE *f = fopen(index_path, "wb");
+    if (!f)
+        return false;
+
+    bool ok = (fwrite(INDEX_MAGIC, sizeof(INDEX_MAGIC), 1, f) == 1)
+        && (fwrite(&index->file_size, sizeof(index->file_size), 1, f) == 1)
+        && (fwrite(&index->mtime, sizeof(index->mtime), 1, f) == 1)
+        && (fwrite(&index->mtime_nsec, sizeof(index->mtime_nsec), 1, f) == 1)
+        && (fwrite(&index->n_lines, sizeof(index->n_lines), 1, f) == 1)
+        && (fwrite(&index->n_checkpoints, sizeof(index->n_checkpoints), 1, f) == 1)
+        && (fwrite(index->checkpoints, sizeof(*index->checkpoints), index->n_checkpoints, f) == index->n_checkpoints);
+    if (fclose(f) != 0)
+        ok = false;
+    return ok;
+}
+
+/*
+ * Check that a loaded index's checkpoints could have been built for its file,
+ * so that lines are never searched for outside the file. Line 0 starts at
+ * offset 0, and later checkpoints increase in both line and offset, with every
+ * line at least one byte long and starting inside the file.
+ */
+static bool index_is_valid(const citer_line_index_t *index) {
+    const citer_line_checkpoint_t *cp = index->checkpoints;
+    if ((cp[0].line != 0) || (cp[0].offset != 0))
+        return false;
+    for (size_t i = 1; i < index->n_checkpoints; i++) {
+        if ((cp[i].line <= cp[i - 1].line) || (cp[i].offset <= cp[i - 1].offset) || (cp[i].offset >= index->file_size))
+            return false;
+        if (cp[i].offset - cp[i - 1].offset < cp[i].line - cp[i - 1].line)
+            return false;
+    }
+    /* The last checkpoint is a line of the file. */
+    return (index->n_checkpoints == 1) || (cp[index->n_checkpoints - 1].line < index->n_lines);
+}
+
+citer_line_index_t *citer_line_index_load(const char *path, const char *index_path) {
+    struct stat st;
+    if (stat(path, &st) < 0)
+        return NULL;
+
+    FILE *f = fopen(index_path, "rb");
+    if (!f)
+        return NULL;
+
+    char magic[sizeof(INDEX_MAGIC)];
+    citer_line_index_t *index = malloc(sizeof(*index));
+    index->checkpoints = NULL;
+    bool ok = (fread(magic, sizeof(magic), 1, f) == 1)
+        && (memcmp(magic, INDEX_MAGIC, sizeof(magic)) == 0)
+        && (fread(&index->file_size, sizeof(index->file_size), 1, f) == 1)
+        && (fread(&index->mtime, sizeof(index->mtime), 1, f) == 1)
+        && (fread(&index->mtime_nsec, sizeof(index->mtime_nsec), 1, f) == 1)
+        && (fread(&index->n_lines, sizeof(index->n_lines), 1, f) == 1)
+        && (fread(&index->n_checkpoints, sizeof(index->n_checkpoints), 1, f) == 1)
+        /* Reject stale indexes, for files which have changed since. */
+        && (index->file_size == (uint64_t) st.st_size)
+        && (index->mtime == (int64_t) st.st_mtime)
+        && (index->mtime_nsec == (int64_t) st.st_mtim.tv_nsec)
+        /* Every line takes at least one byte. */
+        && (index->n_lines <= index->file_size)
+        && (index->n_checkpoints > 0)
+        && (index->n_checkpoints <= index->n_lines + 1);
+    if (ok) {
+        index->checkpoints = malloc(index->n_checkpoints * sizeof(*index->checkpoints));
+        ok = (fread(index->checkpoints, sizeof(*index->checkpoints), index->n_checkpoints, f) == index->n_checkpoints)
+            && index_is_valid(index);
+    }
+    fclose(f);
+
+    if (!ok) {
+        citer_line_index_free(index);
+        errno = EINVAL;
+        return NULL;
+    }
+    return index;
+}
+
+citer_line_index_t *citer_line_index_open(const char *path, size_t n_threads) {
+    size_t len = strlen(path);
+    char *index_path = malloc(len + sizeof(".lidx"));
+    memcpy(index_path, path, len);
+    memcpy(index_path + len, ".lidx", sizeof(".lidx"));
+
+    citer_line_index_t *index = citer_line_index_load(path, index_path);
+    if (!index) {
+        index = citer_line_index_build(path, n_threads);
+        /* The saved index is only a cache, so failing to save it is fine. */
+        if (index)
+            citer_line_index_save(index, index_path);
+    }
+    free(index_path);
+    return index;
+}
+
+size_t citer_line_index_count(const citer_line_index_t *index) {
+    return (size_t) index->n_lines;
+}
+
+void citer_line_index_free(citer_line_index_t *index) {
+    if (!index)
+        return;
+    free(index->checkpoints);
+    free(index);
+}
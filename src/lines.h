@@ -0,0 +1,163 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_LINES_H_
+#define _CITER_LINES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "iterator.h"
+
+/*
+ * A view of one line of text.
+ *
+ * The ptr field points to the first character of the line, and len is its
+ * length in bytes, not including the line terminator. The line is not
+ * NUL-terminated.
+ */
+typedef struct citer_line {
+    const char *ptr;
+    size_t len;
+} citer_line_t;
+
+/*
+ * Iterator over the lines of a file, which is memory-mapped instead of read.
+ *
+ * Parameters:
+ *   path - Path of the file to read.
+ *
+ * Each item is a pointer to a citer_line_t which views the line in the mapped
+ * file, so no data is copied. Lines are terminated by '\n'. A '\r' before the
+ * '\n' is not removed. A final '\n' at the end of the file does not start
+ * another (empty) line.
+ *
+ * The text the views point to stays valid until the iterator is freed, but
+ * the citer_line_t structures themselves are reused: the one returned by
+ * citer_next() is overwritten by the next call to citer_next(), and likewise
+ * for citer_next_back().
+ *
+ * Newlines are found by comparing 64 bytes at a time with vectorised
+ * comparisons and walking the resulting bitmaps, in either direction. The
+ * iterator is double-ended, so the last lines of a file can be read using
+ * citer_reverse() without touching the rest of the file. The kernel is told
+ * that the mapping will be read sequentially (and asked to back it with huge
+ * pages where supported); this advice is dropped once lines are read from the
+ * back.
+ *
+ * The file must not be truncated while the iterator is in use.
+ *
+ * Without an index (see citer_mmap_lines_indexed()), the number of lines is
+ * not known in advance, and skipping lines means scanning them.
+ *
+ * Returns a new iterator, or NULL if the file cannot be opened or mapped, in
+ * which case errno is set. The returned iterator must be freed with
+ * citer_free(), which unmaps the file.
+ */
+iterator_t *citer_mmap_lines(const char *path);
+
+/*
+ * Sparse index of the lines of a file.
+ *
+ * The index records the total number of lines, and the offset of every
+ * 1024th line. Finding any line then only requires scanning from the nearest
+ * recorded line. The index is tied to the size and modification time of the
+ * file it was built from.
+ */
+typedef struct citer_line_index citer_line_index_t;
+
+/*
+ * Build a line index for a file.
+ *
+ * The file is memory-mapped and divided into byte ranges which are scanned in
+ * parallel, each by its own thread, in a single pass. N_THREADS is the maximum
+ * number of threads to use, or 0 to use one per online CPU. Small files use
+ * fewer threads.
+ *
+ * Returns a new index, or NULL if the file cannot be opened or mapped, in
+ * which case errno is set. The index must be freed with
+ * citer_line_index_free().
+ */
+citer_line_index_t *citer_line_index_build(const char *path, size_t n_threads);
+
+/*
+ * Save a line index to a file.
+ *
+ * The index is saved in the native byte order, so it can only be loaded on
+ * machines of the same architecture.
+ *
+ * Returns true on success, or false if the file cannot be written, in which
+ * case errno is set.
+ */
+bool citer_line_index_save(const citer_line_index_t *index, const char *index_path);
+
+/*
+ * Load a line index for the file at PATH, which was saved to INDEX_PATH.
+ *
+ * Returns a new index, or NULL if the index cannot be read, is corrupt, or is
+ * stale (i.e. the file's size or modification time has changed since the
+ * index was built). The index must be freed with citer_line_index_free().
+ */
+citer_line_index_t *citer_line_index_load(const char *path, const char *index_path);
+
+/*
+ * Get a line index for a file, using the saved index next to it if possible.
+ *
+ * Loads the index saved at PATH followed by ".lidx". If that is missing or
+ * stale, a new index is built (see citer_line_index_build()) and saved there.
+ * Failing to save the index is not an error.
+ *
+ * Returns a new index, or NULL if the file cannot be opened or mapped. The
+ * index must be freed with citer_line_index_free().
+ */
+citer_line_index_t *citer_line_index_open(const char *path, size_t n_threads);
+
+/*
+ * Get the number of lines in the file a line index was built from.
+ */
+size_t citer_line_index_count(const citer_line_index_t *index);
+
+/*
+ * Free a line index. Does nothing if index is NULL.
+ */
+void citer_line_index_free(citer_line_index_t *index);
+
+/*
+ * Iterator over the lines of a file, using a line index.
+ *
+ * This is the same as citer_mmap_lines(), but the iterator knows its exact
+ * size and can find any line quickly using the index. So it skips lines (see
+ * citer_advance(), citer_nth() and citer_skip()) from either end without
+ * scanning the skipped lines, and it can be split (see citer_split_at()) by
+ * line count, e.g. to divide a file between threads. The file is only mapped
+ * once, and is unmapped when the last of the split iterators is freed, which
+ * can happen on any thread.
+ *
+ * The index is not copied, so it must not be freed until this iterator and
+ * all iterators split off from it have been freed.
+ *
+ * The index must match the file: its size, modification time, and the number
+ * of lines after the index's last checkpoint (which are counted) are checked.
+ *
+ * Returns a new iterator, or NULL if the file cannot be opened or mapped, or
+ * if the index does not match the file (in which case errno is set to
+ * EINVAL). The returned iterator must be freed with citer_free().
+ */
+iterator_t *citer_mmap_lines_indexed(const char *path, const citer_line_index_t *index);
+
+#endif /* _CITER_LINES_H_ */
@@ -0,0 +1,510 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "merge.h"
+#include "over_array.h"
+#include "repeat.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Number of items skipped in a row from one side before galloping. */
+#define MIN_GALLOP 7
+
+/* Number of items taken at once from iterators which can be read directly. */
+#define REFILL_SIZE 64
+
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+
+typedef enum merge_op {
+    OP_JOIN,
+    OP_UNION,
+    OP_INTERSECT,
+    OP_DIFFERENCE,
+} merge_op_t;
+
+/*
+ * State shared by all merges. The heads are the next items of each side, or
+ * NULL once the side is exhausted. A head which has been yielded is only
+ * replaced at the next call, so that it stays valid until then.
+ */
+typedef struct citer_merge_data {
+    iterator_t *a;
+    iterator_t *b;
+    citer_cmp_fn_t cmp;
+    void *extra_data;
+    merge_op_t op;
+    bool started;
+    void *head_a;
+    void *head_b;
+    bool pop_a;
+    bool pop_b;
+    /* Number of items skipped in a row from each side. */
+    size_t skipped_a;
+    size_t skipped_b;
+
+    /* Joins: the run of items of b equal to head_a, and the next one to pair
+     * with it. */
+    void **run;
+    size_t run_len;
+    size_t run_capacity;
+    size_t run_pos;
+    citer_pair_t pair;
+} citer_merge_data_t;
+
+/*
+ * Count the leading items of a strided side which are less than TARGET (an
+ * item of the other side), using an exponential search then a binary search.
+ */
+static size_t gallop(citer_merge_data_t *data, iterator_t *it, bool is_a, void *target) {
+    void *first;
+    size_t stride;
+    size_t len;
+    if (!citer_as_strided(it, &first, &stride, &len))
+        return 0;
+    char *base = (char *) first;
+#define LESS(i) (is_a ? data->cmp(base + (i) * stride, target, data->extra_data) < 0 \
+                      : data->cmp(target, base + (i) * stride, data->extra_data) > 0)
+    /* Items before bound / 2 are less. */
+    size_t bound = 1;
+    while (bound <= len && LESS(bound - 1))
+        bound *= 2;
+    size_t lo = bound / 2;
+    size_t hi = MIN(bound - 1, len);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (LESS(mid))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+#undef LESS
+    return lo;
+}
+
+/*
+ * Drop the head of a, which is less than the head of b. After MIN_GALLOP
+ * heads in a row, gallop to the first item which is not less.
+ */
+static void skip_a(citer_merge_data_t *data) {
+    if (++data->skipped_a >= MIN_GALLOP)
+        citer_advance(data->a, gallop(data, data->a, true, data->head_b));
+    data->head_a = citer_next(data->a);
+    data->skipped_b = 0;
+}
+
+static void skip_b(citer_merge_data_t *data) {
+    if (++data->skipped_b >= MIN_GALLOP)
+        citer_advance(data->b, gallop(data, data->b, false, data->head_a));
+    data->head_b = citer_next(data->b);
+    data->skipped_a = 0;
+}
+
+/* Get the size bound of the rest of a side, including its head. */
+static citer_size_bound_t side_bound(iterator_t *it, void *head, bool popped) {
+    citer_size_bound_t bound = it->size_bound;
+    if (head && !popped)
+        citer_bound_add(bound, 1);
+    return bound;
+}
+
+static void update_bound(iterator_t *self) {
+    citer_merge_data_t *data = (citer_merge_data_t *) self->data;
+    citer_size_bound_t a = side_bound(data->a, data->head_a, data->pop_a);
+    citer_size_bound_t b = side_bound(data->b, data->head_b, data->pop_b);
+    citer_size_bound_t bound = { 0 };
+    switch (data->op) {
+    case OP_JOIN: {
+        /* The rest of the current run, then each remaining item of a paired
+         * with at most the run and all of b. */
+        size_t pending = data->run_len - data->run_pos;
+        citer_size_bound_t rest_a = data->run_len ? data->a->size_bound : a;
+        citer_size_bound_t per_a = b;
+        citer_bound_add(per_a, data->run_len);
+        bound.lower = pending;
+        if ((rest_a.upper_infinite && (per_a.upper_infinite || per_a.upper))
+            || (per_a.upper_infinite && rest_a.upper)) {
+            bound.upper_infinite = true;
+        } else if (per_a.upper && rest_a.upper > (SIZE_MAX - pending) / per_a.upper) {
+            bound.upper_infinite = true;
+        } else {
+            bound.upper = rest_a.upper * per_a.upper + pending;
+        }
+        break;
+    }
+    case OP_UNION:
+        bound.lower_infinite = a.lower_infinite || b.lower_infinite;
+        bound.lower = bound.lower_infinite ? 0 : MAX(a.lower, b.lower);
+        bound.upper_infinite = a.upper_infinite || b.upper_infinite || a.upper > SIZE_MAX - b.upper;
+        bound.upper = bound.upper_infinite ? 0 : a.upper + b.upper;
+        break;
+    case OP_INTERSECT:
+        bound.upper_infinite = a.upper_infinite && b.upper_infinite;
+        bound.upper = a.upper_infinite ? b.upper : (b.upper_infinite ? a.upper : MIN(a.upper, b.upper));
+        break;
+    case OP_DIFFERENCE:
+        if (!b.upper_infinite) {
+            bound.lower_infinite = a.lower_infinite;
+            bound.lower = (!a.lower_infinite && a.lower > b.upper) ? a.lower - b.upper : 0;
+        }
+        bound.upper_infinite = a.upper_infinite;
+        bound.upper = a.upper;
+        break;
+    }
+    self->size_bound = bound;
+}
+
+/* Read the first heads, or replace the heads which have been yielded. */
+static void pop_heads(citer_merge_data_t *data) {
+    if (!data->started) {
+        data->head_a = citer_next(data->a);
+        data->head_b = citer_next(data->b);
+        data->started = true;
+    }
+    if (data->pop_a)
+        data->head_a = citer_next(data->a);
+    if (data->pop_b)
+        data->head_b = citer_next(data->b);
+    data->pop_a = false;
+    data->pop_b = false;
+}
+
+static void *merge_join_next(citer_merge_data_t *data) {
+    for (;;) {
+        if (data->run_pos < data->run_len) {
+            data->pair.x = data->head_a;
+            data->pair.y = data->run[data->run_pos++];
+            return &data->pair;
+        }
+        if (data->run_len) {
+            /* Pair the next item of a with the same run, if it is equal. */
+            data->head_a = citer_next(data->a);
+            data->run_pos = 0;
+            if (data->head_a && data->cmp(data->head_a, data->run[0], data->extra_data) == 0)
+                continue;
+            data->run_len = 0;
+        }
+        if (!data->head_a || !data->head_b)
+            return NULL;
+
+        int c = data->cmp(data->head_a, data->head_b, data->extra_data);
+        if (c < 0) {
+            skip_a(data);
+        } else if (c > 0) {
+            skip_b(data);
+        } else {
+            data->skipped_a = 0;
+            data->skipped_b = 0;
+            do {
+                if (data->run_len == data->run_capacity) {
+                    data->run_capacity = data->run_capacity ? 2 * data->run_capacity : 16;
+                    data->run = realloc(data->run, data->run_capacity * sizeof(*data->run));
+                }
+                data->run[data->run_len++] = data->head_b;
+                data->head_b = citer_next(data->b);
+            } while (data->head_b && data->cmp(data->head_a, data->head_b, data->extra_data) == 0);
+        }
+    }
+}
+
+static void *union_next(citer_merge_data_t *data) {
+    if (!data->head_a && !data->head_b)
+        return NULL;
+    if (!data->head_b) {
+        data->pop_a = true;
+        return data->head_a;
+    }
+    if (!data->head_a) {
+        data->pop_b = true;
+        return data->head_b;
+    }
+    int c = data->cmp(data->head_a, data->head_b, data->extra_data);
+    if (c <= 0) {
+        data->pop_a = true;
+        data->pop_b = c == 0;
+        return data->head_a;
+    }
+    data->pop_b = true;
+    return data->head_b;
+}
+
+static void *intersect_next(citer_merge_data_t *data) {
+    while (data->head_a && data->head_b) {
+        int c = data->cmp(data->head_a, data->head_b, data->extra_data);
+        if (c < 0) {
+            skip_a(data);
+        } else if (c > 0) {
+            skip_b(data);
+        } else {
+            data->skipped_a = 0;
+            data->skipped_b = 0;
+            data->pop_a = true;
+            data->pop_b = true;
+            return data->head_a;
+        }
+    }
+    return NULL;
+}
+
+static void *difference_next(citer_merge_data_t *data) {
+    while (data->head_a) {
+        int c = data->head_b ? data->cmp(data->head_a, data->head_b, data->extra_data) : -1;
+        if (c < 0) {
+            data->pop_a = true;
+            return data->head_a;
+        } else if (c > 0) {
+            skip_b(data);
+        } else {
+            data->skipped_b = 0;
+            data->head_a = citer_next(data->a);
+            data->head_b = citer_next(data->b);
+        }
+    }
+    return NULL;
+}
+
+static void *citer_merge_next(iterator_t *self) {
+    citer_merge_data_t *data = (citer_merge_data_t *) self->data;
+    pop_heads(data);
+    void *item = NULL;
+    switch (data->op) {
+    case OP_JOIN:
+        item = merge_join_next(data);
+        break;
+    case OP_UNION:
+        item = union_next(data);
+        break;
+    case OP_INTERSECT:
+        item = intersect_next(data);
+        break;
+    case OP_DIFFERENCE:
+        item = difference_next(data);
+        break;
+    }
+    if (item)
+        update_bound(self);
+    else
+        self->size_bound = (citer_size_bound_t) { 0 };
+    return item;
+}
+
+static void citer_merge_free_data(void *_data) {
+    citer_merge_data_t *data = (citer_merge_data_t *) _data;
+    citer_free(data->a);
+    citer_free(data->b);
+    free(data->run);
+    free(data);
+}
+
+static iterator_t *merge_new(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data, merge_op_t op) {
+    citer_merge_data_t *data = calloc(1, sizeof(*data));
+    data->a = a;
+    data->b = b;
+    data->cmp = cmp;
+    data->extra_data = extra_data;
+    data->op = op;
+
+    iterator_t *it = citer_new(
+        data,
+        citer_merge_next,
+        NULL,
+        citer_merge_free_data,
+        CITER_DEFAULT_SIZE_BOUND
+    );
+    update_bound(it);
+    return it;
+}
+
+iterator_t *citer_merge_join(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data) {
+    return merge_new(a, b, cmp, extra_data, OP_JOIN);
+}
+
+iterator_t *citer_sorted_union(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data) {
+    return merge_new(a, b, cmp, extra_data, OP_UNION);
+}
+
+iterator_t *citer_sorted_intersect(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data) {
+    return merge_new(a, b, cmp, extra_data, OP_INTERSECT);
+}
+
+iterator_t *citer_sorted_difference(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data) {
+    return merge_new(a, b, cmp, extra_data, OP_DIFFERENCE);
+}
+
+/*
+ * An input of a K-way merge. Items taken from a strided iterator but not
+ * merged yet start at cursor.
+ */
+typedef struct merge_input {
+    iterator_t *it;
+    void *head;
+    char *cursor;
+    size_t stride;
+    size_t buffered;
+} merge_input_t;
+
+/*
+ * State of a K-way merge. losers[1..k-1] are the internal nodes of a
+ * tournament tree whose leaves (nodes k to 2k-1) are the inputs. Each node
+ * holds the input which lost the match there, and losers[0] holds the overall
+ * winner.
+ */
+typedef struct citer_merge_sorted_data {
+    merge_input_t *inputs;
+    size_t k;
+    size_t *losers;
+    citer_cmp_fn_t cmp;
+    void *extra_data;
+    bool started;
+    /* Whether the head of the winner was yielded, and must be replaced. */
+    bool pop;
+} citer_merge_sorted_data_t;
+
+/* Read the next item of an input into its head. */
+static void input_refill(merge_input_t *input) {
+    if (input->buffered == 0) {
+        void *first;
+        size_t len;
+        if (!citer_as_strided(input->it, &first, &input->stride, &len)) {
+            input->head = citer_next(input->it);
+            return;
+        }
+        input->buffered = MIN(len, REFILL_SIZE);
+        input->cursor = (char *) first;
+        citer_array_advance(input->it, input->buffered);
+        if (input->buffered == 0) {
+            input->head = NULL;
+            return;
+        }
+    }
+    input->head = input->cursor;
+    input->cursor += input->stride;
+    input->buffered--;
+}
+
+/*
+ * Whether input i comes before input j. Exhausted inputs come last, and ties
+ * go to the first input, to keep the merge stable.
+ */
+static inline bool beats(citer_merge_sorted_data_t *data, size_t i, size_t j) {
+    void *x = data->inputs[i].head;
+    void *y = data->inputs[j].head;
+    if (!x || !y)
+        return x != NULL || (!y && i < j);
+    int c = data->cmp(x, y, data->extra_data);
+    return c < 0 || (c == 0 && i < j);
+}
+
+/* Play the matches below a node, and return the winner. */
+static size_t build_tree(citer_merge_sorted_data_t *data, size_t node) {
+    if (node >= data->k)
+        return node - data->k;
+    size_t left = build_tree(data, 2 * node);
+    size_t right = build_tree(data, 2 * node + 1);
+    if (beats(data, left, right)) {
+        data->losers[node] = right;
+        return left;
+    }
+    data->losers[node] = left;
+    return right;
+}
+
+/* Replay the matches of the winner, after its head changed. */
+static void replay(citer_merge_sorted_data_t *data) {
+    size_t winner = data->losers[0];
+    for (size_t node = (winner + data->k) / 2; node >= 1; node /= 2) {
+        if (beats(data, data->losers[node], winner)) {
+            size_t loser = winner;
+            winner = data->losers[node];
+            data->losers[node] = loser;
+        }
+    }
+    data->losers[0] = winner;
+}
+
+static void *citer_merge_sorted_next(iterator_t *self) {
+    citer_merge_sorted_data_t *data = (citer_merge_sorted_data_t *) self->data;
+    if (!data->started) {
+        for (size_t i = 0; i < data->k; i++)
+            input_refill(&data->inputs[i]);
+        data->losers[0] = build_tree(data, 1);
+        data->started = true;
+    } else if (data->pop) {
+        input_refill(&data->inputs[data->losers[0]]);
+        replay(data);
+    }
+    void *item = data->inputs[data->losers[0]].head;
+    data->pop = item != NULL;
+    if (item)
+        citer_bound_sub(self->size_bound, 1);
+    else
+        self->size_bound = (citer_size_bound_t) { 0 };
+    return item;
+}
+
+static void citer_merge_sorted_free_data(void *_data) {
+    citer_merge_sorted_data_t *data = (citer_merge_sorted_data_t *) _data;
+    for (size_t i = 0; i < data->k; i++)
+        citer_free(data->inputs[i].it);
+    free(data->inputs);
+    free(data->losers);
+    free(data);
+}
+
+iterator_t *citer_merge_sorted(iterator_t **its, size_t k, citer_cmp_fn_t cmp, void *extra_data) {
+    if (k == 0)
+        return citer_empty();
+
+    citer_merge_sorted_data_t *data = malloc(sizeof(*data));
+    data->inputs = calloc(k, sizeof(*data->inputs));
+    data->k = k;
+    data->losers = malloc(k * sizeof(*data->losers));
+    data->cmp = cmp;
+    data->extra_data = extra_data;
+    data->started = false;
+    data->pop = false;
+
+    /* The merge yields exactly the items of all the inputs. */
+    citer_size_bound_t size_bound = { 0 };
+    for (size_t i = 0; i < k; i++) {
+        data->inputs[i].it = its[i];
+        citer_size_bound_t bound = its[i]->size_bound;
+        if (bound.lower_infinite || size_bound.lower > SIZE_MAX - bound.lower)
+            size_bound.lower_infinite = true;
+        else
+            size_bound.lower += bound.lower;
+        if (bound.upper_infinite || size_bound.upper > SIZE_MAX - bound.upper)
+            size_bound.upper_infinite = true;
+        else
+            size_bound.upper += bound.upper;
+    }
+    if (size_bound.lower_infinite)
+        size_bound.lower = 0;
+    if (size_bound.upper_infinite)
+        size_bound.upper = 0;
+
+    return citer_new(
+        data,
+        citer_merge_sorted_next,
+        NULL,
+        citer_merge_sorted_free_data,
+        size_bound
+    );
+}
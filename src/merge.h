@@ -0,0 +1,118 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_MERGE_H_
+#define _CITER_MERGE_H_
+
+#include "filters.h"
+#include "iterator.h"
+#include "zip.h"
+
+/*
+ * Operations on sorted iterators.
+ *
+ * The iterators passed to these functions must be sorted in ascending order by
+ * the given comparison function. They are streamed in a single pass, without
+ * buffering or hashing, in O(n + m) comparisons.
+ *
+ * Iterators which can be read directly (see citer_as_strided()), such as
+ * citer_over_array(), are skipped over by galloping: once several items in a
+ * row have been skipped, an exponential search finds the end of the items to
+ * skip, and they are jumped over with citer_advance(). This takes O(log d)
+ * comparisons to skip d items, so that intersections of a small iterator with
+ * a large array are sublinear.
+ *
+ * For all of these functions, the returned iterator must be freed with
+ * citer_free(). Freeing it frees both input iterators as well.
+ */
+
+/*
+ * Join two sorted iterators on equal items.
+ *
+ * Parameters:
+ *   a - The left iterator.
+ *   b - The right iterator.
+ *   cmp - Comparison function, called with an item of a first and an item of
+ *         b second, so a and b may have items of different types.
+ *   extra_data - Extra data to pass to cmp.
+ *
+ * Each item is a pointer to a citer_pair_t, with an item of a as x and an equal
+ * item of b as y. It is overwritten by the next call to citer_next(). Every
+ * pair of equal items is yielded, in the order of a, then of b.
+ *
+ * To pair each item of a with a run of equal items of b, the run is kept, so
+ * that memory use is O(1) only if the items of b are distinct. Items of b
+ * which are part of a run must stay valid until the run is passed, so b must
+ * not reuse its items if it has duplicates.
+ */
+iterator_t *citer_merge_join(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Union of two sorted iterators.
+ *
+ * Yields the items of both iterators in sorted order. Items which are in both
+ * iterators are yielded once, from a. Like C++'s std::set_union(), an item
+ * which is m times in a and n times in b is yielded max(m, n) times.
+ */
+iterator_t *citer_sorted_union(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Intersection of two sorted iterators.
+ *
+ * Yields the items of a which are also in b, in order. An item which is m times
+ * in a and n times in b is yielded min(m, n) times.
+ */
+iterator_t *citer_sorted_intersect(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Difference of two sorted iterators.
+ *
+ * Yields the items of a which are not in b, in order. An item which is m times
+ * in a and n times in b is yielded max(m - n, 0) times.
+ */
+iterator_t *citer_sorted_difference(iterator_t *a, iterator_t *b, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Merge K sorted iterators into one sorted iterator.
+ *
+ * Parameters:
+ *   its - Array of K iterators, each sorted by cmp. The array is copied, and
+ *         the iterators are owned by the merge.
+ *   k - Number of iterators.
+ *   cmp - Comparison function for the items.
+ *   extra_data - Extra data to pass to cmp.
+ *
+ * The next items of the iterators are kept in a tournament (loser) tree, so
+ * each item takes about log2(K) comparisons. Equal items are yielded in the
+ * order of the iterators in its, so the merge is stable.
+ *
+ * Iterators which can be read directly (see citer_as_strided()) are consumed
+ * a block of items at a time, which are then read from memory without
+ * calling the iterator. Other iterators are read one item at a time, and their
+ * items only need to stay valid until the next call to citer_next() on the
+ * merge.
+ *
+ * The size bound is the sum of the bounds of the iterators, so it is exact if
+ * they all are. The merge is not double-ended.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees the K iterators as well, but not the array its.
+ */
+iterator_t *citer_merge_sorted(iterator_t **its, size_t k, citer_cmp_fn_t cmp, void *extra_data);
+
+#endif /* _CITER_MERGE_H_ */
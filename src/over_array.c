@@ -20,11 +20,14 @@
 
 #include <stdlib.h>
 
+/* over_array and over_strided iterators share the same state and functions.
+ * For over_array iterators, stride is the item size and contiguous is true. */
 typedef struct citer_over_array_data {
 	void *array;
-	size_t itemsize;
+	size_t stride;
 	size_t len;
 	size_t i;
+	bool contiguous;
 } citer_over_array_data_t;
 
 static void *citer_over_array_next(iterator_t *self) {
@@ -35,7 +38,7 @@ static void *citer_over_array_next(iterator_t *self) {
 		self->size_bound.lower--;
 		self->size_bound.upper--;
 		/* Cast to (char *) so pointer arithmetic is in terms of bytes. */
-		return (void *) (((char *) data->array) + (data->i++ * data->itemsize));
+		return (void *) (((char *) data->array) + (data->i++ * data->stride));
 	} else {
 		return NULL;
 	}
@@ -49,23 +52,95 @@ static void *citer_over_array_next_back(iterator_t *self) {
 		self->size_bound.lower--;
 		self->size_bound.upper--;
 		/* Cast to (char *) so pointer arithmetic is in terms of bytes. */
-		return (void *) (((char *) data->array) + (((data->len--) - 1) * data->itemsize));
+		return (void *) (((char *) data->array) + (((data->len--) - 1) * data->stride));
 	} else {
 		return NULL;
 	}
 }
 
+static size_t citer_over_array_advance(iterator_t *self, size_t n) {
+	citer_over_array_data_t *data = (citer_over_array_data_t *) self->data;
+	if (n > data->len - data->i)
+		n = data->len - data->i;
+	data->i += n;
+	self->size_bound.lower -= n;
+	self->size_bound.upper -= n;
+	return n;
+}
+
+static size_t citer_over_array_advance_back(iterator_t *self, size_t n) {
+	citer_over_array_data_t *data = (citer_over_array_data_t *) self->data;
+	if (n > data->len - data->i)
+		n = data->len - data->i;
+	data->len -= n;
+	self->size_bound.lower -= n;
+	self->size_bound.upper -= n;
+	return n;
+}
+
 void citer_over_array_free_data(void *_data) {
 	free(_data);
 }
 
-iterator_t *citer_over_array(void *array, size_t itemsize, size_t len) {
+bool citer_as_array(iterator_t *it, void **array, size_t *itemsize, size_t *len) {
+	/* Reversed over_array iterators have their next and next_back functions
+	 * swapped, so they are not treated as contiguous. */
+	if (it->next != citer_over_array_next)
+		return false;
+	citer_over_array_data_t *data = (citer_over_array_data_t *) it->data;
+	if (!data->contiguous)
+		return false;
+	*array = (void *) (((char *) data->array) + (data->i * data->stride));
+	*itemsize = data->stride;
+	*len = data->len - data->i;
+	return true;
+}
+
+bool citer_as_strided(iterator_t *it, void **first, size_t *stride, size_t *len) {
+	/* See citer_as_array() for why reversed iterators are excluded. */
+	if (it->next != citer_over_array_next)
+		return false;
+	citer_over_array_data_t *data = (citer_over_array_data_t *) it->data;
+	*first = (void *) (((char *) data->array) + (data->i * data->stride));
+	*stride = data->stride;
+	*len = data->len - data->i;
+	return true;
+}
+
+void citer_array_advance(iterator_t *it, size_t n) {
+	citer_over_array_advance(it, n);
+}
+
+static iterator_t *citer_over_array_new(void *array, size_t stride, size_t len, bool contiguous);
+
+static iterator_t *citer_over_array_split(iterator_t *self, size_t n) {
+	citer_over_array_data_t *data = (citer_over_array_data_t *) self->data;
+	size_t remaining = data->len - data->i;
+	if (n > remaining)
+		n = remaining;
+
+	/* The new iterator takes the items after the first N. */
+	iterator_t *rest = citer_over_array_new(
+		((char *) data->array) + ((data->i + n) * data->stride),
+		data->stride,
+		remaining - n,
+		data->contiguous
+	);
+
+	data->len = data->i + n;
+	self->size_bound.lower = n;
+	self->size_bound.upper = n;
+	return rest;
+}
+
+static iterator_t *citer_over_array_new(void *array, size_t stride, size_t len, bool contiguous) {
 	citer_over_array_data_t *data = malloc(sizeof(*data));
 	*data = (citer_over_array_data_t) {
 		.array = array,
-		.itemsize = itemsize,
+		.stride = stride,
 		.len = len,
 		.i = 0,
+		.contiguous = contiguous,
 	};
 
 	citer_size_bound_t size_bound = {
@@ -75,11 +150,23 @@ iterator_t *citer_over_array(void *array, size_t itemsize, size_t len) {
 		.upper_infinite = false,
 	};
 
-	return citer_new(
+	iterator_t *it = citer_new(
 		data,
 		citer_over_array_next,
 		citer_over_array_next_back,
 		citer_over_array_free_data,
 		size_bound
 	);
+	it->split = citer_over_array_split;
+	it->advance = citer_over_array_advance;
+	it->advance_back = citer_over_array_advance_back;
+	return it;
+}
+
+iterator_t *citer_over_array(void *array, size_t itemsize, size_t len) {
+	return citer_over_array_new(array, itemsize, len, true);
+}
+
+iterator_t *citer_over_strided(void *base, size_t offset, size_t stride, size_t len) {
+	return citer_over_array_new(((char *) base) + offset, stride, len, false);
 }
@@ -19,10 +19,40 @@
 #ifndef _CITER_OVER_ARRAY_H_
 #define _CITER_OVER_ARRAY_H_
 
+#include <stdbool.h>
 #include <stddef.h>
 
 #include "iterator.h"
 
+/*
+ * A view of a run of consecutive items.
+ *
+ * If indirect is false, ptr points to len items of itemsize bytes each, laid
+ * out contiguously, e.g. a range of the array of an over_array iterator.
+ * If indirect is true, ptr is an array of len items of type (void *), i.e. the
+ * items exactly as an iterator returned them.
+ *
+ * Use citer_slice_get() to get the items of a slice without caring which
+ * representation is used.
+ */
+typedef struct citer_slice {
+    void *ptr;
+    size_t len;
+    size_t itemsize;
+    bool indirect;
+} citer_slice_t;
+
+/*
+ * Get the Ith item of a slice (given as a pointer to a citer_slice_t).
+ *
+ * The result is the same item an iterator over the slice's source would have
+ * returned, i.e. a pointer to the item for contiguous slices.
+ */
+#define citer_slice_get(slice, i) \
+    ((slice)->indirect \
+     ? ((void **) (slice)->ptr)[(i)] \
+     : (void *) (((char *) (slice)->ptr) + ((i) * (slice)->itemsize)))
+
 /*
  * Iterator over an array.
  *
@@ -40,4 +70,69 @@
  */
 iterator_t *citer_over_array(void *array, size_t itemsize, size_t num_items);
 
+/*
+ * Iterator over one field of an array of structs (or any other items spaced a
+ * fixed number of bytes apart).
+ *
+ * Parameters:
+ * - base: pointer to the first element of the array
+ * - offset: offset (in bytes) of the field within each element, e.g. as given
+ *           by offsetof()
+ * - stride: distance (in bytes) between consecutive elements, e.g. the size
+ *           of the struct
+ * - len: number of elements in the array
+ *
+ * Returns a new iterator. This iterator's items are pointers to the field in
+ * each element, i.e. base + offset + (i * stride) for the Ith item. It is
+ * exact-sized, double-ended and splittable.
+ *
+ * This avoids the extra stage (and indirect call per item) of mapping an
+ * over_array iterator to a field. Typed reductions (e.g. citer_sum_f64()) and
+ * citer_filter_cmp() recognise strided iterators (see citer_as_strided()) and
+ * read the fields directly.
+ *
+ * The returned iterator must be freed with citer_free() after use. Freeing the
+ * iterator does not free the array itself.
+ */
+iterator_t *citer_over_strided(void *base, size_t offset, size_t stride, size_t len);
+
+/*
+ * Get direct access to the remaining items of a contiguous iterator.
+ *
+ * If the iterator is an over_array iterator (which has not been reversed),
+ * stores a pointer to its next item in *array, the size of each item in
+ * *itemsize, and the number of remaining items in *len, then returns true.
+ * Otherwise returns false and leaves the output arguments untouched.
+ *
+ * The iterator is not advanced. Callers which process the items through the
+ * returned pointer should mark them as consumed using citer_array_advance().
+ *
+ * This is used by consumers which can process a whole array at once much
+ * faster than one item at a time, e.g. citer_sum_i64().
+ */
+bool citer_as_array(iterator_t *it, void **array, size_t *itemsize, size_t *len);
+
+/*
+ * Mark the first N remaining items of a contiguous iterator as consumed.
+ *
+ * Must only be called on iterators for which citer_as_array() or
+ * citer_as_strided() returns true.
+ * N is clamped to the number of remaining items.
+ */
+void citer_array_advance(iterator_t *it, size_t n);
+
+/*
+ * Get direct access to the remaining items of a strided iterator.
+ *
+ * If the iterator is an over_strided or over_array iterator (which has not been
+ * reversed), stores its next item in *first, the distance (in bytes) between
+ * consecutive items in *stride, and the number of remaining items in *len,
+ * then returns true. Otherwise returns false and leaves the output arguments
+ * untouched.
+ *
+ * The iterator is not advanced. Callers which process the items through the
+ * returned pointer should mark them as consumed using citer_array_advance().
+ */
+bool citer_as_strided(iterator_t *it, void **first, size_t *stride, size_t *len);
+
 #endif /* _CITER_OVER_ARRAY_H_ */
@@ -0,0 +1,193 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "range.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+ * Both signed and unsigned ranges are stored as unsigned values. Since
+ * unsigned arithmetic wraps around, start + (i * step) gives the correct
+ * two's complement result for signed ranges and negative steps too.
+ *
+ * Items in [front, back) have not been returned yet.
+ */
+typedef struct citer_range_data {
+    uint64_t start;
+    uint64_t step;
+    size_t front;
+    size_t back;
+    uint64_t front_value;
+    uint64_t back_value;
+} citer_range_data_t;
+
+#define RANGE_VALUE(data, i) ((data)->start + ((uint64_t) (i) * (data)->step))
+
+static void *citer_range_next(iterator_t *self) {
+    citer_range_data_t *data = (citer_range_data_t *) self->data;
+    if (data->front == data->back)
+        return NULL;
+    self->size_bound.lower--;
+    self->size_bound.upper--;
+    data->front_value = RANGE_VALUE(data, data->front++);
+    return &data->front_value;
+}
+
+static void *citer_range_next_back(iterator_t *self) {
+    citer_range_data_t *data = (citer_range_data_t *) self->data;
+    if (data->front == data->back)
+        return NULL;
+    self->size_bound.lower--;
+    self->size_bound.upper--;
+    data->back_value = RANGE_VALUE(data, --data->back);
+    return &data->back_value;
+}
+
+static size_t citer_range_advance(iterator_t *self, size_t n) {
+    citer_range_data_t *data = (citer_range_data_t *) self->data;
+    if (n > data->back - data->front)
+        n = data->back - data->front;
+    data->front += n;
+    self->size_bound.lower -= n;
+    self->size_bound.upper -= n;
+    return n;
+}
+
+static size_t citer_range_advance_back(iterator_t *self, size_t n) {
+    citer_range_data_t *data = (citer_range_data_t *) self->data;
+    if (n > data->back - data->front)
+        n = data->back - data->front;
+    data->back -= n;
+    self->size_bound.lower -= n;
+    self->size_bound.upper -= n;
+    return n;
+}
+
+static void citer_range_free_data(void *_data) {
+    free(_data);
+}
+
+static iterator_t *citer_range_new(uint64_t start, uint64_t step, size_t front, size_t back);
+
+static iterator_t *citer_range_split(iterator_t *self, size_t n) {
+    citer_range_data_t *data = (citer_range_data_t *) self->data;
+    if (n > data->back - data->front)
+        n = data->back - data->front;
+
+    /* The new iterator takes the items after the first N. */
+    iterator_t *rest = citer_range_new(data->start, data->step, data->front + n, data->back);
+
+    data->back = data->front + n;
+    self->size_bound.lower = n;
+    self->size_bound.upper = n;
+    return rest;
+}
+
+static iterator_t *citer_range_new(uint64_t start, uint64_t step, size_t front, size_t back) {
+    citer_range_data_t *data = malloc(sizeof(*data));
+    *data = (citer_range_data_t) {
+        .start = start,
+        .step = step,
+        .front = front,
+        .back = back,
+    };
+
+    citer_size_bound_t size_bound = {
+        .lower = back - front,
+        .upper = back - front,
+        .lower_infinite = false,
+        .upper_infinite = false,
+    };
+
+    iterator_t *it = citer_new(
+        data,
+        citer_range_next,
+        citer_range_next_back,
+        citer_range_free_data,
+        size_bound
+    );
+    it->split = citer_range_split;
+    it->advance = citer_range_advance;
+    it->advance_back = citer_range_advance_back;
+    return it;
+}
+
+/*
+ * Number of values in [start, end) when counting up by step, given as unsigned
+ * distances so that the full 64-bit range does not overflow.
+ */
+static size_t range_len(uint64_t distance, uint64_t step) {
+    if (distance == 0)
+        return 0;
+    uint64_t len = ((distance - 1) / step) + 1;
+    /* Ranges longer than SIZE_MAX (only possible when size_t is narrower than
+     * 64 bits) are truncated. */
+    return (len > SIZE_MAX) ? SIZE_MAX : (size_t) len;
+}
+
+iterator_t *citer_range_i64(int64_t start, int64_t end, int64_t step) {
+    if (step == 0)
+        return NULL;
+
+    size_t len;
+    if (step > 0)
+        len = (start < end) ? range_len((uint64_t) end - (uint64_t) start, (uint64_t) step) : 0;
+    else
+        len = (start > end) ? range_len((uint64_t) start - (uint64_t) end, -(uint64_t) step) : 0;
+    return citer_range_new((uint64_t) start, (uint64_t) step, 0, len);
+}
+
+iterator_t *citer_range_u64(uint64_t start, uint64_t end, uint64_t step) {
+    if (step == 0)
+        return NULL;
+
+    size_t len = (start < end) ? range_len(end - start, step) : 0;
+    return citer_range_new(start, step, 0, len);
+}
+
+size_t citer_range_fill(iterator_t *it, void *out, size_t n) {
+    bool reversed;
+    if (it->next == citer_range_next)
+        reversed = false;
+    else if (it->next == citer_range_next_back)
+        /* Reversed range. Its back is now the front, and vice versa. */
+        reversed = true;
+    else
+        return 0;
+
+    uint64_t *values = (uint64_t *) out;
+    citer_range_data_t *data = (citer_range_data_t *) it->data;
+    if (n > data->back - data->front)
+        n = data->back - data->front;
+    if (n == 0)
+        return 0;
+
+    if (!reversed) {
+        uint64_t base = RANGE_VALUE(data, data->front);
+        for (size_t i = 0; i < n; i++)
+            values[i] = base + ((uint64_t) i * data->step);
+        citer_range_advance(it, n);
+    } else {
+        uint64_t base = RANGE_VALUE(data, data->back - 1);
+        for (size_t i = 0; i < n; i++)
+            values[i] = base - ((uint64_t) i * data->step);
+        citer_range_advance_back(it, n);
+    }
+    return n;
+}
@@ -0,0 +1,67 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_RANGE_H_
+#define _CITER_RANGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "iterator.h"
+
+/*
+ * Iterator over a range of 64-bit integers.
+ *
+ * Parameters:
+ *   start - The first value of the range.
+ *   end - The end of the range. This value itself is not included.
+ *   step - The difference between consecutive values. Must not be 0. For
+ *          citer_range_i64(), a negative step counts down from start to end.
+ *
+ * Each item is a pointer to the current value (an int64_t for
+ * citer_range_i64() and a uint64_t for citer_range_u64()). The values are not
+ * stored anywhere; they are computed when needed and written to a slot in the
+ * iterator's data. The front and back of the iterator use separate slots, so
+ * the pointer returned by citer_next() stays valid until the next call to
+ * citer_next() (and likewise for citer_next_back()), but not any longer.
+ *
+ * The returned iterator is exact-sized, double-ended and splittable, and can
+ * skip items (see citer_advance()) in O(1) time, so citer_nth(), citer_skip()
+ * and citer_nth_back() do not step through the skipped values. Values can be
+ * written to an array in bulk using citer_range_fill().
+ *
+ * Returns a new iterator, or NULL if step is 0. The returned iterator must be
+ * freed with citer_free() after use.
+ */
+iterator_t *citer_range_i64(int64_t start, int64_t end, int64_t step);
+iterator_t *citer_range_u64(uint64_t start, uint64_t end, uint64_t step);
+
+/*
+ * Write the next N values of a range iterator into an array.
+ *
+ * The array must have room for at least N values of the range's type, i.e. it
+ * should be an (int64_t *) for citer_range_i64() iterators and a (uint64_t *)
+ * for citer_range_u64() iterators. Reversed ranges are filled in reverse
+ * order. The iterator is advanced past the written values.
+ *
+ * Returns the number of values written, which is less than N only if the
+ * iterator was exhausted. Returns 0 if the iterator is not a range iterator.
+ */
+size_t citer_range_fill(iterator_t *it, void *out, size_t n);
+
+#endif /* _CITER_RANGE_H_ */
@@ -0,0 +1,177 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "reduce.h"
+#include "kernels.h"
+#include "over_array.h"
+#include "simd.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Number of items gathered from a non-contiguous iterator at a time. */
+#define BATCH_SIZE 256
+
+/*
+ * Kernel bodies. Each kernel takes an array of N items and folds them into the
+ * accumulator pointed to by acc. The main loops operate on CITER_LANES
+ * independent lanes so that they can be vectorised without reordering any
+ * individual lane's operations.
+ */
+
+/* Integer sum. Items are widened to WIDE, then added modulo 2^64. */
+#define SUM_INT_BODY(WIDE) { \
+    uint64_t lanes[CITER_LANES] = { 0 }; \
+    size_t i = 0; \
+    for (; i + CITER_LANES <= n; i += CITER_LANES) \
+        for (size_t j = 0; j < CITER_LANES; j++) \
+            lanes[j] += (uint64_t) (WIDE) arr[i + j]; \
+    for (; i < n; i++) \
+        lanes[0] += (uint64_t) (WIDE) arr[i]; \
+    for (size_t j = 0; j < CITER_LANES; j++) \
+        *acc += lanes[j]; \
+}
+
+/* Integer product modulo 2^64. */
+#define PRODUCT_INT_BODY(WIDE) { \
+    uint64_t lanes[CITER_LANES]; \
+    for (size_t j = 0; j < CITER_LANES; j++) \
+        lanes[j] = 1; \
+    size_t i = 0; \
+    for (; i + CITER_LANES <= n; i += CITER_LANES) \
+        for (size_t j = 0; j < CITER_LANES; j++) \
+            lanes[j] *= (uint64_t) (WIDE) arr[i + j]; \
+    for (; i < n; i++) \
+        lanes[0] *= (uint64_t) (WIDE) arr[i]; \
+    for (size_t j = 0; j < CITER_LANES; j++) \
+        *acc *= lanes[j]; \
+}
+
+/* Floating-point sum using one Kahan accumulator per lane. */
+#define SUM_FLOAT_BODY { \
+    double sum[CITER_LANES] = { 0 }; \
+    double c[CITER_LANES] = { 0 }; \
+    size_t i = 0; \
+    for (; i + CITER_LANES <= n; i += CITER_LANES) { \
+        for (size_t j = 0; j < CITER_LANES; j++) { \
+            double y = (double) arr[i + j] - c[j]; \
+            double t = sum[j] + y; \
+            c[j] = (t - sum[j]) - y; \
+            sum[j] = t; \
+        } \
+    } \
+    for (size_t j = 0; j < CITER_LANES; j++) { \
+        citer_kahan_add(acc, sum[j]); \
+        citer_kahan_add(acc, -c[j]); \
+    } \
+    for (; i < n; i++) \
+        citer_kahan_add(acc, (double) arr[i]); \
+}
+
+/* Floating-point product. */
+#define PRODUCT_FLOAT_BODY { \
+    double lanes[CITER_LANES]; \
+    for (size_t j = 0; j < CITER_LANES; j++) \
+        lanes[j] = 1.0; \
+    size_t i = 0; \
+    for (; i + CITER_LANES <= n; i += CITER_LANES) \
+        for (size_t j = 0; j < CITER_LANES; j++) \
+            lanes[j] *= (double) arr[i + j]; \
+    for (; i < n; i++) \
+        lanes[0] *= (double) arr[i]; \
+    for (size_t j = 0; j < CITER_LANES; j++) \
+        *acc *= lanes[j]; \
+}
+
+#define KERNEL_ARGS (arr, n, acc)
+
+CITER_DISPATCH_KERNEL(void, sum_i32_kernel, (const int32_t *arr, size_t n, uint64_t *acc), KERNEL_ARGS, SUM_INT_BODY(int64_t))
+CITER_DISPATCH_KERNEL(void, sum_i64_kernel, (const int64_t *arr, size_t n, uint64_t *acc), KERNEL_ARGS, SUM_INT_BODY(int64_t))
+CITER_DISPATCH_KERNEL(void, sum_u32_kernel, (const uint32_t *arr, size_t n, uint64_t *acc), KERNEL_ARGS, SUM_INT_BODY(uint64_t))
+CITER_DISPATCH_KERNEL(void, sum_u64_kernel, (const uint64_t *arr, size_t n, uint64_t *acc), KERNEL_ARGS, SUM_INT_BODY(uint64_t))
+CITER_DISPATCH_KERNEL(void, sum_f32_kernel, (const float *arr, size_t n, citer_kahan_t *acc), KERNEL_ARGS, SUM_FLOAT_BODY)
+CITER_DISPATCH_KERNEL(void, sum_f64_kernel, (const double *arr, size_t n, citer_kahan_t *acc), KERNEL_ARGS, SUM_FLOAT_BODY)
+CITER_DISPATCH_KERNEL(void, product_i64_kernel, (const int64_t *arr, size_t n, uint64_t *acc), KERNEL_ARGS, PRODUCT_INT_BODY(int64_t))
+CITER_DISPATCH_KERNEL(void, product_u64_kernel, (const uint64_t *arr, size_t n, uint64_t *acc), KERNEL_ARGS, PRODUCT_INT_BODY(uint64_t))
+CITER_DISPATCH_KERNEL(void, product_f64_kernel, (const double *arr, size_t n, double *acc), KERNEL_ARGS, PRODUCT_FLOAT_BODY)
+
+/*
+ * Define a reduction function.
+ *
+ * Runs the kernel directly over the source's array if it is contiguous.
+ * Otherwise, gathers items into a buffer in batches and runs the kernel on each
+ * batch.
+ */
+#define DEFINE_REDUCTION(ret, name, T, acc_t, init, kernel, result) \
+    ret name(iterator_t *it) { \
+        if (citer_is_infinite(it)) \
+            /* TODO: Notify caller of error. */ \
+            return 0; \
+        acc_t acc = init; \
+        void *array; \
+        size_t itemsize, len; \
+        if (citer_as_array(it, &array, &itemsize, &len) && (itemsize == sizeof(T))) { \
+            kernel((const T *) array, len, &acc); \
+            citer_array_advance(it, len); \
+        } else if (citer_as_strided(it, &array, &itemsize, &len)) { \
+            /* Gather the fields into a buffer without going through the \
+             * iterator. Here itemsize is the stride. */ \
+            T buf[BATCH_SIZE]; \
+            const char *p = (const char *) array; \
+            for (size_t start = 0; start < len; start += BATCH_SIZE) { \
+                size_t n = (len - start < BATCH_SIZE) ? len - start : BATCH_SIZE; \
+                for (size_t i = 0; i < n; i++) \
+                    memcpy(&buf[i], p + ((start + i) * itemsize), sizeof(T)); \
+                kernel(buf, n, &acc); \
+            } \
+            citer_array_advance(it, len); \
+        } else { \
+            void *items[BATCH_SIZE]; \
+            T buf[BATCH_SIZE]; \
+            size_t n; \
+            do { \
+                n = citer_next_batch(it, items, BATCH_SIZE); \
+                for (size_t i = 0; i < n; i++) \
+                    buf[i] = *((T *) items[i]); \
+                kernel(buf, n, &acc); \
+            } while (n == BATCH_SIZE); \
+        } \
+        return result(acc); \
+    }
+
+#define AS_I64(acc) ((int64_t) (acc))
+#define AS_IS(acc) (acc)
+#define KAHAN_RESULT(acc) ((acc).sum - (acc).c)
+#define KAHAN_INIT ((citer_kahan_t) { .sum = 0.0, .c = 0.0 })
+
+double citer_kernel_sum_f64(const double *arr, size_t n) {
+    citer_kahan_t acc = KAHAN_INIT;
+    sum_f64_kernel(arr, n, &acc);
+    return KAHAN_RESULT(acc);
+}
+
+DEFINE_REDUCTION(int64_t, citer_sum_i32, int32_t, uint64_t, 0, sum_i32_kernel, AS_I64)
+DEFINE_REDUCTION(int64_t, citer_sum_i64, int64_t, uint64_t, 0, sum_i64_kernel, AS_I64)
+DEFINE_REDUCTION(uint64_t, citer_sum_u32, uint32_t, uint64_t, 0, sum_u32_kernel, AS_IS)
+DEFINE_REDUCTION(uint64_t, citer_sum_u64, uint64_t, uint64_t, 0, sum_u64_kernel, AS_IS)
+DEFINE_REDUCTION(double, citer_sum_f32, float, citer_kahan_t, KAHAN_INIT, sum_f32_kernel, KAHAN_RESULT)
+DEFINE_REDUCTION(double, citer_sum_f64, double, citer_kahan_t, KAHAN_INIT, sum_f64_kernel, KAHAN_RESULT)
+DEFINE_REDUCTION(int64_t, citer_product_i64, int64_t, uint64_t, 1, product_i64_kernel, AS_I64)
+DEFINE_REDUCTION(uint64_t, citer_product_u64, uint64_t, uint64_t, 1, product_u64_kernel, AS_IS)
+DEFINE_REDUCTION(double, citer_product_f64, double, double, 1.0, product_f64_kernel, AS_IS)
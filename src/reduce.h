@@ -0,0 +1,71 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_REDUCE_H_
+#define _CITER_REDUCE_H_
+
+#include <stdint.h>
+
+#include "iterator.h"
+
+/*
+ * Typed reductions.
+ *
+ * These functions sum or multiply the items of an iterator whose items are
+ * pointers to numbers of the given type, e.g. citer_sum_i64() expects each item
+ * to be an (int64_t *). This is what citer_over_array() yields for an array of
+ * the corresponding type.
+ *
+ * When the iterator is contiguous (see citer_as_array()) and its item size
+ * matches the type, the whole remaining array is reduced at once using
+ * vectorised kernels, with the instruction set chosen at runtime. Otherwise,
+ * items are pulled from the iterator in batches and gathered into a buffer,
+ * which is then reduced using the same kernels. Strided iterators (see
+ * citer_over_strided()) are gathered into the buffer directly from the array,
+ * without going through the iterator.
+ *
+ * Integer sums of 32-bit types are accumulated in 64 bits. Integer overflow
+ * wraps around (modulo 2^64) instead of being undefined behaviour.
+ *
+ * Floating-point sums are accumulated in double precision using Kahan
+ * summation, so the result does not depend much on the order of the items.
+ *
+ * These functions only work for finite iterators. When the input iterator is
+ * guaranteed to be infinite, 0 is returned. When other infinite iterators are
+ * passed in, these functions loop forever.
+ *
+ * These functions exhaust the iterator, but do not free it.
+ */
+int64_t citer_sum_i32(iterator_t *);
+int64_t citer_sum_i64(iterator_t *);
+uint64_t citer_sum_u32(iterator_t *);
+uint64_t citer_sum_u64(iterator_t *);
+double citer_sum_f32(iterator_t *);
+double citer_sum_f64(iterator_t *);
+
+/*
+ * Typed products.
+ *
+ * Same as the typed sums above, but multiplies the items instead. The product
+ * of an empty iterator is 1.
+ */
+int64_t citer_product_i64(iterator_t *);
+uint64_t citer_product_u64(iterator_t *);
+double citer_product_f64(iterator_t *);
+
+#endif /* _CITER_REDUCE_H_ */
@@ -30,5 +30,12 @@ iterator_t *citer_reverse(iterator_t *orig) {
     citer_next_fn tmp = orig->next;
     orig->next = orig->next_back;
     orig->next_back = tmp;
+    citer_advance_fn tmp_advance = orig->advance;
+    orig->advance = orig->advance_back;
+    orig->advance_back = tmp_advance;
+
+    /* Splitting is defined in terms of the front of the iterator, which has
+     * just become the back. */
+    orig->split = NULL;
     return orig;
 }
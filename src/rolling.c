@@ -0,0 +1,274 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "rolling.h"
+#include "kernels.h"
+#include "over_array.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef enum citer_rolling_kind {
+    ROLLING_GENERIC,
+    ROLLING_SUM,
+    ROLLING_MEAN,
+    ROLLING_VAR,
+    ROLLING_MIN,
+    ROLLING_MAX,
+} citer_rolling_kind_t;
+
+typedef struct citer_rolling_data {
+    iterator_t *orig;
+    size_t width;
+    citer_rolling_kind_t kind;
+
+    /* Generic aggregation. */
+    citer_rolling_fn_t add_fn;
+    citer_rolling_fn_t remove_fn;
+    void *state;
+
+    /* For contiguous sources, items are read straight from the array at base,
+     * which holds len items. Otherwise, the last width items are kept in the
+     * ring, with item i at index (i % width). */
+    char *base;
+    size_t itemsize;
+    size_t len;
+    void **ring;
+    /* Number of items pulled from the source so far. */
+    size_t index;
+
+    /* Typed aggregation. The deque is a circular buffer of width entries,
+     * holding the indices and values of the candidates for the minimum or
+     * maximum of the window, in increasing index order. */
+    citer_kahan_t sum;
+    double mean;
+    double m2;
+    size_t *deque_idx;
+    double *deque_val;
+    size_t deque_head;
+    size_t deque_len;
+    double result;
+} citer_rolling_data_t;
+
+#define DEQUE_AT(data, k) (((data)->deque_head + (k)) % (data)->width)
+
+/*
+ * Push item I with value V onto the monotonic deque. For a maximum, smaller
+ * values at the back can never be the maximum again, so they are dropped. For a
+ * minimum, larger values are dropped.
+ */
+static void deque_push(citer_rolling_data_t *data, size_t i, double v) {
+    bool is_max = data->kind == ROLLING_MAX;
+
+    /* Drop the front entry if it has left the window. */
+    if (data->deque_len && (data->deque_idx[data->deque_head] + data->width <= i)) {
+        data->deque_head = DEQUE_AT(data, 1);
+        data->deque_len--;
+    }
+
+    while (data->deque_len) {
+        double back = data->deque_val[DEQUE_AT(data, data->deque_len - 1)];
+        if (is_max ? (back > v) : (back < v))
+            break;
+        data->deque_len--;
+    }
+
+    size_t pos = DEQUE_AT(data, data->deque_len);
+    data->deque_idx[pos] = i;
+    data->deque_val[pos] = v;
+    data->deque_len++;
+}
+
+/*
+ * Update the aggregate with item I entering the window, and OLD (if not NULL)
+ * leaving it.
+ */
+static void rolling_update(citer_rolling_data_t *data, size_t i, void *item, void *old) {
+    size_t width = data->width;
+    double v, o;
+
+    switch (data->kind) {
+    case ROLLING_GENERIC:
+        if (old)
+            data->remove_fn(data->state, old);
+        data->add_fn(data->state, item);
+        break;
+
+    case ROLLING_SUM:
+    case ROLLING_MEAN:
+        if (data->base && data->itemsize == sizeof(double)) {
+            /* Recompute the sum of the window from scratch once every width
+             * windows (including the first), and update it incrementally in
+             * between. */
+            if (i + 1 < width) {
+                break;
+            } else if ((i + 1 - width) % width == 0) {
+                data->sum.sum = citer_kernel_sum_f64((const double *) (data->base + ((i + 1 - width) * sizeof(double))), width);
+                data->sum.c = 0.0;
+            } else {
+                citer_kahan_add(&data->sum, *((double *) item));
+                citer_kahan_add(&data->sum, -*((double *) old));
+            }
+        } else {
+            citer_kahan_add(&data->sum, *((double *) item));
+            if (old)
+                citer_kahan_add(&data->sum, -*((double *) old));
+        }
+        data->result = data->sum.sum - data->sum.c;
+        if (data->kind == ROLLING_MEAN)
+            data->result /= (double) width;
+        break;
+
+    case ROLLING_VAR:
+        v = *((double *) item);
+        if (old) {
+            /* Replace the oldest value with the new one. */
+            o = *((double *) old);
+            double delta = v - o;
+            double old_mean = data->mean;
+            data->mean += delta / (double) width;
+            data->m2 += delta * ((v - data->mean) + (o - old_mean));
+            if (data->m2 < 0.0)
+                data->m2 = 0.0;
+        } else {
+            /* Welford's algorithm while the window fills up. */
+            double delta = v - data->mean;
+            data->mean += delta / (double) (i + 1);
+            data->m2 += delta * (v - data->mean);
+        }
+        data->result = (width > 1) ? (data->m2 / (double) (width - 1)) : 0.0;
+        break;
+
+    case ROLLING_MIN:
+    case ROLLING_MAX:
+        deque_push(data, i, *((double *) item));
+        data->result = data->deque_val[data->deque_head];
+        break;
+    }
+}
+
+static void *citer_rolling_next(iterator_t *self) {
+    citer_rolling_data_t *data = (citer_rolling_data_t *) self->data;
+    size_t width = data->width;
+
+    for (;;) {
+        size_t i = data->index;
+        void *item;
+        void *old = NULL;
+
+        if (data->base) {
+            if (i == data->len)
+                return NULL;
+            item = data->base + (i * data->itemsize);
+            if (i >= width)
+                old = data->base + ((i - width) * data->itemsize);
+        } else {
+            item = citer_next(data->orig);
+            if (!item)
+                return NULL;
+            if (i >= width)
+                old = data->ring[i % width];
+            data->ring[i % width] = item;
+        }
+        data->index++;
+
+        rolling_update(data, i, item, old);
+
+        /* Only yield once the window is full. */
+        if (i + 1 >= width) {
+            citer_bound_sub(self->size_bound, 1);
+            return (data->kind == ROLLING_GENERIC) ? data->state : (void *) &data->result;
+        }
+    }
+}
+
+static void citer_rolling_free_data(void *_data) {
+    citer_rolling_data_t *data = (citer_rolling_data_t *) _data;
+    free(data->ring);
+    free(data->deque_idx);
+    free(data->deque_val);
+    citer_free(data->orig);
+    free(data);
+}
+
+static iterator_t *citer_rolling_new(iterator_t *orig, size_t width, citer_rolling_kind_t kind) {
+    /* Window width cannot be 0. */
+    if (width == 0)
+        return NULL;
+
+    citer_rolling_data_t *data = malloc(sizeof(*data));
+    *data = (citer_rolling_data_t) {
+        .orig = orig,
+        .width = width,
+        .kind = kind,
+    };
+
+    void *array;
+    if (citer_as_array(orig, &array, &data->itemsize, &data->len))
+        data->base = (char *) array;
+    else
+        data->ring = malloc(width * sizeof(*data->ring));
+
+    if (kind == ROLLING_MIN || kind == ROLLING_MAX) {
+        data->deque_idx = malloc(width * sizeof(*data->deque_idx));
+        data->deque_val = malloc(width * sizeof(*data->deque_val));
+    }
+
+    /* A source of N items has N - width + 1 windows. */
+    citer_size_bound_t size_bound = orig->size_bound;
+    citer_bound_sub(size_bound, width - 1);
+
+    return citer_new(
+        data,
+        citer_rolling_next,
+        NULL,
+        citer_rolling_free_data,
+        size_bound
+    );
+}
+
+iterator_t *citer_rolling(iterator_t *orig, size_t width, citer_rolling_fn_t add_fn, citer_rolling_fn_t remove_fn, void *state) {
+    iterator_t *it = citer_rolling_new(orig, width, ROLLING_GENERIC);
+    if (it) {
+        citer_rolling_data_t *data = (citer_rolling_data_t *) it->data;
+        data->add_fn = add_fn;
+        data->remove_fn = remove_fn;
+        data->state = state;
+    }
+    return it;
+}
+
+iterator_t *citer_rolling_sum(iterator_t *orig, size_t width) {
+    return citer_rolling_new(orig, width, ROLLING_SUM);
+}
+
+iterator_t *citer_rolling_mean(iterator_t *orig, size_t width) {
+    return citer_rolling_new(orig, width, ROLLING_MEAN);
+}
+
+iterator_t *citer_rolling_var(iterator_t *orig, size_t width) {
+    return citer_rolling_new(orig, width, ROLLING_VAR);
+}
+
+iterator_t *citer_rolling_min(iterator_t *orig, size_t width) {
+    return citer_rolling_new(orig, width, ROLLING_MIN);
+}
+
+iterator_t *citer_rolling_max(iterator_t *orig, size_t width) {
+    return citer_rolling_new(orig, width, ROLLING_MAX);
+}
@@ -0,0 +1,96 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_ROLLING_H_
+#define _CITER_ROLLING_H_
+
+#include <stddef.h>
+
+#include "iterator.h"
+
+/*
+ * Update function for citer_rolling().
+ *
+ * The first argument is the user's aggregation state. The second argument is
+ * the item entering (for the add function) or leaving (for the remove
+ * function) the window.
+ */
+typedef void (*citer_rolling_fn_t)(void *state, void *item);
+
+/*
+ * Generic rolling (windowed) aggregation.
+ *
+ * For every window of WIDTH consecutive items of the source, yields the state
+ * pointer after updating it incrementally: each item is passed to add_fn when
+ * it enters the window, and to remove_fn when it leaves the window. Each step
+ * therefore costs one add and at most one remove, regardless of the width.
+ *
+ * The last WIDTH items are remembered by this iterator, so the items
+ * returned by the source must stay valid while they are in the window.
+ * When the source is contiguous (see citer_as_array()), the items are read
+ * straight from its array and nothing is copied.
+ *
+ * A source of N items yields N - WIDTH + 1 states, or none if N < WIDTH.
+ *
+ * Parameters:
+ *   orig - The source iterator.
+ *   width - The width of each window. Must be greater than 0.
+ *   add_fn - Function called on each item entering the window.
+ *   remove_fn - Function called on each item leaving the window.
+ *   state - The aggregation state passed to add_fn and remove_fn. This is
+ *           also the item returned for each window.
+ *
+ * Returns a new iterator, or NULL if width is 0. This iterator must be freed
+ * after use using citer_free(). Freeing this iterator will free the source
+ * iterator as well, but not the state.
+ */
+iterator_t *citer_rolling(iterator_t *orig, size_t width, citer_rolling_fn_t add_fn, citer_rolling_fn_t remove_fn, void *state);
+
+/*
+ * Typed rolling aggregations.
+ *
+ * The source's items must be pointers to doubles, as yielded by
+ * citer_over_array() over an array of doubles. Each returned item is a pointer
+ * to a double holding the aggregate of the current window. The same double is
+ * reused each time the iterator is advanced.
+ *
+ * - citer_rolling_sum() keeps a Kahan-compensated running sum.
+ * - citer_rolling_mean() is the running sum divided by the width.
+ * - citer_rolling_var() keeps a running mean and sum of squared deviations,
+ *   and yields the sample variance (0 when the width is 1).
+ * - citer_rolling_min() and citer_rolling_max() use a monotonic deque, so
+ *   each item is pushed and popped at most once.
+ *
+ * For contiguous sources of doubles, values are read straight from the array,
+ * and the running sum is recomputed with the vectorised summation kernel once
+ * every WIDTH steps, which costs O(1) amortised and stops rounding errors from
+ * building up.
+ *
+ * A source of N items yields N - WIDTH + 1 aggregates, or none if N < WIDTH.
+ *
+ * These functions return NULL if the width is 0. The returned iterator must be
+ * freed after use using citer_free(). Freeing this iterator will free the
+ * source iterator as well.
+ */
+iterator_t *citer_rolling_sum(iterator_t *orig, size_t width);
+iterator_t *citer_rolling_mean(iterator_t *orig, size_t width);
+iterator_t *citer_rolling_var(iterator_t *orig, size_t width);
+iterator_t *citer_rolling_min(iterator_t *orig, size_t width);
+iterator_t *citer_rolling_max(iterator_t *orig, size_t width);
+
+#endif /* _CITER_ROLLING_H_ */
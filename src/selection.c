@@ -0,0 +1,258 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "selection.h"
+#include "collect.h"
+#include "over_array.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Ranges this small are insertion sorted instead of partitioned. */
+#define SMALL_RANGE 16
+
+/* Orderings. LESS(x, y) is true if x comes before y. */
+#define PTR_LESS(x, y) (cmp((x), (y), extra_data) < 0)
+#define NUM_LESS(x, y) ((x) < (y))
+/* NaNs come after all other numbers. */
+#define F64_LESS(x, y) ((x) < (y) || ((y) != (y) && (x) == (x)))
+
+#define SWAP(T, x, y) do { T tmp_ = (x); (x) = (y); (y) = tmp_; } while (0)
+
+/*
+ * Define the heap and selection algorithms for arrays of T, ordered by LESS.
+ * The functions all take cmp and extra_data, which only PTR_LESS uses.
+ *
+ * The heaps are min-heaps: the root is the smallest item.
+ */
+#define DEFINE_ALGORITHMS(S, T, LESS) \
+    static void sift_down_##S(T *heap, size_t n, size_t i, citer_cmp_fn_t cmp, void *extra_data) { \
+        T item = heap[i]; \
+        for (;;) { \
+            size_t child = 2 * i + 1; \
+            if (child >= n) \
+                break; \
+            if (child + 1 < n && LESS(heap[child + 1], heap[child])) \
+                child++; \
+            if (!LESS(heap[child], item)) \
+                break; \
+            heap[i] = heap[child]; \
+            i = child; \
+        } \
+        heap[i] = item; \
+    } \
+    \
+    static void sift_up_##S(T *heap, size_t i, citer_cmp_fn_t cmp, void *extra_data) { \
+        T item = heap[i]; \
+        while (i > 0 && LESS(item, heap[(i - 1) / 2])) { \
+            heap[i] = heap[(i - 1) / 2]; \
+            i = (i - 1) / 2; \
+        } \
+        heap[i] = item; \
+    } \
+    \
+    /* Add an item to a top-K heap of N items, and return the new N. */ \
+    static inline size_t top_k_add_##S(T *heap, size_t n, size_t k, T item, citer_cmp_fn_t cmp, void *extra_data) { \
+        if (n < k) { \
+            heap[n] = item; \
+            sift_up_##S(heap, n, cmp, extra_data); \
+            return n + 1; \
+        } \
+        if (LESS(heap[0], item)) { \
+            heap[0] = item; \
+            sift_down_##S(heap, n, 0, cmp, extra_data); \
+        } \
+        return n; \
+    } \
+    \
+    /* Sort a heap in descending order, by moving the root to the end. */ \
+    static void heap_sort_desc_##S(T *heap, size_t n, citer_cmp_fn_t cmp, void *extra_data) { \
+        for (; n > 1; n--) { \
+            SWAP(T, heap[0], heap[n - 1]); \
+            sift_down_##S(heap, n - 1, 0, cmp, extra_data); \
+        } \
+    } \
+    \
+    /* Sort an array in ascending order, in O(n log n) time at worst. */ \
+    static void heap_sort_##S(T *a, size_t n, citer_cmp_fn_t cmp, void *extra_data) { \
+        for (size_t i = n / 2; i-- > 0;) \
+            sift_down_##S(a, n, i, cmp, extra_data); \
+        heap_sort_desc_##S(a, n, cmp, extra_data); \
+        for (size_t i = 0; i < n / 2; i++) \
+            SWAP(T, a[i], a[n - 1 - i]); \
+    } \
+    \
+    static void insertion_sort_##S(T *a, size_t n, citer_cmp_fn_t cmp, void *extra_data) { \
+        for (size_t i = 1; i < n; i++) { \
+            T item = a[i]; \
+            size_t j = i; \
+            for (; j > 0 && LESS(item, a[j - 1]); j--) \
+                a[j] = a[j - 1]; \
+            a[j] = item; \
+        } \
+    } \
+    \
+    /* \
+     * Move the Nth smallest item of an array to index N (introselect). Each \
+     * partition keeps the side containing N. After 2 log2(len) partitions, \
+     * the rest is heap sorted instead. \
+     */ \
+    static void select_##S(T *a, size_t len, size_t nth, citer_cmp_fn_t cmp, void *extra_data) { \
+        size_t lo = 0; \
+        size_t hi = len; \
+        size_t depth = 0; \
+        for (size_t m = len; m > 1; m /= 2) \
+            depth += 2; \
+        while (hi - lo > SMALL_RANGE) { \
+            if (depth-- == 0) { \
+                heap_sort_##S(a + lo, hi - lo, cmp, extra_data); \
+                return; \
+            } \
+            /* Order the first, middle and last items. They then bound the \
+             * scans of the partition. */ \
+            size_t mid = lo + (hi - lo) / 2; \
+            if (LESS(a[mid], a[lo])) \
+                SWAP(T, a[mid], a[lo]); \
+            if (LESS(a[hi - 1], a[mid])) { \
+                SWAP(T, a[hi - 1], a[mid]); \
+                if (LESS(a[mid], a[lo])) \
+                    SWAP(T, a[mid], a[lo]); \
+            } \
+            T pivot = a[mid]; \
+            /* Hoare partition: afterwards, items in [lo, j] are at most the \
+             * pivot, and items in (j, hi) are at least the pivot. */ \
+            size_t i = lo; \
+            size_t j = hi - 1; \
+            for (;;) { \
+                do \
+                    i++; \
+                while (LESS(a[i], pivot)); \
+                do \
+                    j--; \
+                while (LESS(pivot, a[j])); \
+                if (i >= j) \
+                    break; \
+                SWAP(T, a[i], a[j]); \
+            } \
+            if (nth <= j) \
+                hi = j + 1; \
+            else \
+                lo = j + 1; \
+        } \
+        insertion_sort_##S(a + lo, hi - lo, cmp, extra_data); \
+    }
+
+DEFINE_ALGORITHMS(ptr, void *, PTR_LESS)
+DEFINE_ALGORITHMS(i64, int64_t, NUM_LESS)
+DEFINE_ALGORITHMS(u64, uint64_t, NUM_LESS)
+DEFINE_ALGORITHMS(f64, double, F64_LESS)
+
+void **citer_top_k(iterator_t *it, size_t k, citer_cmp_fn_t cmp, void *extra_data, size_t *len_out) {
+    if (citer_is_infinite(it))
+        return NULL;
+
+    void **heap = malloc((k ? k : 1) * sizeof(*heap));
+    size_t n = 0;
+    if (k > 0) {
+        void *item;
+        while ((item = citer_next(it)))
+            n = top_k_add_ptr(heap, n, k, item, cmp, extra_data);
+    }
+    heap_sort_desc_ptr(heap, n, cmp, extra_data);
+    *len_out = n;
+    return heap;
+}
+
+void *citer_select_nth(iterator_t *it, size_t n, citer_cmp_fn_t cmp, void *extra_data) {
+    size_t len;
+    void **items = citer_collect_into_array(it, &len);
+    if (!items)
+        return NULL;
+    void *item = NULL;
+    if (n < len) {
+        select_ptr(items, len, n, cmp, extra_data);
+        item = items[n];
+    }
+    free(items);
+    return item;
+}
+
+/*
+ * Call BODY with each number of an iterator in x. Strided iterators are read
+ * directly from their array. Other iterators are read one item at a time,
+ * since they may reuse their items.
+ */
+#define FOR_EACH_NUMBER(it, T, BODY) do { \
+        void *array_; \
+        size_t stride_, len_; \
+        if (citer_as_strided(it, &array_, &stride_, &len_)) { \
+            const char *p_ = (const char *) array_; \
+            for (size_t i_ = 0; i_ < len_; i_++) { \
+                T x; \
+                memcpy(&x, p_ + i_ * stride_, sizeof(T)); \
+                BODY; \
+            } \
+            citer_array_advance(it, len_); \
+        } else { \
+            void *item_; \
+            while ((item_ = citer_next(it))) { \
+                T x = *(T *) item_; \
+                BODY; \
+            } \
+        } \
+    } while (0)
+
+#define DEFINE_TYPED(S, T) \
+    size_t citer_top_k_##S(iterator_t *it, size_t k, T *out) { \
+        if (citer_is_infinite(it) || k == 0) \
+            return 0; \
+        size_t n = 0; \
+        FOR_EACH_NUMBER(it, T, n = top_k_add_##S(out, n, k, x, NULL, NULL)); \
+        heap_sort_desc_##S(out, n, NULL, NULL); \
+        return n; \
+    } \
+    \
+    bool citer_select_nth_##S(iterator_t *it, size_t n, T *out) { \
+        if (citer_is_infinite(it)) \
+            return false; \
+        size_t capacity = 64; \
+        if (!it->size_bound.upper_infinite && it->size_bound.upper > capacity) \
+            capacity = it->size_bound.upper; \
+        T *values = malloc(capacity * sizeof(*values)); \
+        size_t len = 0; \
+        FOR_EACH_NUMBER(it, T, { \
+            if (len == capacity) { \
+                capacity *= 2; \
+                values = realloc(values, capacity * sizeof(*values)); \
+            } \
+            values[len++] = x; \
+        }); \
+        bool found = n < len; \
+        if (found) { \
+            select_##S(values, len, n, NULL, NULL); \
+            *out = values[n]; \
+        } \
+        free(values); \
+        return found; \
+    }
+
+DEFINE_TYPED(i64, int64_t)
+DEFINE_TYPED(u64, uint64_t)
+DEFINE_TYPED(f64, double)
@@ -0,0 +1,103 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_SELECTION_H_
+#define _CITER_SELECTION_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "filters.h"
+#include "iterator.h"
+
+/*
+ * Get the K largest items of an iterator.
+ *
+ * Parameters:
+ *   it - The iterator.
+ *   k - Number of items to keep.
+ *   cmp - Comparison function for the items.
+ *   extra_data - Extra data to pass to cmp.
+ *   len_out - Set to the length of the returned array, which is K, or fewer if
+ *             the iterator has fewer items.
+ *
+ * The largest items seen so far are kept in a binary min-heap of K items, so
+ * each item takes one comparison with the smallest of them, plus O(log K)
+ * comparisons if it replaces it. Only O(K) extra memory is used, however long
+ * the iterator is. To get the K smallest items, reverse the comparison.
+ *
+ * The returned array holds the items in descending order, from the largest.
+ * Which of several equal items are kept is unspecified. Since the array holds
+ * pointers to the items, they must stay valid after the iterator returns them,
+ * as for citer_collect_into_array().
+ *
+ * The returned array is dynamically allocated and must be freed after use, even
+ * if it is empty. Returns NULL for iterators which are guaranteed to be
+ * infinite. For other infinite iterators, this function loops forever.
+ *
+ * This function exhausts the iterator, but does not free it.
+ */
+void **citer_top_k(iterator_t *it, size_t k, citer_cmp_fn_t cmp, void *extra_data, size_t *len_out);
+
+/*
+ * Get the Nth smallest item (counting from 0) of an iterator, i.e. the item at
+ * index N if the items were sorted.
+ *
+ * The items are collected into an array (see citer_collect_into_array()), in
+ * which the Nth item is found by introselect: quickselect with median-of-three
+ * pivots, which switches to heapsort if partitioning makes too little
+ * progress, so it takes O(n) time on average and O(n log n) at worst.
+ *
+ * Returns the item, or NULL if the iterator has N items or fewer, or is
+ * guaranteed to be infinite. Items must stay valid after the iterator returns
+ * them.
+ *
+ * This function exhausts the iterator, but does not free it.
+ */
+void *citer_select_nth(iterator_t *it, size_t n, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Typed top-K and selection.
+ *
+ * Same as citer_top_k() and citer_select_nth(), for iterators whose items are
+ * pointers to numbers of the given type (see citer_sum_i64()). The numbers are
+ * compared and moved directly, without calling a comparison function, and
+ * copied out, so items do not need to stay valid. Strided iterators (see
+ * citer_as_strided()) are read directly from their array.
+ *
+ * The citer_top_k_* functions write the K largest numbers to out, which must
+ * have room for K numbers, in descending order, and return how many were
+ * written. They use out as their heap, and allocate no memory.
+ *
+ * The citer_select_nth_* functions store the Nth smallest number in *out and
+ * return true, or return false if the iterator has N items or fewer.
+ *
+ * For doubles, NaNs are ordered after all other numbers.
+ *
+ * These functions exhaust the iterator, but do not free it. They return 0 (or
+ * false) for iterators which are guaranteed to be infinite.
+ */
+size_t citer_top_k_i64(iterator_t *it, size_t k, int64_t *out);
+size_t citer_top_k_u64(iterator_t *it, size_t k, uint64_t *out);
+size_t citer_top_k_f64(iterator_t *it, size_t k, double *out);
+bool citer_select_nth_i64(iterator_t *it, size_t n, int64_t *out);
+bool citer_select_nth_u64(iterator_t *it, size_t n, uint64_t *out);
+bool citer_select_nth_f64(iterator_t *it, size_t n, double *out);
+
+#endif /* _CITER_SELECTION_H_ */
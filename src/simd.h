@@ -0,0 +1,147 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_SIMD_H_
+#define _CITER_SIMD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Internal helpers for writing vectorised kernels.
+ *
+ * This header is not part of citer.h. It is only included by the modules which
+ * contain SIMD kernels.
+ *
+ * Kernels are written as plain C loops over CITER_LANES independent lanes,
+ * which the compiler vectorises. On x86 with GCC or Clang, each kernel is
+ * compiled twice: once for the baseline ISA and once for AVX2. The AVX2
+ * version is selected at runtime when the CPU supports it.
+ */
+
+/* Number of independent accumulator lanes used by the kernels. */
+#define CITER_LANES 8
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CITER_HAVE_AVX2_DISPATCH 1
+#define CITER_TARGET_AVX2 __attribute__((target("avx2")))
+#define citer_cpu_has_avx2() (__builtin_cpu_supports("avx2"))
+#else
+#define CITER_HAVE_AVX2_DISPATCH 0
+#endif
+
+/*
+ * Define a kernel with runtime ISA dispatch.
+ *
+ * Defines a static function NAME with the given parameter list (in
+ * parentheses) and body. ARGS is the parenthesised argument list used to
+ * forward the parameters to the ISA-specific versions.
+ */
+#if CITER_HAVE_AVX2_DISPATCH
+#define CITER_DISPATCH_KERNEL(ret, name, params, args, body) \
+    static ret name##_generic params body \
+    CITER_TARGET_AVX2 static ret name##_avx2 params body \
+    static ret name params { \
+        if (citer_cpu_has_avx2()) \
+            return name##_avx2 args; \
+        return name##_generic args; \
+    }
+#else
+#define CITER_DISPATCH_KERNEL(ret, name, params, args, body) \
+    static ret name params body
+#endif
+
+/*
+ * Bit manipulation helpers for walking bitmaps.
+ *
+ * citer_ctz64() and citer_clz64() must not be called with 0.
+ */
+#if defined(__GNUC__)
+#define citer_ctz64(x) ((unsigned) __builtin_ctzll(x))
+#define citer_clz64(x) ((unsigned) __builtin_clzll(x))
+#define citer_popcount64(x) ((unsigned) __builtin_popcountll(x))
+#else
+static inline unsigned citer_ctz64(uint64_t x) {
+    unsigned n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+}
+
+static inline unsigned citer_clz64(uint64_t x) {
+    unsigned n = 0;
+    while (!(x & (UINT64_C(1) << 63))) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+}
+
+static inline unsigned citer_popcount64(uint64_t x) {
+    unsigned n = 0;
+    for (; x; x &= x - 1)
+        n++;
+    return n;
+}
+#endif
+
+/*
+ * Find all occurrences of a byte in a block of up to 64 bytes.
+ *
+ * Returns a bitmap with bit J set if and only if p[J] == c, for J < N. Full
+ * blocks are compared 16 bytes at a time using SSE2 where available.
+ */
+static inline uint64_t citer_byte_mask64(const char *p, size_t n, char c) {
+    uint64_t mask = 0;
+#if defined(__SSE2__)
+    if (n == 64) {
+        __m128i needle = _mm_set1_epi8(c);
+        for (size_t k = 0; k < 4; k++) {
+            __m128i v = _mm_loadu_si128((const __m128i *) (p + 16 * k));
+            uint16_t m = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+            mask |= ((uint64_t) m) << (16 * k);
+        }
+        return mask;
+    }
+#endif
+    for (size_t j = 0; j < n; j++)
+        mask |= ((uint64_t) (p[j] == c)) << j;
+    return mask;
+}
+
+/*
+ * Prefix XOR of a 64-bit mask: bit i of the result is the XOR of bits 0 to i.
+ * Applied to a bitmap of quotes, it gives the bytes inside quotes.
+ */
+static inline uint64_t citer_prefix_xor64(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+#endif /* _CITER_SIMD_H_ */
@@ -0,0 +1,561 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Needed for sysconf() when compiling with -std=c99. */
+#define _DEFAULT_SOURCE
+
+#include "sort.h"
+#include "collect.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Length of the runs which are insertion sorted before merging. */
+#define INSERTION_RUN 32
+
+/* Fewest items worth giving a thread of its own. */
+#define MIN_ITEMS_PER_THREAD (1 << 15)
+
+/* Fewest items for which to use 11- and 16-bit radix sort digits, rather than
+ * 8-bit ones. */
+#define RADIX_11_MIN_ITEMS (1 << 16)
+#define RADIX_16_MIN_ITEMS (1 << 22)
+
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+
+/*
+ * A sorted array of items, shared between an iterator and the iterators split
+ * off from it. It is freed, along with the source iterator, when the last
+ * reference is released, which may happen on any thread.
+ */
+typedef struct citer_sorted_array {
+    void **items;
+    iterator_t *source;
+    size_t refs;
+    pthread_mutex_t lock;
+} citer_sorted_array_t;
+
+/* Iterates over items [front, back) of the array. */
+typedef struct citer_sorted_data {
+    citer_sorted_array_t *array;
+    size_t front;
+    size_t back;
+} citer_sorted_data_t;
+
+static citer_sorted_array_t *sorted_array_new(void **items, iterator_t *source) {
+    citer_sorted_array_t *array = malloc(sizeof(*array));
+    *array = (citer_sorted_array_t) {
+        .items = items,
+        .source = source,
+        .refs = 1,
+    };
+    pthread_mutex_init(&array->lock, NULL);
+    return array;
+}
+
+static void sorted_array_retain(citer_sorted_array_t *array) {
+    pthread_mutex_lock(&array->lock);
+    array->refs++;
+    pthread_mutex_unlock(&array->lock);
+}
+
+static void sorted_array_release(citer_sorted_array_t *array) {
+    pthread_mutex_lock(&array->lock);
+    size_t refs = --array->refs;
+    pthread_mutex_unlock(&array->lock);
+    if (refs > 0)
+        return;
+
+    free(array->items);
+    citer_free(array->source);
+    pthread_mutex_destroy(&array->lock);
+    free(array);
+}
+
+/*
+ * Sorting.
+ */
+
+static void insertion_sort(void **a, size_t n, citer_cmp_fn_t cmp, void *extra_data) {
+    for (size_t i = 1; i < n; i++) {
+        void *item = a[i];
+        size_t j = i;
+        for (; j > 0 && cmp(item, a[j - 1], extra_data) < 0; j--)
+            a[j] = a[j - 1];
+        a[j] = item;
+    }
+}
+
+/*
+ * Merge two sorted runs into out. On ties, items of the left run go first, so
+ * the merge is stable.
+ */
+static void merge(void **left, size_t n_left, void **right, size_t n_right, void **out, citer_cmp_fn_t cmp, void *extra_data) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < n_left && j < n_right) {
+        if (cmp(right[j], left[i], extra_data) < 0)
+            *out++ = right[j++];
+        else
+            *out++ = left[i++];
+    }
+    memcpy(out, left + i, (n_left - i) * sizeof(*out));
+    memcpy(out + (n_left - i), right + j, (n_right - j) * sizeof(*out));
+}
+
+/*
+ * Sort N items with a bottom-up merge sort, using tmp (of N items) as scratch
+ * space. Returns whichever of a and tmp holds the sorted items.
+ */
+static void **merge_sort(void **a, void **tmp, size_t n, citer_cmp_fn_t cmp, void *extra_data) {
+    for (size_t i = 0; i < n; i += INSERTION_RUN)
+        insertion_sort(a + i, MIN(INSERTION_RUN, n - i), cmp, extra_data);
+    void **src = a;
+    void **dst = tmp;
+    for (size_t width = INSERTION_RUN; width < n; width *= 2) {
+        for (size_t i = 0; i < n; i += 2 * width) {
+            size_t n_left = MIN(width, n - i);
+            size_t n_right = MIN(width, n - i - n_left);
+            merge(src + i, n_left, src + i + n_left, n_right, dst + i, cmp, extra_data);
+        }
+        void **swap = src;
+        src = dst;
+        dst = swap;
+    }
+    return src;
+}
+
+/*
+ * Find how many of the first K items of the stable merge of two runs come from
+ * the left run.
+ */
+static size_t merge_split(size_t k, void **left, size_t n_left, void **right, size_t n_right, citer_cmp_fn_t cmp, void *extra_data) {
+    size_t lo = (k > n_right) ? k - n_right : 0;
+    size_t hi = MIN(k, n_left);
+    /* Find the fewest left items such that the last right item taken comes
+     * before the next left item. */
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        size_t j = k - i;
+        if (j == 0 || cmp(right[j - 1], left[i], extra_data) < 0)
+            hi = i;
+        else
+            lo = i + 1;
+    }
+    return lo;
+}
+
+/*
+ * State of a parallel sort. The array is divided into sorted runs, which
+ * start at bounds[0], ..., bounds[n_runs - 1] and end at bounds[n_runs] (= n).
+ * Each round merges pairs of runs from src into dst.
+ */
+typedef struct par_sort {
+    void **src;
+    void **dst;
+    size_t *bounds;
+    size_t n_runs;
+    citer_cmp_fn_t cmp;
+    void *extra_data;
+} par_sort_t;
+
+typedef struct par_worker {
+    par_sort_t *sort;
+    /* The slice of the output this worker writes, in each phase. */
+    size_t start;
+    size_t end;
+} par_worker_t;
+
+/* Sort the worker's slice, leaving the result in src. */
+static void *par_sort_slice(void *arg) {
+    par_worker_t *worker = (par_worker_t *) arg;
+    par_sort_t *sort = worker->sort;
+    size_t n = worker->end - worker->start;
+    void **a = sort->src + worker->start;
+    void **tmp = sort->dst + worker->start;
+    if (merge_sort(a, tmp, n, sort->cmp, sort->extra_data) == tmp)
+        memcpy(a, tmp, n * sizeof(*a));
+    return NULL;
+}
+
+/*
+ * Write the worker's slice of the output of a round. For each pair of runs
+ * overlapping the slice, binary searches find where the slice's part of the
+ * merge starts and ends in each run.
+ */
+static void *par_merge_round(void *arg) {
+    par_worker_t *worker = (par_worker_t *) arg;
+    par_sort_t *sort = worker->sort;
+    for (size_t r = 0; r < sort->n_runs; r += 2) {
+        size_t start = sort->bounds[r];
+        size_t mid = sort->bounds[r + 1];
+        size_t end = sort->bounds[MIN(r + 2, sort->n_runs)];
+        if (end <= worker->start || start >= worker->end)
+            continue;
+        void **left = sort->src + start;
+        void **right = sort->src + mid;
+        size_t n_left = mid - start;
+        size_t n_right = end - mid;
+        size_t k0 = MAX(start, worker->start) - start;
+        size_t k1 = MIN(end, worker->end) - start;
+        size_t i0 = merge_split(k0, left, n_left, right, n_right, sort->cmp, sort->extra_data);
+        size_t i1 = merge_split(k1, left, n_left, right, n_right, sort->cmp, sort->extra_data);
+        merge(left + i0, i1 - i0, right + (k0 - i0), (k1 - i1) - (k0 - i0), sort->dst + start + k0, sort->cmp, sort->extra_data);
+    }
+    return NULL;
+}
+
+/*
+ * Run a function on each of N_WORKERS workers of SIZE bytes each, the first
+ * one on this thread. Workers which can't be started on their own thread run on
+ * this thread too.
+ */
+static void run_workers(void *(*fn)(void *), void *workers, size_t size, size_t n_workers) {
+    char *worker = (char *) workers;
+    pthread_t *threads = malloc(n_workers * sizeof(*threads));
+    bool *started = calloc(n_workers, sizeof(*started));
+    for (size_t w = 1; w < n_workers; w++)
+        started[w] = (pthread_create(&threads[w], NULL, fn, worker + w * size) == 0);
+    for (size_t w = 0; w < n_workers; w++) {
+        if (!started[w])
+            fn(worker + w * size);
+    }
+    for (size_t w = 1; w < n_workers; w++) {
+        if (started[w])
+            pthread_join(threads[w], NULL);
+    }
+    free(threads);
+    free(started);
+}
+
+/* Find the start and end of worker W's equal slice of N items. */
+static void divide(size_t w, size_t n_workers, size_t n, size_t *start, size_t *end) {
+    *start = n / n_workers * w + MIN(w, n % n_workers);
+    *end = *start + n / n_workers + (w < n % n_workers);
+}
+
+/* Get the number of threads to use, given the number requested (0 for one per
+ * CPU), so that each has enough items to be worth starting. */
+static size_t thread_count(size_t n_threads, size_t n) {
+    if (n_threads == 0) {
+        long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = (n_cpus > 0) ? (size_t) n_cpus : 1;
+    }
+    return MIN(n_threads, n / MIN_ITEMS_PER_THREAD + 1);
+}
+
+/*
+ * Sort N items on N_THREADS threads, using tmp as scratch space. Returns
+ * whichever of a and tmp holds the sorted items.
+ */
+static void **par_merge_sort(void **a, void **tmp, size_t n, citer_cmp_fn_t cmp, void *extra_data, size_t n_threads) {
+    par_sort_t sort = {
+        .src = a,
+        .dst = tmp,
+        .bounds = malloc((n_threads + 1) * sizeof(size_t)),
+        .n_runs = n_threads,
+        .cmp = cmp,
+        .extra_data = extra_data,
+    };
+    par_worker_t *workers = malloc(n_threads * sizeof(*workers));
+    for (size_t w = 0; w < n_threads; w++)
+        workers[w].sort = &sort;
+
+    for (size_t w = 0; w < n_threads; w++) {
+        divide(w, n_threads, n, &workers[w].start, &workers[w].end);
+        sort.bounds[w] = workers[w].start;
+    }
+    sort.bounds[n_threads] = n;
+    run_workers(par_sort_slice, workers, sizeof(*workers), n_threads);
+
+    while (sort.n_runs > 1) {
+        run_workers(par_merge_round, workers, sizeof(*workers), n_threads);
+        /* Every other bound is gone. */
+        size_t n_runs = (sort.n_runs + 1) / 2;
+        for (size_t r = 0; r < n_runs; r++)
+            sort.bounds[r] = sort.bounds[2 * r];
+        sort.bounds[n_runs] = n;
+        sort.n_runs = n_runs;
+        void **swap = sort.src;
+        sort.src = sort.dst;
+        sort.dst = swap;
+    }
+
+    free(sort.bounds);
+    free(workers);
+    return sort.src;
+}
+
+/*
+ * Iteration over the sorted array.
+ */
+
+static void *citer_sorted_next(iterator_t *self) {
+    citer_sorted_data_t *data = (citer_sorted_data_t *) self->data;
+    if (data->front == data->back)
+        return NULL;
+    self->size_bound.lower--;
+    self->size_bound.upper--;
+    return data->array->items[data->front++];
+}
+
+static void *citer_sorted_next_back(iterator_t *self) {
+    citer_sorted_data_t *data = (citer_sorted_data_t *) self->data;
+    if (data->front == data->back)
+        return NULL;
+    self->size_bound.lower--;
+    self->size_bound.upper--;
+    return data->array->items[--data->back];
+}
+
+static size_t citer_sorted_advance(iterator_t *self, size_t n) {
+    citer_sorted_data_t *data = (citer_sorted_data_t *) self->data;
+    n = MIN(n, data->back - data->front);
+    data->front += n;
+    self->size_bound.lower -= n;
+    self->size_bound.upper -= n;
+    return n;
+}
+
+static size_t citer_sorted_advance_back(iterator_t *self, size_t n) {
+    citer_sorted_data_t *data = (citer_sorted_data_t *) self->data;
+    n = MIN(n, data->back - data->front);
+    data->back -= n;
+    self->size_bound.lower -= n;
+    self->size_bound.upper -= n;
+    return n;
+}
+
+static void citer_sorted_free_data(void *_data) {
+    citer_sorted_data_t *data = (citer_sorted_data_t *) _data;
+    sorted_array_release(data->array);
+    free(data);
+}
+
+static iterator_t *sorted_iter_new(citer_sorted_array_t *array, size_t front, size_t back);
+
+static iterator_t *citer_sorted_split(iterator_t *self, size_t n) {
+    citer_sorted_data_t *data = (citer_sorted_data_t *) self->data;
+    n = MIN(n, data->back - data->front);
+    size_t split = data->front + n;
+    sorted_array_retain(data->array);
+    iterator_t *rest = sorted_iter_new(data->array, split, data->back);
+    data->back = split;
+    self->size_bound.lower = n;
+    self->size_bound.upper = n;
+    return rest;
+}
+
+static iterator_t *sorted_iter_new(citer_sorted_array_t *array, size_t front, size_t back) {
+    citer_sorted_data_t *data = malloc(sizeof(*data));
+    *data = (citer_sorted_data_t) {
+        .array = array,
+        .front = front,
+        .back = back,
+    };
+    iterator_t *it = citer_new(
+        data,
+        citer_sorted_next,
+        citer_sorted_next_back,
+        citer_sorted_free_data,
+        (citer_size_bound_t) { .lower = back - front, .upper = back - front }
+    );
+    it->advance = citer_sorted_advance;
+    it->advance_back = citer_sorted_advance_back;
+    it->split = citer_sorted_split;
+    return it;
+}
+
+iterator_t *citer_par_sorted(iterator_t *it, citer_cmp_fn_t cmp, void *extra_data, size_t n_threads) {
+    size_t n;
+    void **items = citer_collect_into_array(it, &n);
+    if (!items)
+        return NULL;
+
+    n_threads = thread_count(n_threads, n);
+    void **tmp = malloc((n ? n : 1) * sizeof(*tmp));
+    void **sorted = (n_threads < 2)
+        ? merge_sort(items, tmp, n, cmp, extra_data)
+        : par_merge_sort(items, tmp, n, cmp, extra_data, n_threads);
+    free((sorted == items) ? tmp : items);
+
+    return sorted_iter_new(sorted_array_new(sorted, it), 0, n);
+}
+
+iterator_t *citer_sorted(iterator_t *it, citer_cmp_fn_t cmp, void *extra_data) {
+    return citer_par_sorted(it, cmp, extra_data, 1);
+}
+
+/*
+ * Radix sort.
+ */
+
+#define SIGN_BIT ((uint64_t) 1 << 63)
+
+typedef struct radix_pair {
+    uint64_t key;
+    void *item;
+} radix_pair_t;
+
+typedef enum radix_key_type {
+    KEY_U64,
+    KEY_I64,
+    KEY_F64,
+} radix_key_type_t;
+
+/* State of a radix sort of items, by keys of the given type. */
+typedef struct radix_sort {
+    void **items;
+    radix_pair_t *pairs;
+    radix_key_type_t type;
+    union {
+        citer_key_u64_fn_t u64;
+        citer_key_i64_fn_t i64;
+        citer_key_f64_fn_t f64;
+    } key;
+    void *fn_data;
+    unsigned bits;
+    unsigned n_digits;
+} radix_sort_t;
+
+typedef struct radix_worker {
+    radix_sort_t *sort;
+    size_t start;
+    size_t end;
+    /* The number of keys with each value of each digit, one row per digit. */
+    size_t *counts;
+} radix_worker_t;
+
+/* Get an item's key, mapped to an unsigned integer which orders the same. */
+static uint64_t radix_key(const radix_sort_t *sort, void *item) {
+    switch (sort->type) {
+    case KEY_I64:
+        return (uint64_t) sort->key.i64(item, sort->fn_data) ^ SIGN_BIT;
+    case KEY_F64: {
+        double x = sort->key.f64(item, sort->fn_data);
+        if (x != x)
+            return UINT64_MAX;
+        if (x == 0)
+            x = 0; /* Not -0. */
+        uint64_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        /* Negative numbers order backwards, and before positive ones. */
+        return (bits & SIGN_BIT) ? ~bits : bits | SIGN_BIT;
+    }
+    default:
+        return sort->key.u64(item, sort->fn_data);
+    }
+}
+
+/* Make the pairs in the worker's slice, and count the values of their digits. */
+static void *radix_count(void *arg) {
+    radix_worker_t *worker = (radix_worker_t *) arg;
+    radix_sort_t *sort = worker->sort;
+    unsigned bits = sort->bits;
+    uint64_t mask = ((uint64_t) 1 << bits) - 1;
+    for (size_t i = worker->start; i < worker->end; i++) {
+        void *item = sort->items[i];
+        uint64_t key = radix_key(sort, item);
+        sort->pairs[i] = (radix_pair_t) { key, item };
+        size_t *counts = worker->counts;
+        for (unsigned d = 0; d < sort->n_digits; d++, counts += mask + 1)
+            counts[(key >> (d * bits)) & mask]++;
+    }
+    return NULL;
+}
+
+static iterator_t *radix_sorted(iterator_t *it, radix_sort_t *sort) {
+    size_t n;
+    void **items = citer_collect_into_array(it, &n);
+    if (!items)
+        return NULL;
+
+    sort->items = items;
+    sort->bits = (n < RADIX_11_MIN_ITEMS) ? 8 : (n < RADIX_16_MIN_ITEMS) ? 11 : 16;
+    sort->n_digits = (64 + sort->bits - 1) / sort->bits;
+    size_t n_buckets = (size_t) 1 << sort->bits;
+    size_t n_counts = sort->n_digits * n_buckets;
+    radix_pair_t *src = malloc((n ? n : 1) * sizeof(*src));
+    radix_pair_t *dst = malloc((n ? n : 1) * sizeof(*dst));
+    sort->pairs = src;
+
+    /* Count every digit in one pass, on several threads for large arrays. */
+    size_t n_threads = thread_count(0, n);
+    radix_worker_t *workers = malloc(n_threads * sizeof(*workers));
+    for (size_t w = 0; w < n_threads; w++) {
+        workers[w].sort = sort;
+        workers[w].counts = calloc(n_counts, sizeof(size_t));
+        divide(w, n_threads, n, &workers[w].start, &workers[w].end);
+    }
+    run_workers(radix_count, workers, sizeof(*workers), n_threads);
+    size_t *counts = workers[0].counts;
+    for (size_t w = 1; w < n_threads; w++) {
+        for (size_t c = 0; c < n_counts; c++)
+            counts[c] += workers[w].counts[c];
+        free(workers[w].counts);
+    }
+    free(workers);
+
+    uint64_t mask = n_buckets - 1;
+    for (unsigned d = 0; d < sort->n_digits && n > 0; d++) {
+        unsigned shift = d * sort->bits;
+        size_t *offsets = counts + d * n_buckets;
+        /* Skip digits which are the same in every key. */
+        if (offsets[(src[0].key >> shift) & mask] == n)
+            continue;
+
+        size_t total = 0;
+        for (size_t b = 0; b < n_buckets; b++) {
+            size_t count = offsets[b];
+            offsets[b] = total;
+            total += count;
+        }
+        for (size_t i = 0; i < n; i++)
+            dst[offsets[(src[i].key >> shift) & mask]++] = src[i];
+        radix_pair_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        items[i] = src[i].item;
+    free(counts);
+    free(src);
+    free(dst);
+    return sorted_iter_new(sorted_array_new(items, it), 0, n);
+}
+
+iterator_t *citer_sorted_by_key_u64(iterator_t *it, citer_key_u64_fn_t key, void *fn_data) {
+    radix_sort_t sort = { .type = KEY_U64, .key.u64 = key, .fn_data = fn_data };
+    return radix_sorted(it, &sort);
+}
+
+iterator_t *citer_sorted_by_key_i64(iterator_t *it, citer_key_i64_fn_t key, void *fn_data) {
+    radix_sort_t sort = { .type = KEY_I64, .key.i64 = key, .fn_data = fn_data };
+    return radix_sorted(it, &sort);
+}
+
+iterator_t *citer_sorted_by_key_f64(iterator_t *it, citer_key_f64_fn_t key, void *fn_data) {
+    radix_sort_t sort = { .type = KEY_F64, .key.f64 = key, .fn_data = fn_data };
+    return radix_sorted(it, &sort);
+}
@@ -0,0 +1,114 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_SORT_H_
+#define _CITER_SORT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "filters.h"
+#include "iterator.h"
+
+/*
+ * Key functions for citer_sorted_by_key_*(). They return the sort key of an
+ * item.
+ */
+typedef uint64_t (*citer_key_u64_fn_t)(void *item, void *fn_data);
+typedef int64_t (*citer_key_i64_fn_t)(void *item, void *fn_data);
+typedef double (*citer_key_f64_fn_t)(void *item, void *fn_data);
+
+/*
+ * Iterate over the items of an iterator in sorted order.
+ *
+ * Parameters:
+ *   it - The iterator to sort. It must be finite.
+ *   cmp - Comparison function for the items.
+ *   extra_data - Extra data to pass to cmp.
+ *
+ * The items are collected into an array (pre-sized from the source's size
+ * bound, see citer_collect_into_array()) before citer_sorted() returns, and
+ * sorted with a stable merge sort: runs of a few items are insertion sorted,
+ * then merged in passes. Equal items keep their order. The sort runs on the
+ * calling thread, so cmp needn't be thread-safe; use citer_par_sorted() to
+ * sort on several threads.
+ *
+ * The result has an exact size and is double-ended and splittable (see
+ * citer_split_at()). Skipping items from either end is O(1), so
+ * citer_reverse(), citer_take(), citer_nth() and citer_nth_back() on it take
+ * no extra work.
+ *
+ * Since the array holds pointers to the items, they must stay valid after the
+ * source returns them, as for citer_collect_into_array(). The source is kept
+ * until the result (and every iterator split from it) is freed, in case it owns
+ * its items.
+ *
+ * Returns a new iterator, which must be freed with citer_free(). Freeing it
+ * frees the source iterator too. Returns NULL if the source is guaranteed to be
+ * infinite; it is then left alone.
+ */
+iterator_t *citer_sorted(iterator_t *it, citer_cmp_fn_t cmp, void *extra_data);
+
+/*
+ * Sort the items of an iterator using several threads.
+ *
+ * Parameters:
+ *   it, cmp, extra_data - As for citer_sorted(). cmp must be safe to call from
+ *                         several threads at once.
+ *   n_threads - Number of threads to use, or 0 to use one per CPU.
+ *
+ * The array is cut into one slice per thread, and the slices are sorted in
+ * parallel. Then pairs of sorted runs are merged in rounds until one run is
+ * left. Each round is shared evenly between all the threads: a thread's share
+ * of the output of a merge is found by binary search (a "merge path"), so the
+ * last merge is as parallel as the first. Arrays too small to be worth
+ * dividing are sorted on the calling thread.
+ *
+ * Returns an iterator over the sorted items, as for citer_sorted().
+ */
+iterator_t *citer_par_sorted(iterator_t *it, citer_cmp_fn_t cmp, void *extra_data, size_t n_threads);
+
+/*
+ * Sort the items of an iterator by a numeric key.
+ *
+ * Parameters:
+ *   it - The iterator to sort. It must be finite.
+ *   key - Function returning the key of an item. It is called once per item,
+ *         possibly from several threads at once.
+ *   fn_data - Extra data to pass to key.
+ *
+ * Instead of comparing items, these functions sort (key, item) pairs with a
+ * least-significant-digit radix sort. Keys are mapped to unsigned integers
+ * which order the same way, and sorted one digit at a time: 8-bit digits for
+ * small arrays, 11-bit digits for medium ones and 16-bit digits for large
+ * ones, so there are never more buckets than are worth filling. The counts for
+ * every digit are taken in a single pass over the pairs, shared between one
+ * thread per CPU for large arrays, and digits which are the same in every key
+ * are skipped. Keys which only use their low bits therefore take fewer passes.
+ *
+ * The sort is stable: items with equal keys keep their order. For doubles,
+ * -0.0 equals 0.0, and NaNs are ordered after all other numbers.
+ *
+ * Returns an iterator over the sorted items, as for citer_sorted(), or NULL if
+ * the source is guaranteed to be infinite.
+ */
+iterator_t *citer_sorted_by_key_u64(iterator_t *it, citer_key_u64_fn_t key, void *fn_data);
+iterator_t *citer_sorted_by_key_i64(iterator_t *it, citer_key_i64_fn_t key, void *fn_data);
+iterator_t *citer_sorted_by_key_f64(iterator_t *it, citer_key_f64_fn_t key, void *fn_data);
+
+#endif /* _CITER_SORT_H_ */
@@ -0,0 +1,124 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CITER_TABLE_H_
+#define _CITER_TABLE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash.h"
+
+/*
+ * Internal open-addressing hash table, shared by the hash-based adapters.
+ *
+ * This header is not part of citer.h.
+ *
+ * The table uses linear probing. The hashes of the entries are stored in an
+ * array of their own, so that a probe compares hashes in consecutive memory
+ * and only looks at an entry (and calls the equality function) when the hashes
+ * match. A stored hash of 0 marks an empty slot.
+ *
+ * Each entry is entry_size bytes, stored inline, and starts with its key: a
+ * pointer to the key (void *key) if key_size is 0, or a copy of the key's
+ * key_size bytes otherwise. The rest of the entry is up to the user of the
+ * table, e.g. an accumulator. Entries are aligned to 8 bytes.
+ *
+ * The table grows by doubling when it would be more than 3/4 full. Growing
+ * moves entries using their stored hashes, without hashing keys again.
+ */
+typedef struct citer_table {
+    uint64_t *hashes;
+    char *entries;
+    size_t entry_size;
+    size_t key_size;
+    size_t capacity;
+    size_t count;
+} citer_table_t;
+
+/*
+ * Initialise a table with room for at least EXPECTED entries before it grows.
+ * See above for key_size.
+ */
+void citer_table_init(citer_table_t *t, size_t entry_size, size_t key_size, size_t expected);
+
+void citer_table_free(citer_table_t *t);
+
+/*
+ * Get the hash stored for a hash, which is never 0.
+ */
+static inline uint64_t citer_table_hash(uint64_t hash) {
+    return hash ? hash : 1;
+}
+
+static inline void *citer_table_entry(const citer_table_t *t, size_t slot) {
+    return t->entries + slot * t->entry_size;
+}
+
+/*
+ * Get the key of an entry.
+ */
+static inline void *citer_table_key(const citer_table_t *t, void *entry) {
+    return t->key_size ? entry : *(void **) entry;
+}
+
+/*
+ * Get the offset of the rest of an entry, after its key, for a given key_size.
+ */
+static inline size_t citer_table_value_offset(size_t key_size) {
+    if (!key_size)
+        key_size = sizeof(void *);
+    return (key_size + 7) & ~(size_t) 7;
+}
+
+static inline bool citer_table_occupied(const citer_table_t *t, size_t slot) {
+    return t->hashes[slot] != 0;
+}
+
+/*
+ * Hint that the slot of a hash is about to be probed.
+ */
+static inline void citer_table_prefetch(const citer_table_t *t, uint64_t hash) {
+#if defined(__GNUC__)
+    __builtin_prefetch(&t->hashes[citer_table_hash(hash) & (t->capacity - 1)]);
+#else
+    (void) t;
+    (void) hash;
+#endif
+}
+
+/*
+ * Find the entry of a key.
+ *
+ * Returns the entry, or NULL if the key is not in the table.
+ */
+void *citer_table_find(const citer_table_t *t, uint64_t hash, void *key, citer_eq_fn_t eq, void *fn_data);
+
+/*
+ * Find the entry of a key, or insert one.
+ *
+ * If the key is not in the table, a new entry is added, with its key set to KEY
+ * (or a copy of it) and the rest of it zeroed, and *inserted is set to true.
+ * Otherwise, *inserted is set to false.
+ *
+ * Returns the entry. It stays valid until the next insertion.
+ */
+void *citer_table_insert(citer_table_t *t, uint64_t hash, void *key, citer_eq_fn_t eq, void *fn_data, bool *inserted);
+
+#endif /* _CITER_TABLE_H_ */
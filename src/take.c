@@ -40,10 +40,9 @@ static void *citer_take_next_back(iterator_t *self) {
 	citer_take_data_t *data = (citer_take_data_t *) self->data;
 	/* Double-endedness is only implemented for exact-size sources, so we can
 	 * treat the bounds as the exact number of items. */
-	while (data->original->size_bound.upper > data->count) {
-		/* Skip elements from the back until len == count. */
-		citer_next_back(data->original);
-	}
+	/* Skip elements from the back until len == count. */
+	if (data->original->size_bound.upper > data->count)
+		citer_advance_back(data->original, data->original->size_bound.upper - data->count);
 	data->count--;
 	citer_bound_sub(self->size_bound, 1);
 	return citer_next_back(data->original);
@@ -85,9 +84,9 @@ iterator_t *citer_take(iterator_t *original, size_t count) {
 
 static void *citer_skip_next(iterator_t *self) {
 	citer_take_data_t *data = (citer_take_data_t *) self->data;
-	while (data->count > 0) {
-		data->count--;
-		citer_next(data->original);
+	if (data->count > 0) {
+		citer_advance(data->original, data->count);
+		data->count = 0;
 	}
 	citer_bound_sub(self->size_bound, 1);
 	return citer_next(data->original);
@@ -108,9 +107,9 @@ static void *citer_skip_next_back(iterator_t *self) {
 	}
 
 	/* Skip items from the front, not the back. */
-	while (data->count > 0) {
-		data->count--;
-		citer_next(data->original);
+	if (data->count > 0) {
+		citer_advance(data->original, data->count);
+		data->count = 0;
 	}
 	citer_bound_sub(self->size_bound, 1);
 	/* Return the next item from the back. */
@@ -137,10 +136,8 @@ iterator_t *citer_skip(iterator_t *original, size_t count) {
 }
 
 void *citer_nth(iterator_t *it, size_t n) {
-	while (n) {
-		citer_next(it);
-		n--;
-	}
+	if (citer_advance(it, n) < n)
+		return NULL;
 	return citer_next(it);
 }
 
@@ -149,10 +146,8 @@ void *citer_nth_back(iterator_t *it, size_t n) {
 	if (!citer_is_double_ended(it))
 		return NULL;
 
-	while (n) {
-		citer_next_back(it);
-		n--;
-	}
+	if (citer_advance_back(it, n) < n)
+		return NULL;
 	return citer_next_back(it);
 }
 
@@ -17,9 +17,13 @@
  */
 
 #include "zip.h"
+#include "over_array.h"
 #include "take.h"
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*
  * Note on double-endedness for zip:
@@ -108,6 +112,249 @@ iterator_t *citer_zip(iterator_t *first, iterator_t *second) {
 	);
 }
 
+typedef struct citer_zip_n_data {
+	iterator_t **its;
+	size_t n;
+	citer_tuple_t tuple;
+	/* Only used when zipping arrays. Items in [front, back) of each array
+	 * have not been returned yet. */
+	char **bases;
+	size_t *itemsizes;
+	size_t front;
+	size_t back;
+} citer_zip_n_data_t;
+
+static void *citer_zip_n_next(iterator_t *self) {
+	citer_zip_n_data_t *data = (citer_zip_n_data_t *) self->data;
+
+	citer_bound_sub(self->size_bound, 1);
+
+	for (size_t k = 0; k < data->n; k++) {
+		void *item = citer_next(data->its[k]);
+		if (!item)
+			return NULL;
+		data->tuple.items[k] = item;
+	}
+	return &data->tuple;
+}
+
+/*
+ * If this is called, we know that all sources are exact-sized and
+ * double-ended. See the note on double-endedness at the top of this file.
+ */
+static void *citer_zip_n_next_back(iterator_t *self) {
+	citer_zip_n_data_t *data = (citer_zip_n_data_t *) self->data;
+
+	if (self->size_bound.lower == 0)
+		return NULL;
+
+	for (size_t k = 0; k < data->n; k++) {
+		iterator_t *it = data->its[k];
+		size_t nth = it->size_bound.upper - self->size_bound.upper;
+		data->tuple.items[k] = citer_nth_back(it, nth);
+	}
+	citer_bound_sub(self->size_bound, 1);
+	return &data->tuple;
+}
+
+static void *citer_zip_arrays_next(iterator_t *self) {
+	citer_zip_n_data_t *data = (citer_zip_n_data_t *) self->data;
+	if (data->front == data->back)
+		return NULL;
+
+	size_t i = data->front++;
+	for (size_t k = 0; k < data->n; k++)
+		data->tuple.items[k] = data->bases[k] + (i * data->itemsizes[k]);
+	self->size_bound.lower--;
+	self->size_bound.upper--;
+	return &data->tuple;
+}
+
+static void *citer_zip_arrays_next_back(iterator_t *self) {
+	citer_zip_n_data_t *data = (citer_zip_n_data_t *) self->data;
+	if (data->front == data->back)
+		return NULL;
+
+	size_t i = --data->back;
+	for (size_t k = 0; k < data->n; k++)
+		data->tuple.items[k] = data->bases[k] + (i * data->itemsizes[k]);
+	self->size_bound.lower--;
+	self->size_bound.upper--;
+	return &data->tuple;
+}
+
+static void citer_zip_n_free_data(void *_data) {
+	citer_zip_n_data_t *data = (citer_zip_n_data_t *) _data;
+	if (data->its) {
+		for (size_t k = 0; k < data->n; k++)
+			citer_free(data->its[k]);
+		free(data->its);
+	}
+	free(data->tuple.items);
+	free(data->bases);
+	free(data->itemsizes);
+	free(data);
+}
+
+/*
+ * Allocate the state shared by citer_zip_n() and citer_zip_arrays().
+ */
+static citer_zip_n_data_t *citer_zip_n_data_new(size_t n) {
+	citer_zip_n_data_t *data = malloc(sizeof(*data));
+	*data = (citer_zip_n_data_t) {
+		.n = n,
+		.tuple = {
+			.items = malloc(n * sizeof(void *)),
+			.len = n,
+		},
+	};
+	return data;
+}
+
+static iterator_t *citer_zip_arrays_split(iterator_t *self, size_t n);
+
+/*
+ * Create an iterator over zipped arrays from already-allocated state whose
+ * bases, itemsizes, front and back are set.
+ */
+static iterator_t *citer_zip_arrays_new(citer_zip_n_data_t *data) {
+	size_t len = data->back - data->front;
+	iterator_t *it = citer_new(
+		data,
+		citer_zip_arrays_next,
+		citer_zip_arrays_next_back,
+		citer_zip_n_free_data,
+		(citer_size_bound_t) {
+			.lower = len,
+			.upper = len,
+			.lower_infinite = false,
+			.upper_infinite = false,
+		}
+	);
+	it->split = citer_zip_arrays_split;
+	return it;
+}
+
+static iterator_t *citer_zip_arrays_split(iterator_t *self, size_t n) {
+	citer_zip_n_data_t *data = (citer_zip_n_data_t *) self->data;
+	if (n > data->back - data->front)
+		n = data->back - data->front;
+
+	citer_zip_n_data_t *rest = citer_zip_n_data_new(data->n);
+	rest->bases = malloc(data->n * sizeof(*rest->bases));
+	rest->itemsizes = malloc(data->n * sizeof(*rest->itemsizes));
+	memcpy(rest->bases, data->bases, data->n * sizeof(*rest->bases));
+	memcpy(rest->itemsizes, data->itemsizes, data->n * sizeof(*rest->itemsizes));
+	rest->front = data->front + n;
+	rest->back = data->back;
+
+	data->back = data->front + n;
+	self->size_bound.lower = n;
+	self->size_bound.upper = n;
+	return citer_zip_arrays_new(rest);
+}
+
+iterator_t *citer_zip_arrays(void **bases, size_t *itemsizes, size_t n, size_t len) {
+	if (n == 0)
+		return NULL;
+
+	citer_zip_n_data_t *data = citer_zip_n_data_new(n);
+	data->bases = malloc(n * sizeof(*data->bases));
+	data->itemsizes = malloc(n * sizeof(*data->itemsizes));
+	memcpy(data->bases, bases, n * sizeof(*data->bases));
+	memcpy(data->itemsizes, itemsizes, n * sizeof(*data->itemsizes));
+	data->front = 0;
+	data->back = len;
+	return citer_zip_arrays_new(data);
+}
+
+iterator_t *citer_over_columns(const citer_column_t *columns, size_t n_columns, size_t n_rows, const size_t *projection, size_t n_projected) {
+	size_t n = projection ? n_projected : n_columns;
+	if (n == 0)
+		return NULL;
+	if (projection) {
+		for (size_t k = 0; k < n; k++) {
+			if (projection[k] >= n_columns)
+				return NULL;
+		}
+	}
+
+	citer_zip_n_data_t *data = citer_zip_n_data_new(n);
+	data->bases = malloc(n * sizeof(*data->bases));
+	data->itemsizes = malloc(n * sizeof(*data->itemsizes));
+	for (size_t k = 0; k < n; k++) {
+		const citer_column_t *col = &columns[projection ? projection[k] : k];
+		data->bases[k] = (char *) col->base;
+		data->itemsizes[k] = col->itemsize;
+	}
+	data->front = 0;
+	data->back = n_rows;
+	return citer_zip_arrays_new(data);
+}
+
+bool citer_as_column(iterator_t *it, size_t k, void **array, size_t *itemsize, size_t *len) {
+	/* Reversed iterators have their next and next_back functions swapped, so
+	 * they are not treated as columnar. */
+	if (it->next != citer_zip_arrays_next)
+		return false;
+	citer_zip_n_data_t *data = (citer_zip_n_data_t *) it->data;
+	if (k >= data->n)
+		return false;
+	*array = data->bases[k] + (data->front * data->itemsizes[k]);
+	*itemsize = data->itemsizes[k];
+	*len = data->back - data->front;
+	return true;
+}
+
+iterator_t *citer_zip_n(iterator_t **its, size_t n) {
+	if (n == 0)
+		return NULL;
+
+	citer_zip_n_data_t *data = citer_zip_n_data_new(n);
+	data->its = malloc(n * sizeof(*data->its));
+	memcpy(data->its, its, n * sizeof(*data->its));
+
+	/* If every source is contiguous, advance them all with one index. The
+	 * sources are kept so that they are freed along with this iterator. */
+	char **bases = malloc(n * sizeof(*bases));
+	size_t *itemsizes = malloc(n * sizeof(*itemsizes));
+	size_t len = SIZE_MAX;
+	size_t k;
+	for (k = 0; k < n; k++) {
+		void *array;
+		size_t this_len;
+		if (!citer_as_array(its[k], &array, &itemsizes[k], &this_len))
+			break;
+		bases[k] = (char *) array;
+		len = MIN(len, this_len);
+	}
+	if (k == n) {
+		data->bases = bases;
+		data->itemsizes = itemsizes;
+		data->front = 0;
+		data->back = len;
+		return citer_zip_arrays_new(data);
+	}
+	free(bases);
+	free(itemsizes);
+
+	citer_size_bound_t size_bound = its[0]->size_bound;
+	bool double_ended = CITER_HEDE(its[0]);
+	for (k = 1; k < n; k++) {
+		citer_size_bound_t prev = size_bound;
+		set_to_min_bound(&size_bound, &prev, &its[k]->size_bound);
+		double_ended = double_ended && CITER_HEDE(its[k]);
+	}
+
+	return citer_new(
+		data,
+		citer_zip_n_next,
+		double_ended ? citer_zip_n_next_back : NULL,
+		citer_zip_n_free_data,
+		size_bound
+	);
+}
+
 /*
  * Set the destination size bound to the minimum of the two input size bounds.
  */
@@ -19,6 +19,9 @@
 #ifndef _CITER_ZIP_H_
 #define _CITER_ZIP_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #include "iterator.h"
 
 /*
@@ -48,4 +51,124 @@ typedef struct citer_pair {
  */
 iterator_t *citer_zip(iterator_t *, iterator_t *);
 
+/*
+ * Represents a tuple of N items.
+ *
+ * The items field points to an array of len items.
+ */
+typedef struct citer_tuple {
+    void **items;
+    size_t len;
+} citer_tuple_t;
+
+/*
+ * Zips N iterators together.
+ *
+ * Like citer_zip(), but for any number of iterators. The resulting iterator
+ * yields pointers to a citer_tuple_t, whose Kth item comes from the Kth input
+ * iterator.
+ *
+ * The same tuple structure will be reused each time the iterator is advanced,
+ * so pointers to it should not be saved without first being copied.
+ *
+ * If all input iterators are contiguous (see citer_as_array()), they are
+ * advanced together with a single shared index, as with citer_zip_arrays().
+ *
+ * The array of iterators is copied, so it does not need to outlive the
+ * returned iterator, but the iterators themselves are owned by it.
+ *
+ * Returns a new iterator, or NULL if n is 0. The returned iterator must be
+ * freed after use using citer_free(). Freeing this iterator also frees the
+ * input iterators.
+ */
+iterator_t *citer_zip_n(iterator_t **its, size_t n);
+
+/*
+ * Zips N arrays together.
+ *
+ * Parameters:
+ *   bases - Pointers to the first item of each array.
+ *   itemsizes - The size (in bytes) of the items of each array.
+ *   n - The number of arrays.
+ *   len - The number of items to iterate over. Each array must have at least
+ *         this many items.
+ *
+ * The resulting iterator yields pointers to a citer_tuple_t, whose Kth item is
+ * a pointer to the current item of the Kth array. All arrays are advanced with
+ * a single shared index, so this is much cheaper than zipping N
+ * citer_over_array() iterators.
+ *
+ * The same tuple structure will be reused each time the iterator is advanced,
+ * so pointers to it should not be saved without first being copied.
+ *
+ * The returned iterator is exact-sized, double-ended and can be split using
+ * citer_split_at(). The bases and itemsizes arrays are copied, but the arrays
+ * they describe are not.
+ *
+ * Returns a new iterator, or NULL if n is 0. The returned iterator must be
+ * freed after use using citer_free().
+ */
+iterator_t *citer_zip_arrays(void **bases, size_t *itemsizes, size_t n, size_t len);
+
+/*
+ * Describes one column of a columnar (struct-of-arrays) table.
+ *
+ * The base field points to the first value of the column, and itemsize is the
+ * size (in bytes) of each value.
+ */
+typedef struct citer_column {
+    void *base;
+    size_t itemsize;
+} citer_column_t;
+
+/*
+ * Iterator over the rows of a columnar table.
+ *
+ * Parameters:
+ *   columns - Array of column descriptors.
+ *   n_columns - Number of columns.
+ *   n_rows - Number of rows. Each column must have at least this many values.
+ *   projection - Indices (into columns) of the columns to iterate over, or
+ *                NULL to iterate over all columns.
+ *   n_projected - Number of indices in projection. Ignored if projection is
+ *                 NULL.
+ *
+ * Each item is a pointer to a citer_tuple_t which serves as a view of the
+ * current row. Its Kth item points to the current value of the Kth projected
+ * column. Only the projected columns are touched, so projecting away unused
+ * columns keeps them out of the cache.
+ *
+ * The same tuple structure will be reused each time the iterator is advanced,
+ * so pointers to it should not be saved without first being copied.
+ *
+ * This is equivalent to citer_zip_arrays() over the projected columns, so the
+ * returned iterator is exact-sized, double-ended and splittable. Consumers
+ * which can process a whole column at once can get the remaining values of a
+ * column using citer_as_column().
+ *
+ * The columns and projection arrays are copied, but the columns themselves
+ * are not.
+ *
+ * Returns a new iterator, or NULL if there are no columns to iterate over or
+ * the projection names a column past the end of columns. The returned iterator
+ * must be freed after use using citer_free().
+ */
+iterator_t *citer_over_columns(const citer_column_t *columns, size_t n_columns, size_t n_rows, const size_t *projection, size_t n_projected);
+
+/*
+ * Get direct access to the remaining values of a column.
+ *
+ * If the iterator was created by citer_over_columns() or citer_zip_arrays()
+ * (or by citer_zip_n() over contiguous iterators) and has not been reversed,
+ * stores a pointer to the Kth column's value in the next row in *array, the
+ * size of each value in *itemsize, and the number of remaining rows in *len,
+ * then returns true. Otherwise returns false and leaves the output arguments
+ * untouched.
+ *
+ * The iterator is not advanced. The returned array can be passed to
+ * citer_over_array() to use column-aware consumers, e.g. to sum one column
+ * with citer_sum_f64() or filter it with citer_filter_cmp().
+ */
+bool citer_as_column(iterator_t *it, size_t k, void **array, size_t *itemsize, size_t *len);
+
 #endif /* _CITER_ZIP_H_ */
@@ -0,0 +1,266 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <citer.h>
+
+/* Check the fields of the next row, after unescaping them. */
+static void check_row(iterator_t *it, const citer_csv_options_t *options, size_t n, const char **expected) {
+    citer_csv_row_t *row = citer_next(it);
+    assert(row && row->n_fields == n);
+    for (size_t i = 0; i < n; i++) {
+        char value[256];
+        size_t len = citer_csv_unescape(&row->fields[i], value, options);
+        assert(len == strlen(expected[i]) && memcmp(value, expected[i], len) == 0);
+    }
+}
+
+#define CHECK_ROW(it, options, ...) do { \
+    const char *expected[] = { __VA_ARGS__ }; \
+    check_row(it, options, sizeof(expected) / sizeof(*expected), expected); \
+} while (0)
+
+/*
+ * Reference parser, one byte at a time. Writes each field as (start, end)
+ * offsets into fields, with rows ended by (SIZE_MAX, SIZE_MAX) markers. Returns the
+ * number of offsets written.
+ */
+static size_t reference_parse(const char *buf, size_t len, const citer_csv_options_t *o, size_t *fields) {
+    bool doubled = o->escape == '\0' || o->escape == o->quote;
+    bool in_quotes = false;
+    /* Whether a quote here would open a quoted field: at the start of a
+     * field, or right after a closing quote. */
+    bool quote_opens = true;
+    /* Whether the current row has fields already. */
+    bool in_row = false;
+    size_t n = 0, start = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = buf[i];
+        bool opens = quote_opens;
+        quote_opens = false;
+        if (!doubled && c == o->escape) {
+            i++;
+        } else if (o->quote && c == o->quote && (in_quotes || opens)) {
+            in_quotes = !in_quotes;
+            quote_opens = !in_quotes;
+        } else if (!in_quotes && (c == o->delimiter || c == '\n')) {
+            quote_opens = true;
+            fields[n++] = start;
+            fields[n++] = i;
+            start = i + 1;
+            in_row = c != '\n';
+            if (c == '\n') {
+                fields[n++] = SIZE_MAX;
+                fields[n++] = SIZE_MAX;
+            }
+        }
+    }
+    if (start < len || in_row) {
+        fields[n++] = start;
+        fields[n++] = (in_quotes && len > start && buf[len - 1] == '\n') ? len - 1 : len;
+        fields[n++] = SIZE_MAX;
+        fields[n++] = SIZE_MAX;
+    }
+    return n;
+}
+
+/* Compare citer_csv() against the reference parser. */
+static void check_against_reference(const char *buf, size_t len, const citer_csv_options_t *o) {
+    size_t *fields = malloc((4 * len + 4) * sizeof(*fields));
+    size_t n = reference_parse(buf, len, o, fields);
+
+    iterator_t *it = citer_csv(buf, len, o);
+    size_t k = 0;
+    citer_csv_row_t *row;
+    while ((row = citer_next(it))) {
+        for (size_t i = 0; i < row->n_fields; i++) {
+            assert(k + 1 < n && fields[k] != SIZE_MAX);
+            size_t start = fields[k++], end = fields[k++];
+            bool last = i + 1 == row->n_fields;
+            if (last && end > start && buf[end - 1] == '\r')
+                end--;
+            if (o->quote && end > start && buf[start] == o->quote) {
+                start++;
+                if (end > start && buf[end - 1] == o->quote)
+                    end--;
+            }
+            assert(row->fields[i].ptr == buf + start && row->fields[i].len == end - start);
+        }
+        assert(fields[k] == SIZE_MAX);
+        k += 2;
+        assert(it->size_bound.upper >= it->size_bound.lower);
+    }
+    assert(k == n);
+    citer_free(it);
+    free(fields);
+}
+
+static bool first_field_is(void *item, void *extra_data) {
+    const citer_csv_row_t *row = (const citer_csv_row_t *) item;
+    const char *value = (const char *) extra_data;
+    return row->fields[0].len == strlen(value) && memcmp(row->fields[0].ptr, value, row->fields[0].len) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    /* RFC 4180 quoting, with delimiters, newlines and doubled quotes inside
+     * quotes, and CRLF line endings. */
+    {
+        const char *text =
+            "name,age,quote\r\n"
+            "alice,30,\"hello, world\"\r\n"
+            "bob,,\"she said \"\"hi\"\"\"\r\n"
+            "\"multi\nline\",1,\n"
+            "\n"
+            "last,2,x";
+        iterator_t *it = citer_csv(text, strlen(text), NULL);
+        assert(it->size_bound.lower == 1 && it->size_bound.upper == strlen(text));
+        CHECK_ROW(it, NULL, "name", "age", "quote");
+        CHECK_ROW(it, NULL, "alice", "30", "hello, world");
+        CHECK_ROW(it, NULL, "bob", "", "she said \"hi\"");
+        CHECK_ROW(it, NULL, "multi\nline", "1", "");
+        CHECK_ROW(it, NULL, "");
+        CHECK_ROW(it, NULL, "last", "2", "x");
+        assert(citer_next(it) == NULL);
+        assert(it->size_bound.upper == 0);
+        citer_free(it);
+    }
+
+    /* Fields which don't need unescaping point straight into the buffer. */
+    {
+        const char *text = "a,\"b,c\",\"d\"\"e\"\n";
+        iterator_t *it = citer_csv(text, strlen(text), NULL);
+        citer_csv_row_t *row = citer_next(it);
+        assert(row->n_fields == 3);
+        assert(row->fields[0].ptr == text && row->fields[0].len == 1 && !row->fields[0].escaped);
+        assert(row->fields[1].ptr == text + 3 && row->fields[1].len == 3 && !row->fields[1].escaped);
+        assert(row->fields[2].len == 4 && row->fields[2].escaped);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    /* TSV, and backslash escapes. */
+    {
+        const char *text = "a\t\"b\"\tc\n";
+        citer_csv_options_t tsv = CITER_TSV_DEFAULT;
+        iterator_t *it = citer_csv(text, strlen(text), &tsv);
+        CHECK_ROW(it, &tsv, "a", "\"b\"", "c");
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+
+        text = "a\\,b,\"c\\\"d\",e\\\\\n";
+        citer_csv_options_t backslash = { ',', '"', '\\' };
+        it = citer_csv(text, strlen(text), &backslash);
+        CHECK_ROW(it, &backslash, "a,b", "c\"d", "e\\");
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    /* Rows longer than a block, with many fields. */
+    {
+        char text[4000];
+        size_t len = 0;
+        for (int i = 0; i < 500; i++)
+            len += sprintf(text + len, "%d%c", i, (i % 100 == 99) ? '\n' : ',');
+        iterator_t *it = citer_csv(text, len, NULL);
+        citer_csv_row_t *row;
+        int i = 0, rows = 0;
+        while ((row = citer_next(it))) {
+            assert(row->n_fields == 100);
+            for (size_t j = 0; j < row->n_fields; j++, i++)
+                assert(atoi(row->fields[j].ptr) == i);
+            rows++;
+        }
+        assert(rows == 5);
+        citer_free(it);
+    }
+
+    /* Filtering rows without copying them. */
+    {
+        const char *text = "x,1\ny,2\nx,3\n";
+        iterator_t *it = citer_filter(citer_csv(text, strlen(text), NULL), first_field_is, "x");
+        CHECK_ROW(it, NULL, "x", "1");
+        CHECK_ROW(it, NULL, "x", "3");
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    /* Random text, checked against the reference parser. Quotes spanning
+     * blocks and escapes at the ends of blocks are the tricky cases. */
+    {
+        const char alphabet[] = "ab,\"\n\r\\";
+        citer_csv_options_t dialects[] = {
+            CITER_CSV_DEFAULT,
+            CITER_TSV_DEFAULT,
+            { ',', '"', '\\' },
+            { ',', '\0', '\\' },
+        };
+        srand(42);
+        char buf[600];
+        for (int round = 0; round < 4000; round++) {
+            size_t len = rand() % sizeof(buf);
+            for (size_t i = 0; i < len; i++)
+                buf[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+            /* Long runs of escapes and quotes. */
+            if (round % 2) {
+                for (size_t i = rand() % (len + 1); i < len && rand() % 8; i++)
+                    buf[i] = (round % 4 == 1) ? '\\' : '"';
+            }
+            for (size_t d = 0; d < sizeof(dialects) / sizeof(*dialects); d++)
+                check_against_reference(buf, len, &dialects[d]);
+        }
+    }
+
+    /* Quotes in the middle of unquoted fields are ordinary characters, and
+     * unterminated quoted fields end before the final newline. */
+    {
+        const char *text = "ab\"c,d\ne,f\n";
+        iterator_t *it = citer_csv(text, strlen(text), NULL);
+        CHECK_ROW(it, NULL, "ab\"c", "d");
+        CHECK_ROW(it, NULL, "e", "f");
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+
+        text = "a,\"b,c\r\n";
+        it = citer_csv(text, strlen(text), NULL);
+        CHECK_ROW(it, NULL, "a", "b,c");
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    {
+        iterator_t *it = citer_csv("", 0, NULL);
+        assert(citer_has_exact_size(it) && it->size_bound.upper == 0);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+    citer_csv_options_t bad = { '"', '"', '"' };
+    assert(citer_csv("a", 1, &bad) == NULL);
+
+    return 0;
+}
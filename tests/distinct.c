@@ -0,0 +1,155 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <citer.h>
+
+static uint64_t hash_u64(void *item, void *fn_data) {
+    return citer_hash_u64(*(uint64_t *) item);
+}
+
+static bool eq_u64(void *item1, void *item2, void *fn_data) {
+    return *(uint64_t *) item1 == *(uint64_t *) item2;
+}
+
+/* A bad hash, so that probes run into long collision chains. */
+static uint64_t hash_mod(void *item, void *fn_data) {
+    return *(uint64_t *) item % 7;
+}
+
+static uint64_t hash_str(void *item, void *fn_data) {
+    return citer_hash_bytes(*(char **) item, strlen(*(char **) item));
+}
+
+static bool eq_str(void *item1, void *item2, void *fn_data) {
+    return strcmp(*(char **) item1, *(char **) item2) == 0;
+}
+
+static size_t index_u64(void *item, void *fn_data) {
+    return (size_t) *(uint64_t *) item;
+}
+
+static void *deref(void *item, void *fn_data) {
+    return *(void **) item;
+}
+
+/* Check that it yields the first occurrence of each value of arr, in order. */
+static void check_distinct(iterator_t *it, const uint64_t *arr, size_t n) {
+    bool *seen = calloc(1000, sizeof(*seen));
+    for (size_t i = 0; i < n; i++) {
+        if (arr[i] >= 1000 || seen[arr[i]])
+            continue;
+        seen[arr[i]] = true;
+        uint64_t *item = citer_next(it);
+        assert(item == &arr[i]);
+    }
+    assert(citer_next(it) == NULL);
+    free(seen);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    uint64_t arr[10000];
+    srand(1);
+    for (size_t i = 0; i < 10000; i++)
+        arr[i] = rand() % 1000;
+
+    {
+        iterator_t *it = citer_distinct(citer_over_array(arr, sizeof(*arr), 10000), hash_u64, eq_u64, NULL);
+        assert(it->size_bound.lower == 1 && it->size_bound.upper == 10000);
+        assert(!citer_is_double_ended(it));
+        check_distinct(it, arr, 10000);
+        assert(it->size_bound.lower == 0 && it->size_bound.upper == 0);
+        citer_free(it);
+    }
+
+    /* Colliding hashes, and a source without an upper bound, so that the
+     * table grows. */
+    {
+        iterator_t *it = citer_distinct(citer_over_array(arr, sizeof(*arr), 10000), hash_mod, eq_u64, NULL);
+        check_distinct(it, arr, 10000);
+        citer_free(it);
+
+        iterator_t *halves[] = {
+            citer_over_array(arr, sizeof(*arr), 5000),
+            citer_over_array(arr + 5000, sizeof(*arr), 5000),
+        };
+        iterator_t *src = citer_flatten(citer_map(citer_over_array(halves, sizeof(*halves), 2), deref, NULL));
+        assert(src->size_bound.upper_infinite);
+        it = citer_distinct(src, hash_u64, eq_u64, NULL);
+        assert(it->size_bound.upper_infinite);
+        check_distinct(it, arr, 10000);
+        citer_free(it);
+    }
+
+    /* Strings, compared by contents. */
+    {
+        const char *words[] = { "a", "b", "a", "ccc", "b", "ccc", "d" };
+        /* Separate copies, so that equal strings are at different addresses. */
+        char buf[7][4];
+        char *copies[7];
+        for (size_t i = 0; i < 7; i++)
+            copies[i] = strcpy(buf[i], words[i]);
+        iterator_t *it = citer_distinct(citer_over_array(copies, sizeof(*copies), 7), hash_str, eq_str, NULL);
+        const char *expected[] = { "a", "b", "ccc", "d" };
+        for (size_t i = 0; i < 4; i++)
+            assert(strcmp(*(char **) citer_next(it), expected[i]) == 0);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    /* Bitmap mode. Values outside the domain are always yielded. */
+    {
+        iterator_t *it = citer_distinct_bitmap(citer_over_array(arr, sizeof(*arr), 10000), index_u64, 1000, NULL);
+        check_distinct(it, arr, 10000);
+        citer_free(it);
+
+        uint64_t small[] = { 3, 5, 3, 70, 5, 70, 3 };
+        it = citer_distinct_bitmap(citer_over_array(small, sizeof(*small), 7), index_u64, 64, NULL);
+        assert(citer_next(it) == &small[0]);
+        assert(citer_next(it) == &small[1]);
+        assert(citer_next(it) == &small[3]);
+        assert(citer_next(it) == &small[5]);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    /* Empty sources. */
+    {
+        iterator_t *it = citer_distinct(citer_empty(), hash_u64, eq_u64, NULL);
+        assert(it->size_bound.lower == 0);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    assert(citer_hash_u64(1) != citer_hash_u64(2));
+    assert(citer_hash_bytes("abcdefghij", 10) == citer_hash_bytes("abcdefghij", 10));
+    assert(citer_hash_bytes("abcdefghij", 10) != citer_hash_bytes("abcdefghik", 10));
+
+    return 0;
+}
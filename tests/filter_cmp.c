@@ -0,0 +1,139 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <citer.h>
+
+struct record {
+    int32_t id;
+    double value;
+    uint64_t flags;
+};
+
+static void *map_noop(void *item, void *fn_data) {
+    (void) fn_data; /* Mark unused. */
+    return item;
+}
+
+static bool expected_match(const struct record *r) {
+    /* Matches the predicates used below with CITER_ALL_OF. */
+    return (r->id % 7 != 3) && (r->value >= 10.0) && (r->value < 60.0);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    citer_cmp_pred_t preds[] = {
+        { .offset = offsetof(struct record, value), .type = CITER_F64, .op = CITER_BETWEEN, .a.f = 10.0, .b.f = 60.0 },
+        { .offset = offsetof(struct record, flags), .type = CITER_U64, .op = CITER_NE, .a.u = 3 },
+    };
+
+    for (size_t len = 0; len < 300; len += 13) {
+        struct record *recs = malloc(len * sizeof(*recs));
+        for (size_t i = 0; i < len; i++) {
+            recs[i] = (struct record) {
+                .id = (int32_t) i,
+                .value = (double) ((i * 37) % 100),
+                .flags = i % 7,
+            };
+        }
+
+        /* Contiguous source, alternating between both ends. */
+        iterator_t *it = citer_filter_cmp(citer_over_array(recs, sizeof(*recs), len), preds, 2, CITER_ALL_OF);
+        size_t lo = 0, hi = len;
+        for (size_t k = 0; ; k++) {
+            struct record *r;
+            if (k % 3 == 2) {
+                while (hi > lo && !expected_match(&recs[hi - 1]))
+                    hi--;
+                r = citer_next_back(it);
+                if (hi == lo) {
+                    assert(r == NULL);
+                    break;
+                }
+                assert(r == &recs[--hi]);
+            } else {
+                while (lo < hi && !expected_match(&recs[lo]))
+                    lo++;
+                r = citer_next(it);
+                if (lo == hi) {
+                    assert(r == NULL);
+                    break;
+                }
+                assert(r == &recs[lo++]);
+            }
+        }
+        assert(it->size_bound.upper == 0);
+        citer_free(it);
+
+        /* Strided source over the value field, with predicates relative to
+         * the field. */
+        citer_cmp_pred_t value_pred = preds[0];
+        value_pred.offset = 0;
+        it = citer_filter_cmp(citer_over_strided(recs, offsetof(struct record, value), sizeof(*recs), len), &value_pred, 1, CITER_ALL_OF);
+        for (size_t i = 0; i < len; i++) {
+            if (recs[i].value >= 10.0 && recs[i].value < 60.0)
+                assert(citer_next(it) == &recs[i].value);
+        }
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+
+        /* Non-contiguous source. */
+        it = citer_filter_cmp(citer_map(citer_over_array(recs, sizeof(*recs), len), map_noop, NULL), preds, 2, CITER_ALL_OF);
+        for (size_t i = 0; i < len; i++) {
+            if (expected_match(&recs[i]))
+                assert(citer_next(it) == &recs[i]);
+        }
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+
+        free(recs);
+    }
+
+    /* Plain numbers combined with CITER_ANY_OF. */
+    {
+        int64_t arr[100];
+        for (size_t i = 0; i < 100; i++)
+            arr[i] = (int64_t) i - 50;
+        citer_cmp_pred_t any[] = {
+            { .type = CITER_I64, .op = CITER_LT, .a.i = -45 },
+            { .type = CITER_I64, .op = CITER_GE, .a.i = 47 },
+        };
+        iterator_t *it = citer_filter_cmp(citer_over_array(arr, sizeof(*arr), 100), any, 2, CITER_ANY_OF);
+        int64_t *x;
+        size_t count = 0;
+        while ((x = citer_next(it))) {
+            printf("%ld ", (long) *x);
+            assert(*x < -45 || *x >= 47);
+            count++;
+        }
+        printf("\n");
+        assert(count == 8);
+        citer_free(it);
+    }
+
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <citer.h>
+
+struct event {
+    uint64_t user;
+    uint32_t kind;
+};
+
+static void *event_user(void *item, void *fn_data) {
+    return &((struct event *) item)->user;
+}
+
+static uint64_t hash_u64(void *key, void *fn_data) {
+    return citer_hash_u64(*(uint64_t *) key);
+}
+
+/* Identity hash, which the Bloom filter must cope with. */
+static uint64_t hash_u64_identity(void *key, void *fn_data) {
+    return *(uint64_t *) key;
+}
+
+static bool eq_u64(void *key1, void *key2, void *fn_data) {
+    return *(uint64_t *) key1 == *(uint64_t *) key2;
+}
+
+static void *identity(void *item, void *fn_data) {
+    return item;
+}
+
+/* Copies each key into the same buffer, like iterators which reuse their
+ * items. */
+static void *copy_to_buffer(void *item, void *fn_data) {
+    static uint64_t buffer;
+    buffer = *(uint64_t *) item;
+    return &buffer;
+}
+
+/* Users whose ID is a multiple of 3 are in the set. */
+static bool in_set(uint64_t user) {
+    return user % 3 == 0;
+}
+
+/*
+ * Check a filter of events against the set, and return the number of false
+ * positives. Items must be yielded in order (or in reverse order).
+ */
+static size_t check_filter(iterator_t *it, const struct event *events, size_t n, bool from_back) {
+    assert(it != NULL);
+    assert(it->size_bound.lower == 0 && it->size_bound.upper <= n);
+    size_t false_positives = 0;
+    size_t i = from_back ? n : 0;
+    struct event *event;
+    while ((event = from_back ? citer_next_back(it) : citer_next(it))) {
+        /* Skipped events must not be in the set. */
+        if (from_back) {
+            while (&events[i - 1] != event)
+                assert(!in_set(events[--i].user));
+            i--;
+        } else {
+            while (&events[i] != event)
+                assert(!in_set(events[i++].user));
+            i++;
+        }
+        false_positives += !in_set(event->user);
+        assert(citer_is_finite(it));
+    }
+    while (from_back ? i > 0 : i < n)
+        assert(!in_set(events[from_back ? --i : i++].user));
+    assert(it->size_bound.upper == 0);
+    citer_free(it);
+    return false_positives;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    size_t n_users = 300000;
+    size_t n_keys = n_users / 3;
+    uint64_t *keys = malloc(n_keys * sizeof(*keys));
+    for (size_t j = 0; j < n_keys; j++)
+        keys[j] = 3 * j;
+
+    size_t n_events = 200000;
+    struct event *events = malloc(n_events * sizeof(*events));
+    srand(3);
+    for (size_t i = 0; i < n_events; i++) {
+        events[i].user = ((uint64_t) rand() * RAND_MAX + rand()) % n_users;
+        events[i].kind = rand() % 4;
+    }
+    size_t n_out = 0;
+    for (size_t i = 0; i < n_events; i++)
+        n_out += !in_set(events[i].user);
+
+    citer_set_ops_t ops = {
+        .key = event_user,
+        .hash = hash_u64,
+        .eq = eq_u64,
+    };
+
+    /* Exact, from both ends, in blocks and one at a time. */
+    {
+        iterator_t *it = citer_filter_in_set(citer_over_array(events, sizeof(*events), n_events), citer_over_array(keys, sizeof(*keys), n_keys), &ops, 0);
+        assert(check_filter(it, events, n_events, false) == 0);
+        it = citer_filter_in_set(citer_over_array(events, sizeof(*events), n_events), citer_over_array(keys, sizeof(*keys), n_keys), &ops, 0);
+        assert(check_filter(it, events, n_events, true) == 0);
+        iterator_t *orig = citer_map(citer_over_array(events, sizeof(*events), n_events), identity, NULL);
+        it = citer_filter_in_set(orig, citer_over_array(keys, sizeof(*keys), n_keys), &ops, 0);
+        assert(check_filter(it, events, n_events, true) == 0);
+
+        /* Keys which are reused are copied into the set. */
+        ops.key_size = sizeof(uint64_t);
+        iterator_t *key_it = citer_map(citer_over_array(keys, sizeof(*keys), n_keys), copy_to_buffer, NULL);
+        it = citer_filter_in_set(citer_over_array(events, sizeof(*events), n_events), key_it, &ops, 0);
+        assert(check_filter(it, events, n_events, false) == 0);
+        ops.key_size = 0;
+    }
+
+    /* Bloom filters have no false negatives, and about the requested rate of
+     * false positives. */
+    {
+        double rates[] = { 0.1, 0.01, 0.001 };
+        for (size_t r = 0; r < sizeof(rates) / sizeof(*rates); r++) {
+            iterator_t *it = citer_filter_in_set(citer_over_array(events, sizeof(*events), n_events), citer_over_array(keys, sizeof(*keys), n_keys), &ops, rates[r]);
+            size_t false_positives = check_filter(it, events, n_events, r % 2);
+            assert(false_positives <= 1.5 * rates[r] * n_out + 10);
+        }
+
+        /* One at a time, with the keys' hashes not known up front, and a weak
+         * hash. */
+        ops.hash = hash_u64_identity;
+        iterator_t *key_it = citer_map(citer_over_array(keys, sizeof(*keys), n_keys), copy_to_buffer, NULL);
+        iterator_t *orig = citer_map(citer_over_array(events, sizeof(*events), n_events), identity, NULL);
+        iterator_t *it = citer_filter_in_set(orig, key_it, &ops, 0.01);
+        assert(check_filter(it, events, n_events, false) <= 0.015 * n_out + 10);
+        ops.hash = hash_u64;
+    }
+
+    /* Items which are their own keys, and an empty set. */
+    {
+        citer_set_ops_t key_ops = { .hash = hash_u64, .eq = eq_u64 };
+        iterator_t *it = citer_filter_in_set(citer_over_array(keys, sizeof(*keys), n_keys), citer_over_array(keys, sizeof(*keys), 10), &key_ops, 0.01);
+        assert(citer_count(it) >= 10);
+        citer_free(it);
+        it = citer_filter_in_set(citer_over_array(keys, sizeof(*keys), n_keys), citer_empty(), &key_ops, 0.01);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    /* Invalid rates, and exact filters without an equality function. */
+    {
+        iterator_t *it = citer_empty();
+        iterator_t *key_it = citer_empty();
+        assert(citer_filter_in_set(it, key_it, &ops, 1) == NULL);
+        assert(citer_filter_in_set(it, key_it, &ops, -0.5) == NULL);
+        ops.eq = NULL;
+        assert(citer_filter_in_set(it, key_it, &ops, 0) == NULL);
+        citer_free(it);
+        citer_free(key_it);
+    }
+
+    free(keys);
+    free(events);
+    return 0;
+}
@@ -74,6 +74,7 @@ static const size_t N_SOURCES = sizeof(SOURCES) / sizeof(*SOURCES);
 static const constructor_t TRANSFORMERS[] = {
     citer_chain,
     citer_chunked,
+    citer_chunks,
     citer_enumerate,
     citer_filter,
     citer_flatten,
@@ -84,6 +85,7 @@ static const constructor_t TRANSFORMERS[] = {
     citer_skip_while,
     citer_take,
     citer_take_while,
+    citer_windows,
     citer_zip,
 };
 static const size_t N_TRANSFORMERS = sizeof(TRANSFORMERS) / sizeof(*TRANSFORMERS);
@@ -234,6 +236,13 @@ static iterator_t *random_chain(size_t maxlen, char **str_out) {
         asprintf(str_out, "citer_chunked(%s, %lu)", src_str, chunksize);
         free(src_str);
         it = citer_chunked(src, chunksize);
+    } else if (fn == citer_chunks) {
+        char *src_str;
+        iterator_t *src = random_chain(maxlen - 1, &src_str);
+        size_t chunksize = random() % 1024;
+        asprintf(str_out, "citer_chunks(%s, %lu)", src_str, chunksize);
+        free(src_str);
+        it = citer_chunks(src, chunksize);
     } else if (fn == citer_enumerate) {
         char *src_str;
         iterator_t *src = random_chain(maxlen - 1, &src_str);
@@ -297,6 +306,13 @@ static iterator_t *random_chain(size_t maxlen, char **str_out) {
         asprintf(str_out, "citer_take_while(%s, predicate_ranom, NULL)", src_str);
         free(src_str);
         it = citer_take_while(src, predicate_random, NULL);
+    } else if (fn == citer_windows) {
+        char *src_str;
+        iterator_t *src = random_chain(maxlen - 1, &src_str);
+        size_t width = random() % 16;
+        asprintf(str_out, "citer_windows(%s, %lu)", src_str, width);
+        free(src_str);
+        it = citer_windows(src, width);
     } else if (fn == citer_zip) {
         char *a_str, *b_str;
         iterator_t *a, *b;
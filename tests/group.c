@@ -0,0 +1,244 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <citer.h>
+
+struct sale {
+    uint32_t region;
+    int64_t amount;
+};
+
+struct stats {
+    int64_t total;
+    uint64_t count;
+    uint32_t region;
+};
+
+static void *sale_region(void *item, void *fn_data) {
+    return &((struct sale *) item)->region;
+}
+
+static uint64_t hash_u32(void *key, void *fn_data) {
+    return citer_hash_u64(*(uint32_t *) key);
+}
+
+/* A bad hash, so that many keys collide. */
+static uint64_t hash_u32_bad(void *key, void *fn_data) {
+    return *(uint32_t *) key % 5;
+}
+
+static bool eq_u32(void *key1, void *key2, void *fn_data) {
+    return *(uint32_t *) key1 == *(uint32_t *) key2;
+}
+
+static void stats_init(void *acc, void *key, void *fn_data) {
+    ((struct stats *) acc)->region = *(uint32_t *) key;
+}
+
+static void stats_add(void *acc, void *item, void *fn_data) {
+    struct stats *stats = (struct stats *) acc;
+    stats->total += ((struct sale *) item)->amount;
+    stats->count++;
+}
+
+static void *deref(void *item, void *fn_data) {
+    return *(void **) item;
+}
+
+static void stats_merge(void *dst, void *src, void *fn_data) {
+    struct stats *d = (struct stats *) dst;
+    const struct stats *s = (const struct stats *) src;
+    assert(d->region == s->region);
+    d->total += s->total;
+    d->count += s->count;
+}
+
+/* Copies each sale into the same buffer, like iterators which reuse their
+ * items. */
+static void *copy_to_buffer(void *item, void *fn_data) {
+    static struct sale buffer;
+    buffer = *(struct sale *) item;
+    return &buffer;
+}
+
+static void *word_key(void *item, void *fn_data) {
+    return *(char **) item;
+}
+
+static uint64_t hash_str(void *key, void *fn_data) {
+    return citer_hash_bytes(key, strlen(key));
+}
+
+static bool eq_str(void *key1, void *key2, void *fn_data) {
+    return strcmp(key1, key2) == 0;
+}
+
+static void count_item(void *acc, void *item, void *fn_data) {
+    (*(size_t *) acc)++;
+}
+
+/* Check the groups of it against the totals and counts of the first N sales per
+ * region. */
+static void check_groups(iterator_t *it, const struct sale *sales, size_t n, size_t n_regions, bool from_back) {
+    int64_t *totals = calloc(n_regions, sizeof(*totals));
+    uint64_t *counts = calloc(n_regions, sizeof(*counts));
+    for (size_t i = 0; i < n; i++) {
+        totals[sales[i].region] += sales[i].amount;
+        counts[sales[i].region]++;
+    }
+    size_t n_groups = 0;
+    for (size_t r = 0; r < n_regions; r++)
+        n_groups += counts[r] > 0;
+    assert(citer_has_exact_size(it) && it->size_bound.upper == n_groups);
+
+    bool *seen = calloc(n_regions, sizeof(*seen));
+    citer_group_t *group;
+    while ((group = from_back ? citer_next_back(it) : citer_next(it))) {
+        uint32_t region = *(uint32_t *) group->key;
+        struct stats *stats = group->acc;
+        assert(region < n_regions && !seen[region]);
+        seen[region] = true;
+        assert(stats->region == region);
+        assert(stats->total == totals[region] && stats->count == counts[region]);
+        n_groups--;
+        assert(it->size_bound.upper == n_groups);
+    }
+    assert(n_groups == 0);
+    free(seen);
+    free(totals);
+    free(counts);
+    citer_free(it);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    size_t n_sales = 100000;
+    size_t n_regions = 5000;
+    struct sale *sales = malloc(n_sales * sizeof(*sales));
+    srand(7);
+    for (size_t i = 0; i < n_sales; i++) {
+        /* Leave some regions out. */
+        sales[i].region = (rand() % n_regions) & ~1u;
+        sales[i].amount = rand() % 1000 - 500;
+    }
+
+    citer_group_ops_t ops = {
+        .key = sale_region,
+        .hash = hash_u32,
+        .eq = eq_u32,
+        .key_size = 0,
+        .acc_size = sizeof(struct stats),
+        .init = stats_init,
+        .acc = stats_add,
+    };
+
+    /* One table, from the front and from the back. */
+    check_groups(citer_group_fold(citer_over_array(sales, sizeof(*sales), n_sales), &ops), sales, n_sales, n_regions, false);
+    check_groups(citer_group_fold(citer_over_array(sales, sizeof(*sales), n_sales), &ops), sales, n_sales, n_regions, true);
+
+    /* Partitioned, with colliding hashes, and with a number of partitions
+     * which is not a power of two. */
+    ops.partitions = 16;
+    check_groups(citer_group_fold(citer_over_array(sales, sizeof(*sales), n_sales), &ops), sales, n_sales, n_regions, false);
+    ops.partitions = 5;
+    ops.hash = hash_u32_bad;
+    check_groups(citer_group_fold(citer_over_array(sales, sizeof(*sales), 2000), &ops), sales, 2000, n_regions, true);
+    ops.hash = hash_u32;
+    ops.partitions = 0;
+
+    /* Items which are reused need keys copied into the table. The source has
+     * no upper bound, so the table grows. */
+    {
+        ops.key_size = sizeof(uint32_t);
+        iterator_t *halves[] = {
+            citer_over_array(sales, sizeof(*sales), n_sales / 2),
+            citer_over_array(sales + n_sales / 2, sizeof(*sales), n_sales - n_sales / 2),
+        };
+        iterator_t *it = citer_map(citer_flatten(citer_map(citer_over_array(halves, sizeof(*halves), 2), deref, NULL)), copy_to_buffer, NULL);
+        check_groups(citer_group_fold(it, &ops), sales, n_sales, n_regions, false);
+        ops.key_size = 0;
+    }
+
+    /* In parallel, with and without copied keys, and with more partitions
+     * than threads ask for. */
+    {
+        ops.merge = stats_merge;
+        size_t threads[] = { 0, 1, 2, 4, 7 };
+        for (size_t t = 0; t < sizeof(threads) / sizeof(*threads); t++) {
+            iterator_t *it = citer_over_array(sales, sizeof(*sales), n_sales);
+            check_groups(citer_par_group_fold(it, &ops, threads[t]), sales, n_sales, n_regions, t % 2);
+        }
+        ops.key_size = sizeof(uint32_t);
+        ops.partitions = 100;
+        check_groups(citer_par_group_fold(citer_over_array(sales, sizeof(*sales), n_sales), &ops, 3), sales, n_sales, n_regions, false);
+        ops.key_size = 0;
+        ops.partitions = 0;
+
+        /* Sources which can't be split are aggregated on one thread. */
+        iterator_t *it = citer_map(citer_over_array(sales, sizeof(*sales), n_sales), copy_to_buffer, NULL);
+        ops.key_size = sizeof(uint32_t);
+        check_groups(citer_par_group_fold(it, &ops, 4), sales, n_sales, n_regions, false);
+        ops.key_size = 0;
+    }
+
+    /* String keys, with accumulators starting zeroed. */
+    {
+        char *words[] = { "to", "be", "or", "not", "to", "be" };
+        citer_group_ops_t word_ops = {
+            .key = word_key,
+            .hash = hash_str,
+            .eq = eq_str,
+            .acc_size = sizeof(size_t),
+            .acc = count_item,
+        };
+        iterator_t *it = citer_group_fold(citer_over_array(words, sizeof(*words), 6), &word_ops);
+        assert(it->size_bound.upper == 4);
+        citer_group_t *group;
+        size_t total = 0;
+        while ((group = citer_next(it))) {
+            size_t count = *(size_t *) group->acc;
+            const char *word = group->key;
+            assert(count == ((strcmp(word, "to") == 0 || strcmp(word, "be") == 0) ? 2 : 1));
+            total += count;
+        }
+        assert(total == 6);
+        citer_free(it);
+    }
+
+    /* No items, no groups. */
+    {
+        iterator_t *it = citer_group_fold(citer_empty(), &ops);
+        assert(citer_has_exact_size(it) && it->size_bound.upper == 0);
+        assert(citer_next(it) == NULL && citer_next_back(it) == NULL);
+        citer_free(it);
+    }
+
+    free(sales);
+    return 0;
+}
@@ -0,0 +1,386 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Needed for mkstemp() and pipe() when compiling with -std=c99. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <citer.h>
+
+struct record {
+    uint32_t id;
+    char name[8];
+};
+
+static struct record make_record(uint32_t i) {
+    struct record r = { .id = i };
+    snprintf(r.name, sizeof(r.name), "r%u", (unsigned) (i % 100000));
+    return r;
+}
+
+static void write_records(int fd, size_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        struct record r = make_record(i);
+        assert(write(fd, &r, sizeof(r)) == sizeof(r));
+    }
+}
+
+static void check_record(const struct record *r, uint32_t i) {
+    struct record expected = make_record(i);
+    assert(r && memcmp(r, &expected, sizeof(expected)) == 0);
+}
+
+/* Serialise a record as "id name\n". */
+static size_t format_record(void *item, char *buf, size_t len, void *fn_data) {
+    const struct record *r = (const struct record *) item;
+    size_t *calls = (size_t *) fn_data;
+    (*calls)++;
+    int n = snprintf(buf, len, "%u %.8s\n", (unsigned) r->id, r->name);
+    return (size_t) n;
+}
+
+/* A serialised item larger than the staging buffer. */
+static size_t format_large(void *item, char *buf, size_t len, void *fn_data) {
+    size_t size = 100000 + *(int *) item;
+    if (size <= len)
+        memset(buf, 'a' + *(int *) item, size);
+    return size;
+}
+
+static bool keep_all(void *item, void *extra_data) {
+    return true;
+}
+
+/* Copy a record into the buffer in fn_data, which each call reuses. */
+static void *copy_to_buffer(void *item, void *fn_data) {
+    memcpy(fn_data, item, sizeof(struct record));
+    return fn_data;
+}
+
+struct drain {
+    int fd;
+    char *buf;
+    size_t len;
+};
+
+static void *drain_pipe(void *_drain) {
+    struct drain *drain = (struct drain *) _drain;
+    size_t capacity = 1 << 16;
+    drain->buf = malloc(capacity);
+    drain->len = 0;
+    ssize_t n;
+    while ((n = read(drain->fd, drain->buf + drain->len, capacity - drain->len)) > 0) {
+        drain->len += (size_t) n;
+        if (drain->len == capacity)
+            drain->buf = realloc(drain->buf, capacity *= 2);
+    }
+    return NULL;
+}
+
+static char *read_back(int fd, size_t *len) {
+    off_t size = lseek(fd, 0, SEEK_END);
+    char *buf = malloc(size + 1);
+    assert(pread(fd, buf, size, 0) == size);
+    buf[size] = '\0';
+    *len = (size_t) size;
+    return buf;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    char path[] = "/tmp/citer_io_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    unlink(path);
+    write_records(fd, 1000);
+    /* A partial record at the end is ignored. */
+    assert(write(fd, "xyz", 3) == 3);
+
+    /* Regular files have an exact size. Buffers which are not a multiple of
+     * the record size make records straddle reads. */
+    size_t buffer_sizes[] = { 1, 12, 100, 4096, 1 << 20 };
+    for (size_t k = 0; k < sizeof(buffer_sizes) / sizeof(*buffer_sizes); k++) {
+        assert(lseek(fd, 0, SEEK_SET) == 0);
+        iterator_t *it = citer_read_records(fd, sizeof(struct record), buffer_sizes[k]);
+        assert(citer_has_exact_size(it) && it->size_bound.upper == 1000);
+
+        for (uint32_t i = 0; i < 1000; i++) {
+            check_record(citer_next(it), i);
+            assert(it->size_bound.upper == 999 - i);
+        }
+        assert(citer_next(it) == NULL);
+        assert(citer_read_records_error(it) == 0);
+        citer_free(it);
+    }
+
+    /* Starting from the middle of the file. Records in a chunk stay valid
+     * while the chunk is collected. */
+    {
+        assert(lseek(fd, 400 * sizeof(struct record), SEEK_SET) >= 0);
+        iterator_t *it = citer_chunked(citer_read_records(fd, sizeof(struct record), 1000), 50);
+        assert(citer_has_exact_size(it) && it->size_bound.upper == 12);
+        void **chunk;
+        uint32_t i = 400;
+        while ((chunk = citer_next(it))) {
+            for (size_t j = 0; j < 50 && i < 1000; j++)
+                check_record(chunk[j], i++);
+            free(chunk);
+        }
+        assert(i == 1000);
+        citer_free(it);
+    }
+
+    /* Asynchronous reads, with each engine. io_uring falls back to a thread
+     * if the kernel doesn't support it. */
+    citer_io_engine_t engines[] = { CITER_IO_AUTO, CITER_IO_URING, CITER_IO_THREAD };
+    for (size_t e = 0; e < sizeof(engines) / sizeof(*engines); e++) {
+        for (size_t k = 0; k < sizeof(buffer_sizes) / sizeof(*buffer_sizes); k++) {
+            for (size_t depth = 0; depth <= 4; depth += 2) {
+                assert(lseek(fd, 0, SEEK_SET) == 0);
+                iterator_t *it = citer_read_records_async(fd, sizeof(struct record), buffer_sizes[k], depth, engines[e]);
+                assert(citer_has_exact_size(it) && it->size_bound.upper == 1000);
+                citer_io_engine_t engine = citer_read_records_engine(it);
+                assert(engine == CITER_IO_URING || engine == CITER_IO_THREAD);
+                if (engines[e] == CITER_IO_THREAD)
+                    assert(engine == CITER_IO_THREAD);
+
+                /* The previous buffer stays valid. */
+                const struct record *prev = NULL;
+                for (uint32_t i = 0; i < 1000; i++) {
+                    const struct record *r = citer_next(it);
+                    check_record(r, i);
+                    if (prev)
+                        check_record(prev, i - 1);
+                    prev = r;
+                    assert(it->size_bound.upper == 999 - i);
+                }
+                assert(citer_next(it) == NULL);
+                assert(citer_next(it) == NULL);
+                assert(citer_read_records_error(it) == 0);
+                citer_free(it);
+            }
+        }
+    }
+
+    /* Freeing an asynchronous iterator early waits for the reads in flight. */
+    for (size_t e = 0; e < sizeof(engines) / sizeof(*engines); e++) {
+        assert(lseek(fd, 100 * sizeof(struct record), SEEK_SET) >= 0);
+        iterator_t *it = citer_read_records_async(fd, sizeof(struct record), 24, 8, engines[e]);
+        assert(it->size_bound.upper == 900);
+        check_record(citer_next(it), 100);
+        check_record(citer_next(it), 101);
+        check_record(citer_next(it), 102);
+        citer_free(it);
+    }
+    close(fd);
+
+    /* Pipes don't have a known size. */
+    {
+        int fds[2];
+        assert(pipe(fds) == 0);
+        write_records(fds[1], 100);
+        close(fds[1]);
+
+        iterator_t *it = citer_read_records(fds[0], sizeof(struct record), 64);
+        assert(!citer_has_exact_size(it) && it->size_bound.upper_infinite);
+        for (uint32_t i = 0; i < 100; i++)
+            check_record(citer_next(it), i);
+        assert(citer_next(it) == NULL);
+        assert(it->size_bound.upper == 0 && !it->size_bound.upper_infinite);
+        citer_free(it);
+        close(fds[0]);
+    }
+
+    /* Asynchronous reads from pipes use a thread. */
+    {
+        int fds[2];
+        assert(pipe(fds) == 0);
+        write_records(fds[1], 100);
+        assert(write(fds[1], "xyz", 3) == 3);
+        close(fds[1]);
+
+        iterator_t *it = citer_read_records_async(fds[0], sizeof(struct record), 64, 2, CITER_IO_AUTO);
+        assert(citer_read_records_engine(it) == CITER_IO_THREAD);
+        assert(!citer_has_exact_size(it) && it->size_bound.upper_infinite);
+        for (uint32_t i = 0; i < 100; i++)
+            check_record(citer_next(it), i);
+        assert(citer_next(it) == NULL);
+        assert(citer_read_records_error(it) == 0);
+        citer_free(it);
+        close(fds[0]);
+    }
+
+    /* Read errors stop the iteration. */
+    {
+        iterator_t *it = citer_read_records(-1, 4, 16);
+        assert(citer_next(it) == NULL);
+        printf("Error: %s\n", strerror(citer_read_records_error(it)));
+        assert(citer_read_records_error(it) != 0);
+        citer_free(it);
+
+        it = citer_read_records_async(-1, 4, 16, 2, CITER_IO_AUTO);
+        assert(citer_next(it) == NULL);
+        assert(citer_read_records_error(it) == EBADF);
+        citer_free(it);
+    }
+
+    /* Writing serialised items. */
+    {
+        struct record records[3000];
+        for (uint32_t i = 0; i < 3000; i++)
+            records[i] = make_record(i);
+
+        char path[] = "/tmp/citer_io_XXXXXX";
+        int out = mkstemp(path);
+        assert(out >= 0);
+        unlink(path);
+        size_t calls = 0;
+        int error = -1;
+        iterator_t *it = citer_over_array(records, sizeof(*records), 3000);
+        size_t written = citer_write_all(it, out, format_record, &calls, &error);
+        assert(error == 0 && citer_next(it) == NULL);
+        citer_free(it);
+
+        size_t len;
+        char *text = read_back(out, &len);
+        assert(written == len);
+        char *line = text;
+        for (uint32_t i = 0; i < 3000; i++) {
+            char expected[32];
+            int n = snprintf(expected, sizeof(expected), "%u r%u\n", (unsigned) i, (unsigned) i);
+            assert(strncmp(line, expected, n) == 0);
+            line += n;
+        }
+        assert(line == text + len);
+        /* Items are only serialised again when the buffer is full. */
+        assert(calls < 3000 + 3000 / 100);
+
+        /* Items whose memory is reused are serialised before the next one is
+         * taken. */
+        struct record copy;
+        assert(ftruncate(out, 0) == 0 && lseek(out, 0, SEEK_SET) == 0);
+        it = citer_map(citer_over_array(records, sizeof(*records), 3000), copy_to_buffer, &copy);
+        assert(citer_write_all(it, out, format_record, &calls, NULL) == len);
+        citer_free(it);
+        char *text2 = read_back(out, &len);
+        assert(memcmp(text, text2, len) == 0);
+        free(text2);
+        free(text);
+        close(out);
+
+        /* Items larger than the staging buffer. */
+        char large_path[] = "/tmp/citer_io_XXXXXX";
+        out = mkstemp(large_path);
+        assert(out >= 0);
+        unlink(large_path);
+        int sizes[] = { 0, 1, 2 };
+        it = citer_over_array(sizes, sizeof(*sizes), 3);
+        written = citer_write_all(it, out, format_large, NULL, NULL);
+        citer_free(it);
+        assert(written == 300003);
+        text = read_back(out, &len);
+        assert(len == 300003 && text[0] == 'a' && text[100000] == 'b' && text[300002] == 'c');
+        free(text);
+        close(out);
+    }
+
+    /* Writing records from arrays, strided fields and other iterators,
+     * including record readers with buffers smaller than a batch of writes,
+     * which reuse their records' memory. Pipes take partial writes. */
+    {
+        size_t n_records = 20000;
+        struct record *records = malloc(n_records * sizeof(*records));
+        for (uint32_t i = 0; i < n_records; i++)
+            records[i] = make_record(i);
+        struct wrapper {
+            char pad[3];
+            struct record r;
+        } *wrapped = malloc(n_records * sizeof(*wrapped));
+        for (uint32_t i = 0; i < n_records; i++)
+            wrapped[i].r = records[i];
+
+        char in_path[] = "/tmp/citer_io_XXXXXX";
+        int in = mkstemp(in_path);
+        assert(in >= 0);
+        unlink(in_path);
+        assert(write(in, records, n_records * sizeof(*records)) == (ssize_t) (n_records * sizeof(*records)));
+        assert(lseek(in, 0, SEEK_SET) == 0);
+
+        for (int source = 0; source < 4; source++) {
+            int fds[2];
+            assert(pipe(fds) == 0);
+            struct drain drain = { .fd = fds[0] };
+            pthread_t thread;
+            assert(pthread_create(&thread, NULL, drain_pipe, &drain) == 0);
+
+            iterator_t *it;
+            if (source == 0)
+                it = citer_over_array(records, sizeof(*records), n_records);
+            else if (source == 1)
+                it = citer_over_strided(wrapped, offsetof(struct wrapper, r), sizeof(*wrapped), n_records);
+            else if (source == 2)
+                it = citer_filter(citer_over_array(records, sizeof(*records), n_records), keep_all, NULL);
+            else
+                it = citer_read_records(in, sizeof(struct record), 16 * sizeof(struct record));
+            int error = -1;
+            size_t written = citer_write_records(it, fds[1], sizeof(struct record), &error);
+            assert(error == 0 && written == n_records * sizeof(struct record));
+            assert(citer_next(it) == NULL);
+            citer_free(it);
+            close(fds[1]);
+
+            assert(pthread_join(thread, NULL) == 0);
+            assert(drain.len == written);
+            assert(memcmp(drain.buf, records, written) == 0);
+            free(drain.buf);
+            close(fds[0]);
+        }
+        close(in);
+        free(wrapped);
+        free(records);
+    }
+
+    /* Write errors are reported. */
+    {
+        int value = 1;
+        iterator_t *it = citer_over_array(&value, sizeof(value), 1);
+        int error = 0;
+        assert(citer_write_records(it, -1, sizeof(value), &error) == 0);
+        assert(error == EBADF);
+        citer_free(it);
+    }
+
+    assert(citer_read_records(0, 0, 16) == NULL);
+    assert(citer_read_records_async(0, 0, 16, 2, CITER_IO_AUTO) == NULL);
+
+    return 0;
+}
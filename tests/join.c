@@ -0,0 +1,244 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Needed for setrlimit() when compiling with -std=c99. */
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <citer.h>
+
+struct order {
+    uint32_t customer;
+    uint32_t id;
+};
+
+struct customer {
+    uint32_t id;
+    uint32_t region;
+};
+
+static void *order_customer(void *item, void *fn_data) {
+    return &((struct order *) item)->customer;
+}
+
+static void *customer_id(void *item, void *fn_data) {
+    return &((struct customer *) item)->id;
+}
+
+static uint64_t hash_u32(void *key, void *fn_data) {
+    return citer_hash_u64(*(uint32_t *) key);
+}
+
+static bool eq_u32(void *key1, void *key2, void *fn_data) {
+    return *(uint32_t *) key1 == *(uint32_t *) key2;
+}
+
+/* Count the matches of each order, by brute force. */
+static size_t *count_matches(const struct order *orders, size_t n_orders, const struct customer *customers, size_t n_customers) {
+    size_t *matches = calloc(n_orders, sizeof(*matches));
+    for (size_t i = 0; i < n_orders; i++)
+        for (size_t j = 0; j < n_customers; j++)
+            matches[i] += orders[i].customer == customers[j].id;
+    return matches;
+}
+
+/* Check an inner join of orders with customers. If in_order is true, pairs
+ * must be in the order of the orders, then of the customers. */
+static void check_inner(iterator_t *it, const struct order *orders, size_t n_orders, const struct customer *customers, size_t n_customers, bool in_order) {
+    size_t *matches = count_matches(orders, n_orders, customers, n_customers);
+    size_t total = 0;
+    for (size_t i = 0; i < n_orders; i++)
+        total += matches[i];
+
+    size_t *seen = calloc(n_orders, sizeof(*seen));
+    size_t n = 0;
+    const struct order *last_order = NULL;
+    const struct customer *last_customer = NULL;
+    citer_pair_t *pair;
+    while ((pair = citer_next(it))) {
+        const struct order *order = pair->x;
+        const struct customer *customer = pair->y;
+        assert(order->customer == customer->id);
+        /* Orders have unique IDs, which index them. */
+        assert(order->id < n_orders && orders[order->id].customer == order->customer);
+        seen[order->id]++;
+        if (in_order && last_order) {
+            assert(last_order <= order);
+            assert(last_order < order || last_customer < customer);
+        }
+        last_order = order;
+        last_customer = customer;
+        n++;
+        assert(citer_is_finite(it) ? it->size_bound.upper >= total - n : true);
+    }
+    assert(n == total);
+    for (size_t i = 0; i < n_orders; i++)
+        assert(seen[i] == matches[i]);
+    free(seen);
+    free(matches);
+    citer_free(it);
+}
+
+/* Check a semi or anti join of orders with customers. */
+static void check_filter(iterator_t *it, const struct order *orders, size_t n_orders, const struct customer *customers, size_t n_customers, bool semi, bool in_order) {
+    size_t *matches = count_matches(orders, n_orders, customers, n_customers);
+    bool *seen = calloc(n_orders, sizeof(*seen));
+    size_t expected = 0;
+    for (size_t i = 0; i < n_orders; i++)
+        expected += (matches[i] > 0) == semi;
+
+    size_t n = 0;
+    int64_t last = -1;
+    struct order *order;
+    while ((order = citer_next(it))) {
+        assert(order->id < n_orders && !seen[order->id]);
+        assert((matches[order->id] > 0) == semi);
+        seen[order->id] = true;
+        if (in_order) {
+            assert((int64_t) order->id > last);
+            last = order->id;
+        }
+        n++;
+    }
+    assert(n == expected);
+    free(seen);
+    free(matches);
+    citer_free(it);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    size_t n_orders = 3000;
+    size_t n_customers = 1000;
+    struct order *orders = malloc(n_orders * sizeof(*orders));
+    struct customer *customers = malloc(n_customers * sizeof(*customers));
+    srand(11);
+    /* Some customer IDs repeat, and some orders have no customer. */
+    for (size_t j = 0; j < n_customers; j++) {
+        customers[j].id = rand() % 1200;
+        customers[j].region = rand() % 10;
+    }
+    for (size_t i = 0; i < n_orders; i++) {
+        orders[i].customer = rand() % 1500;
+        orders[i].id = i;
+    }
+
+    citer_join_ops_t ops = {
+        .left_key = order_customer,
+        .right_key = customer_id,
+        .hash = hash_u32,
+        .eq = eq_u32,
+    };
+
+    /* In memory. The smaller side is built, whichever it is. */
+    {
+        iterator_t *it = citer_hash_join(citer_over_array(orders, sizeof(*orders), n_orders), citer_over_array(customers, sizeof(*customers), n_customers), &ops, CITER_INNER_JOIN);
+        assert(!citer_hash_join_spilled(it));
+        assert(citer_hash_join_memory(it) >= n_customers * sizeof(void *));
+        check_inner(it, orders, n_orders, customers, n_customers, true);
+
+        /* Build the orders; matches are then in the order of the orders for
+         * each customer. */
+        it = citer_hash_join(citer_over_array(orders, sizeof(*orders), 500), citer_over_array(customers, sizeof(*customers), n_customers), &ops, CITER_INNER_JOIN);
+        check_inner(it, orders, 500, customers, n_customers, false);
+
+        it = citer_hash_join(citer_over_array(orders, sizeof(*orders), n_orders), citer_over_array(customers, sizeof(*customers), n_customers), &ops, CITER_SEMI_JOIN);
+        assert(it->size_bound.lower == 0 && it->size_bound.upper == n_orders);
+        check_filter(it, orders, n_orders, customers, n_customers, true, true);
+        it = citer_hash_join(citer_over_array(orders, sizeof(*orders), n_orders), citer_over_array(customers, sizeof(*customers), n_customers), &ops, CITER_ANTI_JOIN);
+        check_filter(it, orders, n_orders, customers, n_customers, false, true);
+    }
+
+    /* Spilled to temporary files, with a budget well below the build side's
+     * size. */
+    {
+        ops.memory_budget = 4096;
+        ops.left_size = sizeof(struct order);
+        ops.right_size = sizeof(struct customer);
+        iterator_t *it = citer_hash_join(citer_over_array(orders, sizeof(*orders), n_orders), citer_over_array(customers, sizeof(*customers), n_customers), &ops, CITER_INNER_JOIN);
+        assert(citer_hash_join_spilled(it));
+        /* The table isn't presized past the budget, so it spills on the
+         * growth which takes it over. */
+        assert(citer_hash_join_memory(it) <= 2 * ops.memory_budget);
+        assert(citer_is_finite(it) == false);
+        check_inner(it, orders, n_orders, customers, n_customers, false);
+
+        it = citer_hash_join(citer_over_array(orders, sizeof(*orders), n_orders), citer_over_array(customers, sizeof(*customers), n_customers), &ops, CITER_SEMI_JOIN);
+        assert(citer_hash_join_spilled(it));
+        check_filter(it, orders, n_orders, customers, n_customers, true, false);
+        it = citer_hash_join(citer_over_array(orders, sizeof(*orders), n_orders), citer_over_array(customers, sizeof(*customers), n_customers), &ops, CITER_ANTI_JOIN);
+        check_filter(it, orders, n_orders, customers, n_customers, false, false);
+
+        /* Without item sizes, the join stays in memory. */
+        ops.right_size = 0;
+        it = citer_hash_join(citer_over_array(orders, sizeof(*orders), n_orders), citer_over_array(customers, sizeof(*customers), n_customers), &ops, CITER_SEMI_JOIN);
+        assert(!citer_hash_join_spilled(it) && citer_hash_join_memory(it) > ops.memory_budget);
+        check_filter(it, orders, n_orders, customers, n_customers, true, true);
+        ops.right_size = sizeof(struct customer);
+
+        /* Writes to the temporary files which fail (here, past a file size
+         * limit) end the join with an error, rather than dropping items: of
+         * the build side for the smaller limit, and of the probe side only for
+         * the larger one. */
+        struct rlimit old_limit;
+        assert(getrlimit(RLIMIT_FSIZE, &old_limit) == 0);
+        signal(SIGXFSZ, SIG_IGN);
+        rlim_t limits[] = { 128, 512 };
+        for (size_t l = 0; l < sizeof(limits) / sizeof(*limits); l++) {
+            struct rlimit limit = { limits[l], old_limit.rlim_max };
+            assert(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+            it = citer_hash_join(citer_over_array(orders, sizeof(*orders), n_orders), citer_over_array(customers, sizeof(*customers), n_customers), &ops, CITER_INNER_JOIN);
+            assert(citer_hash_join_spilled(it));
+            assert(citer_count(it) == 0);
+            assert(citer_hash_join_error(it) == EFBIG);
+            citer_free(it);
+        }
+        assert(setrlimit(RLIMIT_FSIZE, &old_limit) == 0);
+        signal(SIGXFSZ, SIG_DFL);
+        ops.memory_budget = 0;
+    }
+
+    /* Empty sides. */
+    {
+        iterator_t *it = citer_hash_join(citer_over_array(orders, sizeof(*orders), n_orders), citer_empty(), &ops, CITER_INNER_JOIN);
+        assert(it->size_bound.upper == 0 && !it->size_bound.upper_infinite);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+        it = citer_hash_join(citer_empty(), citer_over_array(customers, sizeof(*customers), n_customers), &ops, CITER_ANTI_JOIN);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+        it = citer_hash_join(citer_over_array(orders, sizeof(*orders), n_orders), citer_empty(), &ops, CITER_ANTI_JOIN);
+        check_filter(it, orders, n_orders, customers, 0, false, true);
+    }
+
+    free(orders);
+    free(customers);
+    return 0;
+}
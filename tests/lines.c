@@ -0,0 +1,284 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Needed for mkstemp() when compiling with -std=c99. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <citer.h>
+
+/* Check that a line view is the line of contents starting at start. */
+static void check_line(const citer_line_t *line, const char *contents, size_t start) {
+    assert(line);
+    assert(line->ptr == NULL || memcmp(line->ptr, contents + start, line->len) == 0);
+    assert(contents[start + line->len] == '\n' || contents[start + line->len] == '\0');
+}
+
+/* Write contents to a new temporary file and return its path. */
+static char *write_temp(const char *contents, size_t len) {
+    static char path[64];
+    strcpy(path, "/tmp/citer_lines_XXXXXX");
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    assert(write(fd, contents, len) == (ssize_t) len);
+    close(fd);
+    return path;
+}
+
+/*
+ * Check the lines of contents, reading from the front and back in the order
+ * given by pattern (one bit per line, set for next_back()).
+ */
+static void check_lines(const char *contents, size_t len, unsigned pattern) {
+    /* Split naively to find the expected lines. */
+    size_t *starts = malloc((len + 1) * sizeof(*starts));
+    size_t *ends = malloc((len + 1) * sizeof(*ends));
+    size_t n = 0;
+    size_t end = (len > 0 && contents[len - 1] == '\n') ? len - 1 : len;
+    if (len > 0) {
+        size_t start = 0;
+        for (size_t i = 0; i < end; i++) {
+            if (contents[i] == '\n') {
+                starts[n] = start;
+                ends[n++] = i;
+                start = i + 1;
+            }
+        }
+        starts[n] = start;
+        ends[n++] = end;
+    }
+
+    char *path = write_temp(contents, len);
+    iterator_t *it = citer_mmap_lines(path);
+    assert(it);
+    unlink(path);
+
+    size_t lo = 0, hi = n;
+    for (size_t k = 0; lo < hi; k++) {
+        assert(it->size_bound.lower <= hi - lo && hi - lo <= it->size_bound.upper);
+        citer_line_t *line;
+        size_t expected;
+        if ((pattern >> (k % 32)) & 1) {
+            line = citer_next_back(it);
+            expected = --hi;
+        } else {
+            line = citer_next(it);
+            expected = lo++;
+        }
+        assert(line);
+        assert(line->len == ends[expected] - starts[expected]);
+        assert(memcmp(line->ptr, contents + starts[expected], line->len) == 0);
+    }
+    assert(citer_next(it) == NULL);
+    assert(citer_next_back(it) == NULL);
+    assert(it->size_bound.upper == 0);
+    citer_free(it);
+    free(starts);
+    free(ends);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    check_lines("", 0, 0);
+    check_lines("\n", 1, 0);
+    check_lines("\n", 1, ~0u);
+    check_lines("\n\n", 2, 0);
+    check_lines("one", 3, 0);
+    check_lines("one\ntwo\r\nthree\n", 15, 0x2);
+
+    /* Random contents with short and long (multi-block) lines. */
+    srand(1234);
+    char *buf = malloc(20000);
+    for (int round = 0; round < 50; round++) {
+        size_t len = (size_t) rand() % 20000;
+        int newline_every = 1 + rand() % 200;
+        for (size_t i = 0; i < len; i++)
+            buf[i] = (rand() % newline_every == 0) ? '\n' : (char) ('a' + rand() % 26);
+        check_lines(buf, len, (unsigned) rand());
+    }
+    free(buf);
+
+    /* Reading the last lines in reverse. */
+    {
+        const char *text = "first\nsecond\nthird\nfourth\n";
+        char *path = write_temp(text, strlen(text));
+        iterator_t *it = citer_take(citer_reverse(citer_mmap_lines(path)), 2);
+        unlink(path);
+        citer_line_t *line;
+        while ((line = citer_next(it)))
+            printf("Got: %.*s\n", (int) line->len, line->ptr);
+        citer_free(it);
+    }
+
+    assert(citer_mmap_lines("/nonexistent/citer_lines") == NULL);
+
+    /* Indexed lines, for a file large enough to be indexed by several
+     * threads. */
+    {
+        size_t len = 3 << 20;
+        char *text = malloc(len + 1);
+        size_t *starts = malloc((len + 1) * sizeof(*starts));
+        size_t n = 0;
+        starts[n++] = 0;
+        for (size_t i = 0; i < len; i++) {
+            text[i] = (rand() % 40 == 0) ? '\n' : 'x';
+            if (text[i] == '\n' && i + 1 < len)
+                starts[n++] = i + 1;
+        }
+        text[len - 1] = 'y';
+        text[len] = '\0';
+
+        char *path = write_temp(text, len);
+        citer_line_index_t *index = citer_line_index_build(path, 4);
+        assert(index && citer_line_index_count(index) == n);
+
+        /* Save and load it again. */
+        char index_path[80];
+        sprintf(index_path, "%s.lidx", path);
+        assert(citer_line_index_save(index, index_path));
+        citer_line_index_free(index);
+        index = citer_line_index_load(path, index_path);
+        assert(index && citer_line_index_count(index) == n);
+
+        iterator_t *it = citer_mmap_lines_indexed(path, index);
+        assert(citer_has_exact_size(it) && it->size_bound.upper == n);
+        check_line(citer_nth(it, 5000), text, starts[5000]);
+        check_line(citer_nth(it, 30000), text, starts[35001]);
+        check_line(citer_nth_back(it, 2), text, starts[n - 3]);
+        check_line(citer_next(it), text, starts[35002]);
+        assert(it->size_bound.upper == n - 3 - 35003);
+
+        /* Split the rest into 4 parts, and check that they cover it. */
+        size_t part = it->size_bound.upper / 4;
+        iterator_t *parts[4] = { it };
+        for (size_t k = 1; k < 4; k++)
+            parts[k] = citer_split_at(parts[k - 1], part);
+        size_t line = 35003;
+        for (size_t k = 0; k < 4; k++) {
+            assert(citer_has_exact_size(parts[k]));
+            if (k < 3)
+                assert(parts[k]->size_bound.upper == part);
+            citer_line_t *view;
+            while ((view = citer_next(parts[k])))
+                check_line(view, text, starts[line++]);
+        }
+        assert(line == n - 3);
+        for (size_t k = 0; k < 4; k++)
+            citer_free(parts[k]);
+
+        /* Skipping past the end from the back. */
+        it = citer_mmap_lines_indexed(path, index);
+        assert(citer_advance_back(it, n + 10) == n);
+        assert(citer_next(it) == NULL && it->size_bound.upper == 0);
+        citer_free(it);
+
+        /* Corrupt indexes are rejected: the first checkpoint moved, a
+         * checkpoint past the end of the file, checkpoints out of order, and
+         * a line count before the last checkpoint. */
+        {
+            /* After the magic, size, mtime (s and ns) and n_lines. */
+            long n_lines_at = 32;
+            long checkpoints_at = 48;
+            /* The line of the last checkpoint. */
+            uint64_t n_checkpoints, last_line;
+            assert(citer_line_index_save(index, index_path));
+            FILE *f = fopen(index_path, "rb");
+            fseek(f, checkpoints_at - 8, SEEK_SET);
+            assert(fread(&n_checkpoints, sizeof(n_checkpoints), 1, f) == 1);
+            fseek(f, checkpoints_at + 16 * (n_checkpoints - 1), SEEK_SET);
+            assert(fread(&last_line, sizeof(last_line), 1, f) == 1);
+            fclose(f);
+            struct { long at; uint64_t value; } corruptions[] = {
+                { checkpoints_at + 8, 1 },
+                { checkpoints_at + 16 + 8, len + 100 },
+                { checkpoints_at + 32, 1 },
+                { n_lines_at, last_line },
+            };
+            for (size_t c = 0; c < sizeof(corruptions) / sizeof(*corruptions); c++) {
+                assert(citer_line_index_save(index, index_path));
+                f = fopen(index_path, "r+b");
+                fseek(f, corruptions[c].at, SEEK_SET);
+                fwrite(&corruptions[c].value, sizeof(uint64_t), 1, f);
+                fclose(f);
+                errno = 0;
+                assert(citer_line_index_load(path, index_path) == NULL && errno == EINVAL);
+            }
+        }
+
+        /* Changing the file makes the index stale. */
+        FILE *f = fopen(path, "a");
+        fputs("more\n", f);
+        fclose(f);
+        assert(citer_line_index_load(path, index_path) == NULL);
+        assert(citer_mmap_lines_indexed(path, index) == NULL);
+        citer_line_index_free(index);
+
+        unlink(index_path);
+        unlink(path);
+        free(starts);
+        free(text);
+    }
+
+    /* Line counts which disagree with the file pass the checks on loading,
+     * but are caught when the file is mapped. */
+    {
+        char small[1000];
+        size_t small_len = 0;
+        for (int i = 0; i < 100; i++)
+            small_len += sprintf(small + small_len, "line %d\n", i);
+        char *path = write_temp(small, small_len);
+        char index_path[80];
+        sprintf(index_path, "%s.lidx", path);
+        citer_line_index_t *index = citer_line_index_build(path, 1);
+        uint64_t counts[] = { 600, 50, 100 };
+        for (size_t c = 0; c < sizeof(counts) / sizeof(*counts); c++) {
+            assert(citer_line_index_save(index, index_path));
+            FILE *f = fopen(index_path, "r+b");
+            fseek(f, 32, SEEK_SET);
+            fwrite(&counts[c], sizeof(uint64_t), 1, f);
+            fclose(f);
+            citer_line_index_t *loaded = citer_line_index_load(path, index_path);
+            assert(loaded);
+            errno = 0;
+            iterator_t *it = citer_mmap_lines_indexed(path, loaded);
+            if (counts[c] == 100) {
+                check_line(citer_nth(it, 99), small, small_len - strlen("line 99\n"));
+                citer_free(it);
+            } else {
+                assert(it == NULL && errno == EINVAL);
+            }
+            citer_line_index_free(loaded);
+        }
+        citer_line_index_free(index);
+        unlink(index_path);
+        unlink(path);
+    }
+
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <citer.h>
+
+struct trade {
+    uint32_t time;
+    uint32_t qty;
+};
+
+static size_t n_compares = 0;
+
+static int cmp_u32(void *item1, void *item2, void *extra_data) {
+    n_compares++;
+    uint32_t x = *(uint32_t *) item1;
+    uint32_t y = *(uint32_t *) item2;
+    return (x > y) - (x < y);
+}
+
+/* Compares a trade with a quote (a time), by time. */
+static int cmp_trade_time(void *item1, void *item2, void *extra_data) {
+    uint32_t x = ((struct trade *) item1)->time;
+    uint32_t y = *(uint32_t *) item2;
+    return (x > y) - (x < y);
+}
+
+static int cmp_trade(void *item1, void *item2, void *extra_data) {
+    uint32_t x = ((struct trade *) item1)->time;
+    uint32_t y = ((struct trade *) item2)->time;
+    return (x > y) - (x < y);
+}
+
+static void *identity(void *item, void *fn_data) {
+    return item;
+}
+
+/* Sorted array of N values in [0, max). */
+static uint32_t *sorted_values(size_t n, uint32_t max) {
+    uint32_t *values = malloc((n + 1) * sizeof(*values));
+    for (size_t i = 0; i < n; i++)
+        values[i] = rand() % max;
+    for (size_t i = 1; i < n; i++) {
+        uint32_t v = values[i];
+        size_t j = i;
+        for (; j > 0 && values[j - 1] > v; j--)
+            values[j] = values[j - 1];
+        values[j] = v;
+    }
+    return values;
+}
+
+/* Either a contiguous iterator, which is galloped over, or one which isn't. */
+static iterator_t *source(uint32_t *values, size_t n, bool direct) {
+    iterator_t *it = citer_over_array(values, sizeof(*values), n);
+    return direct ? it : citer_map(it, identity, NULL);
+}
+
+/*
+ * Check a set operation against the counts it should yield for each value, and
+ * its size bounds along the way.
+ */
+static void check_set_op(iterator_t *it, const uint32_t *a, size_t n_a, const uint32_t *b, size_t n_b, uint32_t max, int op) {
+    size_t *count_a = calloc(max, sizeof(*count_a));
+    size_t *count_b = calloc(max, sizeof(*count_b));
+    for (size_t i = 0; i < n_a; i++)
+        count_a[a[i]]++;
+    for (size_t i = 0; i < n_b; i++)
+        count_b[b[i]]++;
+    size_t remaining = 0;
+    for (uint32_t v = 0; v < max; v++) {
+        size_t m = count_a[v];
+        size_t n = count_b[v];
+        /* Union, intersection and difference. */
+        size_t expected = (op == 0) ? (m > n ? m : n) : (op == 1) ? (m < n ? m : n) : (m > n ? m - n : 0);
+        count_a[v] = expected;
+        remaining += expected;
+    }
+
+    int64_t last = -1;
+    uint32_t *item;
+    for (;;) {
+        assert(!it->size_bound.lower_infinite && it->size_bound.lower <= remaining);
+        assert(citer_le_upper(it->size_bound, remaining));
+        if (!(item = citer_next(it)))
+            break;
+        assert((int64_t) *item >= last);
+        last = *item;
+        assert(count_a[*item] > 0);
+        count_a[*item]--;
+        remaining--;
+    }
+    assert(remaining == 0);
+    assert(citer_has_exact_size(it) && it->size_bound.upper == 0);
+    free(count_a);
+    free(count_b);
+    citer_free(it);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    srand(5);
+
+    /* Set operations on iterators with duplicates, with and without
+     * galloping, and with one side empty. */
+    {
+        size_t sizes[][2] = { { 2000, 1500 }, { 50, 3000 }, { 3000, 50 }, { 0, 100 }, { 100, 0 } };
+        uint32_t max = 1000;
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+            size_t n_a = sizes[s][0];
+            size_t n_b = sizes[s][1];
+            uint32_t *a = sorted_values(n_a, max);
+            uint32_t *b = sorted_values(n_b, max);
+            for (int direct = 0; direct < 4; direct++) {
+                check_set_op(citer_sorted_union(source(a, n_a, direct & 1), source(b, n_b, direct & 2), cmp_u32, NULL), a, n_a, b, n_b, max, 0);
+                check_set_op(citer_sorted_intersect(source(a, n_a, direct & 1), source(b, n_b, direct & 2), cmp_u32, NULL), a, n_a, b, n_b, max, 1);
+                check_set_op(citer_sorted_difference(source(a, n_a, direct & 1), source(b, n_b, direct & 2), cmp_u32, NULL), a, n_a, b, n_b, max, 2);
+            }
+            free(a);
+            free(b);
+        }
+    }
+
+    /* Intersecting a few items with a large array is sublinear. */
+    {
+        size_t n_b = 1000000;
+        uint32_t *b = malloc(n_b * sizeof(*b));
+        for (size_t i = 0; i < n_b; i++)
+            b[i] = 2 * i;
+        uint32_t a[] = { 6, 1001, 40000, 1000000, 1999998, 2000001 };
+        size_t n_a = sizeof(a) / sizeof(*a);
+        n_compares = 0;
+        iterator_t *it = citer_sorted_intersect(citer_over_array(a, sizeof(*a), n_a), citer_over_array(b, sizeof(*b), n_b), cmp_u32, NULL);
+        uint32_t expected[] = { 6, 40000, 1000000, 1999998 };
+        for (size_t i = 0; i < 4; i++)
+            assert(*(uint32_t *) citer_next(it) == expected[i]);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+        assert(n_compares < 1000);
+
+        /* Without random access, every item is compared. */
+        n_compares = 0;
+        it = citer_sorted_intersect(citer_over_array(a, sizeof(*a), n_a), source(b, n_b, false), cmp_u32, NULL);
+        assert(citer_count(it) == 4);
+        citer_free(it);
+        assert(n_compares >= n_b / 2);
+        free(b);
+    }
+
+    /* Joins of trades with times, with runs on both sides. */
+    {
+        size_t n_trades = 3000;
+        size_t n_times = 800;
+        uint32_t max = 700;
+        uint32_t *trade_times = sorted_values(n_trades, max);
+        struct trade *trades = malloc(n_trades * sizeof(*trades));
+        for (size_t i = 0; i < n_trades; i++)
+            trades[i] = (struct trade) { trade_times[i], (uint32_t) i };
+        uint32_t *times = sorted_values(n_times, max);
+
+        size_t expected = 0;
+        for (size_t i = 0; i < n_trades; i++)
+            for (size_t j = 0; j < n_times; j++)
+                expected += trades[i].time == times[j];
+
+        for (int direct = 0; direct < 2; direct++) {
+            iterator_t *b = direct ? citer_over_array(times, sizeof(*times), n_times) : source(times, n_times, false);
+            iterator_t *it = citer_merge_join(citer_over_array(trades, sizeof(*trades), n_trades), b, cmp_trade_time, NULL);
+            assert(citer_le_upper(it->size_bound, expected));
+            size_t n = 0;
+            const struct trade *last_trade = NULL;
+            const uint32_t *last_time = NULL;
+            citer_pair_t *pair;
+            while ((pair = citer_next(it))) {
+                const struct trade *trade = pair->x;
+                const uint32_t *time = pair->y;
+                assert(trade->time == *time);
+                /* In the order of a, then of b. */
+                assert(!last_trade || last_trade < trade || (last_trade == trade && last_time < time));
+                last_trade = trade;
+                last_time = time;
+                n++;
+                assert(citer_le_upper(it->size_bound, expected - n) && it->size_bound.lower <= expected - n);
+            }
+            assert(n == expected);
+            citer_free(it);
+        }
+        free(trade_times);
+        free(trades);
+        free(times);
+    }
+
+    /* K-way merges of shards of trades, some of which are read directly and
+     * some of which are empty. The qty of each trade is its shard and index
+     * within the shard, to check that the merge is stable. */
+    {
+        size_t k = 100;
+        struct trade **shards = malloc(k * sizeof(*shards));
+        size_t *lens = malloc(k * sizeof(*lens));
+        iterator_t **its = malloc(k * sizeof(*its));
+        size_t total = 0;
+        for (size_t s = 0; s < k; s++) {
+            lens[s] = (s % 10 == 3) ? 0 : rand() % 500;
+            uint32_t *times = sorted_values(lens[s], 2000);
+            shards[s] = malloc((lens[s] + 1) * sizeof(**shards));
+            for (size_t i = 0; i < lens[s]; i++)
+                shards[s][i] = (struct trade) { times[i], (uint32_t) (s << 16 | i) };
+            free(times);
+            total += lens[s];
+        }
+        for (size_t s = 0; s < k; s++) {
+            its[s] = citer_over_array(shards[s], sizeof(**shards), lens[s]);
+            if (s % 3 == 0)
+                its[s] = citer_map(its[s], identity, NULL);
+        }
+        iterator_t *it = citer_merge_sorted(its, k, cmp_trade, NULL);
+        free(its);
+        assert(citer_has_exact_size(it) && it->size_bound.upper == total);
+        const struct trade *last = NULL;
+        struct trade *trade;
+        size_t n = 0;
+        while ((trade = citer_next(it))) {
+            assert(!last || last->time < trade->time || (last->time == trade->time && last->qty < trade->qty));
+            last = trade;
+            n++;
+            assert(citer_has_exact_size(it) && it->size_bound.upper == total - n);
+        }
+        assert(n == total);
+        citer_free(it);
+
+        /* One input, and none. */
+        it = citer_merge_sorted(&(iterator_t *) { citer_over_array(shards[0], sizeof(**shards), lens[0]) }, 1, cmp_trade, NULL);
+        assert(citer_count(it) == lens[0]);
+        citer_free(it);
+        it = citer_merge_sorted(NULL, 0, cmp_trade, NULL);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+
+        for (size_t s = 0; s < k; s++)
+            free(shards[s]);
+        free(shards);
+        free(lens);
+    }
+
+    return 0;
+}
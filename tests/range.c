@@ -0,0 +1,144 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <citer.h>
+
+static void check_i64(int64_t start, int64_t end, int64_t step, size_t expected_len) {
+    iterator_t *it = citer_range_i64(start, end, step);
+    assert(citer_has_exact_size(it) && it->size_bound.upper == expected_len);
+
+    int64_t *x;
+    size_t i = 0;
+    while ((x = citer_next(it))) {
+        assert(*x == start + ((int64_t) i * step));
+        i++;
+    }
+    assert(i == expected_len);
+    citer_free(it);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    /* Lengths, including empty ranges and steps which overshoot the end. */
+    check_i64(0, 10, 1, 10);
+    check_i64(0, 10, 3, 4);
+    check_i64(-5, 5, 5, 2);
+    check_i64(10, 0, -3, 4);
+    check_i64(10, 0, 1, 0);
+    check_i64(0, 10, -1, 0);
+    check_i64(7, 7, 1, 0);
+    assert(citer_range_i64(0, 10, 0) == NULL);
+    assert(citer_range_u64(0, 10, 0) == NULL);
+
+    /* Ranges spanning the whole 64-bit space. */
+    {
+        iterator_t *it = citer_range_i64(INT64_MIN, INT64_MAX, INT64_MAX);
+        assert(it->size_bound.upper == 3);
+        assert(*((int64_t *) citer_next(it)) == INT64_MIN);
+        assert(*((int64_t *) citer_next_back(it)) == INT64_MAX - 1);
+        assert(*((int64_t *) citer_next(it)) == -1);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+
+        it = citer_range_u64(0, UINT64_MAX, 1);
+        assert(*((uint64_t *) citer_nth(it, 1000000000000000000u)) == 1000000000000000000u);
+        assert(*((uint64_t *) citer_nth_back(it, 5)) == UINT64_MAX - 6);
+        citer_free(it);
+    }
+
+    /* O(1) skip, and both ends returning values at the same time. */
+    {
+        iterator_t *it = citer_skip(citer_range_i64(0, 4000000000000000000, 2), 1000000000000000000);
+        int64_t *front = citer_next(it);
+        int64_t *back = citer_next_back(it);
+        printf("Front: %lld, back: %lld\n", (long long) *front, (long long) *back);
+        assert(*front == 2000000000000000000);
+        assert(*back == 3999999999999999998);
+        citer_free(it);
+    }
+
+    /* Reverse and split. */
+    {
+        iterator_t *it = citer_range_i64(0, 100, 1);
+        iterator_t *back = citer_split_at(it, 40);
+        assert(it->size_bound.upper == 40 && back->size_bound.upper == 60);
+        assert(*((int64_t *) citer_next(back)) == 40);
+
+        back = citer_reverse(back);
+        assert(*((int64_t *) citer_next(back)) == 99);
+        assert(*((int64_t *) citer_nth(back, 9)) == 89);
+        assert(*((int64_t *) citer_next_back(back)) == 41);
+        assert(citer_count(back) == 47);
+        citer_free(back);
+
+        assert(*((int64_t *) citer_nth_back(it, 39)) == 0);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    /* Bulk fill, forwards and reversed. */
+    {
+        int64_t buf[16];
+        iterator_t *it = citer_range_i64(5, -20, -2);
+        citer_next(it);
+        assert(citer_range_fill(it, buf, 4) == 4);
+        assert(buf[0] == 3 && buf[1] == 1 && buf[2] == -1 && buf[3] == -3);
+        it = citer_reverse(it);
+        assert(citer_range_fill(it, buf, 16) == 8);
+        assert(buf[0] == -19 && buf[7] == -5);
+        assert(citer_range_fill(it, buf, 16) == 0);
+        citer_free(it);
+
+        it = citer_over_array(buf, sizeof(*buf), 16);
+        assert(citer_range_fill(it, buf, 16) == 0);
+        citer_free(it);
+    }
+
+    /* Used with enumerate, zip and take. */
+    {
+        iterator_t *it = citer_zip(
+            citer_enumerate(citer_range_u64(10, 100, 10)),
+            citer_take(citer_range_i64(-1, INT64_MIN, -1), 5)
+        );
+        assert(citer_has_exact_size(it) && it->size_bound.upper == 5);
+        citer_pair_t *pair;
+        size_t i = 0;
+        while ((pair = citer_next(it))) {
+            citer_enumerate_item_t *e = pair->x;
+            int64_t y = *((int64_t *) pair->y);
+            printf("Got: (%zu, %llu), %lld\n", e->index, (unsigned long long) *((uint64_t *) e->item), (long long) y);
+            assert(e->index == i);
+            assert(*((uint64_t *) e->item) == 10 * (i + 1));
+            assert(y == -1 - (int64_t) i);
+            i++;
+        }
+        assert(i == 5);
+        citer_free(it);
+    }
+
+    return 0;
+}
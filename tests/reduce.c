@@ -0,0 +1,168 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <citer.h>
+
+struct point {
+    char tag;
+    int32_t x;
+    double y;
+};
+
+static void *map_noop(void *item, void *fn_data) {
+    (void) fn_data; /* Mark unused. */
+    return item;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    /* Integer sums over contiguous and non-contiguous sources, for lengths
+     * which exercise both the vectorised loop and the tail. */
+    for (size_t len = 0; len < 1100; len += 37) {
+        int64_t *i64 = malloc(len * sizeof(*i64));
+        uint32_t *u32 = malloc(len * sizeof(*u32));
+        int32_t *i32 = malloc(len * sizeof(*i32));
+        int64_t expected_i = 0;
+        uint64_t expected_u = 0;
+        for (size_t i = 0; i < len; i++) {
+            i64[i] = (int64_t) i * 1000003 - 500000000;
+            i32[i] = (int32_t) i64[i];
+            u32[i] = 4000000000u - i;
+            expected_i += i64[i];
+            expected_u += u32[i];
+        }
+
+        iterator_t *it = citer_over_array(i64, sizeof(*i64), len);
+        assert(citer_sum_i64(it) == expected_i);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+
+        it = citer_map(citer_over_array(i64, sizeof(*i64), len), map_noop, NULL);
+        assert(citer_sum_i64(it) == expected_i);
+        citer_free(it);
+
+        it = citer_over_array(i32, sizeof(*i32), len);
+        assert(citer_sum_i32(it) == expected_i);
+        citer_free(it);
+
+        it = citer_reverse(citer_over_array(u32, sizeof(*u32), len));
+        assert(citer_sum_u32(it) == expected_u);
+        citer_free(it);
+
+        it = citer_over_array(u32, sizeof(*u32), len);
+        assert(citer_sum_u32(it) == expected_u);
+        citer_free(it);
+
+        free(i64);
+        free(i32);
+        free(u32);
+    }
+
+    /* Partially consumed source. */
+    {
+        uint64_t arr[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+        iterator_t *it = citer_over_array(arr, sizeof(*arr), 10);
+        citer_next(it);
+        citer_next_back(it);
+        assert(citer_sum_u64(it) == 44);
+        assert(it->size_bound.upper == 0);
+        citer_free(it);
+    }
+
+    /* Kahan summation keeps small items which naive summation would lose. */
+    {
+        size_t len = 10001;
+        double *arr = malloc(len * sizeof(*arr));
+        arr[0] = 1e16;
+        for (size_t i = 1; i < len; i++)
+            arr[i] = 1.0;
+
+        iterator_t *it = citer_over_array(arr, sizeof(*arr), len);
+        double sum = citer_sum_f64(it);
+        printf("Sum: %.1f\n", sum);
+        assert(sum == 1e16 + 10000.0);
+        citer_free(it);
+
+        it = citer_map(citer_over_array(arr, sizeof(*arr), len), map_noop, NULL);
+        assert(citer_sum_f64(it) == 1e16 + 10000.0);
+        citer_free(it);
+        free(arr);
+    }
+
+    /* Float sum. */
+    {
+        float arr[] = { 0.5f, 1.5f, 2.25f, -1.0f, 3.75f, 0.5f, 0.25f, 0.25f, 1.0f };
+        iterator_t *it = citer_over_array(arr, sizeof(*arr), sizeof(arr) / sizeof(*arr));
+        assert(citer_sum_f32(it) == 9.0);
+        citer_free(it);
+    }
+
+    /* Strided source over a field of an array of structs. */
+    {
+        struct point recs[600];
+        int64_t expected_x = 0;
+        double expected_y = 0.0;
+        for (size_t i = 0; i < 600; i++) {
+            recs[i].tag = 'a';
+            recs[i].x = (int32_t) i * 3 - 700;
+            recs[i].y = (double) i * 0.25;
+            expected_x += recs[i].x;
+            expected_y += recs[i].y;
+        }
+
+        iterator_t *it = citer_over_strided(recs, offsetof(struct point, x), sizeof(*recs), 600);
+        citer_next(it);
+        assert(citer_sum_i32(it) == expected_x - recs[0].x);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+
+        it = citer_over_strided(recs, offsetof(struct point, y), sizeof(*recs), 600);
+        assert(citer_sum_f64(it) == expected_y);
+        citer_free(it);
+    }
+
+    /* Products. */
+    {
+        int64_t arr[] = { 1, -2, 3, -4, 5, 6, 7, 8, 9, 10, 11 };
+        size_t len = sizeof(arr) / sizeof(*arr);
+        iterator_t *it = citer_over_array(arr, sizeof(*arr), len);
+        assert(citer_product_i64(it) == 39916800);
+        citer_free(it);
+
+        double darr[] = { 0.5, 4.0, 1.5, 2.0, -1.0, 1.0, 1.0, 1.0, 2.0 };
+        it = citer_over_array(darr, sizeof(*darr), sizeof(darr) / sizeof(*darr));
+        assert(citer_product_f64(it) == -12.0);
+        citer_free(it);
+
+        it = citer_empty();
+        assert(citer_product_u64(it) == 1);
+        citer_free(it);
+    }
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <citer.h>
+
+static void *map_noop(void *item, void *fn_data) {
+    (void) fn_data; /* Mark unused. */
+    return item;
+}
+
+struct sum_state {
+    long sum;
+};
+
+static void add_long(void *state, void *item) {
+    ((struct sum_state *) state)->sum += *((long *) item);
+}
+
+static void remove_long(void *state, void *item) {
+    ((struct sum_state *) state)->sum -= *((long *) item);
+}
+
+static bool close_enough(double x, double y) {
+    return fabs(x - y) <= 1e-9 * (1.0 + fabs(y));
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    size_t len = 200;
+    double *arr = malloc(len * sizeof(*arr));
+    for (size_t i = 0; i < len; i++)
+        arr[i] = (double) ((i * 7919) % 101) - 50.0 + 0.25 * (double) i;
+
+    iterator_t *(*constructors[])(iterator_t *, size_t) = {
+        citer_rolling_sum,
+        citer_rolling_mean,
+        citer_rolling_var,
+        citer_rolling_min,
+        citer_rolling_max,
+    };
+
+    for (size_t c = 0; c < 5; c++) {
+        for (size_t width = 1; width <= 17; width += 4) {
+            for (int contiguous = 0; contiguous < 2; contiguous++) {
+                iterator_t *src = citer_over_array(arr, sizeof(*arr), len);
+                if (!contiguous)
+                    src = citer_map(src, map_noop, NULL);
+                iterator_t *it = constructors[c](src, width);
+                assert(citer_has_exact_size(it) && it->size_bound.upper == len - width + 1);
+
+                for (size_t start = 0; start + width <= len; start++) {
+                    double *got = citer_next(it);
+                    assert(got);
+
+                    /* Compute the expected aggregate naively. */
+                    double sum = 0.0, min = arr[start], max = arr[start];
+                    for (size_t j = start; j < start + width; j++) {
+                        sum += arr[j];
+                        min = fmin(min, arr[j]);
+                        max = fmax(max, arr[j]);
+                    }
+                    double mean = sum / (double) width;
+                    double var = 0.0;
+                    for (size_t j = start; j < start + width; j++)
+                        var += (arr[j] - mean) * (arr[j] - mean);
+                    var = width > 1 ? var / (double) (width - 1) : 0.0;
+
+                    double expected[] = { sum, mean, var, min, max };
+                    assert(close_enough(*got, expected[c]));
+                }
+                assert(citer_next(it) == NULL);
+                assert(it->size_bound.upper == 0);
+                citer_free(it);
+            }
+        }
+    }
+
+    /* Window wider than the source. */
+    {
+        iterator_t *it = citer_rolling_max(citer_over_array(arr, sizeof(*arr), 3), 4);
+        assert(citer_has_exact_size(it) && it->size_bound.upper == 0);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    /* Generic rolling aggregation. */
+    {
+        long items[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        struct sum_state state = { 0 };
+        iterator_t *it = citer_rolling(citer_over_array(items, sizeof(*items), 8), 3, add_long, remove_long, &state);
+        struct sum_state *s;
+        long expected = 6;
+        while ((s = citer_next(it))) {
+            printf("Window sum: %ld\n", s->sum);
+            assert(s == &state && s->sum == expected);
+            expected += 3;
+        }
+        assert(expected == 24);
+        citer_free(it);
+    }
+
+    free(arr);
+    return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <citer.h>
+
+struct reading {
+    uint32_t sensor;
+    double value;
+};
+
+static int cmp_i64(void *item1, void *item2, void *extra_data) {
+    int64_t x = *(int64_t *) item1;
+    int64_t y = *(int64_t *) item2;
+    return (x > y) - (x < y);
+}
+
+static int qsort_cmp_i64(const void *a, const void *b) {
+    return cmp_i64((void *) a, (void *) b, NULL);
+}
+
+static void *identity(void *item, void *fn_data) {
+    return item;
+}
+
+/* Copies each number into the same buffer, like iterators which reuse their
+ * items. */
+static void *copy_to_buffer(void *item, void *fn_data) {
+    static int64_t buffer;
+    buffer = *(int64_t *) item;
+    return &buffer;
+}
+
+/* Fill an array with one of several patterns, including ones which are bad for
+ * naive quickselect. */
+static void fill(int64_t *values, size_t n, int pattern) {
+    for (size_t i = 0; i < n; i++) {
+        switch (pattern) {
+        case 0: values[i] = rand() % 1000000; break;
+        case 1: values[i] = rand() % 10; break;
+        case 2: values[i] = (int64_t) i; break;
+        case 3: values[i] = (int64_t) (n - i); break;
+        case 4: values[i] = 42; break;
+        default: values[i] = (int64_t) (i < n / 2 ? i : n - i); break;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    srand(13);
+    size_t n = 5000;
+    int64_t *values = malloc(n * sizeof(*values));
+    int64_t *sorted = malloc(n * sizeof(*sorted));
+    int64_t *top = malloc(n * sizeof(*top));
+
+    for (int pattern = 0; pattern < 6; pattern++) {
+        fill(values, n, pattern);
+        for (size_t i = 0; i < n; i++)
+            sorted[i] = values[i];
+        qsort(sorted, n, sizeof(*sorted), qsort_cmp_i64);
+
+        /* Selection of a spread of ranks, generic and typed. */
+        size_t ranks[] = { 0, 1, 17, n / 3, n / 2, n - 2, n - 1 };
+        for (size_t r = 0; r < sizeof(ranks) / sizeof(*ranks); r++) {
+            iterator_t *it = citer_over_array(values, sizeof(*values), n);
+            int64_t *item = citer_select_nth(it, ranks[r], cmp_i64, NULL);
+            assert(item && *item == sorted[ranks[r]]);
+            citer_free(it);
+
+            int64_t x;
+            it = citer_over_array(values, sizeof(*values), n);
+            assert(citer_select_nth_i64(it, ranks[r], &x) && x == sorted[ranks[r]]);
+            citer_free(it);
+            it = citer_map(citer_over_array(values, sizeof(*values), n), copy_to_buffer, NULL);
+            assert(citer_select_nth_i64(it, ranks[r], &x) && x == sorted[ranks[r]]);
+            citer_free(it);
+        }
+
+        /* Top K, for K smaller than, equal to and larger than the number of
+         * items. */
+        size_t ks[] = { 1, 10, 100, n, n + 10 };
+        for (size_t j = 0; j < sizeof(ks) / sizeof(*ks); j++) {
+            size_t k = ks[j];
+            size_t expected = k < n ? k : n;
+            iterator_t *it = citer_over_array(values, sizeof(*values), n);
+            size_t len;
+            void **items = citer_top_k(it, k, cmp_i64, NULL, &len);
+            assert(len == expected);
+            for (size_t i = 0; i < len; i++)
+                assert(*(int64_t *) items[i] == sorted[n - 1 - i]);
+            free(items);
+            citer_free(it);
+
+            int64_t *out = malloc((k + 1) * sizeof(*out));
+            it = citer_map(citer_over_array(values, sizeof(*values), n), copy_to_buffer, NULL);
+            assert(citer_top_k_i64(it, k, out) == expected);
+            for (size_t i = 0; i < expected; i++)
+                assert(out[i] == sorted[n - 1 - i]);
+            citer_free(it);
+            free(out);
+        }
+    }
+
+    /* Unsigned and floating-point fields of records, with NaNs last. */
+    {
+        size_t n_readings = 1000;
+        struct reading *readings = malloc(n_readings * sizeof(*readings));
+        for (size_t i = 0; i < n_readings; i++)
+            readings[i] = (struct reading) { (uint32_t) i, (i % 100 == 7) ? 0.0 / 0.0 : (double) (rand() % 2000) - 1000.5 };
+
+        double top_values[5];
+        iterator_t *it = citer_over_strided(readings, offsetof(struct reading, value), sizeof(*readings), n_readings);
+        assert(citer_top_k_f64(it, 5, top_values) == 5);
+        for (size_t i = 0; i < 5; i++)
+            assert(top_values[i] != top_values[i]);
+        citer_free(it);
+
+        double median;
+        it = citer_over_strided(readings, offsetof(struct reading, value), sizeof(*readings), n_readings);
+        assert(citer_select_nth_f64(it, n_readings / 2, &median));
+        citer_free(it);
+        size_t below = 0;
+        size_t above = 0;
+        for (size_t i = 0; i < n_readings; i++) {
+            below += readings[i].value < median;
+            above += readings[i].value > median || readings[i].value != readings[i].value;
+        }
+        assert(below <= n_readings / 2 && above <= n_readings - n_readings / 2 - 1);
+
+        uint64_t ids[1000];
+        for (size_t i = 0; i < n_readings; i++)
+            ids[i] = n_readings - 1 - i;
+        uint64_t largest[3];
+        it = citer_map(citer_over_array(ids, sizeof(*ids), n_readings), identity, NULL);
+        assert(citer_top_k_u64(it, 3, largest) == 3);
+        assert(largest[0] == 999 && largest[1] == 998 && largest[2] == 997);
+        citer_free(it);
+        free(readings);
+    }
+
+    /* Too few items, no items, and infinite iterators. */
+    {
+        int64_t x;
+        iterator_t *it = citer_over_array(values, sizeof(*values), 10);
+        assert(citer_select_nth(it, 10, cmp_i64, NULL) == NULL);
+        citer_free(it);
+        it = citer_empty();
+        assert(!citer_select_nth_i64(it, 0, &x));
+        size_t len = 1;
+        void **items = citer_top_k(it, 5, cmp_i64, NULL, &len);
+        assert(items && len == 0);
+        free(items);
+        citer_free(it);
+        it = citer_repeat(&x);
+        assert(citer_top_k(it, 5, cmp_i64, NULL, &len) == NULL);
+        assert(citer_top_k_i64(it, 5, top) == 0);
+        citer_free(it);
+    }
+
+    free(values);
+    free(sorted);
+    free(top);
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * CIter - C library for lazily-evaluated iterators.
+ * Copyright (C) 2024  Kian Kasad <kian@kasad.com>
+ *
+ * This file is part of CIter.
+ *
+ * CIter is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software
+ * Foundation, version 3 of the License.
+ *
+ * CIter is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with CIter. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <citer.h>
+
+struct entry {
+    uint32_t key;
+    uint32_t pos;
+};
+
+static int cmp_key(void *item1, void *item2, void *extra_data) {
+    uint32_t x = ((struct entry *) item1)->key;
+    uint32_t y = ((struct entry *) item2)->key;
+    return (x > y) - (x < y);
+}
+
+static bool even_pos(void *item, void *extra_data) {
+    return ((struct entry *) item)->pos % 2 == 0;
+}
+
+static uint64_t key_u64(void *item, void *fn_data) {
+    return ((struct entry *) item)->key;
+}
+
+/* Keys centred on zero, so half are negative. */
+static int64_t key_i64(void *item, void *fn_data) {
+    return (int64_t) ((struct entry *) item)->key - 25000;
+}
+
+static double key_f64(void *item, void *fn_data) {
+    return *(double *) item;
+}
+
+/* Check that an iterator yields entries sorted by key, with equal keys in
+ * their original order. */
+static void check_sorted(iterator_t *it, size_t n) {
+    assert(it != NULL);
+    assert(citer_has_exact_size(it) && it->size_bound.upper == n);
+    assert(citer_is_double_ended(it) && citer_is_splittable(it));
+    const struct entry *last = NULL;
+    struct entry *entry;
+    size_t count = 0;
+    while ((entry = citer_next(it))) {
+        assert(!last || last->key < entry->key || (last->key == entry->key && last->pos < entry->pos));
+        last = entry;
+        count++;
+    }
+    assert(count == n);
+    citer_free(it);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    size_t n = 300000;
+    struct entry *entries = malloc(n * sizeof(*entries));
+    srand(17);
+    for (size_t i = 0; i < n; i++)
+        entries[i] = (struct entry) { (uint32_t) (rand() % 50000), (uint32_t) i };
+
+    /* Small, odd-sized and large inputs, on one or more threads. */
+    {
+        size_t sizes[] = { 0, 1, 31, 33, 1000, n };
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); s++)
+            check_sorted(citer_sorted(citer_over_array(entries, sizeof(*entries), sizes[s]), cmp_key, NULL), sizes[s]);
+        size_t threads[] = { 1, 2, 3, 4, 7 };
+        for (size_t t = 0; t < sizeof(threads) / sizeof(*threads); t++) {
+            iterator_t *it = citer_over_array(entries, sizeof(*entries), n);
+            check_sorted(citer_par_sorted(it, cmp_key, NULL, threads[t]), n);
+        }
+
+        /* Without an exact size to pre-size from. */
+        iterator_t *it = citer_filter(citer_over_array(entries, sizeof(*entries), n), even_pos, NULL);
+        check_sorted(citer_sorted(it, cmp_key, NULL), n / 2);
+    }
+
+    /* Reversing, skipping and splitting need no extra work. */
+    {
+        size_t m = 5000;
+        iterator_t *it = citer_sorted(citer_over_array(entries, sizeof(*entries), m), cmp_key, NULL);
+        struct entry *first = citer_next(it);
+        struct entry *last = citer_next_back(it);
+        assert(first->key <= last->key);
+        struct entry *mid = citer_nth(it, 100);
+        assert(mid && mid->key >= first->key && it->size_bound.upper == m - 2 - 101);
+        struct entry *back = citer_nth_back(it, 10);
+        assert(back && back->key <= last->key && it->size_bound.upper == m - 2 - 101 - 11);
+
+        /* Split off the second half, then free the first half before
+         * reading the second. */
+        size_t left = it->size_bound.upper;
+        iterator_t *rest = citer_split_at(it, left / 2);
+        assert(it->size_bound.upper == left / 2 && rest->size_bound.upper == left - left / 2);
+        struct entry *end_of_first = citer_next_back(it);
+        uint32_t boundary = end_of_first->key;
+        citer_free(it);
+        struct entry *entry;
+        while ((entry = citer_next(rest)))
+            assert(entry->key >= boundary);
+        citer_free(rest);
+
+        /* The largest three, via citer_reverse() and citer_take(). */
+        it = citer_take(citer_reverse(citer_sorted(citer_over_array(entries, sizeof(*entries), m), cmp_key, NULL)), 3);
+        uint32_t max_key = 0;
+        for (size_t i = 0; i < m; i++)
+            max_key = (entries[i].key > max_key) ? entries[i].key : max_key;
+        entry = citer_next(it);
+        assert(entry->key == max_key);
+        assert(citer_count(it) == 2);
+        citer_free(it);
+    }
+
+    /* Radix sorts, with 8- and 11-bit digits. Keys under 2^16 need only the
+     * low digits. */
+    {
+        size_t sizes[] = { 0, 1, 1000, n };
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+            iterator_t *it = citer_over_array(entries, sizeof(*entries), sizes[s]);
+            check_sorted(citer_sorted_by_key_u64(it, key_u64, NULL), sizes[s]);
+            it = citer_over_array(entries, sizeof(*entries), sizes[s]);
+            check_sorted(citer_sorted_by_key_i64(it, key_i64, NULL), sizes[s]);
+        }
+
+        /* Large keys need every digit. */
+        for (size_t i = 0; i < 1000; i++)
+            entries[i].key = (uint32_t) rand() * 2654435761u;
+        check_sorted(citer_sorted_by_key_u64(citer_over_array(entries, sizeof(*entries), 1000), key_u64, NULL), 1000);
+    }
+
+    /* Doubles, including infinities, zeros of both signs and NaNs. */
+    {
+        double values[] = { 2.5, -0.0, NAN, -INFINITY, 1e-300, 0.0, -2.5, INFINITY, -1e300, -NAN, 2.5, -1e-300 };
+        double expected[] = { -INFINITY, -1e300, -2.5, -1e-300, 0.0, 0.0, 1e-300, 2.5, 2.5, INFINITY };
+        size_t len = sizeof(values) / sizeof(*values);
+        iterator_t *it = citer_sorted_by_key_f64(citer_over_array(values, sizeof(*values), len), key_f64, NULL);
+        assert(it->size_bound.upper == len);
+        double *sorted[sizeof(values) / sizeof(*values)];
+        for (size_t i = 0; i < len; i++)
+            sorted[i] = citer_next(it);
+        for (size_t i = 0; i < sizeof(expected) / sizeof(*expected); i++)
+            assert(*sorted[i] == expected[i]);
+        /* Equal zeros, 2.5s and NaNs stay in their order. */
+        assert(sorted[4] == &values[1] && sorted[5] == &values[5]);
+        assert(sorted[7] == &values[0] && sorted[8] == &values[10]);
+        assert(sorted[10] == &values[2] && sorted[11] == &values[9]);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+    }
+
+    /* Infinite iterators can't be sorted. */
+    {
+        iterator_t *it = citer_repeat(entries);
+        assert(citer_sorted(it, cmp_key, NULL) == NULL);
+        assert(citer_sorted_by_key_u64(it, key_u64, NULL) == NULL);
+        citer_free(it);
+    }
+
+    free(entries);
+    return 0;
+}
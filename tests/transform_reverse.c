@@ -17,12 +17,19 @@
  */
 
 #include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <citer.h>
 
+struct pair {
+    int a;
+    long b;
+};
+
 static void *map_deref(void *item, void *fn_data) {
     (void) fn_data; /* Mark unused. */
     return (void *) *((void **) item);
@@ -96,6 +103,78 @@ start_chunked:;
         }
     }
 
+    /* Chunks reverse, over contiguous and non-contiguous sources */
+    {
+        unsigned long items[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        size_t len = sizeof(items) / sizeof(*items);
+        size_t chunksize = 3;
+
+        for (int contiguous = 0; contiguous < 2; contiguous++) {
+            iterator_t *src = citer_over_array(items, sizeof(*items), len);
+            if (!contiguous)
+                src = citer_map(src, map_deref, NULL);
+            iterator_t *it = citer_reverse(citer_chunks(src, chunksize));
+            assert(citer_has_exact_size(it) && it->size_bound.upper == 3);
+
+            /* Expected chunks from the back: [7, 8], [4, 5, 6], [1, 2, 3]. */
+            size_t starts[] = { 6, 3, 0 };
+            size_t lens[] = { 2, 3, 3 };
+            for (size_t i = 0; i < 3; i++) {
+                citer_slice_t *chunk = (citer_slice_t *) citer_next(it);
+                assert(chunk->len == lens[i]);
+                assert(chunk->indirect == !contiguous);
+                printf("Got: [");
+                for (size_t j = 0; j < chunk->len; j++) {
+                    void *item = citer_slice_get(chunk, j);
+                    unsigned long x = contiguous ? *((unsigned long *) item) : (unsigned long) item;
+                    printf("%lu%s", x, j == chunk->len - 1 ? "" : ", ");
+                    assert(x == items[starts[i] + j]);
+                }
+                printf("]\n");
+            }
+            assert(citer_next(it) == NULL);
+            assert(citer_next_back(it) == NULL);
+            citer_free(it);
+        }
+        printf("\n");
+    }
+
+    /* Windows from both ends, over contiguous and non-contiguous sources */
+    {
+        unsigned long items[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+        for (size_t len = 0; len <= 11; len++) {
+            for (size_t width = 1; width <= 5; width++) {
+                for (int contiguous = 0; contiguous < 2; contiguous++) {
+                    iterator_t *src = citer_over_array(items, sizeof(*items), len);
+                    if (!contiguous)
+                        src = citer_map(src, map_deref, NULL);
+                    iterator_t *it = citer_windows(src, width);
+                    size_t n_windows = len >= width ? len - width + 1 : 0;
+                    assert(citer_has_exact_size(it) && it->size_bound.upper == n_windows);
+
+                    /* Alternate between both ends in an irregular pattern. */
+                    size_t lo = 0, hi = n_windows;
+                    for (size_t k = 0; lo < hi; k++) {
+                        bool back = (k % 3) == 1 || (k % 5) == 4;
+                        citer_slice_t *win = (citer_slice_t *) (back ? citer_next_back(it) : citer_next(it));
+                        size_t start = back ? --hi : lo++;
+                        assert(win && win->len == width);
+                        for (size_t j = 0; j < width; j++) {
+                            void *item = citer_slice_get(win, j);
+                            unsigned long x = contiguous ? *((unsigned long *) item) : (unsigned long) item;
+                            assert(x == items[start + j]);
+                        }
+                        assert(it->size_bound.upper == hi - lo);
+                    }
+                    assert(citer_next(it) == NULL);
+                    assert(citer_next_back(it) == NULL);
+                    citer_free(it);
+                }
+            }
+        }
+    }
+
     /* Take reverse */
     {
         unsigned long items[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
@@ -149,5 +228,127 @@ start_chunked:;
         citer_free(it);
     }
 
+    /* Zip N reverse, over contiguous and non-contiguous sources */
+    puts("Zip N reverse:");
+    {
+        unsigned long a[] = { 1, 2, 3, 4, 5, 6 };
+        unsigned long b[] = { 10, 20, 30, 40, 50 };
+        unsigned long c[] = { 100, 200, 300, 400, 500, 600, 700 };
+
+        for (int contiguous = 0; contiguous < 2; contiguous++) {
+            iterator_t *its[] = {
+                citer_over_array(a, sizeof(*a), 6),
+                citer_over_array(b, sizeof(*b), 5),
+                citer_over_array(c, sizeof(*c), 7),
+            };
+            if (!contiguous)
+                its[1] = citer_map(its[1], map_deref, NULL);
+            iterator_t *it = citer_reverse(citer_zip_n(its, 3));
+            assert(citer_has_exact_size(it) && it->size_bound.upper == 5);
+
+            for (size_t i = 5; i > 0; i--) {
+                citer_tuple_t *t = (citer_tuple_t *) citer_next(it);
+                assert(t->len == 3);
+                unsigned long y = contiguous ? *((unsigned long *) t->items[1]) : (unsigned long) t->items[1];
+                printf("Got: (%lu, %lu, %lu)\n", *((unsigned long *) t->items[0]), y, *((unsigned long *) t->items[2]));
+                assert(t->items[0] == &a[i - 1]);
+                assert(y == b[i - 1]);
+                assert(t->items[2] == &c[i - 1]);
+            }
+            assert(citer_next(it) == NULL);
+            citer_free(it);
+        }
+    }
+
+    /* Zip arrays split */
+    {
+        int xs[] = { 1, 2, 3, 4, 5, 6, 7 };
+        double ys[] = { 0.5, 1.5, 2.5, 3.5, 4.5, 5.5, 6.5 };
+        void *bases[] = { xs, ys };
+        size_t itemsizes[] = { sizeof(*xs), sizeof(*ys) };
+
+        iterator_t *front = citer_zip_arrays(bases, itemsizes, 2, 7);
+        citer_next(front);
+        iterator_t *back = citer_split_at(front, 3);
+        assert(back && citer_has_exact_size(back) && back->size_bound.upper == 3);
+        assert(citer_has_exact_size(front) && front->size_bound.upper == 3);
+
+        citer_tuple_t *t = citer_next_back(front);
+        assert(t->items[0] == &xs[3] && t->items[1] == &ys[3]);
+        t = citer_next(back);
+        assert(t->items[0] == &xs[4] && t->items[1] == &ys[4]);
+        t = citer_next_back(back);
+        assert(t->items[0] == &xs[6] && t->items[1] == &ys[6]);
+        assert(citer_count(front) == 2);
+        citer_free(front);
+        citer_free(back);
+    }
+
+    /* Columns reverse with projection, and raw column access */
+    {
+        int ids[] = { 1, 2, 3, 4, 5 };
+        char tags[] = { 'a', 'b', 'c', 'd', 'e' };
+        double vals[] = { 0.5, 1.5, 2.5, 3.5, 4.5 };
+        citer_column_t cols[] = {
+            { ids, sizeof(*ids) },
+            { tags, sizeof(*tags) },
+            { vals, sizeof(*vals) },
+        };
+        size_t projection[] = { 2, 0 };
+
+        iterator_t *it = citer_over_columns(cols, 3, 5, projection, 2);
+        assert(citer_has_exact_size(it) && it->size_bound.upper == 5);
+        citer_next(it);
+
+        void *array;
+        size_t itemsize, len;
+        assert(citer_as_column(it, 0, &array, &itemsize, &len));
+        assert(array == &vals[1] && itemsize == sizeof(*vals) && len == 4);
+        assert(!citer_as_column(it, 2, &array, &itemsize, &len));
+        iterator_t *col = citer_over_array(array, itemsize, len);
+        assert(citer_sum_f64(col) == 12.0);
+        citer_free(col);
+
+        it = citer_reverse(it);
+        assert(!citer_as_column(it, 0, &array, &itemsize, &len));
+        for (size_t i = 5; i > 1; i--) {
+            citer_tuple_t *row = citer_next(it);
+            assert(row->len == 2);
+            assert(row->items[0] == &vals[i - 1] && row->items[1] == &ids[i - 1]);
+        }
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+
+        assert(citer_over_columns(cols, 3, 5, projection, 0) == NULL);
+        assert(citer_over_columns(cols, 0, 5, NULL, 0) == NULL);
+        size_t bad_projection[] = { 2, 3 };
+        assert(citer_over_columns(cols, 3, 5, bad_projection, 2) == NULL);
+    }
+
+    /* Strided reverse and split */
+    {
+        struct pair recs[] = { { 1, 10 }, { 2, 20 }, { 3, 30 }, { 4, 40 }, { 5, 50 } };
+        iterator_t *it = citer_over_strided(recs, offsetof(struct pair, b), sizeof(*recs), 5);
+        assert(citer_has_exact_size(it) && citer_is_splittable(it));
+        iterator_t *back = citer_split_at(it, 2);
+        assert(citer_has_exact_size(back) && back->size_bound.upper == 3);
+
+        void *first;
+        size_t stride, len;
+        assert(citer_as_strided(back, &first, &stride, &len));
+        assert(first == &recs[2].b && stride == sizeof(*recs) && len == 3);
+        assert(!citer_as_array(back, &first, &stride, &len));
+
+        back = citer_reverse(back);
+        for (size_t i = 5; i > 2; i--)
+            assert(citer_next(back) == &recs[i - 1].b);
+        assert(citer_next(back) == NULL);
+        assert(citer_next_back(it) == &recs[1].b);
+        assert(citer_next(it) == &recs[0].b);
+        assert(citer_next(it) == NULL);
+        citer_free(it);
+        citer_free(back);
+    }
+
     return 0;
 }